@@ -0,0 +1,65 @@
+#include "allocation.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::uint64_t> g_count{0};
+std::atomic<std::uint64_t> g_bytes{0};
+
+void*
+countedAlloc(std::size_t size)
+{
+    g_count.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(size, std::memory_order_relaxed);
+    // malloc(0) 可能返回 nullptr
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+// 替换全局 operator new / delete, nothrow 版本的默认实现会调用这里的版本
+// 对齐版本 (align_val_t) 不替换, 不计入统计
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace YLineServer::Bench {
+
+std::uint64_t
+allocationCount()
+{
+    return g_count.load(std::memory_order_relaxed);
+}
+
+std::uint64_t
+allocationBytes()
+{
+    return g_bytes.load(std::memory_order_relaxed);
+}
+
+AllocationCounter::AllocationCounter(benchmark::State& state)
+    : m_state(state), m_count(allocationCount()), m_bytes(allocationBytes())
+{
+}
+
+AllocationCounter::~AllocationCounter()
+{
+    m_state.counters["allocs"] = benchmark::Counter(
+        static_cast<double>(allocationCount() - m_count), benchmark::Counter::kAvgIterations
+    );
+    m_state.counters["alloc_bytes"] = benchmark::Counter(
+        static_cast<double>(allocationBytes() - m_bytes), benchmark::Counter::kAvgIterations, benchmark::Counter::kIs1024
+    );
+}
+
+} // namespace YLineServer::Bench
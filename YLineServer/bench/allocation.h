@@ -0,0 +1,34 @@
+#ifndef YLINESERVER_BENCH_ALLOCATION_H
+#define YLINESERVER_BENCH_ALLOCATION_H
+
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+namespace YLineServer::Bench {
+
+// 进程启动以来 operator new 的调用次数和申请的字节数, 由 allocation.cpp 中替换的全局 operator new 累加
+std::uint64_t allocationCount();
+std::uint64_t allocationBytes();
+
+/*
+统计计时循环中的内存分配, 在 for (auto _ : state) 之前构造, 析构时写入计数器
+allocs / alloc_bytes 为每次迭代的平均值; 统计是全局的, 只适用于单线程基准
+*/
+class AllocationCounter {
+public:
+    explicit AllocationCounter(benchmark::State& state);
+    ~AllocationCounter();
+
+    AllocationCounter(const AllocationCounter&) = delete;
+    AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+private:
+    benchmark::State& m_state;
+    std::uint64_t m_count;
+    std::uint64_t m_bytes;
+};
+
+} // namespace YLineServer::Bench
+
+#endif // YLINESERVER_BENCH_ALLOCATION_H
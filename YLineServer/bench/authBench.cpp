@@ -0,0 +1,52 @@
+#include <string>
+
+#include <benchmark/benchmark.h>
+#include <json/value.h>
+
+#include "allocation.h"
+#include "utils/jwt.h"
+#include "utils/passwd.h"
+
+using namespace YLineServer;
+
+namespace {
+
+// 每个需要登录的请求都会解码一次 JWT, 密钥在 main.cpp 中设置
+void
+BM_DecodeAuthJwt(benchmark::State& state)
+{
+    const std::string token = Jwt::generateAuthJwt(42, "bench", false);
+
+    Bench::AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        Json::Value payload;
+        std::string err;
+        const bool ok = Jwt::decodeAuthJwt(token, payload, err);
+        if (!ok)
+        {
+            state.SkipWithError(err.c_str());
+            break;
+        }
+        benchmark::DoNotOptimize(payload);
+    }
+}
+
+// 登录和创建用户时哈希一次密码
+void
+BM_HashPassword(benchmark::State& state)
+{
+    const std::string salt = Passwd::generateSalt();
+    const std::string password = "correct horse battery staple";
+
+    Bench::AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(Passwd::hashPassword(password, salt));
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_DecodeAuthJwt);
+BENCHMARK(BM_HashPassword);
@@ -0,0 +1,45 @@
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <json/value.h>
+
+#include "allocation.h"
+#include "fixtures.h"
+#include "scheduler/dag.h"
+
+using namespace YLineServer;
+
+namespace {
+
+void
+BM_ResolveTasks(benchmark::State& state, Bench::Shape shape)
+{
+    const auto taskCount = static_cast<int>(state.range(0));
+    const Json::Value job = Bench::makeJob(taskCount, shape);
+    const bool dependency = shape != Bench::Shape::Flat;
+
+    Bench::AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        std::string err;
+        std::vector<Components::Task> tasks;
+        const bool ok = Scheduler::resolveTasks(job, err, tasks, dependency);
+        if (!ok)
+        {
+            state.SkipWithError(err.c_str());
+            break;
+        }
+        benchmark::DoNotOptimize(tasks.data());
+    }
+    state.SetItemsProcessed(state.iterations() * taskCount);
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_ResolveTasks, flat, Bench::Shape::Flat)
+    ->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_ResolveTasks, chain, Bench::Shape::Chain)
+    ->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_ResolveTasks, layered, Bench::Shape::Layered)
+    ->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,69 @@
+#include "fixtures.h"
+
+#include <string>
+
+namespace YLineServer::Bench {
+
+constexpr int LAYER_WIDTH = 100;
+
+Json::Value
+makeJob(int taskCount, Shape shape)
+{
+    Json::Value job;
+    job["job_name"] = "bench";
+    job["submit_user"] = "bench";
+    Json::Value& tasks = job["tasks"];
+    tasks.resize(taskCount);
+    for (int i = 0; i < taskCount; ++i)
+    {
+        Json::Value& task = tasks[i];
+        task["task_id"] = "t" + std::to_string(i);
+        task["name"] = "task " + std::to_string(i);
+        task["payload"]["command"] = "render --frame " + std::to_string(i);
+
+        if (shape == Shape::Flat)
+        {
+            continue;
+        }
+        Json::Value& dependency = task["dependency"];
+        dependency = Json::arrayValue;
+        if (shape == Shape::Chain)
+        {
+            if (i > 0)
+            {
+                dependency.append("t" + std::to_string(i - 1));
+            }
+            continue;
+        }
+        const int layerStart = i - i % LAYER_WIDTH;
+        if (layerStart > 0)
+        {
+            const int offset = i % LAYER_WIDTH;
+            dependency.append("t" + std::to_string(layerStart - LAYER_WIDTH + offset));
+            dependency.append("t" + std::to_string(layerStart - LAYER_WIDTH + (offset + 1) % LAYER_WIDTH));
+        }
+    }
+    return job;
+}
+
+YLineWorker::UsageSample
+makeUsageSample(std::size_t gpuCount)
+{
+    YLineWorker::UsageSample sample;
+    sample.time = std::chrono::system_clock::now();
+    sample.cpuUsage = 37.5;
+    sample.memoryUsage = 62.25;
+    for (std::size_t i = 0; i < gpuCount; ++i)
+    {
+        YLineWorker::GpuUsageSample gpu;
+        gpu.index = static_cast<unsigned int>(i);
+        gpu.usage.gpuUsage = 98.0;
+        gpu.usage.gpuMemoryUsed = 21.5;
+        gpu.usage.gpuTemperature = 71.0;
+        gpu.usage.gpuPowerUsage = 320.5;
+        sample.gpus.push_back(gpu);
+    }
+    return sample;
+}
+
+} // namespace YLineServer::Bench
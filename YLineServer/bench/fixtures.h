@@ -0,0 +1,24 @@
+#ifndef YLINESERVER_BENCH_FIXTURES_H
+#define YLINESERVER_BENCH_FIXTURES_H
+
+#include <cstddef>
+
+#include <json/value.h>
+
+#include "usageSampler.h"
+
+// 基准测试共用的输入数据
+namespace YLineServer::Bench {
+
+// DAG 的形状: 无依赖, 单链, 分层 (每层 100 个任务, 每个任务依赖上一层的 2 个任务)
+enum class Shape { Flat, Chain, Layered };
+
+// 函数: 生成有 taskCount 个任务的作业提交请求
+Json::Value makeJob(int taskCount, Shape shape);
+
+// 函数: 生成有 gpuCount 块 GPU 的使用率样本
+YLineWorker::UsageSample makeUsageSample(std::size_t gpuCount);
+
+} // namespace YLineServer::Bench
+
+#endif // YLINESERVER_BENCH_FIXTURES_H
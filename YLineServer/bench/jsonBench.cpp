@@ -0,0 +1,59 @@
+#include <cstdint>
+#include <string>
+
+#include <benchmark/benchmark.h>
+#include <json/value.h>
+#include <json/writer.h>
+
+#include "allocation.h"
+#include "fixtures.h"
+#include "utils/api.h"
+#include "workerMessages.h"
+
+using namespace YLineServer;
+
+namespace {
+
+std::string
+compact(const Json::Value& json)
+{
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "";
+    return Json::writeString(writer, json);
+}
+
+void
+BM_ParseJson(benchmark::State& state, const std::string& input)
+{
+    Bench::AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        Json::Value json;
+        std::string errs;
+        const bool ok = Api::parseJson(input, json, errs);
+        benchmark::DoNotOptimize(ok);
+        benchmark::DoNotOptimize(json);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(input.size()));
+}
+
+// 工作机每秒发送的使用率消息, 2 块 GPU
+void
+BM_ParseJson_Usage(benchmark::State& state)
+{
+    static const std::string input = compact(YLineWorker::makeUsageJson(Bench::makeUsageSample(2)));
+    BM_ParseJson(state, input);
+}
+
+// 有 state.range(0) 个分层依赖任务的作业提交请求
+void
+BM_ParseJson_Job(benchmark::State& state)
+{
+    const std::string input = compact(Bench::makeJob(static_cast<int>(state.range(0)), Bench::Shape::Layered));
+    BM_ParseJson(state, input);
+}
+
+} // namespace
+
+BENCHMARK(BM_ParseJson_Usage);
+BENCHMARK(BM_ParseJson_Job)->Arg(1'000)->Arg(100'000)->Unit(benchmark::kMicrosecond);
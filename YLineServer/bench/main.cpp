@@ -0,0 +1,37 @@
+/*
+YLineMicroBench: 服务器和工作机热路径上的辅助函数的微基准测试
+
+构建: cmake -DYLINE_BUILD_BENCHMARKS=ON, 使用 Release 构建, Debug 构建的数字没有意义
+
+优化前后对比:
+    YLineMicroBench --benchmark_repetitions=10 --benchmark_out=before.json --benchmark_out_format=json
+    (修改代码, 重新构建)
+    YLineMicroBench --benchmark_repetitions=10 --benchmark_out=after.json --benchmark_out_format=json
+    python3 <benchmark>/tools/compare.py benchmarks before.json after.json
+只运行部分基准: --benchmark_filter=ResolveTasks
+*/
+#include <benchmark/benchmark.h>
+#include <spdlog/spdlog.h>
+
+#include "utils/server.h"
+
+int main(int argc, char** argv)
+{
+    // 解析任务时的 debug 日志不计入
+    spdlog::set_level(spdlog::level::warn);
+
+    // Jwt 从服务器配置中读取密钥
+    YLineServer::Config config{};
+    config.jwt_secret = "YLineMicroBench-secret";
+    config.jwt_expire = false;
+    YLineServer::ServerSingleton::getInstance().setConfigData(config);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include <string>
+
+#include <benchmark/benchmark.h>
+#include <json/value.h>
+
+#include "allocation.h"
+#include "fixtures.h"
+#include "controllers/YLineServer_WorkerCtrl.h"
+#include "utils/decode.h"
+#include "workerMessages.h"
+
+using namespace YLineServer;
+
+namespace {
+
+// 工作机端: WorkerSingleton::getUsageJson 由最新的样本构建使用率消息, 这里直接构建, 不需要采样线程
+void
+BM_MakeUsageJson(benchmark::State& state)
+{
+    const auto sample = Bench::makeUsageSample(static_cast<std::size_t>(state.range(0)));
+
+    Bench::AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(YLineWorker::makeUsageJson(sample));
+    }
+}
+
+// 服务器端: writeUsage2redis 中解码使用率上报的部分
+void
+BM_DecodeUsage(benchmark::State& state)
+{
+    const Json::Value usage = YLineWorker::makeUsageJson(Bench::makeUsageSample(static_cast<std::size_t>(state.range(0))));
+
+    Bench::AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(Decode::decodeUsage(usage));
+    }
+}
+
+// 服务器端: writeUsage2redis 中构建 Redis 指令的部分
+void
+BM_BuildUsageRedisCommands(benchmark::State& state)
+{
+    const Json::Value usage = YLineWorker::makeUsageJson(Bench::makeUsageSample(static_cast<std::size_t>(state.range(0))));
+    const Decode::UsageReport report = Decode::decodeUsage(usage);
+    const std::string workerUUID = "0f8fad5b-d9cb-469f-a165-70867728950e";
+    const std::string workerIP = "192.168.1.23";
+
+    Bench::AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(WorkerCtrl::buildUsageRedisCommands(usage, report, workerUUID, workerIP));
+    }
+}
+
+} // namespace
+
+// 参数为 GPU 数量
+BENCHMARK(BM_MakeUsageJson)->Arg(0)->Arg(2)->Arg(8);
+BENCHMARK(BM_DecodeUsage)->Arg(0)->Arg(2)->Arg(8);
+BENCHMARK(BM_BuildUsageRedisCommands)->Arg(0)->Arg(2)->Arg(8);
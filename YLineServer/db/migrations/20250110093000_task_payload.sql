@@ -0,0 +1,6 @@
+-- migrate:up
+-- 任务执行信息, 由工作机解析, 例如 {"cmd": ["blender", "-b", "scene.blend", "-f", "1"], "cwd": "...", "env": {...}}
+ALTER TABLE tasks ADD COLUMN payload JSONB NOT NULL DEFAULT '{}';
+
+-- migrate:down
+ALTER TABLE tasks DROP COLUMN IF EXISTS payload;
@@ -0,0 +1,7 @@
+-- migrate:up
+-- 任务最新的检查点, 由工作机上传到产物存储后报告, 例如 {"key": "checkpoints/42/7/<worker>.<ts>", "ts": 1737360000000, "size": 1024, "worker": "..."}
+-- 任务重新入队时随分发消息发送给工作机, 从检查点恢复
+ALTER TABLE tasks ADD COLUMN checkpoint JSONB;
+
+-- migrate:down
+ALTER TABLE tasks DROP COLUMN IF EXISTS checkpoint;
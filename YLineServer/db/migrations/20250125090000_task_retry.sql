@@ -0,0 +1,19 @@
+-- migrate:up transaction:false
+-- ALTER TYPE ... ADD VALUE 不能在事务中执行
+-- 用完重试次数的任务被隔离, 状态改回 pending 后重新提交作业即可再次执行
+ALTER TYPE exec_status ADD VALUE IF NOT EXISTS 'quarantined';
+
+-- 作业的重试策略, 例如 {"max_attempts": 5, "backoff_base": 30, "backoff_max": 900}, 为空时使用服务器配置
+ALTER TABLE jobs ADD COLUMN IF NOT EXISTS retry_policy JSONB;
+
+-- 已经失败的次数和最后一次失败的原因
+ALTER TABLE tasks ADD COLUMN IF NOT EXISTS attempts INT NOT NULL DEFAULT 0;
+ALTER TABLE tasks ADD COLUMN IF NOT EXISTS last_error TEXT;
+
+-- migrate:down
+-- PostgreSQL 不能删除枚举值, 隔离的任务改为 failed
+UPDATE tasks SET status = 'failed' WHERE status = 'quarantined';
+UPDATE jobs SET status = 'failed' WHERE status = 'quarantined';
+ALTER TABLE tasks DROP COLUMN IF EXISTS last_error;
+ALTER TABLE tasks DROP COLUMN IF EXISTS attempts;
+ALTER TABLE jobs DROP COLUMN IF EXISTS retry_policy;
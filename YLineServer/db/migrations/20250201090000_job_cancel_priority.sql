@@ -0,0 +1,13 @@
+-- migrate:up transaction:false
+-- ALTER TYPE ... ADD VALUE 不能在事务中执行
+-- 取消的作业和它尚未完成的任务, 重新提交作业后恢复为 pending
+ALTER TYPE exec_status ADD VALUE IF NOT EXISTS 'cancelled';
+
+-- 作业优先级 0-100, 作为 AMQP 消息优先级; 不低于服务器 preempt_priority 的作业可以抢占优先级更低的任务
+ALTER TABLE jobs ADD COLUMN IF NOT EXISTS priority SMALLINT NOT NULL DEFAULT 0;
+
+-- migrate:down
+-- PostgreSQL 不能删除枚举值, 取消的任务改回 pending
+UPDATE tasks SET status = 'pending' WHERE status = 'cancelled';
+UPDATE jobs SET status = 'pending' WHERE status = 'cancelled';
+ALTER TABLE jobs DROP COLUMN IF EXISTS priority;
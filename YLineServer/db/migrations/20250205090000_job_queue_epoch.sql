@@ -0,0 +1,7 @@
+-- migrate:up
+-- 作业的排队代数, 每次重新提交已取消的作业时加一
+-- 任务消息带有发布时的代数, 消费者丢弃代数更旧的消息, 取消前留在队列中的任务不会和重新发布的副本重复执行
+ALTER TABLE jobs ADD COLUMN IF NOT EXISTS queue_epoch INT NOT NULL DEFAULT 0;
+
+-- migrate:down
+ALTER TABLE jobs DROP COLUMN IF EXISTS queue_epoch;
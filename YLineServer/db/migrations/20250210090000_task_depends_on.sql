@@ -0,0 +1,12 @@
+-- migrate:up
+-- 任务依赖的 task_id 数组, 依赖全部完成后任务才会发布到队列
+-- 此前提交的有依赖的任务没有记录依赖关系, 视为没有依赖, 重新提交作业后直接执行
+ALTER TABLE tasks ADD COLUMN IF NOT EXISTS depends_on JSONB NOT NULL DEFAULT '[]'::jsonb;
+
+-- 任务最后一次发布时作业的排队代数, 为空表示还没有发布过
+-- 认领发布时比较代数, 多个依赖同时完成也只会发布一次, 重新提交作业后代数变化, 可以再次发布
+ALTER TABLE tasks ADD COLUMN IF NOT EXISTS queued_epoch INT;
+
+-- migrate:down
+ALTER TABLE tasks DROP COLUMN IF EXISTS queued_epoch;
+ALTER TABLE tasks DROP COLUMN IF EXISTS depends_on;
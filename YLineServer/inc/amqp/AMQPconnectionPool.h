@@ -1,6 +1,7 @@
 #ifndef YLINESERVER_AMQP_CONNECTION_POOL_H
 #define YLINESERVER_AMQP_CONNECTION_POOL_H
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -68,6 +69,12 @@ public:
     std::unique_ptr<AMQP::Channel>
     make_channel();
 
+    // 在连接所属的 EventLoop 上创建临时 Channel 并执行 func, 可以在任意线程调用
+    // AMQP-CPP 不是线程安全的, 跨线程发布消息时应使用该函数而不是 make_channel
+    // func 返回发布的消息数; Channel 处于 publisher confirm 模式, broker 的确认计入连接的指标
+    void
+    runWithChannel(std::function<std::size_t(AMQP::Channel &)> && func);
+
     bool
     ready() const;
 
@@ -12,6 +12,8 @@
 
 #include <entt/signal/sigh.hpp>
 
+#include "UTmetrics.h"
+
 namespace YLineServer{
 
 class TrantorHandler
@@ -71,24 +73,50 @@ public:
         return _amqpConnection.get();
     }
 
+    inline trantor::EventLoop *
+    getLoop() const
+    {
+        return m_loop;
+    }
+
     inline entt::sigh<void()> &
     getRecoonectSignal()
     {
         return m_onReconnect;
     }
 
+    // 连接的指标, 以连接名为标签
+    struct HandlerMetrics
+    {
+        YSolowork::util::Counter * publishes;   // 发布的消息
+        YSolowork::util::Counter * confirms;    // broker 确认 (publisher confirm ack) 的消息
+        YSolowork::util::Counter * nacks;       // broker 拒绝的消息
+        YSolowork::util::Counter * sentBytes;   // 写入 TCP 连接的字节数
+        YSolowork::util::Counter * ready;       // 连接 (重新) 就绪的次数
+    };
+
+    inline const HandlerMetrics &
+    metrics() const
+    {
+        return m_metrics;
+    }
+
 private:
     std::shared_ptr<trantor::TcpClient> m_tcpClient;
     std::unique_ptr<AMQP::Connection> _amqpConnection;
     std::string m_name;
     trantor::EventLoop * m_loop;
     entt::sigh<void()> m_onReconnect;
+    HandlerMetrics m_metrics;
 
     explicit inline
     TrantorHandler(
         const std::string & name,
         trantor::EventLoop * loop
-    ) : m_name(name), m_loop(loop) {};
+    ) : m_name(name), m_loop(loop), m_metrics(makeHandlerMetrics(name)) {};
+
+    static HandlerMetrics
+    makeHandlerMetrics(const std::string & name);
 
     void
     setConnection(
@@ -0,0 +1,120 @@
+#ifndef YLINESERVER_CLUSTER_MEMBERSHIP_H
+#define YLINESERVER_CLUSTER_MEMBERSHIP_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <trantor/net/EventLoop.h>
+
+namespace drogon::nosql
+{
+class RedisSubscriber;
+}
+
+namespace YLineServer::Cluster
+{
+
+// 集群成员, 即一个 YLineServer 实例
+struct Member
+{
+    std::string instance_uuid;
+    std::string address; // host:port, 用于重定向工作机
+};
+
+// 函数: rendezvous (HRW) 哈希权重, 所有实例对同一 key 得到相同结果
+std::uint64_t rendezvousScore(std::string_view instance_uuid, std::string_view key) noexcept;
+
+// 函数: 在成员中选出 key 的所有者, 成员为空时返回 nullopt
+std::optional<Member> rendezvousOwner(const std::vector<Member> & members, std::string_view key);
+
+/*
+集群成员注册表, 所有实例共享同一个 Redis
+
+Redis 布局:
+    ZSET ServerInstances          member = instance_uuid, score = 最近一次心跳的 unix 时间 (秒)
+    HASH ServerInstanceAddress    field  = instance_uuid, value = advertise address
+
+每个实例定时写入自己的心跳, 并读取心跳未过期的实例作为当前成员列表
+工作机和任务通过 rendezvous 哈希分配到实例, 成员变化时只有被移动的 key 会受影响
+*/
+class Membership
+{
+public:
+    explicit
+    Membership(
+        const std::string & self_uuid,
+        const std::string & advertise_address,
+        const double heartbeat_interval,
+        const int member_ttl
+    );
+
+    // 在指定的 EventLoop 上启动心跳定时器
+    void
+    start(trantor::EventLoop * loop);
+
+    // 成员列表快照
+    std::vector<Member>
+    members() const;
+
+    // key 的所有者, 成员列表尚未同步时视为本实例
+    Member
+    ownerOf(std::string_view key) const;
+
+    // 本实例是否为 key 的所有者
+    bool
+    isOwner(std::string_view key) const;
+
+    inline const Member &
+    self() const { return m_self; }
+
+    // 成员列表变化时的回调, 在心跳所在的 EventLoop 上调用
+    inline void
+    setMembershipChangedCallback(std::function<void()> && callback)
+    {
+        m_onMembershipChanged = std::move(callback);
+    }
+
+    // 其他实例的广播, 回调在 Redis 客户端的线程上调用, 需要在 start 之前设置
+    using BroadcastCallback = std::function<void(const std::string & message)>;
+
+    inline void
+    setBroadcastCallback(const std::string & channel, BroadcastCallback && callback)
+    {
+        m_broadcastCallbacks[channel] = std::move(callback);
+    }
+
+    // 通过 Redis 发布订阅向所有实例 (包括本实例) 广播, 不保证送达, 接收方需要是幂等的
+    void
+    broadcast(const std::string & channel, const std::string & message) const;
+
+private:
+    Member m_self;
+    double m_heartbeatInterval;
+    int m_memberTTL;
+
+    mutable std::shared_mutex m_mutex;
+    std::vector<Member> m_members; // 按 instance_uuid 排序
+
+    std::function<void()> m_onMembershipChanged;
+
+    std::unordered_map<std::string, BroadcastCallback> m_broadcastCallbacks;
+    std::shared_ptr<drogon::nosql::RedisSubscriber> m_subscriber;
+
+    // 写入本实例心跳并刷新成员列表
+    void
+    heartbeat();
+
+    void
+    updateMembers(std::vector<Member> && members);
+};
+
+} // namespace YLineServer::Cluster
+
+#endif // YLINESERVER_CLUSTER_MEMBERSHIP_H
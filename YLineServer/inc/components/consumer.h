@@ -4,18 +4,111 @@
 #include "utils/config.h"
 #include "AMQP/AMQPconnectionPool.h"
 
+#include <boost/uuid/uuid.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
 namespace Queue
 {
     const std::string default_queue = "default";
+
+    // 重新发布消息时附带的重投递信息
+    namespace Headers
+    {
+        const std::string redelivery_count = "x-yline-redelivery-count"; // 被回收重投的次数
+        const std::string reclaimed_from = "x-yline-reclaimed-from";     // 上一次执行该任务的工作机
+        const std::string reclaim_reason = "x-yline-reclaim-reason";
+        const std::string reclaimed_at = "x-yline-reclaimed-at";         // unix 时间 (秒)
+        const std::string attempt = "x-yline-attempt";                   // 已经失败的次数
+        const std::string last_error = "x-yline-last-error";             // 上一次失败的原因
+        const std::string failed_on = "x-yline-failed-on";               // 上一次失败的工作机
+    }
+
+    // 失败重试的延迟队列, 没有消费者, 消息过期后由默认交换机死信回原队列
+    // 每个等待时间一个队列 (队列级 TTL), 避免不同 TTL 的消息在同一个队列中互相阻塞
+    inline std::string
+    retry_queue(const std::string & queue, std::uint32_t seconds) { return std::format("{}.retry.{}s", queue, seconds); }
+
+    // 用完重试次数的任务, 没有消费者, 留给人工检查后重新提交
+    inline std::string
+    quarantine_queue(const std::string & queue) { return queue + ".quarantine"; }
 }
 
 namespace YLineServer::Components
 {
+
+// 已投递但尚未确认的消息, 回收时用于重新发布
+struct InFlightDelivery
+{
+    std::string exchange;
+    std::string routingKey;
+    std::string body;
+    AMQP::Table headers;
+    std::uint8_t priority = 0;
+    bool redelivered = false;
+    std::int64_t job_id = 0;
+    std::string task_id;
+    std::chrono::steady_clock::time_point dispatchedAt; // 抢占时优先选择最后分发的任务
+    bool preempting = false;                            // 已经发送了抢占命令, 等待工作机结束
+    bool started = false;                               // 工作机已经开始执行; 之前是 lookahead 预取, 在工作机上排队
+};
+
+// 工作机报告中的投递身份
+// delivery tag 只在所属 Channel 内唯一, Channel 重建或工作机重新注册后从 1 开始重新编号
+// 所以同时比较 Channel 的代数 (随分发消息发送, 工作机在报告中原样带回) 和任务
+struct DeliveryRef
+{
+    std::uint64_t delivery_tag = 0;
+    std::uint64_t generation = 0;
+    std::int64_t job_id = 0;
+    std::string task_id;
+};
+
+// 重新发布后等待 broker 确认的原消息, 只属于当前 Channel
+// Channel 处于 publisher confirm 模式, 新消息被确认后才确认原消息; 在此之前断开时原消息由 broker 重新入队, 任务不会丢失
+struct PendingConfirms
+{
+    std::uint64_t published = 0;                        // 已发布的消息数量, 即最后一条消息的确认序号
+    std::map<std::uint64_t, std::uint64_t> originals;   // 确认序号 -> 原消息的 delivery tag
+    std::shared_ptr<AMQP::Channel> retired;             // 消费者移除后由这里持有 Channel, 确认完成后关闭
+};
+
+// basic.consume 的状态, 跨 Channel 重建保留是否暂停
+struct ConsumeState
+{
+    std::string consumerTag;    // broker 确认开始消费后才知道
+    bool consuming = false;     // 当前 Channel 已经发送了 basic.consume
+    bool paused = false;
+};
+
+// 结构体: 任务失败后的处理结果
+struct FailureDecision
+{
+    bool found = false;             // 投递仍然未确认
+    bool quarantined = false;       // 用完重试次数, 已隔离
+    std::uint32_t attempt = 0;      // 包括本次在内已经失败的次数
+    std::uint32_t max_attempts = 0;
+    std::uint32_t delay = 0;        // 重新入队前等待的秒数
+};
+
 struct Consumer
 {
+    // slots 为工作机的并发槽位数, lookahead 为额外预取的任务数, 工作机在前面的任务运行时提前准备它们的输入
+    // broker 最多同时投递 prefetch = slots + lookahead 个未确认的消息
     explicit inline
-    Consumer(const std::string & queueName = Queue::default_queue)
-        :m_queueName(queueName), m_onReconnect(dummy_signal)
+    Consumer(
+        const boost::uuids::uuid & workerUUID,
+        const std::uint16_t slots = 1,
+        const std::uint16_t lookahead = 0,
+        const std::string & queueName = Queue::default_queue
+    )
+        :m_workerUUID(workerUUID), m_slots(slots), m_prefetch(slots + lookahead), m_queueName(queueName), m_onReconnect(dummy_signal)
     {
         createChannel();
     }
@@ -23,17 +116,96 @@ struct Consumer
     void // 重建 Channel 的函数
     rebuildChannel();
 
+    // 以下函数需要在消费者 I/O 线程上调用
+
+    // 以下三个函数在投递不属于当前 Channel (代数不同), 或者任务与投递不符时拒绝执行
+
+    void // 确认消息
+    ack(const DeliveryRef & ref);
+
+    void // 拒绝消息, requeue 为 true 时重新入队
+    reject(const DeliveryRef & ref, bool requeue);
+
+    std::size_t // 回收所有未确认的消息: 附带重投递信息重新发布到原队列, broker 确认后再确认原消息, 返回回收数量
+    reclaimInFlight(const std::string & fromWorker, const std::string & reason);
+
+    FailureDecision // 任务失败: 按重试策略延迟重新入队, 或者用完次数后隔离, broker 确认后再确认原消息
+    fail(const DeliveryRef & ref, const std::string & failedOn, const std::string & error);
+
+    void // 移除消费者之前调用: 不再重建 Channel, 重新发布的消息都得到确认后才关闭 Channel
+    retire();
+
+    void // 暂停消费: 取消 basic.consume, 保留 Channel 和已投递未确认的消息, 工作机仍然可以报告它们的结果
+    pause();
+
+    void // 恢复消费, Channel 重建后仍然保持暂停
+    resume();
+
+    inline bool // 已暂停消费
+    paused() const { return m_consume->paused; }
+
+    inline std::uint64_t // 当前 Channel 的代数, 所有消费者的 Channel 共用一个递增的计数
+    generation() const { return m_generation; }
+
+    inline std::size_t // 未确认的消息数量
+    inFlightCount() const { return m_inFlight ? m_inFlight->size() : 0; }
+
+    inline const std::unordered_map<std::uint64_t, InFlightDelivery> & // 未确认的消息
+    inFlight() const { return *m_inFlight; }
+
+    bool // 投递属于当前 Channel, 仍未确认, 并且任务相符; 用于校验工作机的日志和检查点, 不记录日志
+    holds(const DeliveryRef & ref) const;
+
+    void // 工作机报告任务已经开始执行
+    markStarted(const DeliveryRef & ref);
+
+    inline bool // 标记为正在被抢占, 已经标记过时返回 false
+    markPreempting(std::uint64_t deliveryTag)
+    {
+        const auto it = m_inFlight->find(deliveryTag);
+        if (it == m_inFlight->end() || it->second.preempting)
+        {
+            return false;
+        }
+        it->second.preempting = true;
+        return true;
+    }
+
+    inline std::uint16_t // 预取数量
+    prefetch() const { return m_prefetch; }
+
+    inline std::uint16_t // 并发槽位数, 不包括 lookahead
+    slots() const { return m_slots; }
+
+    inline const boost::uuids::uuid & // 所属工作机
+    workerUUID() const { return m_workerUUID; }
+
     friend Components::Consumer // 创建消费者
     make_Consumer(const AMQPConnectionPool& pool, const std::string & queueName);
 private:
     std::unique_ptr<AMQP::Channel> m_channel;
     std::shared_ptr<int> lifecycleHelper;
+    boost::uuids::uuid m_workerUUID;
+    std::uint16_t m_slots;
+    std::uint16_t m_prefetch;
     std::string m_queueName;
+    std::uint64_t m_generation = 0;
+    // deliveryTag -> 消息, 只属于当前 Channel, 重建 Channel 时 broker 会自动重新入队
+    std::shared_ptr<std::unordered_map<std::uint64_t, InFlightDelivery>> m_inFlight;
+    std::shared_ptr<PendingConfirms> m_confirms;
+    std::shared_ptr<ConsumeState> m_consume = std::make_shared<ConsumeState>();
     entt::sigh<void()> dummy_signal;
     entt::sink<entt::sigh<void()>> m_onReconnect;
 
     void // 创建 Channel 的函数
     createChannel();
+
+    void // 在当前 Channel 上开始消费
+    startConsuming();
+
+    // 查找报告对应的投递, 不属于当前 Channel 或任务不符时返回 end()
+    std::unordered_map<std::uint64_t, InFlightDelivery>::iterator
+    findDelivery(const DeliveryRef & ref, const char * action);
 };
 
 } // namespace YLineServer::Components
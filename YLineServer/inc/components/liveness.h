@@ -0,0 +1,102 @@
+#ifndef YLineServer_Componets_LIVENESS_H
+#define YLineServer_Componets_LIVENESS_H
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+#include <trantor/net/EventLoop.h>
+
+namespace YLineServer::Components
+{
+
+/*
+工作机存活追踪, 时间轮 (timer wheel) 扫描
+
+在线工作机: 任何消息都视为心跳, 超过 heartbeat_timeout 未收到则触发超时回调 (断开连接), 并转为离线
+离线工作机: 超过 reclaim_grace 仍未重连则触发死亡回调 (回收任务, 销毁实体)
+
+心跳只更新时间戳, 不移动时间轮中的条目; 条目到期时如果截止时间已被推后, 再重新放入对应的槽
+每个工作机在时间轮中只有一个有效条目, 状态变化时通过 generation 使旧条目失效
+*/
+class LivenessTracker
+{
+public:
+    using Callback = std::function<void(const boost::uuids::uuid&)>;
+
+    LivenessTracker(double heartbeat_timeout, double reclaim_grace, double tick_interval = 1.0);
+
+    // 在指定的 EventLoop 上启动时间轮, 回调也在该 EventLoop 上调用
+    void
+    start(trantor::EventLoop * loop);
+
+    // 工作机注册或重连, 置为在线
+    void
+    track(const boost::uuids::uuid& worker_uuid);
+
+    // 收到工作机消息
+    void
+    heartbeat(const boost::uuids::uuid& worker_uuid);
+
+    // 工作机连接断开, 开始回收宽限期
+    void
+    markOffline(const boost::uuids::uuid& worker_uuid);
+
+    // 停止追踪
+    void
+    untrack(const boost::uuids::uuid& worker_uuid);
+
+    inline void
+    setHeartbeatTimeoutCallback(Callback && callback) { m_onHeartbeatTimeout = std::move(callback); }
+
+    inline void
+    setDeadCallback(Callback && callback) { m_onDead = std::move(callback); }
+
+private:
+    struct UuidHash {
+        std::size_t operator()(const boost::uuids::uuid& uuid) const noexcept;
+    };
+
+    struct Entry
+    {
+        bool online = true;
+        std::uint64_t lastSeen = 0;     // tick
+        std::uint64_t offlineSince = 0; // tick
+        std::uint64_t generation = 0;
+    };
+
+    using Slot = std::vector<std::pair<boost::uuids::uuid, std::uint64_t>>; // (worker_uuid, generation)
+
+    double m_tickInterval;
+    std::uint64_t m_heartbeatTimeoutTicks;
+    std::uint64_t m_reclaimGraceTicks;
+
+    std::mutex m_mutex;
+    std::unordered_map<boost::uuids::uuid, Entry, UuidHash> m_entries;
+    std::vector<Slot> m_wheel;
+    std::uint64_t m_currentTick = 0;
+    std::uint64_t m_nextGeneration = 0;
+
+    Callback m_onHeartbeatTimeout;
+    Callback m_onDead;
+
+    // 截止时间 (调用者持有锁)
+    std::uint64_t
+    deadlineOf(const Entry& entry) const;
+
+    // 放入截止时间对应的槽 (调用者持有锁)
+    void
+    schedule(const boost::uuids::uuid& worker_uuid, const Entry& entry);
+
+    // 推进一格并处理到期条目
+    void
+    tick();
+};
+
+} // namespace YLineServer::Components
+
+#endif // YLineServer_Componets_LIVENESS_H
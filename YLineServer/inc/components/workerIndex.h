@@ -0,0 +1,170 @@
+#ifndef YLineServer_Componets_WORKER_INDEX_H
+#define YLineServer_Componets_WORKER_INDEX_H
+
+#include <array>
+#include <functional>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+#include <entt/entt.hpp>
+#include <json/value.h>
+#include "drogon/WebSocketConnection.h"
+
+namespace YLineServer::Components
+{
+
+using EnTTidType = entt::registry::entity_type;
+
+// 工作机索引条目
+struct WorkerIndexEntry
+{
+    EnTTidType entity = entt::null;
+    drogon::WebSocketConnectionPtr wsConnPtr;
+    boost::uuids::uuid server_instance_uuid{};
+    bool online = false;
+    std::vector<std::string> capabilities;
+};
+
+// 函数: 从注册信息中提取工作机能力标签, 如 "CPU", "GPU", "NVIDIA", "os:Linux"
+std::vector<std::string> workerCapabilities(const Json::Value& workerInfo);
+
+/*
+工作机分片索引, 替代对 Components::Worker view 的线性扫描
+
+主索引:   worker_uuid -> WorkerIndexEntry
+连接索引: WebSocketConnectionPtr -> worker_uuid
+二级索引: capability / online / server_instance_uuid -> worker_uuid 集合
+
+每个分片一把读写锁, 工作机按 uuid 哈希到分片, 重连风暴时不同工作机基本不会争用同一把锁
+所有查询都是同步的 O(1) (二级索引查询需要合并所有分片)
+*/
+class WorkerIndex
+{
+public:
+    static constexpr std::size_t ShardCount = 16;
+
+    // 插入或覆盖工作机, 覆盖时会同步更新所有二级索引
+    void
+    upsert(const boost::uuids::uuid& worker_uuid, WorkerIndexEntry entry);
+
+    std::optional<WorkerIndexEntry>
+    find(const boost::uuids::uuid& worker_uuid) const;
+
+    std::optional<boost::uuids::uuid>
+    findByConnection(const drogon::WebSocketConnectionPtr& wsConnPtr) const;
+
+    // 移除工作机, 返回被移除的条目
+    std::optional<WorkerIndexEntry>
+    erase(const boost::uuids::uuid& worker_uuid);
+
+    // 仅当工作机离线时移除, 与 rebindConnection 互斥, 用于回收时避免误删刚重连的工作机
+    std::optional<WorkerIndexEntry>
+    eraseIfOffline(const boost::uuids::uuid& worker_uuid);
+
+    // 更新在线状态, 工作机不存在时返回 false
+    bool
+    setOnline(const boost::uuids::uuid& worker_uuid, bool online);
+
+    // 更新连接并置为在线 (重连), 工作机不存在时返回 false
+    bool
+    rebindConnection(const boost::uuids::uuid& worker_uuid, const drogon::WebSocketConnectionPtr& wsConnPtr);
+
+    // ---------------- 二级索引 ----------------
+
+    std::vector<boost::uuids::uuid>
+    findByCapability(const std::string& capability) const;
+
+    std::vector<boost::uuids::uuid>
+    findByOnline(bool online) const;
+
+    std::vector<boost::uuids::uuid>
+    findByServerInstance(const boost::uuids::uuid& server_instance_uuid) const;
+
+    std::size_t
+    size() const;
+
+    // 遍历所有工作机, 持有分片读锁, 回调中不要再访问索引
+    template <typename Func>
+    void
+    forEach(Func && func) const
+    {
+        for (const auto& shard : m_shards)
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            for (const auto& [worker_uuid, entry] : shard.workers)
+            {
+                func(worker_uuid, entry);
+            }
+        }
+    }
+
+private:
+    struct UuidHash {
+        std::size_t operator()(const boost::uuids::uuid& uuid) const noexcept;
+    };
+
+    using UuidSet = std::unordered_set<boost::uuids::uuid, UuidHash>;
+
+    struct Shard
+    {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<boost::uuids::uuid, WorkerIndexEntry, UuidHash> workers;
+        std::unordered_map<std::string, UuidSet> byCapability;
+        std::array<UuidSet, 2> byOnline; // [0] 离线, [1] 在线
+        std::unordered_map<boost::uuids::uuid, UuidSet, UuidHash> byServerInstance;
+    };
+
+    struct ConnShard
+    {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<drogon::WebSocketConnectionPtr, boost::uuids::uuid> connToWorker;
+    };
+
+    std::array<Shard, ShardCount> m_shards;
+    std::array<ConnShard, ShardCount> m_connShards;
+
+    Shard&
+    shardOf(const boost::uuids::uuid& worker_uuid);
+
+    const Shard&
+    shardOf(const boost::uuids::uuid& worker_uuid) const;
+
+    ConnShard&
+    connShardOf(const drogon::WebSocketConnectionPtr& wsConnPtr);
+
+    const ConnShard&
+    connShardOf(const drogon::WebSocketConnectionPtr& wsConnPtr) const;
+
+    std::optional<WorkerIndexEntry>
+    eraseIf(const boost::uuids::uuid& worker_uuid, const std::function<bool(const WorkerIndexEntry&)>& predicate);
+
+    // 从二级索引中移除 (调用者持有分片写锁)
+    static void
+    unindex(Shard& shard, const boost::uuids::uuid& worker_uuid, const WorkerIndexEntry& entry);
+
+    // 加入二级索引 (调用者持有分片写锁)
+    static void
+    index(Shard& shard, const boost::uuids::uuid& worker_uuid, const WorkerIndexEntry& entry);
+
+    template <typename Func>
+    std::vector<boost::uuids::uuid>
+    collect(Func && func) const
+    {
+        std::vector<boost::uuids::uuid> result;
+        for (const auto& shard : m_shards)
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            func(shard, result);
+        }
+        return result;
+    }
+};
+
+} // namespace YLineServer::Components
+
+#endif // YLineServer_Componets_WORKER_INDEX_H
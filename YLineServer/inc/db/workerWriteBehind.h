@@ -0,0 +1,106 @@
+#ifndef YLINESERVER_DB_WORKER_WRITE_BEHIND_H
+#define YLINESERVER_DB_WORKER_WRITE_BEHIND_H
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <drogon/utils/coroutine.h>
+#include <json/value.h>
+#include <trantor/net/EventLoop.h>
+
+namespace YLineServer::DB {
+
+// 工作机 upsert 的一行
+struct WorkerUpsert
+{
+    std::string worker_uuid;
+    std::string server_instance_uuid;
+    int worker_entt_id;
+    std::string worker_info; // 已序列化的 JSON
+};
+
+// upsert 结果
+struct WorkerUpsertResult
+{
+    int id;
+    bool inserted; // true: 新插入, false: 更新已有行
+};
+
+// 函数: 紧凑序列化 JSON, 每个线程复用同一个 StreamWriterBuilder
+std::string writeCompactJson(const Json::Value& json);
+
+/*
+工作机注册写缓冲 (write-behind)
+
+重连风暴时大量工作机同时注册, 逐行写入会占满数据库连接池
+提交的 upsert 先进入缓冲区, 在 batch_delay 内到达的行合并为一条多行
+INSERT ... ON CONFLICT (worker_uuid) DO UPDATE ... RETURNING 语句
+每个提交者仍然单独得到自己那一行的结果
+
+同一批次中同一工作机的多次提交只写入最后一次, 所有提交者得到同一个结果
+(Postgres 不允许一条 ON CONFLICT DO UPDATE 语句多次修改同一行)
+*/
+class WorkerWriteBehind
+{
+public:
+    using ResultCallback = std::function<void(const WorkerUpsertResult&)>;
+    using ErrorCallback = std::function<void(const std::exception_ptr&)>;
+
+    WorkerWriteBehind(double batch_delay, std::size_t batch_size);
+
+    // 在指定的 EventLoop 上执行合并和写入
+    void
+    start(trantor::EventLoop * loop);
+
+    // 提交一行, 可以在任意线程调用, 回调在数据库客户端的线程上调用
+    void
+    submit(WorkerUpsert&& row, ResultCallback&& onResult, ErrorCallback&& onError);
+
+    // 协程接口, 结果在调用者所在的 EventLoop 上返回, 失败时抛出 std::runtime_error
+    drogon::Task<WorkerUpsertResult>
+    upsertCoro(WorkerUpsert row);
+
+private:
+    struct Pending
+    {
+        WorkerUpsert row;
+        std::vector<std::pair<ResultCallback, ErrorCallback>> callbacks;
+    };
+
+    struct UpsertAwaiter : public drogon::CallbackAwaiter<WorkerUpsertResult>
+    {
+        UpsertAwaiter(WorkerWriteBehind& buffer, WorkerUpsert&& row)
+            : m_buffer(buffer), m_row(std::move(row))
+        {
+        }
+
+        void
+        await_suspend(std::coroutine_handle<> handle);
+
+    private:
+        WorkerWriteBehind& m_buffer;
+        WorkerUpsert m_row;
+    };
+
+    double m_batchDelay;
+    std::size_t m_batchSize;
+    trantor::EventLoop * m_loop = nullptr;
+
+    std::mutex m_mutex;
+    std::vector<Pending> m_pending;
+    std::unordered_map<std::string, std::size_t> m_pendingIndex; // worker_uuid -> m_pending 下标
+    bool m_flushScheduled = false;
+
+    // 写入当前缓冲区中的所有行, 在 m_loop 上调用
+    void
+    flush();
+};
+
+} // namespace YLineServer::DB
+
+#endif // YLINESERVER_DB_WORKER_WRITE_BEHIND_H
@@ -12,12 +12,16 @@ struct Task
     int order;
     std::string name;
     bool dependency;
+    std::string payload = "{}"; // 已序列化的 JSON, 由工作机解析执行
+    std::string depends_on = "[]"; // 已序列化的 JSON 数组, 依赖的 task_id, 全部完成后任务才会发布
 };
 
 struct Job
 {
     std::string name;
     std::string submit_user;
+    std::string retry_policy;   // 已序列化的 JSON, 为空时使用服务器配置
+    int priority = 0;           // 0-100, AMQP 消息优先级
 };
 
 
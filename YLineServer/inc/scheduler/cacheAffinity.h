@@ -0,0 +1,68 @@
+#ifndef YLINESERVER_SCHEDULER_CACHE_AFFINITY_H
+#define YLINESERVER_SCHEDULER_CACHE_AFFINITY_H
+
+#include <cstddef>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+#include <json/value.h>
+
+namespace YLineServer::Scheduler
+{
+
+/*
+缓存亲和性, 记录每台工作机的输入文件缓存中有哪些内容 (SHA-256)
+
+工作机注册时上报完整列表, 之后通过 cacheUpdate 增量上报新增和淘汰的哈希
+消费者收到声明了输入哈希的任务时, 如果本工作机一个都没有缓存, 而其他在线工作机有, 就把任务退回队列一次, 让有缓存的工作机取走
+可以在任意线程调用
+*/
+class CacheAffinity
+{
+public:
+    // 用工作机上报的完整列表替换
+    void
+    reset(const boost::uuids::uuid& worker, const Json::Value& hashes);
+
+    void
+    update(const boost::uuids::uuid& worker, const Json::Value& added, const Json::Value& evicted);
+
+    // 工作机下线
+    void
+    remove(const boost::uuids::uuid& worker);
+
+    // 工作机缓存了其中多少个
+    std::size_t
+    count(const boost::uuids::uuid& worker, const std::vector<std::string>& hashes) const;
+
+    // 缓存了其中至少一个的工作机
+    std::vector<boost::uuids::uuid>
+    holders(const std::vector<std::string>& hashes) const;
+
+private:
+    struct UuidHash {
+        std::size_t operator()(const boost::uuids::uuid& uuid) const noexcept;
+    };
+
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<boost::uuids::uuid, std::unordered_set<std::string>, UuidHash> m_workers; // 工作机 -> 哈希
+    std::unordered_map<std::string, std::unordered_set<boost::uuids::uuid, UuidHash>> m_holders; // 哈希 -> 工作机
+
+    // 调用者持有写锁
+    void
+    addLocked(const boost::uuids::uuid& worker, const std::string& hash);
+
+    void
+    evictLocked(const boost::uuids::uuid& worker, const std::string& hash);
+
+    void
+    removeLocked(const boost::uuids::uuid& worker);
+};
+
+} // namespace YLineServer::Scheduler
+
+#endif // YLINESERVER_SCHEDULER_CACHE_AFFINITY_H
@@ -0,0 +1,33 @@
+#ifndef YLINESERVER_SCHEDULER_DAG_H
+#define YLINESERVER_SCHEDULER_DAG_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <json/value.h>
+
+#include "job.h"
+
+namespace YLineServer::Scheduler
+{
+
+// 函数: 按依赖关系拓扑排序, 把排序后的位置写入 task_Components[i].order; 依赖成环时返回 false 并设置 err
+// Dependency 为 task_id -> 它依赖的 task_id
+bool
+resolveDAG
+(
+    std::vector<Components::Task> &task_Components,
+    const std::unordered_map<std::string, std::size_t> &taskID2Index,
+    const std::unordered_map<std::string, std::vector<std::string>> &Dependency,
+    std::string &err
+);
+
+// 函数: 校验并解析提交的作业中的 tasks, dependency 为 true 时解析依赖并按拓扑顺序排序; 格式错误时返回 false 并设置 err
+bool
+resolveTasks(const Json::Value &json, std::string &err, std::vector<Components::Task> &task_Components, bool dependency = false);
+
+} // namespace YLineServer::Scheduler
+
+#endif // YLINESERVER_SCHEDULER_DAG_H
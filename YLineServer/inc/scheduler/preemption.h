@@ -0,0 +1,72 @@
+#ifndef YLINESERVER_SCHEDULER_PREEMPTION_H
+#define YLINESERVER_SCHEDULER_PREEMPTION_H
+
+#include <chrono>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+
+namespace YLineServer::Scheduler
+{
+
+// 结构体: 正在执行的投递, 抢占的候选
+struct RunningDelivery
+{
+    boost::uuids::uuid worker;
+    std::uint64_t delivery_tag = 0;
+    std::uint8_t priority = 0;
+    std::chrono::steady_clock::time_point dispatched;
+    std::string task_id;
+    std::uint64_t generation = 0; // 所属 Channel 的代数
+    std::int64_t job_id = 0;
+};
+
+/*
+函数: 为 priority 优先级的任务选出最多 count 个被抢占的投递
+
+只抢占优先级更低的投递, 优先级最低的先被抢占; 同一优先级中最后分发的先被抢占, 丢弃的计算最少
+被抢占的任务重新入队, 可以从最近的检查点恢复
+*/
+std::vector<RunningDelivery>
+selectVictims(std::vector<RunningDelivery> candidates, std::uint8_t priority, std::size_t count);
+
+/*
+已取消的作业
+
+消费者丢弃已取消作业的排队中的任务 (包括延迟重试的), 工作机上的副本由服务器发送 cancelTask 结束
+重新提交时作业的排队代数加一, 取消前发布的消息代数更旧, 恢复后仍然被丢弃
+集群模式下通过 Membership 广播, 每个实例都有完整的集合
+可以在任意线程调用
+*/
+class JobCancellation
+{
+public:
+    // 取消作业, 之前未取消时返回 true
+    bool
+    cancel(std::int64_t job_id);
+
+    // 作业以排队代数 epoch 重新提交, 代数只增不减
+    void
+    resume(std::int64_t job_id, std::int64_t epoch);
+
+    bool
+    isCancelled(std::int64_t job_id) const;
+
+    // 消息的代数早于作业当前的排队代数
+    bool
+    isStale(std::int64_t job_id, std::int64_t epoch) const;
+
+private:
+    mutable std::shared_mutex m_mutex;
+    std::unordered_set<std::int64_t> m_jobs;
+    std::unordered_map<std::int64_t, std::int64_t> m_epochs;
+};
+
+} // namespace YLineServer::Scheduler
+
+#endif // YLINESERVER_SCHEDULER_PREEMPTION_H
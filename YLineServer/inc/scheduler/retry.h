@@ -0,0 +1,90 @@
+#ifndef YLINESERVER_SCHEDULER_RETRY_H
+#define YLINESERVER_SCHEDULER_RETRY_H
+
+#include <chrono>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include <boost/uuid/uuid.hpp>
+#include <json/value.h>
+
+namespace YLineServer::Scheduler
+{
+
+// 结构体: 重试策略, 服务器配置为默认值, 作业的 retry 和任务 payload.retry 依次覆盖
+struct RetryPolicy
+{
+    std::uint32_t max_attempts = 3;   // 包括第一次执行在内最多执行的次数, 用完后任务被隔离
+    double backoff_base = 10.0;       // 第一次重试前等待的秒数, 之后每次翻倍
+    double backoff_max = 600.0;       // 等待时间上限 (秒)
+};
+
+// 函数: 用 JSON 中出现的字段覆盖 policy, 格式错误时返回 false 并设置 err
+bool
+applyRetryPolicy(const Json::Value& json, RetryPolicy& policy, std::string& err);
+
+// 函数: 序列化为 JSON, 随任务消息发布
+Json::Value
+retryPolicyToJson(const RetryPolicy& policy);
+
+// 函数: 第 attempt 次失败后重新入队前等待的秒数 (取整到秒, 相同的等待时间共用一个延迟队列)
+std::uint32_t
+backoffSeconds(const RetryPolicy& policy, std::uint32_t attempt);
+
+// 结构体: 工作机黑名单选项
+struct BlacklistOptions
+{
+    std::uint32_t failures = 2;       // 同一作业的任务在一台工作机上失败这么多次后, 该工作机不再执行这个作业
+    double ttl = 3600.0;              // 黑名单有效期 (秒), 从最后一次失败算起
+    double defer = 5.0;               // 投递给黑名单中的工作机时, 延迟这么多秒后重新入队 (秒)
+};
+
+/*
+按作业记录失败任务的工作机
+
+同一作业的任务在某台工作机上反复失败, 通常是这台机器的环境问题 (缺少插件, 驱动版本, 磁盘已满)
+把它拉黑后, 该作业的任务由其他工作机执行, 不再消耗重试次数
+黑名单过期后自动解除, 所有工作机都被拉黑的作业在过期前不会再有进展
+可以在任意线程调用
+*/
+class WorkerBlacklist
+{
+public:
+    explicit WorkerBlacklist(const BlacklistOptions& options);
+
+    inline const BlacklistOptions&
+    options() const { return m_options; }
+
+    // 记录一次失败, 该工作机因此刚进入黑名单时返回 true
+    bool
+    recordFailure(std::int64_t job_id, const boost::uuids::uuid& worker);
+
+    bool
+    isBlacklisted(std::int64_t job_id, const boost::uuids::uuid& worker) const;
+
+private:
+    struct UuidHash {
+        std::size_t operator()(const boost::uuids::uuid& uuid) const noexcept;
+    };
+
+    struct Failures
+    {
+        std::uint32_t count = 0;
+        std::chrono::steady_clock::time_point last;
+    };
+
+    BlacklistOptions m_options;
+
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<std::int64_t, std::unordered_map<boost::uuids::uuid, Failures, UuidHash>> m_jobs;
+
+    // 删除过期的记录 (调用者持有写锁)
+    void
+    pruneLocked(std::chrono::steady_clock::time_point now);
+};
+
+} // namespace YLineServer::Scheduler
+
+#endif // YLINESERVER_SCHEDULER_RETRY_H
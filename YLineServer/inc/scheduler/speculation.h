@@ -0,0 +1,188 @@
+#ifndef YLINESERVER_SCHEDULER_SPECULATION_H
+#define YLINESERVER_SCHEDULER_SPECULATION_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+#include <json/value.h>
+#include <trantor/net/EventLoop.h>
+
+namespace YLineServer::Scheduler
+{
+
+// 推测执行副本的投递标签, 最高位置 1, 不会与 broker 的投递标签冲突, 也不需要确认
+constexpr std::uint64_t SPECULATIVE_TAG_BIT = std::uint64_t{1} << 63;
+
+inline bool
+isSpeculativeTag(std::uint64_t deliveryTag) { return (deliveryTag & SPECULATIVE_TAG_BIT) != 0; }
+
+// 结构体: 推测执行选项
+struct SpeculationOptions
+{
+    bool enable = true;
+    double interval = 5.0;         // 扫描间隔 (秒)
+    double percentile = 0.75;      // 同一作业已完成任务耗时的分位数
+    double multiplier = 1.5;       // 运行时间超过 分位数 * multiplier 视为拖尾任务
+    std::size_t min_samples = 3;   // 同一作业至少完成这么多任务后才开始推测
+    double min_runtime = 30.0;     // 运行时间低于该值 (秒) 的任务不推测
+};
+
+/*
+推测执行 (speculative execution), 缩短长尾任务拖慢的作业完成时间
+
+作业的大部分任务完成后, 剩余的少数慢任务会让大部分工作机空闲
+定时扫描: 任务运行时间超过同一作业已完成任务耗时的分位数 * multiplier 时, 在一台空闲的工作机上复制执行一份
+第一个成功的结果生效, 其余副本被取消, 取消或失败的副本结果被忽略
+
+空闲工作机指并发槽位没有占满的工作机, 此时 broker 的队列中已经没有它可以取走的任务, 即作业排队中的任务已经为零
+为避免与 broker 的投递竞争, 工作机需要连续两次扫描都空闲才会被使用
+
+原副本来自 broker, 完成后需要确认消息; 推测副本由服务器直接分发, 使用 SPECULATIVE_TAG_BIT 标记的投递标签
+回调都在 start 传入的 EventLoop (消费者 I/O 线程) 上调用, 其余函数可以在任意线程调用
+*/
+class Speculation
+{
+public:
+    // 某台工作机上的一个任务副本
+    // 原副本的 delivery tag 只在 Channel 的同一代内唯一, generation 为分发时 Channel 的代数, 推测副本为 0
+    struct CopyRef
+    {
+        boost::uuids::uuid worker;
+        std::uint64_t delivery_tag;
+        std::uint64_t generation;
+        std::int64_t job_id;
+        std::string task_id;
+    };
+
+    // 任务副本结束后的处理方式
+    struct Verdict
+    {
+        bool record = true;           // 结果是否写入数据库
+        bool ack = true;              // 是否立即确认本副本的消息 (只对原副本有效)
+        std::vector<CopyRef> cancel;  // 需要取消的其他副本
+        std::vector<CopyRef> settle;  // 之前延后确认的原副本
+    };
+
+    // 返回空闲工作机及其空闲槽位数 (不包括推测副本)
+    using IdleWorkersCallback = std::function<std::vector<std::pair<boost::uuids::uuid, std::size_t>>()>;
+    // 向工作机发送推测副本, 工作机不可用时返回 false
+    using DispatchCallback = std::function<bool(const boost::uuids::uuid&, const Json::Value&)>;
+
+    explicit Speculation(const SpeculationOptions& options);
+
+    // 在指定的 EventLoop 上启动定时扫描
+    void
+    start(trantor::EventLoop * loop);
+
+    inline void
+    setIdleWorkersCallback(IdleWorkersCallback && callback) { m_idleWorkers = std::move(callback); }
+
+    inline void
+    setDispatchCallback(DispatchCallback && callback) { m_dispatch = std::move(callback); }
+
+    // 任务是否已经由某个副本成功完成
+    bool
+    isCompleted(std::int64_t job_id, const std::string& task_id) const;
+
+    // broker 把任务投递给工作机
+    void
+    onDispatched(const boost::uuids::uuid& worker, std::uint64_t deliveryTag, std::uint64_t generation, const Json::Value& task);
+
+    // 工作机开始执行
+    void
+    onStarted(const boost::uuids::uuid& worker, std::uint64_t deliveryTag, std::uint64_t generation, std::int64_t job_id, const std::string& task_id);
+
+    // 副本结束, duration 为工作机测得的运行时间 (秒)
+    Verdict
+    onFinished(
+        const boost::uuids::uuid& worker,
+        std::uint64_t deliveryTag,
+        std::uint64_t generation,
+        std::int64_t job_id,
+        const std::string& task_id,
+        bool success,
+        double duration
+    );
+
+    // 工作机拒绝了副本, 返回延后确认且需要重新入队的原副本
+    std::vector<CopyRef>
+    onRejected(const boost::uuids::uuid& worker, std::uint64_t deliveryTag, std::uint64_t generation, std::int64_t job_id, const std::string& task_id);
+
+    // 副本被取消 (作业取消或被抢占), 返回延后确认的原副本
+    std::vector<CopyRef>
+    onCancelled(const boost::uuids::uuid& worker, std::uint64_t deliveryTag, std::uint64_t generation, std::int64_t job_id, const std::string& task_id);
+
+    // 作业所有正在执行的副本, 取消作业时使用
+    std::vector<CopyRef>
+    copiesOf(std::int64_t job_id) const;
+
+    // 工作机被回收, 其上的原副本已经重新发布到队列, 返回延后确认且需要重新入队的原副本
+    std::vector<CopyRef>
+    onWorkerLost(const boost::uuids::uuid& worker);
+
+private:
+    struct UuidHash {
+        std::size_t operator()(const boost::uuids::uuid& uuid) const noexcept;
+    };
+
+    struct Copy
+    {
+        boost::uuids::uuid worker;
+        std::uint64_t delivery_tag;
+        std::uint64_t generation = 0;
+        bool speculative = false;
+        bool started = false;
+        std::chrono::steady_clock::time_point startTime;
+    };
+
+    struct TaskState
+    {
+        Json::Value task;                  // broker 消息的内容, 复制执行时使用
+        std::vector<Copy> copies;          // 正在执行的副本
+        std::vector<CopyRef> deferred;     // 已失败但还有其他副本在执行, 延后确认的原副本
+        std::unordered_set<boost::uuids::uuid, UuidHash> rejectedBy;
+        bool speculated = false;           // 每个任务最多推测一次
+    };
+
+    struct JobState
+    {
+        std::unordered_map<std::string, TaskState> running;
+        std::unordered_set<std::string> completed;
+        std::vector<double> durations;     // 已完成任务的运行时间
+        std::chrono::steady_clock::time_point lastActivity;
+    };
+
+    SpeculationOptions m_options;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::int64_t, JobState> m_jobs;
+    std::unordered_set<boost::uuids::uuid, UuidHash> m_idleLastScan; // 只在 EventLoop 上访问
+    std::uint64_t m_nextTag = 0;
+
+    IdleWorkersCallback m_idleWorkers;
+    DispatchCallback m_dispatch;
+
+    // 查找副本 (调用者持有锁)
+    static std::vector<Copy>::iterator
+    findCopy(TaskState& state, const boost::uuids::uuid& worker, std::uint64_t deliveryTag, std::uint64_t generation);
+
+    // 副本没有结果就不再执行, 没有副本时移除任务, 返回需要重新入队的延后确认的原副本 (调用者持有锁)
+    std::vector<CopyRef>
+    dropCopy(JobState& job, const std::string& task_id, const boost::uuids::uuid& worker, std::uint64_t deliveryTag, std::uint64_t generation);
+
+    // 扫描拖尾任务并分发推测副本
+    void
+    scan();
+};
+
+} // namespace YLineServer::Scheduler
+
+#endif // YLINESERVER_SCHEDULER_SPECULATION_H
@@ -0,0 +1,126 @@
+#ifndef YLINESERVER_STORAGE_ARTIFACT_STORE_H
+#define YLINESERVER_STORAGE_ARTIFACT_STORE_H
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <trantor/net/EventLoopThread.h>
+
+#include "UThash.h"
+
+namespace YLineServer::Storage
+{
+
+// 结构体: 产物状态
+struct ArtifactStatus
+{
+    bool complete = false;
+    std::uint64_t size = 0;    // 已完成时为文件大小, 否则为已收到的字节数 (续传位置)
+    std::string sha256;        // 已完成时的 SHA-256
+};
+
+// 枚举: 产物操作结果
+enum class ArtifactResult
+{
+    ok,
+    offset_mismatch,   // 数据块不是从已收到的位置开始, 客户端需要从 status 中的位置续传
+    chunk_corrupted,   // 数据块的 SHA-256 不一致, 客户端需要重发该块
+    file_corrupted,    // 整个文件的 SHA-256 不一致, 已收到的数据被丢弃
+    already_complete,
+    io_error
+};
+
+/*
+任务产物存储, 接收工作机分块上传的文件, 见 UTartifact.h
+
+<dir>/<key>.part 保存已收到的数据, 数据块必须从已收到的位置开始顺序追加
+整个文件的 SHA-256 随数据块增量计算, 完成时不需要再读一遍文件; 服务器重启后续传时才从 .part 重新计算
+完成后重命名为 <dir>/<key>, SHA-256 保存在 <dir>/<key>.sha256
+
+磁盘写入在独立的写线程上进行, 不阻塞 HTTP I/O 线程
+数据块由 drogon 接收, 超过 client_max_memory_body_size 的请求体已经缓存在临时文件中, 整个过程不会把大文件读入内存
+回调在写线程上调用
+*/
+class ArtifactStore
+{
+public:
+    using StatusCallback = std::function<void(const ArtifactStatus&)>;
+    using ResultCallback = std::function<void(ArtifactResult, const ArtifactStatus&)>;
+
+    explicit ArtifactStore(std::filesystem::path dir);
+
+    // 启动写线程
+    void
+    start();
+
+    // 以下函数可以在任意线程调用, key 需要事先通过 isValidArtifactKey 校验
+
+    void
+    status(const std::string& key, StatusCallback&& callback);
+
+    // 追加数据块, data 在回调之前必须保持有效, 由 keepAlive 持有
+    void
+    write(
+        const std::string& key,
+        std::uint64_t offset,
+        std::string_view data,
+        const std::string& chunkSha256,
+        std::shared_ptr<const void> keepAlive,
+        ResultCallback&& callback
+    );
+
+    // 校验整个文件的 SHA-256 并完成上传
+    void
+    complete(const std::string& key, const std::string& sha256, ResultCallback&& callback);
+
+    // 已完成产物的路径, 不存在时返回空路径
+    std::filesystem::path
+    completedPath(const std::string& key) const;
+
+    // 已完成产物的 SHA-256, 读取失败时返回空字符串
+    std::string
+    completedSha256(const std::string& key) const;
+
+private:
+    // 上传中的产物
+    struct Upload
+    {
+        YSolowork::util::Sha256 hasher;
+        std::uint64_t size = 0;
+        std::chrono::steady_clock::time_point lastWrite;
+    };
+
+    std::filesystem::path m_dir;
+    std::unique_ptr<trantor::EventLoopThread> m_thread;
+
+    // 以下只在写线程上访问
+    std::unordered_map<std::string, Upload> m_uploads; // key -> 上传状态
+
+    std::filesystem::path
+    finalPath(const std::string& key) const;
+
+    std::filesystem::path
+    partPath(const std::string& key) const;
+
+    // 在写线程上执行
+    ArtifactStatus
+    statusOf(const std::string& key) const;
+
+    // 找到或重建上传状态, .part 的大小与内存中不一致时 (服务器重启) 从文件重新计算 SHA-256
+    Upload*
+    uploadOf(const std::string& key);
+
+    // 释放长时间没有写入的上传状态, .part 保留在磁盘上
+    void
+    dropIdle();
+};
+
+} // namespace YLineServer::Storage
+
+#endif // YLINESERVER_STORAGE_ARTIFACT_STORE_H
@@ -0,0 +1,207 @@
+#ifndef YLINESERVER_STORAGE_EVENT_JOURNAL_H
+#define YLINESERVER_STORAGE_EVENT_JOURNAL_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+
+namespace YLineServer::Storage
+{
+
+// 枚举: 调度事件, 0 表示记录还没有写入
+enum class JournalEvent : std::uint8_t
+{
+    TaskQueued = 1,      // 作业提交, 任务发布到队列
+    TaskDispatched = 2,  // 消费者收到投递, 分发给工作机
+    TaskAcked = 3,       // 向 broker 确认投递
+    TaskCompleted = 4,   // 工作机报告任务结束
+    TaskRequeued = 5,    // 投递重新入队
+    TaskDropped = 6,     // 投递被拒绝且不重新入队, 或者隔离
+    WorkerOnline = 7,    // 工作机注册
+    WorkerOffline = 8,   // 工作机断开或心跳超时
+};
+
+// 事件名称, 与 JournalEvent 对应, 未知事件返回空
+std::string_view
+journalEventName(JournalEvent event);
+
+// 从名称解析事件
+std::optional<JournalEvent>
+parseJournalEvent(std::string_view name);
+
+// detail 字段: 重新入队和丢弃的原因
+enum class JournalReason : std::uint8_t
+{
+    None = 0,
+    Rejected = 1,       // 工作机拒绝或者被抢占
+    Reclaimed = 2,      // 工作机离线, 回收未确认的投递
+    Retry = 3,          // 任务失败, 按重试策略延迟重新入队
+    Quarantined = 4,    // 用完重试次数, 隔离
+    Disconnected = 5,   // 工作机断开连接
+    Timeout = 6,        // 工作机心跳超时
+};
+
+std::string_view
+journalReasonName(JournalReason reason);
+
+// 函数: task_id 的 64 位 FNV-1a 哈希, 截断的 task_id 也能精确过滤
+constexpr std::uint64_t
+journalTaskHash(std::string_view taskID)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    for (const char c : taskID)
+    {
+        hash = (hash ^ static_cast<std::uint8_t>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// 结构体: 日志记录, 定长 64 字节, 直接写入内存映射的文件
+// task_id 超过 TASK_ID_SIZE 时截断, 不足时以 0 填充; task_hash 为完整 task_id 的哈希
+struct JournalRecord
+{
+    static constexpr std::size_t TASK_ID_SIZE = 14;
+
+    std::int64_t time;                       // Unix 纳秒
+    std::uint64_t delivery_tag;
+    std::int64_t job_id;
+    std::array<std::uint8_t, 16> worker;     // 工作机 UUID, 没有时全 0
+    std::uint64_t task_hash;
+    std::array<char, TASK_ID_SIZE> task_id;
+    std::uint8_t type;                       // JournalEvent, 最后写入
+    std::uint8_t detail;                     // 事件相关: 重新入队原因, 完成状态, 尝试次数
+
+    inline std::string_view
+    taskID() const
+    {
+        const auto end = std::find(task_id.begin(), task_id.end(), '\0');
+        return std::string_view(task_id.data(), static_cast<std::size_t>(end - task_id.begin()));
+    }
+};
+static_assert(sizeof(JournalRecord) == 64, "JournalRecord must stay 64 bytes");
+
+// 结构体: 日志段文件头, 与记录同样 64 字节, 记录紧随其后
+struct JournalHeader
+{
+    static constexpr std::array<char, 8> MAGIC = {'Y', 'L', 'J', 'O', 'U', 'R', 'N', 'L'};
+    static constexpr std::uint32_t VERSION = 1;
+
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t record_size;
+    std::uint64_t capacity;                  // 记录数量
+    std::int64_t created;                    // Unix 纳秒
+    std::uint32_t thread;                    // 写入线程编号
+    std::array<std::uint8_t, 28> reserved;
+};
+static_assert(sizeof(JournalHeader) == 64, "JournalHeader must stay 64 bytes");
+
+// 日志段文件扩展名
+constexpr std::string_view JOURNAL_EXTENSION = ".ylj";
+
+// 结构体: 日志选项
+struct EventJournalOptions
+{
+    std::filesystem::path dir;
+    std::size_t segment_records = 1 << 20;   // 每个段文件的记录数量, 默认 64 MiB
+    std::size_t max_segments = 64;           // 目录中最多保留的段文件数量, 超过时删除最旧的
+};
+
+/*
+调度事件日志
+
+只追加的二进制日志, 每个写入线程有自己的内存映射段文件 <dir>/<创建时间>_<线程编号>.ylj
+写入只是向映射内存复制一条定长记录, 不加锁也不做系统调用; 段写满时由该线程创建下一个段
+进程崩溃时已写入的记录仍在页缓存中, 由内核写回文件
+
+离线工具 YLineJournal 按时间合并所有段文件, 解码并过滤记录
+*/
+class EventJournal
+{
+public:
+    explicit EventJournal(EventJournalOptions options);
+
+    // 记录任务事件, 可以在任意线程调用
+    void
+    record(
+        JournalEvent event,
+        const boost::uuids::uuid& worker,
+        std::uint64_t deliveryTag,
+        std::int64_t jobID,
+        std::string_view taskID,
+        std::uint8_t detail = 0
+    );
+
+    // 记录工作机事件
+    void
+    record(JournalEvent event, const boost::uuids::uuid& worker, JournalReason reason = JournalReason::None);
+
+    // 创建段文件失败而丢弃的记录数量
+    std::uint64_t
+    dropped() const;
+
+    // 段文件, 按文件名 (创建时间) 排序
+    static std::vector<std::filesystem::path>
+    segments(const std::filesystem::path& dir);
+
+private:
+    // 写入线程和日志共享的状态, 线程退出时日志可能已经销毁
+    struct State
+    {
+        EventJournalOptions options;
+        std::atomic<std::uint32_t> threads = 0;
+        std::atomic<std::uint64_t> dropped = 0;
+        std::mutex mutex;
+        std::unordered_set<std::string> active;  // 正在写入的段文件, 清理时跳过
+    };
+
+    class Writer;
+
+    std::shared_ptr<State> m_state;
+
+    Writer&
+    writer();
+};
+
+// 段文件读取器, 逐条读取记录, 遇到未写入的记录时结束
+class JournalReader
+{
+public:
+    // 打开失败或者文件头无效时抛出 std::runtime_error
+    explicit JournalReader(const std::filesystem::path& path);
+
+    inline const JournalHeader&
+    header() const
+    {
+        return m_header;
+    }
+
+    // 下一条记录, 没有时返回空
+    std::optional<JournalRecord>
+    next();
+
+private:
+    std::ifstream m_file;
+    JournalHeader m_header{};
+    std::vector<JournalRecord> m_buffer;
+    std::size_t m_position = 0;
+    std::uint64_t m_remaining = 0;
+    bool m_end = false;
+};
+
+} // namespace YLineServer::Storage
+
+#endif // YLINESERVER_STORAGE_EVENT_JOURNAL_H
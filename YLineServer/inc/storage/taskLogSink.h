@@ -0,0 +1,75 @@
+#ifndef YLINESERVER_STORAGE_TASK_LOG_SINK_H
+#define YLINESERVER_STORAGE_TASK_LOG_SINK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <trantor/net/EventLoopThread.h>
+
+#include "UTlogFrame.h"
+
+namespace YLineServer::Storage
+{
+
+/*
+任务日志存储
+
+工作机上传的日志块是独立的 gzip 成员, 按序号直接追加到
+<dir>/<job_id>/<task_id>.<stream>.log.gz, 不需要解压, 结果是合法的多成员 gzip 文件
+
+I/O 线程只负责解码帧头并把数据交给独立的写线程, 磁盘写入不会阻塞 WebSocket
+等待写入的数据超过 max_pending_bytes 时直接丢弃新的日志块, 避免输出很多的任务拖垮服务器
+*/
+class TaskLogSink
+{
+public:
+    TaskLogSink(std::filesystem::path dir, std::size_t max_pending_bytes);
+
+    // 启动写线程
+    void
+    start();
+
+    // 追加一块日志, 可以在任意线程调用
+    void
+    append(const YSolowork::util::LogFrameHeader& header, std::string&& payload);
+
+    // 日志文件路径
+    std::filesystem::path
+    pathOf(std::int64_t job_id, const std::string& task_id, const std::string& stream) const;
+
+private:
+    struct OpenLog
+    {
+        std::ofstream file;
+        std::uint64_t nextSeq = 0;
+        std::chrono::steady_clock::time_point lastWrite;
+    };
+
+    std::filesystem::path m_dir;
+    std::size_t m_maxPendingBytes;
+    std::unique_ptr<trantor::EventLoopThread> m_thread;
+
+    std::atomic<std::size_t> m_pendingBytes = 0;
+    std::atomic<std::uint64_t> m_droppedChunks = 0;
+
+    // 以下只在写线程上访问
+    std::unordered_map<std::string, OpenLog> m_openLogs; // 文件路径 -> 打开的文件
+
+    // 在写线程上写入
+    void
+    write(const YSolowork::util::LogFrameHeader& header, const std::string& payload);
+
+    // 关闭长时间没有写入的文件
+    void
+    closeIdle();
+};
+
+} // namespace YLineServer::Storage
+
+#endif // YLINESERVER_STORAGE_TASK_LOG_SINK_H
@@ -0,0 +1,165 @@
+#ifndef YLINESERVER_STORAGE_USAGE_HISTORY_H
+#define YLINESERVER_STORAGE_USAGE_HISTORY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+
+namespace YLineServer::Storage
+{
+
+// 结构体: 工作机上报的一次使用率, 负数表示工作机获取失败
+struct UsageSample
+{
+    struct Gpu
+    {
+        unsigned int index = 0;
+        double usage = -1;        // 百分比
+        double memory_used = -1;  // GB
+        double temperature = -1;  // 摄氏度
+        double power = -1;        // W
+    };
+
+    double cpu = -1;     // 百分比
+    double memory = -1;  // 百分比
+    std::vector<Gpu> gpus;
+};
+
+// 结构体: 一个时间桶内某个指标的统计, 小时桶最多 3600 个样本, 用 16 字节保存
+struct UsageStat
+{
+    float min = 0;
+    float max = 0;
+    float sum = 0;
+    std::uint16_t count = 0;
+
+    void
+    add(float value);
+
+    inline double
+    avg() const
+    {
+        return count == 0 ? 0.0 : static_cast<double>(sum) / count;
+    }
+};
+
+// 结构体: 查询结果, stats 按时间桶逐行排列, 每行 metrics.size() 个
+struct UsageSeries
+{
+    std::int64_t width = 0;             // 时间桶宽度 (秒)
+    std::vector<std::string> metrics;   // cpu, memory, gpu<index>.usage, gpu<index>.memory_used, ...
+    std::vector<std::int64_t> starts;   // 时间桶起点 (Unix 秒)
+    std::vector<UsageStat> stats;
+};
+
+// 结构体: 历史保留的时间桶数量
+struct UsageHistoryOptions
+{
+    std::size_t raw_count = 300;      // 1 秒桶
+    std::size_t minute_count = 720;   // 1 分钟桶
+    std::size_t hour_count = 336;     // 1 小时桶
+    std::size_t max_points = 1000;    // 自动选择精度时, 查询结果最多的时间桶数量
+};
+
+/*
+工作机使用率历史, 保存在进程内的环形缓冲区中
+
+每个样本同时累加到 1 秒, 1 分钟, 1 小时三个精度的时间桶 (每个指标的 min/avg/max, GPU 分别统计)
+每个精度保留固定数量的时间桶, 内存只与时间桶数量和指标数量有关, 与样本数量无关
+查询在覆盖查询起点, 且结果不超过 max_points 个时间桶的精度中选择最精细的一个, 结果大小同样与时间桶数量成正比
+
+使用率由工作机所在的服务器实例记录, 集群模式下只有该实例有这台工作机的历史
+可以在任意线程调用
+*/
+class UsageHistory
+{
+public:
+    // 支持的精度 (秒)
+    static constexpr std::array<std::int64_t, 3> WIDTHS = {1, 60, 3600};
+
+    explicit UsageHistory(UsageHistoryOptions options);
+
+    // 记录一个样本, time 为接收时间 (Unix 秒)
+    void
+    record(const boost::uuids::uuid& worker, std::int64_t time, const UsageSample& sample);
+
+    // 查询 [from, to] 范围内的时间桶, width 为 WIDTHS 之一, 0 表示自动选择; 没有该工作机的历史时返回空
+    std::optional<UsageSeries>
+    query(const boost::uuids::uuid& worker, std::int64_t from, std::int64_t to, std::int64_t width) const;
+
+    // 删除超过 maxIdle 秒没有样本的工作机
+    void
+    prune(std::int64_t now, std::int64_t maxIdle);
+
+private:
+    // 一个精度的环形缓冲区
+    class Tier
+    {
+    public:
+        Tier(std::int64_t width, std::size_t capacity, std::size_t metrics);
+
+        // values 中的 NaN 表示缺失
+        void
+        add(std::int64_t time, const std::vector<float>& values);
+
+        // 是否保留了 from 之后的全部历史
+        bool
+        covers(std::int64_t from) const;
+
+        // 追加与 [from, to] 重叠的时间桶
+        void
+        collect(std::int64_t from, std::int64_t to, UsageSeries& series) const;
+
+        inline std::int64_t
+        width() const
+        {
+            return m_width;
+        }
+
+    private:
+        std::int64_t m_width;
+        std::size_t m_capacity;
+        std::size_t m_metrics;
+        std::vector<std::int64_t> m_starts;
+        std::vector<UsageStat> m_stats;  // m_capacity * m_metrics
+        std::size_t m_head = 0;          // 最旧的时间桶
+        std::size_t m_size = 0;
+    };
+
+    struct WorkerHistory
+    {
+        mutable std::mutex mutex;
+        std::vector<unsigned int> gpus;     // GPU 编号, 变化时清空历史
+        std::vector<std::string> metrics;
+        std::vector<Tier> tiers;            // 与 WIDTHS 对应
+        std::int64_t lastSample = 0;
+    };
+
+    struct UuidHash
+    {
+        std::size_t
+        operator()(const boost::uuids::uuid& uuid) const noexcept;
+    };
+
+    UsageHistoryOptions m_options;
+
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<boost::uuids::uuid, std::shared_ptr<WorkerHistory>, UuidHash> m_workers;
+
+    // 按 GPU 编号初始化指标和时间桶 (调用者持有 history.mutex)
+    void
+    resetLocked(WorkerHistory& history, const UsageSample& sample) const;
+};
+
+} // namespace YLineServer::Storage
+
+#endif // YLINESERVER_STORAGE_USAGE_HISTORY_H
@@ -4,6 +4,7 @@
 #include "drogon/lib/src/impl_forwards.h"
 #include "json/value.h"
 #include <json/json.h>
+#include <string_view>
 #include "drogon/WebSocketConnection.h"
 
 #ifndef YLINESERVER_API_H
@@ -22,8 +23,8 @@ HttpResponsePtr makeJsonResponse(const Json::Value& json, const HttpStatusCode&
 // 函数: 生成 HTML 响应
 HttpResponsePtr makeHttpResponse(const std::string& body, const HttpStatusCode& status, const HttpRequestPtr& req, const ContentType& contentType);
 
-// 函数: 解析 JSON
-bool parseJson(const std::string& jsonStr, Json::Value& resultJson, std::string& errs);
+// 函数: 解析 JSON, 直接读取传入的缓冲区, 每个线程复用一个解析器, 可以在任意线程调用
+bool parseJson(std::string_view jsonStr, Json::Value& resultJson, std::string& errs);
 
 //函数: 鉴权 WebSocket 连接
 void authWebSocketConnection(const WebSocketConnectionPtr& wsConnPtr, const std::string& token, const std::string &from);
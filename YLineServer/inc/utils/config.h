@@ -5,6 +5,7 @@
 #include <cstddef>
 #include <filesystem>
 #include <spdlog/spdlog.h>
+#include <spdlog/async_logger.h>
 #include <unordered_set>
 
 namespace YLineServer {
@@ -56,12 +57,80 @@ struct Config {
 
     // log
     spdlog::level::level_enum log_level;
+    bool log_async;
+    size_t log_queue_size;
+    spdlog::async_overflow_policy log_overflow_policy;
 
     // dbmate
     bool migrate;
     std::string dbmate_download_url;
     std::string dbmate_download_name;
     std::filesystem::path dbmate_path;
+
+    // cluster
+    bool cluster_enable;
+    std::string cluster_advertise_address;
+    float cluster_heartbeat_interval;
+    int cluster_member_ttl;
+
+    // db write-behind
+    float db_register_batch_delay;
+    size_t db_register_batch_size;
+
+    // worker liveness
+    float worker_heartbeat_timeout;
+    float worker_reclaim_grace;
+
+    // task log
+    std::filesystem::path task_log_dir;
+    size_t task_log_max_pending_bytes;
+
+    // artifact
+    std::filesystem::path artifact_dir;
+    size_t artifact_max_chunk_bytes;
+
+    // speculative execution
+    bool speculative_enable;
+    float speculative_interval;
+    float speculative_percentile;
+    float speculative_multiplier;
+    size_t speculative_min_samples;
+    float speculative_min_runtime;
+
+    // cache affinity 缓存亲和性
+    bool cache_affinity;
+
+    // retry 失败重试
+    std::uint32_t retry_max_attempts;
+    float retry_backoff_base;
+    float retry_backoff_max;
+    std::uint32_t retry_blacklist_failures;
+    float retry_blacklist_ttl;
+    float retry_blacklist_defer;
+
+    // preemption 抢占与取消
+    bool preempt_enable;
+    std::uint8_t preempt_priority;
+    float preempt_grace;
+    size_t preempt_max;
+    float cancel_grace;
+
+    // monitor 事件循环监控
+    float loop_probe_interval;
+    float loop_stall_threshold;
+    float loop_log_interval;
+
+    // usage history 工作机使用率历史
+    size_t usage_history_raw;
+    size_t usage_history_minutes;
+    size_t usage_history_hours;
+    size_t usage_history_max_points;
+
+    // journal 调度事件日志
+    bool journal_enable;
+    std::filesystem::path journal_dir;
+    size_t journal_segment_records;
+    size_t journal_max_segments;
 };
 
 // 函数: 解析配置文件
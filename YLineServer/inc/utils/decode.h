@@ -0,0 +1,38 @@
+#ifndef YLINESERVER_DECODE_H
+#define YLINESERVER_DECODE_H
+
+#include <cstdint>
+#include <vector>
+
+#include <json/value.h>
+
+#include "UTnvml.h"
+#include "UTusage.h"
+
+/*
+工作机高频消息的类型化解码
+
+解析后的 Json::Value 只读取一次, 使用率历史和 Redis hash 直接使用结构体; Redis 中的 NVIDIA 数组仍然原样转存上报的 JSON
+缺少或类型不对的数值字段为 -1, 与工作机获取失败时上报的值一致
+*/
+namespace YLineServer::Decode {
+
+// 结构体: 一块 NVIDIA GPU 的使用率
+struct GpuUsage {
+    unsigned int index = 0;
+    YSolowork::util::nvUsageInfoGPU usage;
+};
+
+// 结构体: 工作机的使用率上报 ("command": "usage")
+struct UsageReport {
+    YSolowork::util::UsageInfoCPU cpu{-1.0, -1.0};
+    std::vector<GpuUsage> nvidia;
+    std::int64_t ts = 0; // 工作机的采样时间 (Unix 毫秒), 旧版本工作机没有, 为 0
+};
+
+// 函数: 解码使用率上报
+UsageReport decodeUsage(const Json::Value& json);
+
+} // namespace YLineServer::Decode
+
+#endif // YLINESERVER_DECODE_H
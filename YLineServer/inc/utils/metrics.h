@@ -0,0 +1,60 @@
+#ifndef YLINESERVER_METRICS_H
+#define YLINESERVER_METRICS_H
+
+#include "UTmetrics.h"
+#include "utils/config.h"
+
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+
+#include <string>
+#include <string_view>
+
+namespace YLineServer::Metrics
+{
+
+using YSolowork::util::Counter;
+using YSolowork::util::Gauge;
+using YSolowork::util::Histogram;
+
+// 函数: 注册 HTTP 请求延迟统计和采集时计算的计量 (EnTT 注册表实体数量), 在 app().run() 之前调用
+void install();
+
+// 函数: 配置事件循环监控, 卡顿 (附调用栈) 和周期汇总写入日志, 在 app().run() 之前调用
+void installLoopMonitor(const Config& config);
+
+// 函数: 监控 drogon 的主循环和所有 I/O 循环, I/O 循环在 app().run() 之后才存在, 需要在主循环中调用
+void watchDrogonLoops();
+
+// 函数: 路由所属的控制器, 用作 controller 标签
+std::string controllerOf(std::string_view pathPattern);
+
+// 函数: 记录一个 HTTP 请求, 由 post-handling advice 调用
+void observeRequest(const drogon::HttpRequestPtr& req, const drogon::HttpResponsePtr& resp);
+
+/*
+数据库/Redis 命令延迟, op 为调用位置的简短名称
+查找需要注册表的锁, 调用方应缓存返回的引用:
+
+    static auto& latency = Metrics::dbLatency("task_status");
+    const auto start = std::chrono::steady_clock::now();
+    ... >> [start](const Result&) { latency.observeSince(start); }
+*/
+Histogram& dbLatency(const std::string& op);
+Histogram& redisLatency(const std::string& op);
+
+// 工作机注册耗时: 收到注册请求到回复 registered, 包含数据库写缓冲的等待
+Histogram& workerRegisterLatency();
+
+// 工作机使用率的接收延迟: 工作机采样 (消息中的 ts) 到写入 Redis, 依赖两端的时钟同步
+Histogram& workerUsageLag();
+
+// WebSocket 控制器的当前连接数
+Gauge& wsConnections(const std::string& controller);
+
+// 消费者对投递的处理: ack, reject, requeue, republish (回收/重试/隔离重新发布)
+Counter& deliveries(const std::string& result);
+
+} // namespace YLineServer::Metrics
+
+#endif // YLINESERVER_METRICS_H
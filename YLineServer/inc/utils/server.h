@@ -11,12 +11,25 @@
 #include <entt/entt.hpp>
 #include <spdlog/spdlog.h>
 #include <unordered_map>
+#include <mutex>
 #include <shared_mutex>
 #include <vector>
 #include "drogon/WebSocketConnection.h"
 #include "models/Users.h"
 
 #include "amqp/AMQPconnectionPool.h"
+#include "cluster/membership.h"
+#include "components/workerIndex.h"
+#include "components/liveness.h"
+#include "db/workerWriteBehind.h"
+#include "scheduler/cacheAffinity.h"
+#include "scheduler/preemption.h"
+#include "scheduler/retry.h"
+#include "scheduler/speculation.h"
+#include "storage/artifactStore.h"
+#include "storage/taskLogSink.h"
+#include "storage/eventJournal.h"
+#include "storage/usageHistory.h"
 
 using EnTTidType = entt::registry::entity_type;
 using namespace drogon;
@@ -71,18 +84,14 @@ public:
     // 添加工作机到 EnTT
     EnTTidType addUserEntt(const Users::PrimaryKeyType& userId, const std::string& username, bool isAdmin = false);
 
-    // 工作机 UUID 到 EnTTid 映射
-    std::unordered_map<boost::uuids::uuid, EnTTidType, UuidHash> WorkerUUIDtoEnTTid; 
-
-    // hash 表，存储 WebSocket 连接到工作机 UUID 的映射 
-    std::unordered_map<drogon::WebSocketConnectionPtr, boost::uuids::uuid> wsConnToWorkerUUID;
+    // 工作机分片索引: UUID 到 EnTTid, WebSocket 连接到 UUID, 以及能力/在线状态/服务器实例二级索引
+    Components::WorkerIndex workerIndex;
 
     // hash 表，存储用户名到 EnTTid 的映射
     std::unordered_map<std::string, EnTTidType> usernameToEnTTid; // 用户名到 EnTTid 映射
 
-    // 共享锁
-    std::shared_mutex workerUUIDMapMutex;
-    std::shared_mutex wsConnMapMutex;
+    // EnTT registry 不是线程安全的, 创建/销毁实体和增删组件时需要持有该锁
+    std::mutex registryMutex;
 
     // AMQP 连接池 for Producer
     std::shared_ptr<AMQPConnectionPool> amqpConnectionPool;
@@ -92,6 +101,49 @@ public:
 
     // AMQP 连接池 for Consumer
     std::shared_ptr<AMQPConnectionPool> consumer_amqpConnectionPool;
+
+    // 集群成员注册表, 未启用集群模式时为空
+    std::shared_ptr<Cluster::Membership> membership;
+
+    // 工作机存活追踪, 运行在消费者 I/O 线程上
+    std::shared_ptr<Components::LivenessTracker> livenessTracker;
+
+    // 工作机注册写缓冲, 合并注册时的数据库 upsert
+    std::shared_ptr<DB::WorkerWriteBehind> workerWriteBehind;
+
+    // 任务日志存储
+    std::shared_ptr<Storage::TaskLogSink> taskLogSink;
+
+    // 任务产物存储
+    std::shared_ptr<Storage::ArtifactStore> artifactStore;
+
+    // 工作机使用率历史
+    std::shared_ptr<Storage::UsageHistory> usageHistory;
+
+    // 调度事件日志, 未启用时为空
+    std::shared_ptr<Storage::EventJournal> eventJournal;
+
+    // 拖尾任务的推测执行, 扫描运行在消费者 I/O 线程上
+    std::shared_ptr<Scheduler::Speculation> speculation;
+
+    // 工作机输入缓存内容, 用于缓存亲和性分发
+    std::shared_ptr<Scheduler::CacheAffinity> cacheAffinity;
+
+    // 反复失败同一作业的工作机黑名单
+    std::shared_ptr<Scheduler::WorkerBlacklist> workerBlacklist;
+
+    // 已取消的作业
+    std::shared_ptr<Scheduler::JobCancellation> jobCancellation;
+
+    // 服务器配置的默认重试策略
+    inline Scheduler::RetryPolicy defaultRetryPolicy() const
+    {
+        return Scheduler::RetryPolicy{
+            configData_.retry_max_attempts,
+            configData_.retry_backoff_base,
+            configData_.retry_backoff_max,
+        };
+    }
 private:
     inline ServerSingleton()  // 私有构造函数，防止外部实例化
         : server_instance_uuid(boost::uuids::random_generator()())
@@ -1,6 +1,7 @@
 #include "AMQP/AMQPconnectionPool.h"
 #include <drogon/HttpAppFramework.h>
 #include "spdlog/spdlog.h"
+#include <algorithm>
 #include <cstddef>
 #include <memory>
 
@@ -125,4 +126,76 @@ AMQPConnectionPool::make_channel()
 }
 
 
-}// namespace YLineServer
\ No newline at end of file
+void
+AMQPConnectionPool::runWithChannel(std::function<std::size_t(AMQP::Channel &)> && func)
+{
+    static std::atomic<size_t> index = 0;
+    size_t handlerIndex = index.fetch_add(1, std::memory_order_relaxed) % m_AMQPHandler.size();
+    auto handler = m_AMQPHandler[handlerIndex];
+
+    handler->getLoop()->runInLoop
+    (
+        [this, handler, handlerIndex, func = std::move(func)]()
+        {
+            auto connection = handler->getAMQPConnection();
+            if (!connection)
+            {
+                spdlog::error
+                (
+                    "Pool `{0}` AMQP Channel create failed, Connection is not available 通道创建失败, AMQP 连接不可用",
+                    m_pool_name
+                );
+                return;
+            }
+
+            auto channel = std::make_shared<AMQP::Channel>(connection);
+            channel->onError
+            (
+                [this, handlerIndex](const char *message)
+                {
+                    spdlog::error
+                    (
+                        "Pool `{0}` AMQP Channel comes from Handler {1} has error: {2} 来自 Handler {1} 的 AMQP 通道发生错误: {2}",
+                        m_pool_name,
+                        handlerIndex,
+                        message
+                    );
+                }
+            );
+
+            // publisher confirm: broker 按投递标签顺序确认, multiple 表示确认到该标签为止的所有消息
+            auto settled = std::make_shared<std::uint64_t>(0);
+            const auto settle = [settled](std::uint64_t deliveryTag, bool multiple) -> std::uint64_t
+            {
+                const std::uint64_t count = multiple ? deliveryTag - std::min(*settled, deliveryTag) : 1;
+                *settled = std::max(*settled, deliveryTag);
+                return count;
+            };
+            const auto & metrics = handler->metrics();
+            channel->confirmSelect()
+                .onAck([&metrics, settle](std::uint64_t deliveryTag, bool multiple)
+                {
+                    metrics.confirms->inc(settle(deliveryTag, multiple));
+                })
+                .onNack([this, &metrics, settle](std::uint64_t deliveryTag, bool multiple, bool)
+                {
+                    metrics.nacks->inc(settle(deliveryTag, multiple));
+                    spdlog::warn("Pool `{}` broker nacked published message {} 消息发布被 broker 拒绝", m_pool_name, deliveryTag);
+                });
+
+            metrics.publishes->inc(func(*channel));
+
+            // 关闭 Channel, 确认先于关闭帧到达; 完成后再释放, 不能在 Channel 自己的回调中析构它
+            auto holder = std::make_shared<std::shared_ptr<AMQP::Channel>>(channel);
+            channel->close().onFinalize
+            (
+                [holder, loop = handler->getLoop()]()
+                {
+                    loop->queueInLoop([channel = std::move(*holder)]() {});
+                }
+            );
+        }
+    );
+}
+
+}// namespace YLineServer
@@ -5,6 +5,20 @@
 
 namespace YLineServer{
 
+TrantorHandler::HandlerMetrics
+TrantorHandler::makeHandlerMetrics(const std::string & name)
+{
+    auto & registry = YSolowork::util::MetricsRegistry::instance();
+    const YSolowork::util::MetricLabels labels = {{"handler", name}};
+    return HandlerMetrics{
+        &registry.counter("yline_amqp_published_total", "Messages published per AMQP connection", labels),
+        &registry.counter("yline_amqp_confirms_total", "Publisher confirms (ack) per AMQP connection", labels),
+        &registry.counter("yline_amqp_nacks_total", "Publisher negative acknowledgements per AMQP connection", labels),
+        &registry.counter("yline_amqp_sent_bytes_total", "Bytes written to the broker per AMQP connection", labels),
+        &registry.counter("yline_amqp_ready_total", "Times the AMQP connection became ready, reconnects included", labels),
+    };
+}
+
 void
 TrantorHandler::reConnectTcpClient
 (
@@ -114,8 +128,9 @@ TrantorHandler::onData(AMQP::Connection *connection, const char *data, size_t si
 {
     if (m_tcpClient && m_tcpClient->connection()) 
     {
-        spdlog::debug("{} Sending data to TCP connection 发送数据到 TCP 连接", m_name);
+        SPDLOG_DEBUG("{} Sending data to TCP connection 发送数据到 TCP 连接", m_name);
         m_tcpClient->connection()->send(data, size); // 发送数据到 TCP 连接
+        m_metrics.sentBytes->inc(size);
     } 
     // else 
     // {
@@ -128,6 +143,7 @@ TrantorHandler::onReady(AMQP::Connection *connection)
 {
     // the input connection is _amqpConnection
     spdlog::info("{} connection is ready 连接已准备就绪", m_name);
+    m_metrics.ready->inc();
     // 发布重建通道信号
     m_onReconnect.publish();
 }
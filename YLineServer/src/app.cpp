@@ -7,8 +7,13 @@
 #include "utils/logger.h"
 #include "database.h"
 #include "middlewares/YLineServer_CORSMid.h"
+#include "controllers/YLineServer_WorkerCtrl.h"
 #include "utils/api.h"
+#include "utils/metrics.h"
+#include "UTloopMonitor.h"
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <spdlog/logger.h>
 #include <spdlog/spdlog.h>
@@ -41,6 +46,10 @@ void spawnApp(const Config& config, const std::shared_ptr<spdlog::logger> custom
 
     drogon::app().addListener(config.server_ip, config.server_port);
 
+    // 产物分块上传: 请求体上限放宽到一个数据块, 超过 64 KiB 的请求体缓存在临时文件中而不是内存
+    drogon::app().setClientMaxBodySize(std::max<size_t>(config.artifact_max_chunk_bytes + 64 * 1024, 1024 * 1024));
+    drogon::app().setClientMaxMemoryBodySize(64 * 1024);
+
     // 设置自定义 404 页面
     // auto resp404 = drogon::HttpResponse::newNotFoundResponse();
     // resp404->setStatusCode(drogon::k404NotFound);
@@ -110,6 +119,158 @@ void spawnApp(const Config& config, const std::shared_ptr<spdlog::logger> custom
         spdlog::info("CORS middleware enabled 跨域请求中间件已启用");
     }
 
+    // 指标: HTTP 请求延迟和采集时计算的计量, 通过 /metrics 暴露
+    YLineServer::Metrics::install();
+    YLineServer::Metrics::installLoopMonitor(config);
+    app().getLoop()->queueInLoop(&YLineServer::Metrics::watchDrogonLoops);
+
+    // 工作机注册写缓冲, 在主 loop 上合并写入
+    auto & workerWriteBehind = YLineServer::ServerSingleton::getInstance().workerWriteBehind;
+    workerWriteBehind = std::make_shared<YLineServer::DB::WorkerWriteBehind>
+    (
+        config.db_register_batch_delay,
+        config.db_register_batch_size
+    );
+    workerWriteBehind->start(app().getLoop());
+
+    // 工作机存活追踪, 在消费者 I/O 线程就绪后启动
+    auto & livenessTracker = YLineServer::ServerSingleton::getInstance().livenessTracker;
+    livenessTracker = std::make_shared<YLineServer::Components::LivenessTracker>
+    (
+        config.worker_heartbeat_timeout,
+        config.worker_reclaim_grace
+    );
+    livenessTracker->setHeartbeatTimeoutCallback(&YLineServer::WorkerCtrl::disconnectLostWorker);
+    livenessTracker->setDeadCallback(&YLineServer::WorkerCtrl::reclaimDeadWorker);
+
+    // 任务日志存储, 独立的写线程
+    auto & taskLogSink = YLineServer::ServerSingleton::getInstance().taskLogSink;
+    taskLogSink = std::make_shared<YLineServer::Storage::TaskLogSink>
+    (
+        config.task_log_dir,
+        config.task_log_max_pending_bytes
+    );
+    taskLogSink->start();
+
+    // 任务产物存储, 独立的写线程
+    auto & artifactStore = YLineServer::ServerSingleton::getInstance().artifactStore;
+    artifactStore = std::make_shared<YLineServer::Storage::ArtifactStore>(config.artifact_dir);
+    artifactStore->start();
+
+    // 工作机使用率历史, 定期删除长时间没有上报的工作机, 保留时间与最粗的精度一致
+    auto & usageHistory = YLineServer::ServerSingleton::getInstance().usageHistory;
+    usageHistory = std::make_shared<YLineServer::Storage::UsageHistory>
+    (
+        YLineServer::Storage::UsageHistoryOptions{
+            .raw_count = config.usage_history_raw,
+            .minute_count = config.usage_history_minutes,
+            .hour_count = config.usage_history_hours,
+            .max_points = config.usage_history_max_points,
+        }
+    );
+    app().getLoop()->runEvery
+    (
+        600.0,
+        [usageHistory, retention = static_cast<std::int64_t>(config.usage_history_hours) * 3600]()
+        {
+            const auto now = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()
+            ).count();
+            usageHistory->prune(now, retention);
+        }
+    );
+
+    // 调度事件日志, 每个线程写自己的段文件
+    if (config.journal_enable)
+    {
+        YLineServer::ServerSingleton::getInstance().eventJournal = std::make_shared<YLineServer::Storage::EventJournal>
+        (
+            YLineServer::Storage::EventJournalOptions{
+                .dir = config.journal_dir,
+                .segment_records = config.journal_segment_records,
+                .max_segments = config.journal_max_segments,
+            }
+        );
+        spdlog::info("Scheduler event journal 调度事件日志: {}", config.journal_dir.string());
+    }
+
+    // 推测执行, 在消费者 I/O 线程就绪后启动
+    auto & speculation = YLineServer::ServerSingleton::getInstance().speculation;
+    speculation = std::make_shared<YLineServer::Scheduler::Speculation>
+    (
+        YLineServer::Scheduler::SpeculationOptions{
+            .enable = config.speculative_enable,
+            .interval = config.speculative_interval,
+            .percentile = config.speculative_percentile,
+            .multiplier = config.speculative_multiplier,
+            .min_samples = config.speculative_min_samples,
+            .min_runtime = config.speculative_min_runtime,
+        }
+    );
+    speculation->setIdleWorkersCallback(&YLineServer::WorkerCtrl::idleWorkers);
+    speculation->setDispatchCallback(&YLineServer::WorkerCtrl::dispatchSpeculative);
+
+    // 缓存亲和性
+    YLineServer::ServerSingleton::getInstance().cacheAffinity = std::make_shared<YLineServer::Scheduler::CacheAffinity>();
+
+    // 失败重试的工作机黑名单
+    YLineServer::ServerSingleton::getInstance().workerBlacklist = std::make_shared<YLineServer::Scheduler::WorkerBlacklist>
+    (
+        YLineServer::Scheduler::BlacklistOptions{
+            .failures = config.retry_blacklist_failures,
+            .ttl = config.retry_blacklist_ttl,
+            .defer = config.retry_blacklist_defer,
+        }
+    );
+
+    // 已取消的作业
+    YLineServer::ServerSingleton::getInstance().jobCancellation = std::make_shared<YLineServer::Scheduler::JobCancellation>();
+
+    // 集群模式: 加入成员注册表并定时心跳
+    if (config.cluster_enable)
+    {
+        auto & membership = YLineServer::ServerSingleton::getInstance().membership;
+        membership = std::make_shared<YLineServer::Cluster::Membership>
+        (
+            boost::uuids::to_string(YLineServer::ServerSingleton::getInstance().getServerInstanceUUID()),
+            config.cluster_advertise_address,
+            config.cluster_heartbeat_interval,
+            config.cluster_member_ttl
+        );
+        // 成员变化后移交不再属于本实例的工作机
+        membership->setMembershipChangedCallback(&YLineServer::WorkerCtrl::handOffForeignWorkers);
+        // 其他实例上的作业取消/重新提交
+        membership->setBroadcastCallback(
+            YLineServer::WorkerCtrl::jobControlChannel,
+            [](const std::string & message)
+            {
+                Json::Value control;
+                std::string errs;
+                if (!YLineServer::Api::parseJson(message, control, errs) || !control["job_id"].isIntegral())
+                {
+                    spdlog::error("Invalid job control message 无效的作业控制消息: {}", message);
+                    return;
+                }
+                const std::int64_t jobID = control["job_id"].asInt64();
+                if (control["action"].asString() == "cancel")
+                {
+                    YLineServer::WorkerCtrl::cancelJob(jobID);
+                }
+                else if (control["action"].asString() == "resume")
+                {
+                    YLineServer::ServerSingleton::getInstance().jobCancellation->resume(jobID, control["epoch"].asInt64());
+                }
+            }
+        );
+        app().getLoop()->queueInLoop
+        (
+            [membership]()
+            {
+                membership->start(app().getLoop());
+            }
+        );
+    }
+
     // AMQP 连接池 for Producer
     auto & amqpConnectionPool = YLineServer::ServerSingleton::getInstance().amqpConnectionPool;
     app().getLoop()->queueInLoop
@@ -176,40 +337,90 @@ void spawnApp(const Config& config, const std::shared_ptr<spdlog::logger> custom
                         throw std::runtime_error("Queue `default` declare failed, 默认队列声明失败: " + std::string(message));
                     }
                 );
+
+            // 声明隔离队列, 用完重试次数的任务发布到这里, 没有消费者
+            channel->declareQueue(Queue::quarantine_queue(Queue::default_queue), AMQP::durable)
+                .onSuccess
+                (
+                    [](const std::string &name, uint32_t messageCount, uint32_t consumerCount)
+                    {
+                        spdlog::info("Queue `{}` declared Success, {} quarantined tasks 隔离队列声明成功", name, messageCount);
+                    }
+                )
+                .onError
+                (
+                    [](const char *message)
+                    {
+                        throw std::runtime_error("Queue `quarantine` declare failed, 隔离队列声明失败: " + std::string(message));
+                    }
+                );
                 
         }
     );
 
-    // 测试发布消息
-    app().getLoop()->runEvery(
-        2,
-        []()
+    // 初始化消费者线程
+    app().getLoop()->queueInLoop
+    (
+        [ &config ]()
         {
-            // 发布消息
-            auto channel = YLineServer::ServerSingleton::getInstance().amqpConnectionPool->make_channel();
-
-            if (!channel)
-            {
-                spdlog::error("Failed to create AMQP Channel for Producer, 无法创建 AMQP 通道");
-                return;
-            }
-            
-            channel->publish("", Queue::default_queue, "Hello, World!");
+            task::initConsumerLoop(config);
+            YSolowork::util::LoopMonitor::instance().watch(
+                YLineServer::ServerSingleton::getInstance().consumerLoopIOThread->getLoop(), "consumer"
+            );
+            // 回收任务需要操作 Consumer 的 Channel, 所以时间轮运行在消费者 I/O 线程上
+            YLineServer::ServerSingleton::getInstance().livenessTracker->start(
+                YLineServer::ServerSingleton::getInstance().consumerLoopIOThread->getLoop()
+            );
+            // 空闲工作机由 Consumer 的未确认消息数量判断, 同样运行在消费者 I/O 线程上
+            YLineServer::ServerSingleton::getInstance().speculation->start(
+                YLineServer::ServerSingleton::getInstance().consumerLoopIOThread->getLoop()
+            );
         }
     );
 
-    // 初始化消费者线程
+    // 恢复已取消的作业和重新提交过的作业的排队代数, 重启前排队的任务不会因为集合为空而被执行; 数据库客户端只能在 drogon 的 I/O 线程上使用
     app().getLoop()->queueInLoop
     (
-        [ &config ]()
+        []()
         {
-            task::initConsumerLoop(config);
+            app().getIOLoop(0)->queueInLoop(
+                []()
+                {
+                    auto dbClient = app().getFastDbClient("YLinedb");
+                    *dbClient << "SELECT id, status = 'cancelled' AS cancelled, queue_epoch FROM jobs "
+                                 "WHERE status = 'cancelled' OR queue_epoch > 0"
+                              >> [](const drogon::orm::Result & result)
+                              {
+                                  auto & cancellation = YLineServer::ServerSingleton::getInstance().jobCancellation;
+                                  for (const auto & row : result)
+                                  {
+                                      // 已取消的作业丢弃所有消息, 重新提交时广播新的代数
+                                      if (row["cancelled"].as<bool>())
+                                      {
+                                          cancellation->cancel(row["id"].as<int64_t>());
+                                      }
+                                      else
+                                      {
+                                          cancellation->resume(row["id"].as<int64_t>(), row["queue_epoch"].as<int64_t>());
+                                      }
+                                  }
+                                  spdlog::info("Loaded {} cancelled or resumed jobs 已加载取消和重新提交的作业", result.size());
+                              }
+                              >> [](const drogon::orm::DrogonDbException & e)
+                              {
+                                  spdlog::error("Failed to load cancelled jobs 加载取消的作业失败: {}", e.base().what());
+                              };
+                }
+            );
         }
     );
 
     // 启动事件循环
     spdlog::info("Start Listening 开始监听");
     drogon::app().run();
+
+    // 事件循环退出后不再投递探测
+    YSolowork::util::LoopMonitor::instance().stop();
 }
 
 }
\ No newline at end of file
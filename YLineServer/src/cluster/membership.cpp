@@ -0,0 +1,255 @@
+#include "cluster/membership.h"
+#include "utils/metrics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <mutex>
+
+#include <drogon/HttpAppFramework.h>
+#include <drogon/nosql/RedisSubscriber.h>
+#include "drogon/utils/coroutine.h"
+#include <spdlog/spdlog.h>
+
+namespace YLineServer::Cluster
+{
+
+// FNV-1a 64, 不使用 std::hash 以保证不同平台/编译器的实例得到相同的哈希
+inline std::uint64_t
+fnv1a64(std::string_view data, std::uint64_t hash = 14695981039346656037ull) noexcept
+{
+    for (const unsigned char c : data)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::uint64_t
+rendezvousScore(std::string_view instance_uuid, std::string_view key) noexcept
+{
+    std::uint64_t hash = fnv1a64(key, fnv1a64(instance_uuid));
+    // splitmix64 finalizer, 打散 FNV 在相近输入上的相关性
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebull;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+std::optional<Member>
+rendezvousOwner(const std::vector<Member> & members, std::string_view key)
+{
+    if (members.empty())
+    {
+        return std::nullopt;
+    }
+
+    const Member * owner = nullptr;
+    std::uint64_t ownerScore = 0;
+    for (const auto & member : members)
+    {
+        const std::uint64_t score = rendezvousScore(member.instance_uuid, key);
+        // 分数相同时按 uuid 决胜, 保证结果确定
+        if (!owner || score > ownerScore || (score == ownerScore && member.instance_uuid > owner->instance_uuid))
+        {
+            owner = &member;
+            ownerScore = score;
+        }
+    }
+
+    return *owner;
+}
+
+Membership::Membership(
+    const std::string & self_uuid,
+    const std::string & advertise_address,
+    const double heartbeat_interval,
+    const int member_ttl
+) : m_self{self_uuid, advertise_address}, m_heartbeatInterval(heartbeat_interval), m_memberTTL(member_ttl)
+{
+}
+
+void
+Membership::start(trantor::EventLoop * loop)
+{
+    spdlog::info(
+        "Cluster mode enabled, instance {} advertise as {} 集群模式已启用",
+        m_self.instance_uuid,
+        m_self.address
+    );
+    if (!m_broadcastCallbacks.empty())
+    {
+        m_subscriber = drogon::app().getRedisClient("YLineRedis")->newSubscriber();
+        for (const auto & [channel, callback] : m_broadcastCallbacks)
+        {
+            m_subscriber->subscribe(
+                channel,
+                [&callback](const std::string &, const std::string & message) { callback(message); }
+            );
+        }
+    }
+    loop->runInLoop([this]() { heartbeat(); });
+    loop->runEvery(m_heartbeatInterval, [this]() { heartbeat(); });
+}
+
+std::vector<Member>
+Membership::members() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_members;
+}
+
+Member
+Membership::ownerOf(std::string_view key) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    // 本实例还未出现在成员列表中 (刚启动或 Redis 不可用), 不做重定向, 避免把工作机推向未知实例
+    const bool selfListed = std::any_of(
+        m_members.begin(), m_members.end(),
+        [this](const Member & member) { return member.instance_uuid == m_self.instance_uuid; }
+    );
+    if (!selfListed)
+    {
+        return m_self;
+    }
+
+    return rendezvousOwner(m_members, key).value_or(m_self);
+}
+
+bool
+Membership::isOwner(std::string_view key) const
+{
+    return ownerOf(key).instance_uuid == m_self.instance_uuid;
+}
+
+void
+Membership::broadcast(const std::string & channel, const std::string & message) const
+{
+    drogon::app().getRedisClient("YLineRedis")->execCommandAsync(
+        [](const drogon::nosql::RedisResult &) {},
+        [channel](const std::exception & e)
+        {
+            spdlog::error("Failed to broadcast on {} 集群广播失败: {}", channel, e.what());
+        },
+        "PUBLISH %s %s",
+        channel.c_str(),
+        message.c_str()
+    );
+}
+
+void
+Membership::updateMembers(std::vector<Member> && members)
+{
+    std::sort(
+        members.begin(), members.end(),
+        [](const Member & a, const Member & b) { return a.instance_uuid < b.instance_uuid; }
+    );
+
+    bool changed = false;
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        changed = members.size() != m_members.size() || !std::equal(
+            members.begin(), members.end(), m_members.begin(),
+            [](const Member & a, const Member & b) { return a.instance_uuid == b.instance_uuid && a.address == b.address; }
+        );
+        if (changed)
+        {
+            m_members = std::move(members);
+        }
+    }
+
+    if (changed)
+    {
+        std::string memberStrs;
+        for (const auto & member : this->members())
+        {
+            memberStrs += std::format("\t{} - {}\n", member.instance_uuid, member.address);
+        }
+        spdlog::info("Cluster membership changed 集群成员变化:\n{}", memberStrs);
+
+        if (m_onMembershipChanged)
+        {
+            m_onMembershipChanged();
+        }
+    }
+}
+
+void
+Membership::heartbeat()
+{
+    drogon::async_run([this]() -> drogon::Task<void> {
+        // 非 fast 客户端, 心跳不一定运行在 drogon 的 I/O 线程上
+        auto redis = drogon::app().getRedisClient("YLineRedis");
+        const long long now = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count();
+        const long long expired = now - m_memberTTL;
+
+        // 一次心跳包含多条命令, 记录整轮的延迟
+        static auto & latency = Metrics::redisLatency("cluster_heartbeat");
+        const auto start = std::chrono::steady_clock::now();
+        try
+        {
+            co_await redis->execCommandCoro(
+                "HSET ServerInstanceAddress %s %s",
+                m_self.instance_uuid.c_str(),
+                m_self.address.c_str()
+            );
+            co_await redis->execCommandCoro(
+                "ZADD ServerInstances %lld %s",
+                now,
+                m_self.instance_uuid.c_str()
+            );
+
+            // 清理心跳过期的实例, 任何实例都可以执行清理
+            const auto deadResult = co_await redis->execCommandCoro("ZRANGEBYSCORE ServerInstances -inf %lld", expired);
+            for (const auto & dead : deadResult.asArray())
+            {
+                spdlog::warn("Cluster instance {} heartbeat expired 集群实例心跳过期", dead.asString());
+                co_await redis->execCommandCoro("ZREM ServerInstances %s", dead.asString().c_str());
+                co_await redis->execCommandCoro("HDEL ServerInstanceAddress %s", dead.asString().c_str());
+            }
+
+            const auto aliveResult = co_await redis->execCommandCoro("ZRANGEBYSCORE ServerInstances %lld +inf", expired + 1);
+            const auto & alive = aliveResult.asArray();
+            if (alive.empty())
+            {
+                latency.observeSince(start);
+                updateMembers({});
+                co_return;
+            }
+
+            // uuid 不含空格和 %, 可以直接拼接成命令
+            std::string hmget = "HMGET ServerInstanceAddress";
+            for (const auto & uuid : alive)
+            {
+                hmget += " " + uuid.asString();
+            }
+            const auto addressResult = co_await redis->execCommandCoro(hmget);
+            const auto & addresses = addressResult.asArray();
+
+            std::vector<Member> members;
+            members.reserve(alive.size());
+            for (std::size_t i = 0; i < alive.size() && i < addresses.size(); ++i)
+            {
+                if (addresses[i].isNil())
+                {
+                    continue; // 正在退出的实例
+                }
+                members.push_back({alive[i].asString(), addresses[i].asString()});
+            }
+
+            latency.observeSince(start);
+            updateMembers(std::move(members));
+        }
+        catch (const std::exception & e)
+        {
+            spdlog::error("Cluster heartbeat failed 集群心跳失败 - Redis Error 异常: {}", e.what());
+        }
+    });
+}
+
+} // namespace YLineServer::Cluster
@@ -1,5 +1,14 @@
 #include "components/consumer.h"
 #include "utils/server.h"
+#include "utils/api.h"
+#include "utils/metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+#include <drogon/HttpAppFramework.h>
+#include <drogon/orm/DbClient.h>
 
 namespace YLineServer::task
 {
@@ -60,6 +69,240 @@ get_rebuild_Connection_and_signal(const AMQPConnectionPool & pool)
 namespace YLineServer::Components
 {
 
+namespace
+{
+
+// Channel 的代数, 从 1 开始, 0 表示报告中没有代数
+std::atomic<std::uint64_t> g_nextGeneration{1};
+
+using Storage::JournalEvent;
+using Storage::JournalReason;
+
+// 记录投递的调度事件
+void
+journal(JournalEvent event, const boost::uuids::uuid& workerUUID, std::uint64_t deliveryTag, const InFlightDelivery& delivery, JournalReason reason)
+{
+    if (const auto& eventJournal = ServerSingleton::getInstance().eventJournal)
+    {
+        eventJournal->record(event, workerUUID, deliveryTag, delivery.job_id, delivery.task_id, static_cast<std::uint8_t>(reason));
+    }
+}
+
+// 任务声明的输入哈希
+std::vector<std::string>
+inputHashes(const Json::Value& task)
+{
+    std::vector<std::string> hashes;
+    const auto& inputs = task["payload"]["inputs"];
+    if (!inputs.isArray())
+    {
+        return hashes;
+    }
+    for (const auto& input : inputs)
+    {
+        if (input.isObject() && input["hash"].isString())
+        {
+            hashes.push_back(input["hash"].asString());
+        }
+    }
+    return hashes;
+}
+
+// 本工作机没有缓存任务的任何输入, 而另一台在线工作机有缓存且有空闲槽位时, 应当把任务让给它
+// 只对首次投递生效, 退回的任务再次投递时 redelivered 为 true, 不会被反复退回
+bool
+preferCachedWorker(const boost::uuids::uuid& workerUUID, const Json::Value& task, bool redelivered)
+{
+    auto& server = ServerSingleton::getInstance();
+    const auto& cacheAffinity = server.cacheAffinity;
+    if (redelivered || !cacheAffinity || !server.getConfigData().cache_affinity)
+    {
+        return false;
+    }
+    const auto hashes = inputHashes(task);
+    if (hashes.empty() || cacheAffinity->count(workerUUID, hashes) > 0)
+    {
+        return false;
+    }
+
+    for (const auto& holder : cacheAffinity->holders(hashes))
+    {
+        const auto entry = server.workerIndex.find(holder);
+        if (!entry || !entry->online || !entry->wsConnPtr)
+        {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(server.registryMutex);
+        if (!server.Registry.valid(entry->entity))
+        {
+            continue;
+        }
+        if (const auto* consumer = server.Registry.try_get<Consumer>(entry->entity);
+            consumer && consumer->inFlightCount() < consumer->prefetch())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 发布到延迟队列, seconds 秒后回到 queue; 延迟队列在发布前声明, 同一 Channel 上按顺序执行
+// Channel 不可用时返回 false
+bool
+publishDelayed(
+    AMQP::Channel & channel,
+    const std::string & queue,
+    std::uint32_t seconds,
+    const std::string & body,
+    const AMQP::Table & headers,
+    std::uint8_t priority
+)
+{
+    AMQP::Envelope envelope(body.data(), body.size());
+    envelope.setHeaders(headers);
+    envelope.setPriority(priority);
+    envelope.setPersistent(true);
+    envelope.setContentType("application/json");
+
+    if (seconds == 0)
+    {
+        return channel.publish("", queue, envelope);
+    }
+
+    const std::string delayQueue = Queue::retry_queue(queue, seconds);
+    AMQP::Table arguments;
+    arguments["x-message-ttl"] = static_cast<int64_t>(seconds) * 1000;
+    arguments.set("x-dead-letter-exchange", AMQP::LongString(""));
+    arguments.set("x-dead-letter-routing-key", AMQP::LongString(queue));
+    // 闲置的延迟队列自动删除, 期限远大于 TTL, 每次发布前的声明都会重新计时
+    arguments["x-expires"] = static_cast<int64_t>(seconds) * 2000 + 600000;
+    channel.declareQueue(delayQueue, AMQP::durable, arguments)
+        .onError([delayQueue](const char * message) {
+            spdlog::error("Failed to declare retry queue `{}` 声明重试队列失败: {}", delayQueue, message);
+        });
+    return channel.publish("", delayQueue, envelope);
+}
+
+// 原消息已经重新发布, 等待 broker 确认新消息后再确认原消息
+// 发布失败时 Channel 已经不可用, 原消息不确认, 由 broker 在 Channel 关闭时重新入队
+void
+ackAfterConfirm(PendingConfirms & confirms, bool published, std::uint64_t deliveryTag)
+{
+    if (!published)
+    {
+        spdlog::error("Failed to republish delivery {}, left for the broker to requeue 重新发布失败, 原消息由 broker 重新入队", deliveryTag);
+        return;
+    }
+    confirms.originals.emplace(++confirms.published, deliveryTag);
+}
+
+// 关闭已移除消费者的 Channel, 不能在 Channel 自己的回调中析构它
+void
+closeRetired(PendingConfirms & confirms)
+{
+    auto holder = std::make_shared<std::shared_ptr<AMQP::Channel>>(std::move(confirms.retired));
+    (*holder)->close().onFinalize
+    (
+        [holder]()
+        {
+            ServerSingleton::getInstance().consumerLoopIOThread->getLoop()->queueInLoop([channel = std::move(*holder)]() {});
+        }
+    );
+}
+
+// publisher confirm: broker 按确认序号顺序确认, multiple 表示确认到该序号为止的所有消息
+// 新消息被拒绝时原消息退回队列, 这次的重投递信息 (失败次数等) 随之丢失, 但任务不会丢失
+void
+settleConfirms(AMQP::Channel & channel, PendingConfirms & confirms, std::uint64_t tag, bool multiple, bool confirmed)
+{
+    const auto end = confirms.originals.upper_bound(tag);
+    const auto begin = multiple ? confirms.originals.begin() : confirms.originals.find(tag);
+    if (begin == confirms.originals.end() || begin == end)
+    {
+        return;
+    }
+    for (auto it = begin; it != end; ++it)
+    {
+        if (confirmed)
+        {
+            channel.ack(it->second);
+        }
+        else
+        {
+            spdlog::warn("Broker nacked republished delivery {}, requeue the original 重新发布被 broker 拒绝, 原消息退回队列", it->second);
+            channel.reject(it->second, AMQP::requeue);
+        }
+    }
+    confirms.originals.erase(begin, end);
+
+    if (confirms.retired && confirms.originals.empty())
+    {
+        closeRetired(confirms);
+    }
+}
+
+// 发送分发消息, 工作机已经离线时不发送, 回收工作机时未确认的投递会重新入队
+void
+sendDispatch(const boost::uuids::uuid& workerUUID, const Json::Value& dispatch)
+{
+    const auto entry = ServerSingleton::getInstance().workerIndex.find(workerUUID);
+    if (!entry || !entry->online || !entry->wsConnPtr)
+    {
+        return;
+    }
+    entry->wsConnPtr->sendJson(dispatch);
+    SPDLOG_DEBUG(
+        "Task dispatched to Worker {} 任务已分发给工作机, delivery {}",
+        boost::uuids::to_string(workerUUID), dispatch["delivery_tag"].asUInt64()
+    );
+}
+
+// 重新入队的任务先查询最新的检查点, 随分发消息发送, 工作机从检查点恢复
+// 数据库客户端只能在 drogon 的 I/O 线程上使用, 查询失败时照常从头执行
+void
+dispatchWithCheckpoint(const boost::uuids::uuid& workerUUID, Json::Value&& dispatch)
+{
+    const std::uint64_t deliveryTag = dispatch["delivery_tag"].asUInt64();
+    auto* ioLoop = drogon::app().getIOLoop(deliveryTag % drogon::app().getThreadNum());
+    ioLoop->queueInLoop(
+        [workerUUID, dispatch = std::move(dispatch)]() mutable
+        {
+            const std::string taskID = dispatch["task"]["task_id"].asString();
+            const std::int64_t jobID = dispatch["task"]["job_id"].asInt64();
+            auto dispatchPtr = std::make_shared<Json::Value>(std::move(dispatch));
+            static auto & latency = Metrics::dbLatency("checkpoint_lookup");
+            const auto start = std::chrono::steady_clock::now();
+            auto dbClient = drogon::app().getFastDbClient("YLinedb");
+            *dbClient << "SELECT checkpoint::text AS checkpoint FROM tasks "
+                         "WHERE job_id = $1 AND task_id = $2 AND checkpoint IS NOT NULL"
+                      << jobID
+                      << taskID
+                      >> [workerUUID, dispatchPtr, taskID, start](const drogon::orm::Result& result)
+                      {
+                          latency.observeSince(start);
+                          Json::Value checkpoint;
+                          std::string errs;
+                          if (!result.empty() && Api::parseJson(result[0]["checkpoint"].as<std::string>(), checkpoint, errs))
+                          {
+                              spdlog::info(
+                                  "Task {} resumes from checkpoint 任务从检查点恢复: {}",
+                                  taskID, checkpoint["key"].asString()
+                              );
+                              (*dispatchPtr)["checkpoint"] = std::move(checkpoint);
+                          }
+                          sendDispatch(workerUUID, *dispatchPtr);
+                      }
+                      >> [workerUUID, dispatchPtr, taskID](const drogon::orm::DrogonDbException& e)
+                      {
+                          spdlog::error("Failed to query checkpoint of Task {} 查询任务检查点失败: {}", taskID, e.base().what());
+                          sendDispatch(workerUUID, *dispatchPtr);
+                      };
+        }
+    );
+}
+
+}
+
 void // 重建 Channel 的函数
 Consumer::createChannel()
 {
@@ -70,15 +313,34 @@ Consumer::createChannel()
     m_onReconnect = entt::sink {signal};
     m_onReconnect.connect<&Consumer::rebuildChannel>(*this); // 连接重建信号
 
-    // 设置消费者
-    m_channel->consume(this->m_queueName)
-        .onReceived([queueName = this->m_queueName](const AMQP::Message &message, uint64_t deliveryTag, bool redelivered) {
-            spdlog::info("Received message from queue `{0}`: {1}", queueName, std::string(message.body(), message.bodySize()));
+    // 旧 Channel 上未确认的消息会被 broker 重新入队, 不再追踪
+    // 新 Channel 的 delivery tag 从 1 开始, 工作机上旧 Channel 的任务可能仍在以相同的 tag 运行, 用代数区分
+    m_inFlight = std::make_shared<std::unordered_map<std::uint64_t, InFlightDelivery>>();
+    m_generation = g_nextGeneration.fetch_add(1, std::memory_order_relaxed);
+
+    // 重新发布 (回收, 重试, 隔离, 黑名单延后) 的消息得到 broker 确认后才确认原消息
+    m_confirms = std::make_shared<PendingConfirms>();
+    m_channel->confirmSelect()
+        .onAck([channel = m_channel.get(), confirms = m_confirms](std::uint64_t deliveryTag, bool multiple)
+        {
+            settleConfirms(*channel, *confirms, deliveryTag, multiple, true);
         })
-        .onSuccess([queueName = this->m_queueName]() {
-            spdlog::info("Consumer for queue `{0}` has been started", queueName);
+        .onNack([channel = m_channel.get(), confirms = m_confirms](std::uint64_t deliveryTag, bool multiple, bool)
+        {
+            settleConfirms(*channel, *confirms, deliveryTag, multiple, false);
         });
 
+    // 每个工作机最多同时持有 prefetch 个未确认的任务
+    m_channel->setQos(m_prefetch);
+
+    // 暂停期间重建的 Channel 在恢复时才开始消费
+    m_consume->consuming = false;
+    m_consume->consumerTag.clear();
+    if (!m_consume->paused)
+    {
+        startConsuming();
+    }
+
     // 设置错误回调
     m_channel->onError
     (
@@ -96,6 +358,213 @@ Consumer::createChannel()
     );
 }
 
+void
+Consumer::startConsuming()
+{
+    m_consume->consuming = true;
+
+    // 设置消费者, 收到的任务转发给工作机执行, 工作机完成后再确认
+    m_channel->consume(this->m_queueName)
+        .onReceived
+        (
+            [workerUUID = m_workerUUID, channel = m_channel.get(), inFlight = m_inFlight, confirms = m_confirms, queueName = m_queueName, generation = m_generation]
+            (const AMQP::Message &message, uint64_t deliveryTag, bool redelivered)
+            {
+                std::string body(message.body(), message.bodySize());
+                const auto entry = ServerSingleton::getInstance().workerIndex.find(workerUUID);
+                if (!entry || !entry->online || !entry->wsConnPtr)
+                {
+                    // 工作机离线, 交还给其他工作机; 消费者随后由 WorkerCtrl::syncConsumer 暂停, 这里只处理暂停前已经投递的消息
+                    channel->reject(deliveryTag, AMQP::requeue);
+                    return;
+                }
+
+                Json::Value task;
+                std::string errs;
+                if (!Api::parseJson(body, task, errs))
+                {
+                    // 无法解析的任务重新入队也无法执行, 直接丢弃
+                    spdlog::error("Drop malformed task message 丢弃无法解析的任务消息: {}", errs);
+                    channel->reject(deliveryTag);
+                    return;
+                }
+
+                const auto & cancellation = ServerSingleton::getInstance().jobCancellation;
+                if (cancellation && task["job_id"].isIntegral() && cancellation->isCancelled(task["job_id"].asInt64()))
+                {
+                    // 作业已取消, 排队中和延迟重试的任务不再执行
+                    spdlog::info(
+                        "Drop Task {} of cancelled Job {} 丢弃已取消作业的任务",
+                        task["task_id"].asString(), task["job_id"].asInt64()
+                    );
+                    channel->ack(deliveryTag);
+                    return;
+                }
+                if (cancellation && task["job_id"].isIntegral()
+                    && cancellation->isStale(task["job_id"].asInt64(), task["epoch"].isIntegral() ? task["epoch"].asInt64() : 0))
+                {
+                    // 作业取消后重新提交过, 这是取消前发布的消息, 任务已经以新的代数重新发布
+                    spdlog::info(
+                        "Drop Task {} of Job {} from an older queue epoch 丢弃作业重新提交前的任务消息",
+                        task["task_id"].asString(), task["job_id"].asInt64()
+                    );
+                    channel->ack(deliveryTag);
+                    return;
+                }
+
+                const auto & blacklist = ServerSingleton::getInstance().workerBlacklist;
+                if (blacklist && task["job_id"].isIntegral() && blacklist->isBlacklisted(task["job_id"].asInt64(), workerUUID))
+                {
+                    // 本工作机反复失败这个作业的任务, 延迟后交给其他工作机, 不消耗重试次数
+                    // 延迟避免 broker 立即把任务再次投递回来
+                    SPDLOG_DEBUG(
+                        "Task {} deferred, Worker {} is blacklisted for Job {} 工作机在作业黑名单中, 任务延后",
+                        task["task_id"].asString(), boost::uuids::to_string(workerUUID), task["job_id"].asInt64()
+                    );
+                    const bool published = publishDelayed(
+                        *channel,
+                        queueName,
+                        static_cast<std::uint32_t>(std::max(0.0, blacklist->options().defer)),
+                        body,
+                        message.headers(),
+                        message.hasPriority() ? message.priority() : std::uint8_t{0}
+                    );
+                    ackAfterConfirm(*confirms, published, deliveryTag);
+                    return;
+                }
+
+                if (preferCachedWorker(workerUUID, task, redelivered))
+                {
+                    // 退回队列, 让已经缓存了输入的工作机取走
+                    SPDLOG_DEBUG(
+                        "Task {} deferred to a worker caching its inputs 任务让给已缓存输入的工作机",
+                        task["task_id"].asString()
+                    );
+                    channel->reject(deliveryTag, AMQP::requeue);
+                    return;
+                }
+
+                const auto & speculation = ServerSingleton::getInstance().speculation;
+                if (speculation && task["task_id"].isString() && task["job_id"].isIntegral()
+                    && speculation->isCompleted(task["job_id"].asInt64(), task["task_id"].asString()))
+                {
+                    // 推测副本已经成功, 回收重投的原副本不需要再执行
+                    spdlog::info("Task {} already completed by another copy, drop redelivery 任务已由其他副本完成", task["task_id"].asString());
+                    channel->ack(deliveryTag);
+                    return;
+                }
+
+                Json::Value dispatch;
+                dispatch["command"] = "dispatch";
+                dispatch["delivery_tag"] = static_cast<Json::UInt64>(deliveryTag);
+                dispatch["generation"] = static_cast<Json::UInt64>(generation);
+                dispatch["dispatch_ts"] = static_cast<Json::Int64>(
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()
+                    ).count()
+                );
+                dispatch["redelivered"] = redelivered;
+                if (message.hasHeaders() && message.headers().contains(Queue::Headers::redelivery_count))
+                {
+                    dispatch["redelivery_count"] = static_cast<Json::Int64>(
+                        static_cast<int64_t>(message.headers().get(Queue::Headers::redelivery_count))
+                    );
+                }
+                if (message.hasHeaders() && message.headers().contains(Queue::Headers::attempt))
+                {
+                    dispatch["attempt"] = static_cast<Json::Int64>(
+                        static_cast<int64_t>(message.headers().get(Queue::Headers::attempt))
+                    );
+                }
+                dispatch["task"] = std::move(task);
+
+                const auto delivery = inFlight->emplace(
+                    deliveryTag,
+                    InFlightDelivery{
+                        message.exchange(),
+                        message.routingkey(),
+                        std::move(body),
+                        message.headers(),
+                        message.hasPriority() ? message.priority() : std::uint8_t{0},
+                        redelivered,
+                        dispatch["task"]["job_id"].isIntegral() ? dispatch["task"]["job_id"].asInt64() : std::int64_t{0},
+                        dispatch["task"]["task_id"].isString() ? dispatch["task"]["task_id"].asString() : std::string{},
+                        std::chrono::steady_clock::now()
+                    }
+                ).first;
+                if (const auto& eventJournal = ServerSingleton::getInstance().eventJournal)
+                {
+                    // detail 为第几次执行, 从 1 开始
+                    const Json::Int64 attempt = dispatch.get("attempt", 0).asInt64() + 1;
+                    eventJournal->record(
+                        JournalEvent::TaskDispatched, workerUUID, deliveryTag,
+                        delivery->second.job_id, delivery->second.task_id,
+                        static_cast<std::uint8_t>(std::clamp<Json::Int64>(attempt, 1, 255))
+                    );
+                }
+
+                if (speculation)
+                {
+                    speculation->onDispatched(workerUUID, deliveryTag, generation, dispatch["task"]);
+                }
+
+                // 首次投递的任务不可能有检查点, 直接分发
+                const bool requeued = redelivered || dispatch.isMember("redelivery_count") || dispatch.isMember("attempt");
+                if (requeued && dispatch["task"]["task_id"].isString() && dispatch["task"]["job_id"].isIntegral())
+                {
+                    dispatchWithCheckpoint(workerUUID, std::move(dispatch));
+                    return;
+                }
+                sendDispatch(workerUUID, dispatch);
+            }
+        )
+        .onSuccess([queueName = this->m_queueName, channel = m_channel.get(), consume = m_consume](const std::string & consumerTag) {
+            consume->consumerTag = consumerTag;
+            if (consume->paused)
+            {
+                // 等待 broker 确认期间被暂停
+                channel->cancel(consumerTag);
+                consume->consuming = false;
+                consume->consumerTag.clear();
+                return;
+            }
+            spdlog::info("Consumer for queue `{0}` has been started", queueName);
+        });
+}
+
+void
+Consumer::pause()
+{
+    if (m_consume->paused)
+    {
+        return;
+    }
+    m_consume->paused = true;
+    // 还没有得到 consumer tag 时由 onSuccess 取消
+    if (m_channel && m_consume->consuming && !m_consume->consumerTag.empty())
+    {
+        m_channel->cancel(m_consume->consumerTag);
+        m_consume->consuming = false;
+        m_consume->consumerTag.clear();
+    }
+    SPDLOG_DEBUG("Consumer of Worker {} paused 工作机的消费者已暂停", boost::uuids::to_string(m_workerUUID));
+}
+
+void
+Consumer::resume()
+{
+    if (!m_consume->paused)
+    {
+        return;
+    }
+    m_consume->paused = false;
+    if (m_channel && !m_consume->consuming)
+    {
+        startConsuming();
+    }
+    SPDLOG_DEBUG("Consumer of Worker {} resumed 工作机的消费者已恢复", boost::uuids::to_string(m_workerUUID));
+}
+
 void
 Consumer::rebuildChannel()
 {
@@ -103,4 +572,221 @@ Consumer::rebuildChannel()
     createChannel();  // 重建 Channel
 }
 
+void
+Consumer::markStarted(const DeliveryRef & ref)
+{
+    if (ref.generation != m_generation)
+    {
+        return;
+    }
+    const auto it = m_inFlight->find(ref.delivery_tag);
+    if (it != m_inFlight->end() && it->second.job_id == ref.job_id && it->second.task_id == ref.task_id)
+    {
+        it->second.started = true;
+    }
+}
+
+bool
+Consumer::holds(const DeliveryRef & ref) const
+{
+    if (ref.generation != m_generation)
+    {
+        return false;
+    }
+    const auto it = m_inFlight->find(ref.delivery_tag);
+    return it != m_inFlight->end() && it->second.job_id == ref.job_id && it->second.task_id == ref.task_id;
+}
+
+std::unordered_map<std::uint64_t, InFlightDelivery>::iterator
+Consumer::findDelivery(const DeliveryRef & ref, const char * action)
+{
+    if (ref.generation != m_generation)
+    {
+        // 旧 Channel (或者上一次注册) 的投递已经由 broker 重新入队或被回收, 相同的 tag 现在属于其他任务
+        spdlog::warn(
+            "{} stale delivery {} of Task {} on queue `{}`, generation {} != {} 忽略旧 Channel 的投递",
+            action, ref.delivery_tag, ref.task_id, m_queueName, ref.generation, m_generation
+        );
+        return m_inFlight->end();
+    }
+    const auto it = m_inFlight->find(ref.delivery_tag);
+    if (it == m_inFlight->end())
+    {
+        spdlog::warn("{} unknown delivery {} on queue `{}` 未知的投递", action, ref.delivery_tag, m_queueName);
+        return it;
+    }
+    if (it->second.job_id != ref.job_id || it->second.task_id != ref.task_id)
+    {
+        spdlog::error(
+            "{} delivery {} on queue `{}` refused, report is for Task {} of Job {} but delivery is Task {} of Job {} 报告与投递的任务不符",
+            action, ref.delivery_tag, m_queueName, ref.task_id, ref.job_id, it->second.task_id, it->second.job_id
+        );
+        return m_inFlight->end();
+    }
+    return it;
+}
+
+void
+Consumer::ack(const DeliveryRef & ref)
+{
+    const auto it = findDelivery(ref, "Ack");
+    if (it == m_inFlight->end())
+    {
+        return;
+    }
+    journal(JournalEvent::TaskAcked, m_workerUUID, ref.delivery_tag, it->second, JournalReason::None);
+    m_inFlight->erase(it);
+    m_channel->ack(ref.delivery_tag);
+    static auto & acked = Metrics::deliveries("ack");
+    acked.inc();
+}
+
+void
+Consumer::reject(const DeliveryRef & ref, bool requeue)
+{
+    const auto it = findDelivery(ref, "Reject");
+    if (it == m_inFlight->end())
+    {
+        return;
+    }
+    journal(requeue ? JournalEvent::TaskRequeued : JournalEvent::TaskDropped, m_workerUUID, ref.delivery_tag, it->second, JournalReason::Rejected);
+    m_inFlight->erase(it);
+    m_channel->reject(ref.delivery_tag, requeue ? AMQP::requeue : 0);
+    static auto & rejected = Metrics::deliveries("reject");
+    static auto & requeued = Metrics::deliveries("requeue");
+    (requeue ? requeued : rejected).inc();
+}
+
+std::size_t
+Consumer::reclaimInFlight(const std::string & fromWorker, const std::string & reason)
+{
+    const auto now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+
+    std::size_t count = 0;
+    for (auto & [deliveryTag, delivery] : *m_inFlight)
+    {
+        AMQP::Table headers = delivery.headers;
+        const int64_t redeliveryCount = headers.contains(Queue::Headers::redelivery_count)
+            ? static_cast<int64_t>(headers.get(Queue::Headers::redelivery_count))
+            : 0;
+        headers.set(Queue::Headers::redelivery_count, AMQP::LongLong(redeliveryCount + 1));
+        headers.set(Queue::Headers::reclaimed_from, AMQP::LongString(fromWorker));
+        headers.set(Queue::Headers::reclaim_reason, AMQP::LongString(reason));
+        headers.set(Queue::Headers::reclaimed_at, AMQP::LongLong(now));
+
+        AMQP::Envelope envelope(delivery.body.data(), delivery.body.size());
+        envelope.setHeaders(headers);
+        envelope.setPriority(delivery.priority);
+        envelope.setPersistent(true);
+
+        // broker 确认新消息后再确认原消息, 最坏情况下任务被执行两次, 而不会丢失
+        ackAfterConfirm(*m_confirms, m_channel->publish(delivery.exchange, delivery.routingKey, envelope), deliveryTag);
+        journal(JournalEvent::TaskRequeued, m_workerUUID, deliveryTag, delivery, JournalReason::Reclaimed);
+        ++count;
+    }
+    m_inFlight->clear();
+    static auto & reclaimed = Metrics::deliveries("reclaim");
+    reclaimed.inc(count);
+
+    return count;
+}
+
+void
+Consumer::retire()
+{
+    // 不再响应连接重建, 消费者即将被移除
+    m_onReconnect.disconnect();
+    if (!m_channel)
+    {
+        return;
+    }
+
+    // 移除后仍然投递过来的消息找不到工作机, 会被退回队列
+    // 关闭 Channel 会让未确认的原消息重新入队, 等待重新发布的消息都得到确认后再关闭
+    m_confirms->retired = std::move(m_channel);
+    m_confirms->retired->onError
+    (
+        [confirms = m_confirms, queueName = m_queueName](const char * message)
+        {
+            spdlog::error("Retired consumer for queue `{}` has error 已移除消费者的通道发生错误: {}", queueName, message);
+            // 原消息随 Channel 一起由 broker 重新入队
+            confirms->originals.clear();
+            ServerSingleton::getInstance().consumerLoopIOThread->getLoop()->queueInLoop(
+                [channel = std::move(confirms->retired)]() {}
+            );
+        }
+    );
+    if (m_confirms->originals.empty())
+    {
+        closeRetired(*m_confirms);
+    }
+}
+
+FailureDecision
+Consumer::fail(const DeliveryRef & ref, const std::string & failedOn, const std::string & error)
+{
+    FailureDecision decision;
+    const std::uint64_t deliveryTag = ref.delivery_tag;
+    const auto it = findDelivery(ref, "Fail");
+    if (it == m_inFlight->end())
+    {
+        return decision;
+    }
+    decision.found = true;
+    const InFlightDelivery & delivery = it->second;
+
+    // 发布时写入消息的策略, 旧消息没有时使用服务器默认值
+    Scheduler::RetryPolicy policy = ServerSingleton::getInstance().defaultRetryPolicy();
+    Json::Value task;
+    std::string errs;
+    if (Api::parseJson(delivery.body, task, errs) && !Scheduler::applyRetryPolicy(task["retry"], policy, errs))
+    {
+        spdlog::warn("Invalid retry policy in task message, using defaults 任务消息中的重试策略无效, 使用默认值: {}", errs);
+        policy = ServerSingleton::getInstance().defaultRetryPolicy();
+    }
+
+    AMQP::Table headers = delivery.headers;
+    const int64_t failed = headers.contains(Queue::Headers::attempt)
+        ? static_cast<int64_t>(headers.get(Queue::Headers::attempt))
+        : 0;
+    decision.attempt = static_cast<std::uint32_t>(std::max<int64_t>(failed, 0) + 1);
+    decision.max_attempts = policy.max_attempts;
+    headers.set(Queue::Headers::attempt, AMQP::LongLong(decision.attempt));
+    headers.set(Queue::Headers::last_error, AMQP::LongString(error.substr(0, 1024)));
+    headers.set(Queue::Headers::failed_on, AMQP::LongString(failedOn));
+
+    bool published = false;
+    if (decision.attempt < policy.max_attempts)
+    {
+        decision.delay = Scheduler::backoffSeconds(policy, decision.attempt);
+        published = publishDelayed(*m_channel, m_queueName, decision.delay, delivery.body, headers, delivery.priority);
+    }
+    else
+    {
+        // 毒任务隔离, 不再占用工作机的槽位
+        decision.quarantined = true;
+        AMQP::Envelope envelope(delivery.body.data(), delivery.body.size());
+        envelope.setHeaders(headers);
+        envelope.setPriority(delivery.priority);
+        envelope.setPersistent(true);
+        envelope.setContentType("application/json");
+        published = m_channel->publish("", Queue::quarantine_queue(m_queueName), envelope);
+    }
+
+    // 与回收相同, broker 确认新消息后再确认原消息
+    ackAfterConfirm(*m_confirms, published, deliveryTag);
+    journal(
+        decision.quarantined ? JournalEvent::TaskDropped : JournalEvent::TaskRequeued,
+        m_workerUUID, deliveryTag, delivery,
+        decision.quarantined ? JournalReason::Quarantined : JournalReason::Retry
+    );
+    m_inFlight->erase(it);
+    static auto & retried = Metrics::deliveries("retry");
+    static auto & quarantined = Metrics::deliveries("quarantine");
+    (decision.quarantined ? quarantined : retried).inc();
+    return decision;
+}
+
 } // namespace YLineServer::Components
@@ -0,0 +1,160 @@
+#include "components/liveness.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <boost/uuid/uuid_io.hpp>
+#include <spdlog/spdlog.h>
+
+namespace YLineServer::Components
+{
+
+std::size_t LivenessTracker::UuidHash::operator()(const boost::uuids::uuid& uuid) const noexcept
+{
+    return boost::uuids::hash_value(uuid);
+}
+
+LivenessTracker::LivenessTracker(double heartbeat_timeout, double reclaim_grace, double tick_interval)
+    : m_tickInterval(tick_interval),
+      m_heartbeatTimeoutTicks(std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(heartbeat_timeout / tick_interval)))),
+      m_reclaimGraceTicks(std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(reclaim_grace / tick_interval))))
+{
+    // 截止时间距离当前最多 max(timeout, grace) 格, 时间轮多留一格避免绕回到当前槽
+    m_wheel.resize(std::max(m_heartbeatTimeoutTicks, m_reclaimGraceTicks) + 2);
+}
+
+void
+LivenessTracker::start(trantor::EventLoop * loop)
+{
+    spdlog::info(
+        "Worker liveness tracker started, heartbeat timeout {} ticks, reclaim grace {} ticks, tick {}s 工作机存活追踪已启动",
+        m_heartbeatTimeoutTicks, m_reclaimGraceTicks, m_tickInterval
+    );
+    loop->runEvery(m_tickInterval, [this]() { tick(); });
+}
+
+std::uint64_t
+LivenessTracker::deadlineOf(const Entry& entry) const
+{
+    return entry.online
+        ? entry.lastSeen + m_heartbeatTimeoutTicks
+        : entry.offlineSince + m_reclaimGraceTicks;
+}
+
+void
+LivenessTracker::schedule(const boost::uuids::uuid& worker_uuid, const Entry& entry)
+{
+    const std::uint64_t deadline = std::max(deadlineOf(entry), m_currentTick + 1);
+    m_wheel[deadline % m_wheel.size()].emplace_back(worker_uuid, entry.generation);
+}
+
+void
+LivenessTracker::track(const boost::uuids::uuid& worker_uuid)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& entry = m_entries[worker_uuid];
+    entry.online = true;
+    entry.lastSeen = m_currentTick;
+    entry.generation = ++m_nextGeneration;
+    schedule(worker_uuid, entry);
+}
+
+void
+LivenessTracker::heartbeat(const boost::uuids::uuid& worker_uuid)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(worker_uuid);
+    if (it != m_entries.end() && it->second.online)
+    {
+        it->second.lastSeen = m_currentTick;
+    }
+}
+
+void
+LivenessTracker::markOffline(const boost::uuids::uuid& worker_uuid)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(worker_uuid);
+    // 心跳超时时已经转为离线, 不重置宽限期
+    if (it == m_entries.end() || !it->second.online)
+    {
+        return;
+    }
+    it->second.online = false;
+    it->second.offlineSince = m_currentTick;
+    it->second.generation = ++m_nextGeneration;
+    schedule(worker_uuid, it->second);
+}
+
+void
+LivenessTracker::untrack(const boost::uuids::uuid& worker_uuid)
+{
+    // 时间轮中的旧条目在到期时被忽略
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.erase(worker_uuid);
+}
+
+void
+LivenessTracker::tick()
+{
+    std::vector<boost::uuids::uuid> timedOut;
+    std::vector<boost::uuids::uuid> dead;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_currentTick;
+        Slot slot;
+        slot.swap(m_wheel[m_currentTick % m_wheel.size()]);
+
+        for (const auto& [worker_uuid, generation] : slot)
+        {
+            auto it = m_entries.find(worker_uuid);
+            if (it == m_entries.end() || it->second.generation != generation)
+            {
+                continue; // 已失效的条目
+            }
+
+            auto& entry = it->second;
+            if (deadlineOf(entry) > m_currentTick)
+            {
+                // 期间收到了心跳, 截止时间被推后
+                schedule(worker_uuid, entry);
+                continue;
+            }
+
+            if (entry.online)
+            {
+                // 心跳超时, 转为离线并开始回收宽限期, 连接断开时的 markOffline 不再重置
+                timedOut.push_back(worker_uuid);
+                entry.online = false;
+                entry.offlineSince = m_currentTick;
+                entry.generation = ++m_nextGeneration;
+                schedule(worker_uuid, entry);
+            }
+            else
+            {
+                dead.push_back(worker_uuid);
+                m_entries.erase(it);
+            }
+        }
+    }
+
+    // 在锁外调用回调, 回调中可以再次调用 track/markOffline
+    for (const auto& worker_uuid : timedOut)
+    {
+        spdlog::warn("Worker {} heartbeat timeout 工作机心跳超时", boost::uuids::to_string(worker_uuid));
+        if (m_onHeartbeatTimeout)
+        {
+            m_onHeartbeatTimeout(worker_uuid);
+        }
+    }
+    for (const auto& worker_uuid : dead)
+    {
+        spdlog::warn("Worker {} did not come back within grace period 工作机在宽限期内未重连", boost::uuids::to_string(worker_uuid));
+        if (m_onDead)
+        {
+            m_onDead(worker_uuid);
+        }
+    }
+}
+
+} // namespace YLineServer::Components
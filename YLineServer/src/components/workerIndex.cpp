@@ -0,0 +1,302 @@
+#include "components/workerIndex.h"
+
+#include <boost/uuid/uuid_io.hpp>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+namespace YLineServer::Components
+{
+
+std::vector<std::string> workerCapabilities(const Json::Value& workerInfo)
+{
+    std::unordered_set<std::string> capabilities;
+
+    const auto& machineInfo = workerInfo["machineInfo"];
+    if (machineInfo.isObject())
+    {
+        for (const auto& device : machineInfo["devices"])
+        {
+            if (device.isMember("type") && device["type"].isString() && device["type"].asString() != "Unknown")
+            {
+                capabilities.insert(device["type"].asString());
+            }
+        }
+
+        const auto& os = machineInfo["systomInfo"]["OS"];
+        if (os.isString())
+        {
+            capabilities.insert("os:" + os.asString());
+        }
+    }
+
+    if (workerInfo.isMember("NVIDIA") && !workerInfo["NVIDIA"].empty())
+    {
+        capabilities.insert("NVIDIA");
+    }
+
+    return {capabilities.begin(), capabilities.end()};
+}
+
+std::size_t WorkerIndex::UuidHash::operator()(const boost::uuids::uuid& uuid) const noexcept
+{
+    return boost::uuids::hash_value(uuid);
+}
+
+WorkerIndex::Shard& WorkerIndex::shardOf(const boost::uuids::uuid& worker_uuid)
+{
+    return m_shards[UuidHash{}(worker_uuid) % ShardCount];
+}
+
+const WorkerIndex::Shard& WorkerIndex::shardOf(const boost::uuids::uuid& worker_uuid) const
+{
+    return m_shards[UuidHash{}(worker_uuid) % ShardCount];
+}
+
+WorkerIndex::ConnShard& WorkerIndex::connShardOf(const drogon::WebSocketConnectionPtr& wsConnPtr)
+{
+    return m_connShards[std::hash<drogon::WebSocketConnectionPtr>{}(wsConnPtr) % ShardCount];
+}
+
+const WorkerIndex::ConnShard& WorkerIndex::connShardOf(const drogon::WebSocketConnectionPtr& wsConnPtr) const
+{
+    return m_connShards[std::hash<drogon::WebSocketConnectionPtr>{}(wsConnPtr) % ShardCount];
+}
+
+void WorkerIndex::unindex(Shard& shard, const boost::uuids::uuid& worker_uuid, const WorkerIndexEntry& entry)
+{
+    for (const auto& capability : entry.capabilities)
+    {
+        auto it = shard.byCapability.find(capability);
+        if (it != shard.byCapability.end())
+        {
+            it->second.erase(worker_uuid);
+            if (it->second.empty())
+            {
+                shard.byCapability.erase(it);
+            }
+        }
+    }
+
+    shard.byOnline[entry.online].erase(worker_uuid);
+
+    auto it = shard.byServerInstance.find(entry.server_instance_uuid);
+    if (it != shard.byServerInstance.end())
+    {
+        it->second.erase(worker_uuid);
+        if (it->second.empty())
+        {
+            shard.byServerInstance.erase(it);
+        }
+    }
+}
+
+void WorkerIndex::index(Shard& shard, const boost::uuids::uuid& worker_uuid, const WorkerIndexEntry& entry)
+{
+    for (const auto& capability : entry.capabilities)
+    {
+        shard.byCapability[capability].insert(worker_uuid);
+    }
+    shard.byOnline[entry.online].insert(worker_uuid);
+    shard.byServerInstance[entry.server_instance_uuid].insert(worker_uuid);
+}
+
+void WorkerIndex::upsert(const boost::uuids::uuid& worker_uuid, WorkerIndexEntry entry)
+{
+    drogon::WebSocketConnectionPtr oldConn;
+    const drogon::WebSocketConnectionPtr newConn = entry.wsConnPtr;
+    {
+        auto& shard = shardOf(worker_uuid);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.workers.find(worker_uuid);
+        if (it != shard.workers.end())
+        {
+            unindex(shard, worker_uuid, it->second);
+            oldConn = std::move(it->second.wsConnPtr);
+            it->second = std::move(entry);
+        }
+        else
+        {
+            it = shard.workers.emplace(worker_uuid, std::move(entry)).first;
+        }
+        index(shard, worker_uuid, it->second);
+    }
+
+    // 连接索引使用独立的分片锁, 不与工作机分片锁嵌套
+    if (oldConn && oldConn != newConn)
+    {
+        auto& connShard = connShardOf(oldConn);
+        std::unique_lock<std::shared_mutex> lock(connShard.mutex);
+        connShard.connToWorker.erase(oldConn);
+    }
+    if (newConn)
+    {
+        auto& connShard = connShardOf(newConn);
+        std::unique_lock<std::shared_mutex> lock(connShard.mutex);
+        connShard.connToWorker[newConn] = worker_uuid;
+    }
+}
+
+std::optional<WorkerIndexEntry> WorkerIndex::find(const boost::uuids::uuid& worker_uuid) const
+{
+    const auto& shard = shardOf(worker_uuid);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.workers.find(worker_uuid);
+    if (it == shard.workers.end())
+    {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::optional<boost::uuids::uuid> WorkerIndex::findByConnection(const drogon::WebSocketConnectionPtr& wsConnPtr) const
+{
+    const auto& connShard = connShardOf(wsConnPtr);
+    std::shared_lock<std::shared_mutex> lock(connShard.mutex);
+    auto it = connShard.connToWorker.find(wsConnPtr);
+    if (it == connShard.connToWorker.end())
+    {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::optional<WorkerIndexEntry> WorkerIndex::erase(const boost::uuids::uuid& worker_uuid)
+{
+    return eraseIf(worker_uuid, [](const WorkerIndexEntry&) { return true; });
+}
+
+std::optional<WorkerIndexEntry> WorkerIndex::eraseIfOffline(const boost::uuids::uuid& worker_uuid)
+{
+    return eraseIf(worker_uuid, [](const WorkerIndexEntry& entry) { return !entry.online; });
+}
+
+std::optional<WorkerIndexEntry> WorkerIndex::eraseIf(
+    const boost::uuids::uuid& worker_uuid,
+    const std::function<bool(const WorkerIndexEntry&)>& predicate
+)
+{
+    std::optional<WorkerIndexEntry> erased;
+    {
+        auto& shard = shardOf(worker_uuid);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.workers.find(worker_uuid);
+        if (it == shard.workers.end() || !predicate(it->second))
+        {
+            return std::nullopt;
+        }
+        unindex(shard, worker_uuid, it->second);
+        erased = std::move(it->second);
+        shard.workers.erase(it);
+    }
+
+    if (erased->wsConnPtr)
+    {
+        auto& connShard = connShardOf(erased->wsConnPtr);
+        std::unique_lock<std::shared_mutex> lock(connShard.mutex);
+        auto it = connShard.connToWorker.find(erased->wsConnPtr);
+        // 连接可能已经被重新绑定到其他工作机
+        if (it != connShard.connToWorker.end() && it->second == worker_uuid)
+        {
+            connShard.connToWorker.erase(it);
+        }
+    }
+
+    return erased;
+}
+
+bool WorkerIndex::setOnline(const boost::uuids::uuid& worker_uuid, bool online)
+{
+    auto& shard = shardOf(worker_uuid);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.workers.find(worker_uuid);
+    if (it == shard.workers.end())
+    {
+        return false;
+    }
+    if (it->second.online != online)
+    {
+        shard.byOnline[it->second.online].erase(worker_uuid);
+        it->second.online = online;
+        shard.byOnline[online].insert(worker_uuid);
+    }
+    return true;
+}
+
+bool WorkerIndex::rebindConnection(const boost::uuids::uuid& worker_uuid, const drogon::WebSocketConnectionPtr& wsConnPtr)
+{
+    drogon::WebSocketConnectionPtr oldConn;
+    {
+        // 在同一把分片锁内更新连接和在线状态, 不会与 eraseIfOffline 交错
+        auto& shard = shardOf(worker_uuid);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.workers.find(worker_uuid);
+        if (it == shard.workers.end())
+        {
+            return false;
+        }
+        oldConn = std::exchange(it->second.wsConnPtr, wsConnPtr);
+        if (!it->second.online)
+        {
+            shard.byOnline[0].erase(worker_uuid);
+            it->second.online = true;
+            shard.byOnline[1].insert(worker_uuid);
+        }
+    }
+
+    if (oldConn && oldConn != wsConnPtr)
+    {
+        auto& connShard = connShardOf(oldConn);
+        std::unique_lock<std::shared_mutex> lock(connShard.mutex);
+        connShard.connToWorker.erase(oldConn);
+    }
+    if (wsConnPtr)
+    {
+        auto& connShard = connShardOf(wsConnPtr);
+        std::unique_lock<std::shared_mutex> lock(connShard.mutex);
+        connShard.connToWorker[wsConnPtr] = worker_uuid;
+    }
+    return true;
+}
+
+std::vector<boost::uuids::uuid> WorkerIndex::findByCapability(const std::string& capability) const
+{
+    return collect([&capability](const Shard& shard, std::vector<boost::uuids::uuid>& result) {
+        auto it = shard.byCapability.find(capability);
+        if (it != shard.byCapability.end())
+        {
+            result.insert(result.end(), it->second.begin(), it->second.end());
+        }
+    });
+}
+
+std::vector<boost::uuids::uuid> WorkerIndex::findByOnline(bool online) const
+{
+    return collect([online](const Shard& shard, std::vector<boost::uuids::uuid>& result) {
+        result.insert(result.end(), shard.byOnline[online].begin(), shard.byOnline[online].end());
+    });
+}
+
+std::vector<boost::uuids::uuid> WorkerIndex::findByServerInstance(const boost::uuids::uuid& server_instance_uuid) const
+{
+    return collect([&server_instance_uuid](const Shard& shard, std::vector<boost::uuids::uuid>& result) {
+        auto it = shard.byServerInstance.find(server_instance_uuid);
+        if (it != shard.byServerInstance.end())
+        {
+            result.insert(result.end(), it->second.begin(), it->second.end());
+        }
+    });
+}
+
+std::size_t WorkerIndex::size() const
+{
+    std::size_t count = 0;
+    for (const auto& shard : m_shards)
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        count += shard.workers.size();
+    }
+    return count;
+}
+
+} // namespace YLineServer::Components
@@ -1,13 +1,14 @@
 #include "YLineServer_WorkerCtrl.h"
 
 #include "entt/entity/fwd.hpp"
-#include "models/Workers.h"
 #include "spdlog/spdlog.h"
 #include "utils/server.h"
 #include "utils/api.h"
+#include "utils/metrics.h"
 
 #include <boost/uuid/string_generator.hpp>
-#include <future>
+#include <algorithm>
+#include <limits>
 #include <json/value.h>
 #include <mutex>
 
@@ -17,266 +18,420 @@
 using EnTTidType = entt::registry::entity_type;
 
 using namespace YLineServer;
-using namespace drogon_model::yline;
 
-void registerNewWorkerDatabase(
-    const std::string& workerUUID, 
+namespace
+{
+// 移交时等待忙碌工作机排空的检查间隔 (秒)
+constexpr double HANDOFF_RETRY_INTERVAL = 5.0;
+}
+
+// 在工作机索引中同步查找, O(1), 不需要跨线程 future
+EnTTidType findRegisteredWorkerEnTTbyUUID(const boost::uuids::uuid& worker_uuid) noexcept
+{
+    const auto entry = ServerSingleton::getInstance().workerIndex.find(worker_uuid);
+    return entry ? entry->entity : static_cast<EnTTidType>(entt::null);
+}
+
+EnTTidType registerNewWorkerEnTT(
+    const boost::uuids::uuid& worker_uuid, 
+    const boost::uuids::uuid& server_instance_uuid, 
     const Json::Value& workerInfo, 
-    EnTTidType workerEnTTid,
     const WebSocketConnectionPtr& wsConnPtr
 )
 {
-    // database
-    auto dbClient = drogon::app().getFastDbClient("YLinedb");
-    drogon::orm::Mapper<Workers> mapper(dbClient);
-
-    //uuid
-    const std::string& server_instance_uuid = boost::uuids::to_string(ServerSingleton::getInstance().getServerInstanceUUID());
-
-    // 构造 worker 对象
-    Workers worker;
-    worker.setWorkerUuid(workerUUID);
-    worker.setServerInstanceUuid(server_instance_uuid);
-    worker.setWorkerEnttId(static_cast<std::underlying_type_t<EnTTidType>>(workerEnTTid));
-     // 将 Json::Value 的 workerInfo 转换为字符串
-    Json::StreamWriterBuilder writer;
-    const std::string workerInfoStr = Json::writeString(writer, workerInfo);
-    worker.setWorkerInfo(workerInfoStr);
-
-    // 插入数据库 这里需要使用同步
-    mapper.insert(
-        worker,
-        [](const Workers worker)
-        {
-            spdlog::info("New Worker registered into database 新工作机注册到数据库成功: {}", *worker.getWorkerUuid());
-        },
-        [wsConnPtr](const drogon::orm::DrogonDbException &e)
-        {
-            wsConnPtr->shutdown(CloseCode::kUnexpectedCondition, "Failed to register new Worker into database 注册新工作机到数据库失败");
-            spdlog::error("Failed to register new Worker into database 注册新工作机到数据库失败: {}", e.base().what());
+    auto& server = ServerSingleton::getInstance();
+    EnTTidType workerEntity;
+    {
+        std::lock_guard<std::mutex> lock(server.registryMutex);
+        auto &registry = server.Registry;
+        // 注册 worker 实体
+        workerEntity = registry.create();
+        // 添加 worker 元数据组件
+        registry.emplace<Components::Worker>(
+            workerEntity,
+            worker_uuid,
+            server_instance_uuid,
+            workerInfo,
+            wsConnPtr
+        );
+
+        // 添加 consumer 组件, 预取数量为工作机上报的并发槽位数加上 lookahead
+        constexpr Json::UInt maxPrefetch = std::numeric_limits<std::uint16_t>::max();
+        const auto slots = workerInfo.isMember("slots") && workerInfo["slots"].isUInt()
+            ? std::clamp<Json::UInt>(workerInfo["slots"].asUInt(), 1, maxPrefetch)
+            : 1;
+        const auto lookahead = workerInfo.isMember("lookahead") && workerInfo["lookahead"].isUInt()
+            ? std::min<Json::UInt>(workerInfo["lookahead"].asUInt(), maxPrefetch - slots)
+            : 0;
+        registry.emplace<Components::Consumer>(
+            workerEntity,
+            worker_uuid,
+            static_cast<std::uint16_t>(slots),
+            static_cast<std::uint16_t>(lookahead)
+        );
+    }
+
+    // 同时添加到工作机索引
+    server.workerIndex.upsert(
+        worker_uuid,
+        Components::WorkerIndexEntry{
+            .entity = workerEntity,
+            .wsConnPtr = wsConnPtr,
+            .server_instance_uuid = server_instance_uuid,
+            .online = true,
+            .capabilities = Components::workerCapabilities(workerInfo)
         }
     );
-}
+    if (server.eventJournal)
+    {
+        server.eventJournal->record(Storage::JournalEvent::WorkerOnline, worker_uuid);
+    }
 
+    return workerEntity;
+}
 
-EnTTidType findRegisteredWorkerEnTTbyUUIDSync(const boost::uuids::uuid& worker_uuid) noexcept
+// 已注册的工作机重连, 更新其连接, 实体已被回收时返回 false
+bool rebindWorkerEnTT(const boost::uuids::uuid& worker_uuid, EnTTidType workerEnTTid, const WebSocketConnectionPtr& wsConnPtr)
 {
-    auto &registry = ServerSingleton::getInstance().Registry;
-    auto view = registry.view<Components::Worker>();
-    for (auto entity : view)
+    auto& server = ServerSingleton::getInstance();
+    if (!server.workerIndex.rebindConnection(worker_uuid, wsConnPtr))
     {
-        auto& workerMeta = view.get<Components::Worker>(entity);
-        if (workerMeta.worker_uuid == worker_uuid)
-        {
-            return entity;
-        }
+        return false;
     }
 
-    return entt::null;
+    std::lock_guard<std::mutex> lock(server.registryMutex);
+    if (!server.Registry.valid(workerEnTTid))
+    {
+        return false;
+    }
+    if (auto* worker = server.Registry.try_get<Components::Worker>(workerEnTTid))
+    {
+        worker->wsConnPtr = wsConnPtr;
+    }
+    // 离线期间暂停的消费者重新开始接收任务
+    WorkerCtrl::syncConsumer(worker_uuid);
+    return true;
 }
 
-std::shared_future<EnTTidType> findRegisteredWorkerEnTTbyUUIDAsync(const boost::uuids::uuid& worker_uuid)
+void WorkerCtrl::syncConsumer(const boost::uuids::uuid& workerUUID)
 {
-    auto promise = std::make_shared<std::promise<EnTTidType>>();
-    auto future = promise->get_future().share(); // 获取共享 future
-    // 将任务放入事件循环
-    static std::atomic<int> currentThreadIndex{0};
-    int threadNum = drogon::app().getThreadNum();
-    // 获取当前线程索引，并轮询递增
-    int index = currentThreadIndex.fetch_add(1) % threadNum;
-    spdlog::debug("Assigning `findRegisteredWorkerEnTTbyUUIDAsync` task to IOLoop index {}", index);
-    app().getIOLoop(index)->queueInLoop([promise, worker_uuid]() {
-        std::shared_lock<std::shared_mutex> lock(ServerSingleton::getInstance().workerUUIDMapMutex);
-        auto it = ServerSingleton::getInstance().WorkerUUIDtoEnTTid.find(worker_uuid);
-        // 首先在 hash 表中查找
-        if (it != ServerSingleton::getInstance().WorkerUUIDtoEnTTid.end())
+    // Consumer 只能在消费者 I/O 线程上操作, 执行时再读取状态, 期间可能已经再次变化
+    ServerSingleton::getInstance().consumerLoopIOThread->getLoop()->queueInLoop(
+        [workerUUID]()
         {
-            promise->set_value(it->second);
-            return;
+            auto& server = ServerSingleton::getInstance();
+            const auto entry = server.workerIndex.find(workerUUID);
+            if (!entry)
+            {
+                return;
+            }
+            // 离线工作机的消费者会反复收到并退回任务; 等待移交的工作机由 handOffForeignWorkers 排空
+            bool consume = entry->online && entry->wsConnPtr;
+            if (consume && server.membership)
+            {
+                consume = server.membership->ownerOf(boost::uuids::to_string(workerUUID)).instance_uuid
+                    == server.membership->self().instance_uuid;
+            }
+
+            std::lock_guard<std::mutex> lock(server.registryMutex);
+            if (!server.Registry.valid(entry->entity))
+            {
+                return;
+            }
+            if (auto* consumer = server.Registry.try_get<Components::Consumer>(entry->entity))
+            {
+                consume ? consumer->resume() : consumer->pause();
+            }
         }
+    );
+}
 
-        // 旧代码 也许冗余 但是保留
-        auto result = findRegisteredWorkerEnTTbyUUIDSync(worker_uuid);
-        promise->set_value(result);
-    });
+// 工作机仍在本实例的索引中 (在线或者在回收宽限期内)
+bool isTrackedWorker(const std::string& workerUUID) noexcept
+{
+    try
+    {
+        return ServerSingleton::getInstance().workerIndex.find(boost::uuids::string_generator()(workerUUID)).has_value();
+    }
+    catch (const std::runtime_error&)
+    {
+        return false;
+    }
+}
 
-    return future;
+void WorkerCtrl::redirectWorker(const WebSocketConnectionPtr& wsConnPtr, const Cluster::Member& owner)
+{
+    Json::Value json;
+    json["command"] = "redirect";
+    json["server"] = owner.address;
+    wsConnPtr->sendJson(json);
+    // 关闭连接, 由工作机重新连接到所属实例
+    wsConnPtr->shutdown(CloseCode::kNormalClosure, "Redirected to owner instance 重定向到所属实例");
+    spdlog::info(
+        "{} - Worker redirected to instance {} ({}) 工作机被重定向到所属实例", 
+        wsConnPtr->peerAddr().toIpPort(), owner.instance_uuid, owner.address
+    );
 }
 
-EnTTidType registerNewWorkerEnTT(
-    const boost::uuids::uuid& worker_uuid, 
-    const boost::uuids::uuid& server_instance_uuid, 
-    const Json::Value& workerInfo, 
-    const WebSocketConnectionPtr& wsConnPtr
-)
+void WorkerCtrl::handOffForeignWorkers()
 {
-    auto &registry = ServerSingleton::getInstance().Registry;
-    // 注册 worker 实体
-    auto workerEntity = registry.create();
-    // 添加 worker 元数据组件
-    registry.emplace<Components::Worker>(
-        workerEntity,
-        worker_uuid,
-        server_instance_uuid,
-        workerInfo,
-        wsConnPtr
+    const auto& membership = ServerSingleton::getInstance().membership;
+    if (!membership)
+    {
+        return;
+    }
+
+    // 需要读取和暂停 Consumer, 在消费者 I/O 线程上执行
+    const auto loop = ServerSingleton::getInstance().consumerLoopIOThread->getLoop();
+    if (!loop->isInLoopThread())
+    {
+        loop->queueInLoop(&WorkerCtrl::handOffForeignWorkers);
+        return;
+    }
+
+    struct Candidate
+    {
+        EnTTidType entity;
+        WebSocketConnectionPtr wsConnPtr;
+        Cluster::Member owner;
+        bool foreign;
+    };
+    std::vector<Candidate> candidates;
+    ServerSingleton::getInstance().workerIndex.forEach(
+        [&membership, &candidates](const boost::uuids::uuid& workerUUID, const Components::WorkerIndexEntry& entry)
+        {
+            if (!entry.online || !entry.wsConnPtr)
+            {
+                return;
+            }
+            auto owner = membership->ownerOf(boost::uuids::to_string(workerUUID));
+            const bool foreign = owner.instance_uuid != membership->self().instance_uuid;
+            candidates.push_back(Candidate{entry.entity, entry.wsConnPtr, std::move(owner), foreign});
+        }
     );
 
-    // 添加 consumer 组件
-    registry.emplace<Components::Consumer>(workerEntity);
+    // 先收集再发送, 避免持锁时触发 handleConnectionClosed
+    std::vector<std::pair<WebSocketConnectionPtr, Cluster::Member>> foreignWorkers;
+    std::size_t draining = 0;
+    {
+        std::lock_guard<std::mutex> lock(ServerSingleton::getInstance().registryMutex);
+        auto& registry = ServerSingleton::getInstance().Registry;
+        for (auto& candidate : candidates)
+        {
+            auto* consumer = registry.valid(candidate.entity) ? registry.try_get<Components::Consumer>(candidate.entity) : nullptr;
+            if (!candidate.foreign)
+            {
+                // 成员再次变化, 正在移交的工作机又属于本实例
+                if (consumer && consumer->paused())
+                {
+                    consumer->resume();
+                }
+                continue;
+            }
+            if (consumer && consumer->inFlightCount() > 0)
+            {
+                // 重定向后工作机在新实例上继续运行这些任务, 本实例又会在宽限期后重新入队, 任务会执行两次
+                consumer->pause();
+                ++draining;
+                continue;
+            }
+            foreignWorkers.emplace_back(std::move(candidate.wsConnPtr), std::move(candidate.owner));
+        }
+    }
 
-    return workerEntity;
+    if (!foreignWorkers.empty())
+    {
+        spdlog::info("Handing off {} Workers to other instances 移交工作机到其他实例", foreignWorkers.size());
+    }
+    for (const auto& [wsConnPtr, owner] : foreignWorkers)
+    {
+        redirectWorker(wsConnPtr, owner);
+    }
+
+    // 等待正在排空的工作机, 只保留一个定时器
+    static bool retryScheduled = false;
+    if (draining > 0 && !retryScheduled)
+    {
+        spdlog::info("Waiting for {} busy Workers to drain before hand-off 等待忙碌的工作机完成任务后再移交", draining);
+        retryScheduled = true;
+        loop->runAfter(
+            HANDOFF_RETRY_INTERVAL,
+            []()
+            {
+                retryScheduled = false;
+                handOffForeignWorkers();
+            }
+        );
+    }
 }
 
-Workers getUpdateWorker(
-    const Workers& oldWorker, 
-    const Json::Value& workerInfo, 
-    const boost::uuids::uuid& server_instance_uuid,
-    EnTTidType workerEnTTid
-)
+void WorkerCtrl::disconnectLostWorker(const boost::uuids::uuid& workerUUID)
 {
-    Workers updateWorker = oldWorker;
-    updateWorker.setWorkerInfo(Json::writeString(Json::StreamWriterBuilder(), workerInfo));
-    updateWorker.setServerInstanceUuid(boost::uuids::to_string(server_instance_uuid));
-    updateWorker.setWorkerEnttId(static_cast<std::underlying_type_t<EnTTidType>>(workerEnTTid));
-    return updateWorker;
+    const auto entry = ServerSingleton::getInstance().workerIndex.find(workerUUID);
+    if (!entry)
+    {
+        return;
+    }
+    ServerSingleton::getInstance().workerIndex.setOnline(workerUUID, false);
+    syncConsumer(workerUUID);
+    if (const auto& eventJournal = ServerSingleton::getInstance().eventJournal)
+    {
+        eventJournal->record(Storage::JournalEvent::WorkerOffline, workerUUID, Storage::JournalReason::Timeout);
+    }
+    if (entry->wsConnPtr && entry->wsConnPtr->connected())
+    {
+        // 半开连接收不到关闭帧, 直接关闭
+        entry->wsConnPtr->forceClose();
+    }
 }
 
-void updateWorkerDatabase(
-    std::shared_ptr<drogon::orm::Mapper<Workers>> mapper, 
-    const Workers updateWorker, 
-    const std::string& workerUUID, 
-    const WebSocketConnectionPtr& wsConnPtr
-)
+void WorkerCtrl::reclaimDeadWorker(const boost::uuids::uuid& workerUUID)
 {
-    mapper->update(
-        updateWorker,
-        [workerUUID](const size_t count)
+    auto& server = ServerSingleton::getInstance();
+    const std::string workerUUIDStr = boost::uuids::to_string(workerUUID);
+
+    // 仅当工作机仍然离线时移除, 宽限期结束时恰好重连的工作机继续追踪
+    const auto entry = server.workerIndex.eraseIfOffline(workerUUID);
+    if (!entry)
+    {
+        if (server.workerIndex.find(workerUUID))
         {
-            spdlog::info("Worker updated in database 数据库中工作机更新成功: {}", workerUUID);
-        },
-        [wsConnPtr](const drogon::orm::DrogonDbException &e)
+            server.livenessTracker->track(workerUUID);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(server.registryMutex);
+    if (!server.Registry.valid(entry->entity))
+    {
+        return;
+    }
+    if (auto* consumer = server.Registry.try_get<Components::Consumer>(entry->entity))
+    {
+        const auto reclaimed = consumer->reclaimInFlight(workerUUIDStr, "worker lost");
+        if (reclaimed > 0)
         {
-            wsConnPtr->shutdown(CloseCode::kUnexpectedCondition, "Failed to update Worker into database 更新工作机到数据库失败");
-            spdlog::error("Failed to update Worker into database 更新工作机到数据库失败: {}", e.base().what());
+            spdlog::warn("Requeued {} in-flight tasks of lost Worker {} 失联工作机的未完成任务已重新入队", reclaimed, workerUUIDStr);
         }
-    );
+        consumer->retire();
+    }
+    server.Registry.destroy(entry->entity);
+    server.cacheAffinity->remove(workerUUID);
+    spdlog::info("Worker {} removed 工作机已移除", workerUUIDStr);
+
+    // 失联工作机上的推测副本不会再有结果, 等待它们结果的原副本重新入队
+    for (const auto& copy : server.speculation->onWorkerLost(workerUUID))
+    {
+        settleDelivery(copy, false, true);
+    }
 }
 
 void WorkerCtrl::registerWorker(const std::string& workerUUID, const Json::Value& workerInfo, const WebSocketConnectionPtr& wsConnPtr) const
 {   
-    // 发起异步查询 EnTT 注册表， 不阻塞
-    auto workerEnTTfuture = findRegisteredWorkerEnTTbyUUIDAsync(boost::uuids::string_generator()(workerUUID));
+    // 集群模式下, 只有所属实例才能注册工作机, 否则数据库中的所属实例会被互相覆盖
+    // 例外: 本实例仍在追踪的工作机 (移交前断开重连) 可能还持有本实例的任务, 先接受重连, 由 handOffForeignWorkers 排空后再移交
+    if (const auto& membership = ServerSingleton::getInstance().membership)
+    {
+        const auto owner = membership->ownerOf(workerUUID);
+        if (owner.instance_uuid != membership->self().instance_uuid && !isTrackedWorker(workerUUID))
+        {
+            redirectWorker(wsConnPtr, owner);
+            return;
+        }
+    }
 
-    // database
-    auto dbClient = drogon::app().getFastDbClient("YLinedb");
-    auto mapper = std::make_shared<drogon::orm::Mapper<Workers>>(dbClient);
+    // wsCtrl 的回调不支持协程, 在这里启动协程, 不阻塞 I/O 线程
+    drogon::async_run([workerUUID, workerInfo, wsConnPtr, start = std::chrono::steady_clock::now()]() -> drogon::Task<void> {
+        co_await registerWorkerCoro(workerUUID, workerInfo, wsConnPtr, start);
+    });
+}
 
-    // 在数据库中查询工作机，如果则更新，否则注册新工作机
-    mapper->findOne(
-        drogon::orm::Criteria(Workers::Cols::_worker_uuid, drogon::orm::CompareOperator::EQ, workerUUID),
-        [mapper, workerUUID, workerInfo, workerEnTTfuture, wsConnPtr](const Workers& databaseWorker) mutable
-        {
-            spdlog::info("Worker found in database 数据库中找到工作机: {}", workerUUID);
+drogon::Task<void> WorkerCtrl::registerWorkerCoro(const std::string workerUUID, const Json::Value workerInfo, const WebSocketConnectionPtr wsConnPtr, std::chrono::steady_clock::time_point start)
+{
+    boost::uuids::uuid workerUUIDbin;
+    try
+    {
+        workerUUIDbin = boost::uuids::string_generator()(workerUUID);
+    }
+    catch (const std::runtime_error& e)
+    {
+        wsConnPtr->shutdown(CloseCode::kInvalidMessage, "Invalid Worker Register UUID");
+        spdlog::error("{} failed to register as Worker, invalid UUID 注册工作机, 无效的UUID: {}", wsConnPtr->peerAddr().toIpPort(), workerUUID);
+        co_return;
+    }
 
-            // 获取  查询结果
-            const auto& workerEnTTid = workerEnTTfuture.get();
-            if (workerEnTTid != entt::null)
-            {
-                // 数据库和 EnTT 注册表中都找到了工作机, 则说明工作机之前就注册在本实例，所以更新数据库中的 worker 数据为本实例
-                spdlog::info("Worker found in EnTT registry EnTT 注册表中找到工作机: {}", static_cast<std::underlying_type_t<EnTTidType>>(workerEnTTid));
-                Workers updateWorker = getUpdateWorker(
-                    databaseWorker, 
-                    workerInfo, 
-                    ServerSingleton::getInstance().getServerInstanceUUID(),
-                    workerEnTTid
-                );
-                updateWorkerDatabase(mapper, updateWorker, workerUUID, wsConnPtr);
-            }
-            else 
-            {
-                // 数据库中找到了工作机，但是 EnTT 注册表中未找到，说明工作机之前未注册在本实例，所以注册新工作机到 EnTT 注册表，并更新数据库中的 worker 数据为本实例
-                spdlog::info("Worker not found in EnTT registry EnTT 注册表中未找到工作机: {}", workerUUID);
-
-                // 注册新工作机到 EnTT 注册表
-                boost::uuids::string_generator gen;
-                boost::uuids::uuid databaseWorkerUUID = gen(*databaseWorker.getWorkerUuid());
-                boost::uuids::uuid databaseWorker_server_instance_uuid = gen(*databaseWorker.getServerInstanceUuid());
-
-                const auto newWorkerEntity = registerNewWorkerEnTT(
-                    databaseWorkerUUID, 
-                    databaseWorker_server_instance_uuid, 
-                    workerInfo, 
-                    wsConnPtr
-                );
-
-                // 同时添加到 hash 表
-                std::unique_lock<std::shared_mutex> lock(ServerSingleton::getInstance().workerUUIDMapMutex);
-                ServerSingleton::getInstance().WorkerUUIDtoEnTTid[databaseWorkerUUID] = newWorkerEntity;
-                std::unique_lock<std::shared_mutex> lock2(ServerSingleton::getInstance().wsConnMapMutex);
-                ServerSingleton::getInstance().wsConnToWorkerUUID[wsConnPtr] = databaseWorkerUUID;
-                
-
-                spdlog::info(
-                    "New Worker registered into EnTT registry 新工作机注册到 EnTT 注册表成功: {}", 
-                    static_cast<std::underlying_type_t<EnTTidType>>(newWorkerEntity)
-                );
-
-                // 更新数据库中的 worker 数据
-                Workers updateWorker = getUpdateWorker(
-                    databaseWorker, 
-                    workerInfo, 
-                    ServerSingleton::getInstance().getServerInstanceUUID(),
-                    newWorkerEntity
-                );
-
-                // check if entity is really valid
-                // auto& __test = ServerSingleton::getInstance().Registry.get<Worker>(newWorkerEntity);
-                // spdlog::info("Worker UUID: {}", boost::uuids::to_string(__test.worker_uuid));
-
-                updateWorkerDatabase(mapper, updateWorker, workerUUID, wsConnPtr);
-                                
+    const auto& server_instance_uuid = ServerSingleton::getInstance().getServerInstanceUUID();
+
+    // 先在本实例的工作机索引中查找, 重连时只需要更新连接
+    auto workerEnTTid = findRegisteredWorkerEnTTbyUUID(workerUUIDbin);
+    if (workerEnTTid != entt::null && rebindWorkerEnTT(workerUUIDbin, workerEnTTid, wsConnPtr))
+    {
+        spdlog::info("Worker found in EnTT registry EnTT 注册表中找到工作机: {}", static_cast<std::underlying_type_t<EnTTidType>>(workerEnTTid));
+    }
+    else 
+    {
+        // 未找到, 或者在重连的同时被存活追踪回收
+        workerEnTTid = registerNewWorkerEnTT(
+            workerUUIDbin,
+            server_instance_uuid, 
+            workerInfo, 
+            wsConnPtr
+        );
+        spdlog::info(
+            "New Worker registered into EnTT registry 新工作机注册到 EnTT 注册表成功: {}", 
+            static_cast<std::underlying_type_t<EnTTidType>>(workerEnTTid)
+        );
+    }
+
+    ServerSingleton::getInstance().livenessTracker->track(workerUUIDbin);
+
+    // 注册和重连时工作机都会上报完整的缓存列表
+    ServerSingleton::getInstance().cacheAffinity->reset(workerUUIDbin, workerInfo["cache"]);
+
+    // 数据库中不论是否已有该工作机, 都只需要一次 upsert, 所属实例更新为本实例
+    // upsert 进入写缓冲, 与同一时间窗口内其他工作机的注册合并为一条语句
+    try
+    {
+        const auto result = co_await ServerSingleton::getInstance().workerWriteBehind->upsertCoro(
+            DB::WorkerUpsert{
+                .worker_uuid = boost::uuids::to_string(workerUUIDbin),
+                .server_instance_uuid = boost::uuids::to_string(server_instance_uuid),
+                .worker_entt_id = static_cast<int>(static_cast<std::underlying_type_t<EnTTidType>>(workerEnTTid)),
+                .worker_info = DB::writeCompactJson(workerInfo)
             }
-        },
-        [this, workerUUID, workerInfo, wsConnPtr, workerEnTTfuture](const drogon::orm::DrogonDbException &e) mutable
+        );
+
+        if (result.inserted)
+        {
+            spdlog::info("New Worker registered into database 新工作机注册到数据库成功: {}", workerUUID);
+        }
+        else 
         {
-            spdlog::info("Failed to find Worker in database 数据库中未找到工作机: {}", workerUUID);
-            spdlog::debug("Database Exception: {}", e.base().what());
+            spdlog::info("Worker updated in database 数据库中工作机更新成功: {}", workerUUID);
+        }
 
-            // 获取 EnTT 查询结果
-            auto workerEnTTid = workerEnTTfuture.get();
-            if (workerEnTTid != entt::null)
-            {
-                // 数据库中未找到工作机，但是 EnTT 注册表中找到了，说明工作机之前就注册在本实例，所以注册新工作机到数据库
-                spdlog::info("Worker found in EnTT registry EnTT 注册表中找到工作机: {}", static_cast<std::underlying_type_t<EnTTidType>>(workerEnTTid));
-            }
-            else 
-            {
-                // 数据库和 EnTT 注册表中都未找到工作机, 则说明工作机之前未注册在本实例，所以注册新工作机到 EnTT 注册表，并注册到数据库
-                spdlog::info("Worker not found in EnTT registry EnTT 注册表中未找到工作机: {}", workerUUID);
-                boost::uuids::string_generator gen;
-                boost::uuids::uuid newWorkerUUID = gen(workerUUID);
-                workerEnTTid = registerNewWorkerEnTT(
-                    newWorkerUUID,
-                    ServerSingleton::getInstance().getServerInstanceUUID(), 
-                    workerInfo, 
-                    wsConnPtr
-                );
-
-                // 同时添加到 hash 表
-                std::unique_lock<std::shared_mutex> lock(ServerSingleton::getInstance().workerUUIDMapMutex);
-                ServerSingleton::getInstance().WorkerUUIDtoEnTTid[newWorkerUUID] = workerEnTTid;
-                std::unique_lock<std::shared_mutex> lock2(ServerSingleton::getInstance().wsConnMapMutex);
-                ServerSingleton::getInstance().wsConnToWorkerUUID[wsConnPtr] = newWorkerUUID;
-
-                spdlog::info(
-                    "New Worker registered into EnTT registry 新工作机注册到 EnTT 注册表成功: {}", 
-                    static_cast<std::underlying_type_t<EnTTidType>>(workerEnTTid)
-                );
-            }
-            // 注册新工作机到数据库 该函使用本实例 UUID
-            registerNewWorkerDatabase(workerUUID, workerInfo, workerEnTTid, wsConnPtr);
+        // 通知工作机注册完成
+        Json::Value json;
+        json["command"] = "registered";
+        json["id"] = result.id;
+        wsConnPtr->sendJson(json);
+
+        static auto& latency = Metrics::workerRegisterLatency();
+        latency.observeSince(start);
+
+        // 不属于本实例的工作机是因为仍有任务而被接受的, 排空后移交
+        if (const auto& membership = ServerSingleton::getInstance().membership;
+            membership && membership->ownerOf(workerUUID).instance_uuid != membership->self().instance_uuid)
+        {
+            handOffForeignWorkers();
         }
-    );
-    
-}
\ No newline at end of file
+    }
+    catch (const std::exception &e)
+    {
+        // 连接关闭时 handleConnectionClosed 会清理索引和 EnTT 实体
+        wsConnPtr->shutdown(CloseCode::kUnexpectedCondition, "Failed to register Worker into database 注册工作机到数据库失败");
+        spdlog::error("Failed to register Worker into database 注册工作机到数据库失败: {}", e.what());
+    }
+
+    co_return;
+}
@@ -0,0 +1,661 @@
+#include "YLineServer_WorkerCtrl.h"
+#include "YLineServer_JobCtrl.h"
+
+#include "spdlog/spdlog.h"
+#include "utils/server.h"
+#include "utils/metrics.h"
+#include "UTartifact.h"
+
+#include <json/value.h>
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <mutex>
+#include <optional>
+#include <unordered_set>
+
+#include "components/consumer.h"
+#include "scheduler/cacheAffinity.h"
+#include "scheduler/preemption.h"
+#include "db/workerWriteBehind.h"
+#include "scheduler/speculation.h"
+
+using namespace YLineServer;
+
+namespace
+{
+
+// 任务报告对应的副本, 工作机在报告中带回分发时的 delivery tag 和 Channel 代数
+Scheduler::Speculation::CopyRef
+reportedCopy(const boost::uuids::uuid& workerUUID, const Json::Value& reportJson)
+{
+    return Scheduler::Speculation::CopyRef{
+        workerUUID,
+        reportJson["delivery_tag"].asUInt64(),
+        reportJson["generation"].asUInt64(),
+        reportJson["job_id"].asInt64(),
+        reportJson["task_id"].asString()
+    };
+}
+
+} // namespace
+
+void WorkerCtrl::settleDelivery(const Scheduler::Speculation::CopyRef& copy, bool ack, bool requeue)
+{
+    if (Scheduler::isSpeculativeTag(copy.delivery_tag))
+    {
+        return;
+    }
+
+    // Consumer 的 Channel 只能在消费者 I/O 线程上操作
+    ServerSingleton::getInstance().consumerLoopIOThread->getLoop()->queueInLoop(
+        [copy, ack, requeue]()
+        {
+            auto& server = ServerSingleton::getInstance();
+            const auto entry = server.workerIndex.find(copy.worker);
+            if (!entry)
+            {
+                // 工作机已被回收, 任务已经重新入队
+                spdlog::warn(
+                    "Worker {} already removed, ignore delivery {} 工作机已移除, 忽略投递",
+                    boost::uuids::to_string(copy.worker), copy.delivery_tag
+                );
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(server.registryMutex);
+            if (!server.Registry.valid(entry->entity))
+            {
+                return;
+            }
+            if (auto* consumer = server.Registry.try_get<Components::Consumer>(entry->entity))
+            {
+                const Components::DeliveryRef ref{copy.delivery_tag, copy.generation, copy.job_id, copy.task_id};
+                if (ack)
+                {
+                    consumer->ack(ref);
+                }
+                else
+                {
+                    consumer->reject(ref, requeue);
+                }
+            }
+        }
+    );
+}
+
+bool WorkerCtrl::holdsCopy(const Scheduler::Speculation::CopyRef& copy)
+{
+    auto& server = ServerSingleton::getInstance();
+    if (Scheduler::isSpeculativeTag(copy.delivery_tag))
+    {
+        if (!server.speculation)
+        {
+            return false;
+        }
+        const auto copies = server.speculation->copiesOf(copy.job_id);
+        return std::ranges::any_of(copies, [&copy](const Scheduler::Speculation::CopyRef& held) {
+            return held.worker == copy.worker && held.delivery_tag == copy.delivery_tag && held.task_id == copy.task_id;
+        });
+    }
+
+    const auto entry = server.workerIndex.find(copy.worker);
+    if (!entry)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(server.registryMutex);
+    if (!server.Registry.valid(entry->entity))
+    {
+        return false;
+    }
+    const auto* consumer = server.Registry.try_get<Components::Consumer>(entry->entity);
+    return consumer && consumer->holds(Components::DeliveryRef{copy.delivery_tag, copy.generation, copy.job_id, copy.task_id});
+}
+
+void WorkerCtrl::retryDelivery(
+    const Scheduler::Speculation::CopyRef& original,
+    const std::string& failedOn,
+    std::int64_t jobID,
+    const std::string& taskID,
+    std::string error
+)
+{
+    ServerSingleton::getInstance().consumerLoopIOThread->getLoop()->queueInLoop(
+        [original, failedOn, jobID, taskID, error = std::move(error)]()
+        {
+            auto& server = ServerSingleton::getInstance();
+            Components::FailureDecision decision;
+            if (const auto entry = server.workerIndex.find(original.worker))
+            {
+                std::lock_guard<std::mutex> lock(server.registryMutex);
+                if (server.Registry.valid(entry->entity))
+                {
+                    if (auto* consumer = server.Registry.try_get<Components::Consumer>(entry->entity))
+                    {
+                        decision = consumer->fail(
+                            Components::DeliveryRef{original.delivery_tag, original.generation, original.job_id, original.task_id},
+                            failedOn, error
+                        );
+                    }
+                }
+            }
+            if (!decision.found)
+            {
+                // 工作机已被回收, 任务已经重新入队, 不计入失败次数
+                spdlog::warn("Delivery of failed Task {} of Job {} already reclaimed 失败任务的投递已被回收", taskID, jobID);
+                return;
+            }
+
+            if (decision.quarantined)
+            {
+                spdlog::error(
+                    "Task {} of Job {} failed {} times, quarantined 任务失败次数用完, 已隔离: {}",
+                    taskID, jobID, decision.attempt, error
+                );
+            }
+            else
+            {
+                spdlog::info(
+                    "Task {} of Job {} retry {}/{} in {}s 任务将重试",
+                    taskID, jobID, decision.attempt + 1, decision.max_attempts, decision.delay
+                );
+            }
+
+            // 数据库客户端只能在 drogon 的 I/O 线程上使用
+            const std::string status = decision.quarantined ? "quarantined" : "pending";
+            const int attempts = static_cast<int>(decision.attempt);
+            drogon::app().getIOLoop(static_cast<std::size_t>(jobID) % drogon::app().getThreadNum())->queueInLoop(
+                [jobID, taskID, status, attempts, error]()
+                {
+                    static auto& latency = Metrics::dbLatency("task_retry");
+                    const auto start = std::chrono::steady_clock::now();
+                    auto dbClient = drogon::app().getFastDbClient("YLinedb");
+                    *dbClient << "UPDATE tasks SET status = $1::exec_status, attempts = $2, last_error = $3 "
+                                 "WHERE job_id = $4 AND task_id = $5"
+                              << status
+                              << attempts
+                              << error
+                              << jobID
+                              << taskID
+                              >> [start, jobID, status](const drogon::orm::Result&)
+                              {
+                                  latency.observeSince(start);
+                                  if (status == "quarantined")
+                                  {
+                                      // 隔离的任务不再执行, 作业可能已经结束
+                                      drogon::async_run([jobID]() -> drogon::Task<void> { co_await JobCtrl::advanceJob(jobID); });
+                                  }
+                              }
+                              >> [taskID, jobID](const drogon::orm::DrogonDbException& e)
+                              {
+                                  spdlog::error("Failed to record retry of Task {} of Job {} 记录任务重试失败: {}", taskID, jobID, e.base().what());
+                              };
+                }
+            );
+        }
+    );
+}
+
+void WorkerCtrl::cancelCopy(
+    const Scheduler::Speculation::CopyRef& copy,
+    std::optional<double> grace,
+    bool preempt
+)
+{
+    const auto entry = ServerSingleton::getInstance().workerIndex.find(copy.worker);
+    if (!entry || !entry->online || !entry->wsConnPtr)
+    {
+        // 离线工作机上的副本结果到达时会被忽略
+        return;
+    }
+    Json::Value cancel;
+    cancel["command"] = preempt ? "preemptTask" : "cancelTask";
+    cancel["delivery_tag"] = static_cast<Json::UInt64>(copy.delivery_tag);
+    cancel["generation"] = static_cast<Json::UInt64>(copy.generation);
+    cancel["task_id"] = copy.task_id;
+    if (grace)
+    {
+        cancel["grace"] = *grace;
+    }
+    entry->wsConnPtr->sendJson(cancel);
+}
+
+void WorkerCtrl::cancelJob(std::int64_t jobID)
+{
+    auto& server = ServerSingleton::getInstance();
+    if (!server.jobCancellation->cancel(jobID))
+    {
+        return;
+    }
+
+    // 所有投递都经过 Speculation::onDispatched, 正在执行的副本都可以从这里找到
+    const auto copies = server.speculation->copiesOf(jobID);
+    const double grace = server.getConfigData().cancel_grace;
+    for (const auto& copy : copies)
+    {
+        cancelCopy(copy, grace);
+    }
+    spdlog::info("Job {} cancelled, stopping {} running copies 作业已取消, 停止正在执行的副本", jobID, copies.size());
+}
+
+void WorkerCtrl::preemptFor(std::uint8_t priority, std::size_t count)
+{
+    auto& server = ServerSingleton::getInstance();
+    const auto& config = server.getConfigData();
+    std::vector<Scheduler::RunningDelivery> victims;
+    {
+        std::lock_guard<std::mutex> lock(server.registryMutex);
+        std::size_t idle = 0;
+        std::vector<Scheduler::RunningDelivery> candidates;
+        std::unordered_map<boost::uuids::uuid, Components::Consumer*, UuidHash> consumers;
+        for (auto&& [entity, consumer] : server.Registry.view<Components::Consumer>().each())
+        {
+            const auto entry = server.workerIndex.find(consumer.workerUUID());
+            if (!entry || !entry->online || !entry->wsConnPtr)
+            {
+                continue;
+            }
+            consumers.emplace(consumer.workerUUID(), &consumer);
+            if (consumer.inFlightCount() < consumer.slots())
+            {
+                idle += consumer.slots() - consumer.inFlightCount();
+            }
+            for (const auto& [deliveryTag, delivery] : consumer.inFlight())
+            {
+                // 排队中的 lookahead 投递不占用槽位, 抢占它们不能腾出槽位
+                if (delivery.started && !delivery.preempting && delivery.priority < priority)
+                {
+                    candidates.push_back(Scheduler::RunningDelivery{
+                        consumer.workerUUID(), deliveryTag, delivery.priority, delivery.dispatchedAt, delivery.task_id,
+                        consumer.generation(), delivery.job_id
+                    });
+                }
+            }
+        }
+        if (idle >= count)
+        {
+            return;
+        }
+
+        victims = Scheduler::selectVictims(std::move(candidates), priority, std::min(count - idle, config.preempt_max));
+        std::erase_if(victims, [&consumers](const Scheduler::RunningDelivery& victim) {
+            return !consumers.at(victim.worker)->markPreempting(victim.delivery_tag);
+        });
+
+        // 被抢占的工作机上还在排队的低优先级 lookahead 投递也退回队列
+        // 否则腾出的槽位会立即被它们占用, 而不是留给高优先级的任务
+        std::unordered_set<boost::uuids::uuid, UuidHash> victimWorkers;
+        for (const auto& victim : victims)
+        {
+            victimWorkers.insert(victim.worker);
+        }
+        for (const auto& worker : victimWorkers)
+        {
+            auto* consumer = consumers.at(worker);
+            std::vector<Scheduler::RunningDelivery> queued;
+            for (const auto& [deliveryTag, delivery] : consumer->inFlight())
+            {
+                if (!delivery.started && !delivery.preempting && delivery.priority < priority)
+                {
+                    queued.push_back(Scheduler::RunningDelivery{
+                        worker, deliveryTag, delivery.priority, delivery.dispatchedAt, delivery.task_id,
+                        consumer->generation(), delivery.job_id
+                    });
+                }
+            }
+            for (auto& delivery : queued)
+            {
+                consumer->markPreempting(delivery.delivery_tag);
+                victims.push_back(std::move(delivery));
+            }
+        }
+    }
+
+    for (const auto& victim : victims)
+    {
+        spdlog::info(
+            "Preempt Task {} (priority {}) on Worker {} for priority {} 抢占低优先级任务",
+            victim.task_id, victim.priority, boost::uuids::to_string(victim.worker), priority
+        );
+        cancelCopy(
+            Scheduler::Speculation::CopyRef{victim.worker, victim.delivery_tag, victim.generation, victim.job_id, victim.task_id},
+            config.preempt_grace, true
+        );
+    }
+}
+
+std::vector<std::pair<boost::uuids::uuid, std::size_t>> WorkerCtrl::idleWorkers()
+{
+    std::vector<std::pair<boost::uuids::uuid, std::size_t>> idle;
+    auto& server = ServerSingleton::getInstance();
+    std::lock_guard<std::mutex> lock(server.registryMutex);
+    for (const auto& [entity, consumer] : server.Registry.view<Components::Consumer>().each())
+    {
+        // lookahead 预取的任务在工作机上排队, 只有并发槽位有空闲才算空闲
+        if (consumer.inFlightCount() >= consumer.slots())
+        {
+            continue;
+        }
+        const auto entry = server.workerIndex.find(consumer.workerUUID());
+        if (!entry || !entry->online || !entry->wsConnPtr)
+        {
+            continue;
+        }
+        idle.emplace_back(consumer.workerUUID(), consumer.slots() - consumer.inFlightCount());
+    }
+    return idle;
+}
+
+bool WorkerCtrl::dispatchSpeculative(const boost::uuids::uuid& workerUUID, const Json::Value& dispatch)
+{
+    const auto entry = ServerSingleton::getInstance().workerIndex.find(workerUUID);
+    if (!entry || !entry->online || !entry->wsConnPtr)
+    {
+        return false;
+    }
+    entry->wsConnPtr->sendJson(dispatch);
+    return true;
+}
+
+void WorkerCtrl::taskStarted(const Json::Value& reportJson, const WebSocketConnectionPtr& wsConnPtr) const
+{
+    auto& server = ServerSingleton::getInstance();
+    const auto workerUUID = server.workerIndex.findByConnection(wsConnPtr);
+    if (workerUUID && reportJson["delivery_tag"].isUInt64())
+    {
+        const auto self = reportedCopy(*workerUUID, reportJson);
+        server.speculation->onStarted(self.worker, self.delivery_tag, self.generation, self.job_id, self.task_id);
+
+        // 抢占只选择已经开始执行的投递, 还在工作机上排队的 lookahead 投递由 preemptFor 另外处理
+        if (!Scheduler::isSpeculativeTag(self.delivery_tag))
+        {
+            server.consumerLoopIOThread->getLoop()->queueInLoop(
+                [self]()
+                {
+                    auto& server = ServerSingleton::getInstance();
+                    const auto entry = server.workerIndex.find(self.worker);
+                    if (!entry)
+                    {
+                        return;
+                    }
+                    std::lock_guard<std::mutex> lock(server.registryMutex);
+                    if (!server.Registry.valid(entry->entity))
+                    {
+                        return;
+                    }
+                    if (auto* consumer = server.Registry.try_get<Components::Consumer>(entry->entity))
+                    {
+                        consumer->markStarted(Components::DeliveryRef{self.delivery_tag, self.generation, self.job_id, self.task_id});
+                    }
+                }
+            );
+        }
+    }
+
+    spdlog::info(
+        "{} - Task {} of Job {} started 任务已开始, pid: {}, cores 核心: {}, gpus: {}",
+        wsConnPtr->peerAddr().toIpPort(),
+        reportJson["task_id"].asString(),
+        reportJson["job_id"].asInt64(),
+        reportJson["pid"].asInt(),
+        reportJson["cores"].asUInt(),
+        reportJson["gpus"].size()
+    );
+}
+
+void WorkerCtrl::taskFinished(const Json::Value& reportJson, const WebSocketConnectionPtr& wsConnPtr) const
+{
+    const auto workerUUID = ServerSingleton::getInstance().workerIndex.findByConnection(wsConnPtr);
+    if (!workerUUID || !reportJson["delivery_tag"].isUInt64())
+    {
+        spdlog::error("{} - Invalid task report 无效的任务报告", wsConnPtr->peerAddr().toIpPort());
+        return;
+    }
+
+    const std::string taskID = reportJson["task_id"].asString();
+    const std::int64_t jobID = reportJson["job_id"].asInt64();
+    const bool success = reportJson["success"].asBool();
+    const std::uint64_t deliveryTag = reportJson["delivery_tag"].asUInt64();
+    const auto self = reportedCopy(*workerUUID, reportJson);
+
+    auto& server = ServerSingleton::getInstance();
+    if (server.eventJournal)
+    {
+        // detail: 0 失败, 1 成功, 2 被抢占, 3 已取消
+        const std::uint8_t status = reportJson["preempted"].asBool() ? 2 : reportJson["cancelled"].asBool() ? 3 : success ? 1 : 0;
+        server.eventJournal->record(Storage::JournalEvent::TaskCompleted, *workerUUID, deliveryTag, jobID, taskID, status);
+    }
+    if (reportJson["preempted"].asBool())
+    {
+        // 被抢占的任务重新入队, 不计入失败次数, 重新投递时从最近的检查点恢复
+        spdlog::info(
+            "{} - Task {} of Job {} preempted, requeue 任务被抢占, 重新入队",
+            wsConnPtr->peerAddr().toIpPort(), taskID, jobID
+        );
+        settleDelivery(self, false, true);
+        for (const auto& copy : server.speculation->onCancelled(*workerUUID, deliveryTag, self.generation, jobID, taskID))
+        {
+            settleDelivery(copy, false, true);
+        }
+        return;
+    }
+    if (reportJson["cancelled"].asBool() && server.jobCancellation->isCancelled(jobID))
+    {
+        // 作业已取消, 确认消息, 任务不再执行; 数据库中的状态由取消请求更新
+        spdlog::info(
+            "{} - Task {} of Job {} cancelled 任务已取消",
+            wsConnPtr->peerAddr().toIpPort(), taskID, jobID
+        );
+        settleDelivery(self, true);
+        for (const auto& copy : server.speculation->onCancelled(*workerUUID, deliveryTag, self.generation, jobID, taskID))
+        {
+            settleDelivery(copy, true);
+        }
+        return;
+    }
+
+    // 推测执行: 同一任务可能有多个副本, 只有第一个成功的结果 (或者所有副本都失败时的最后一个结果) 生效
+    auto verdict = ServerSingleton::getInstance().speculation->onFinished(
+        *workerUUID, deliveryTag, self.generation, jobID, taskID, success, reportJson["duration"].asDouble()
+    );
+    for (const auto& copy : verdict.cancel)
+    {
+        spdlog::info(
+            "Task {} of Job {} finished by another copy, cancel copy on Worker {} 任务已由其他副本完成, 取消该副本",
+            taskID, jobID, boost::uuids::to_string(copy.worker)
+        );
+        cancelCopy(copy);
+    }
+
+    // 失败的结果生效时, 原副本的消息交给重试处理, 由它重新入队或隔离后确认
+    std::optional<Scheduler::Speculation::CopyRef> original;
+    if (!success && verdict.record)
+    {
+        if (verdict.ack && !Scheduler::isSpeculativeTag(deliveryTag))
+        {
+            original = self;
+            verdict.ack = false;
+        }
+        else if (!verdict.settle.empty())
+        {
+            original = verdict.settle.front();
+            verdict.settle.erase(verdict.settle.begin());
+        }
+    }
+
+    for (const auto& copy : verdict.settle)
+    {
+        settleDelivery(copy, true);
+    }
+    if (verdict.ack)
+    {
+        settleDelivery(self, true);
+    }
+    if (!verdict.record)
+    {
+        spdlog::debug(
+            "{} - Result of Task {} of Job {} ignored, another copy decides 任务副本结果被忽略",
+            wsConnPtr->peerAddr().toIpPort(), taskID, jobID
+        );
+        return;
+    }
+
+    if (success)
+    {
+        spdlog::info(
+            "{} - Task {} of Job {} completed in {:.3f}s 任务已完成",
+            wsConnPtr->peerAddr().toIpPort(), taskID, jobID, reportJson["duration"].asDouble()
+        );
+    }
+    else
+    {
+        spdlog::warn(
+            "{} - Task {} of Job {} failed 任务失败, exit code 退出码: {}, {}",
+            wsConnPtr->peerAddr().toIpPort(), taskID, jobID, reportJson["exit_code"].asInt(), reportJson["error"].asString()
+        );
+
+        if (ServerSingleton::getInstance().workerBlacklist->recordFailure(jobID, *workerUUID))
+        {
+            spdlog::warn(
+                "Worker {} blacklisted for Job {} after repeated failures 工作机反复失败, 加入作业黑名单",
+                boost::uuids::to_string(*workerUUID), jobID
+            );
+        }
+
+        if (original)
+        {
+            std::string error = reportJson["error"].asString();
+            if (error.empty())
+            {
+                error = std::format("exit code {}", reportJson["exit_code"].asInt());
+            }
+            retryDelivery(*original, boost::uuids::to_string(*workerUUID), jobID, taskID, std::move(error));
+            return;
+        }
+    }
+
+    static auto& latency = Metrics::dbLatency("task_status");
+    const auto start = std::chrono::steady_clock::now();
+    auto dbClient = drogon::app().getFastDbClient("YLinedb");
+    *dbClient << "UPDATE tasks SET status = $1::exec_status WHERE job_id = $2 AND task_id = $3"
+              << std::string(success ? "completed" : "failed")
+              << jobID
+              << taskID
+              >> [start, jobID](const drogon::orm::Result&)
+              {
+                  latency.observeSince(start);
+                  // 发布依赖已经全部完成的任务, 或者结束作业
+                  drogon::async_run([jobID]() -> drogon::Task<void> { co_await JobCtrl::advanceJob(jobID); });
+              }
+              >> [taskID, jobID](const drogon::orm::DrogonDbException& e)
+              {
+                  spdlog::error("Failed to update status of Task {} of Job {} 更新任务状态失败: {}", taskID, jobID, e.base().what());
+              };
+}
+
+void WorkerCtrl::taskRejected(const Json::Value& reportJson, const WebSocketConnectionPtr& wsConnPtr) const
+{
+    const auto workerUUID = ServerSingleton::getInstance().workerIndex.findByConnection(wsConnPtr);
+    if (!workerUUID || !reportJson["delivery_tag"].isUInt64())
+    {
+        spdlog::error("{} - Invalid task report 无效的任务报告", wsConnPtr->peerAddr().toIpPort());
+        return;
+    }
+
+    const auto self = reportedCopy(*workerUUID, reportJson);
+    spdlog::warn(
+        "{} - Task {} rejected by Worker, requeue 工作机拒绝任务, 重新入队",
+        wsConnPtr->peerAddr().toIpPort(), self.task_id
+    );
+    settleDelivery(self, false, true);
+
+    // 推测副本被拒绝时, 等待它结果的原副本重新入队
+    const auto requeue = ServerSingleton::getInstance().speculation->onRejected(
+        *workerUUID, self.delivery_tag, self.generation, self.job_id, self.task_id
+    );
+    for (const auto& copy : requeue)
+    {
+        settleDelivery(copy, false, true);
+    }
+}
+
+void WorkerCtrl::cacheUpdate(const Json::Value& updateJson, const WebSocketConnectionPtr& wsConnPtr) const
+{
+    auto& server = ServerSingleton::getInstance();
+    const auto workerUUID = server.workerIndex.findByConnection(wsConnPtr);
+    if (!workerUUID)
+    {
+        return;
+    }
+    server.cacheAffinity->update(*workerUUID, updateJson["added"], updateJson["evicted"]);
+    SPDLOG_TRACE(
+        "{} - Cache update 缓存更新, added 新增: {}, evicted 淘汰: {}",
+        wsConnPtr->peerAddr().toIpPort(), updateJson["added"].size(), updateJson["evicted"].size()
+    );
+}
+
+void WorkerCtrl::taskCheckpoint(const Json::Value& reportJson, const WebSocketConnectionPtr& wsConnPtr) const
+{
+    const auto workerUUID = ServerSingleton::getInstance().workerIndex.findByConnection(wsConnPtr);
+    if (!workerUUID
+        || !reportJson["delivery_tag"].isUInt64()
+        || !reportJson["task_id"].isString()
+        || !reportJson["job_id"].isIntegral()
+        || !reportJson["key"].isString()
+        || !YSolowork::util::isValidArtifactKey(reportJson["key"].asString())
+        || !reportJson["ts"].isInt64())
+    {
+        spdlog::error("{} - Invalid checkpoint report 无效的检查点报告", wsConnPtr->peerAddr().toIpPort());
+        return;
+    }
+
+    const auto copy = reportedCopy(*workerUUID, reportJson);
+    const std::int64_t ts = reportJson["ts"].asInt64();
+
+    Json::Value checkpoint;
+    checkpoint["key"] = reportJson["key"];
+    checkpoint["ts"] = static_cast<Json::Int64>(ts);
+    checkpoint["size"] = reportJson["size"];
+    checkpoint["worker"] = boost::uuids::to_string(*workerUUID);
+
+    spdlog::debug(
+        "{} - Task {} of Job {} checkpoint 任务检查点: {}",
+        wsConnPtr->peerAddr().toIpPort(), copy.task_id, copy.job_id, reportJson["key"].asString()
+    );
+
+    // 检查点会覆盖任务的恢复点, 只接受工作机正在执行的投递 (或推测副本) 的检查点; 未确认的投递只能在消费者 I/O 线程上读取
+    ServerSingleton::getInstance().consumerLoopIOThread->getLoop()->queueInLoop(
+        [copy, ts, checkpoint = DB::writeCompactJson(checkpoint)]()
+        {
+            if (!holdsCopy(copy))
+            {
+                spdlog::warn(
+                    "Ignore checkpoint of Task {} of Job {}, delivery {} (generation {}) not held by Worker {} 工作机没有持有该投递, 忽略检查点",
+                    copy.task_id, copy.job_id, copy.delivery_tag, copy.generation, boost::uuids::to_string(copy.worker)
+                );
+                return;
+            }
+
+            // 数据库客户端只能在 drogon 的 I/O 线程上使用
+            drogon::app().getIOLoop(static_cast<std::size_t>(copy.job_id) % drogon::app().getThreadNum())->queueInLoop(
+                [taskID = copy.task_id, jobID = copy.job_id, ts, checkpoint]()
+                {
+                    // 推测副本和迟到的报告可能乱序到达, 只保留时间最新的检查点
+                    auto dbClient = drogon::app().getFastDbClient("YLinedb");
+                    *dbClient << "UPDATE tasks SET checkpoint = $1::jsonb WHERE job_id = $2 AND task_id = $3 "
+                                 "AND (checkpoint IS NULL OR (checkpoint->>'ts')::bigint < $4)"
+                              << checkpoint
+                              << jobID
+                              << taskID
+                              << ts
+                              >> [](const drogon::orm::Result&) {}
+                              >> [taskID, jobID](const drogon::orm::DrogonDbException& e)
+                              {
+                                  spdlog::error("Failed to record checkpoint of Task {} of Job {} 记录任务检查点失败: {}", taskID, jobID, e.base().what());
+                              };
+                }
+            );
+        }
+    );
+}
@@ -0,0 +1,197 @@
+#include "YLineServer_ArtifactCtrl.h"
+
+#include <charconv>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include "UTartifact.h"
+#include "UThash.h"
+#include "utils/api.h"
+#include "utils/server.h"
+#include "storage/artifactStore.h"
+
+using namespace YLineServer;
+
+namespace
+{
+
+std::optional<std::uint64_t>
+parseUInt64(std::string_view text)
+{
+    std::uint64_t value = 0;
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || end != text.data() + text.size() || text.empty())
+    {
+        return std::nullopt;
+    }
+    return value;
+}
+
+Json::Value
+statusJson(const Storage::ArtifactStatus& status)
+{
+    Json::Value json;
+    json["complete"] = status.complete;
+    json["size"] = static_cast<Json::UInt64>(status.size);
+    if (status.complete)
+    {
+        json["sha256"] = status.sha256;
+    }
+    return json;
+}
+
+HttpResponsePtr
+errorResponse(const HttpRequestPtr& req, HttpStatusCode code, const std::string& error)
+{
+    Json::Value json;
+    json["error"] = error;
+    return Api::makeJsonResponse(json, code, req);
+}
+
+// 校验 key 参数, 失败时直接响应
+bool
+validKey(const HttpRequestPtr& req, const std::function<void(const HttpResponsePtr &)>& callback)
+{
+    if (!YSolowork::util::isValidArtifactKey(req->getParameter("key")))
+    {
+        callback(errorResponse(req, k400BadRequest, "Invalid artifact key 无效的产物 key"));
+        return false;
+    }
+    return true;
+}
+
+std::function<void(Storage::ArtifactResult, const Storage::ArtifactStatus&)>
+resultResponder(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr &)>&& callback)
+{
+    return [req, callback = std::move(callback)](Storage::ArtifactResult result, const Storage::ArtifactStatus& status)
+    {
+        static const std::unordered_map<Storage::ArtifactResult, std::pair<HttpStatusCode, const char*>> results = {
+            {Storage::ArtifactResult::ok, {k200OK, ""}},
+            {Storage::ArtifactResult::offset_mismatch, {k409Conflict, "offset_mismatch"}},
+            {Storage::ArtifactResult::chunk_corrupted, {k422UnprocessableEntity, "chunk_corrupted"}},
+            {Storage::ArtifactResult::file_corrupted, {k422UnprocessableEntity, "file_corrupted"}},
+            {Storage::ArtifactResult::already_complete, {k409Conflict, "already_complete"}},
+            {Storage::ArtifactResult::io_error, {k500InternalServerError, "io_error"}},
+        };
+        const auto& [code, error] = results.at(result);
+        auto json = statusJson(status);
+        if (result != Storage::ArtifactResult::ok)
+        {
+            json["error"] = error;
+        }
+        callback(Api::makeJsonResponse(json, code, req));
+    };
+}
+
+} // namespace
+
+void ArtifactCtrl::status(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr &)>&& callback)
+{
+    if (!validKey(req, callback))
+    {
+        return;
+    }
+    ServerSingleton::getInstance().artifactStore->status(
+        req->getParameter("key"),
+        [req, callback = std::move(callback)](const Storage::ArtifactStatus& status)
+        {
+            callback(Api::makeJsonResponse(statusJson(status), k200OK, req));
+        }
+    );
+}
+
+void ArtifactCtrl::uploadChunk(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr &)>&& callback)
+{
+    if (!validKey(req, callback))
+    {
+        return;
+    }
+    const auto offset = parseUInt64(req->getParameter("offset"));
+    const auto& chunkSha256 = req->getParameter("sha256");
+    if (!offset || !YSolowork::util::isSha256Hex(chunkSha256))
+    {
+        callback(errorResponse(req, k400BadRequest, "Invalid `offset` or `sha256` 无效的 `offset` 或 `sha256`"));
+        return;
+    }
+
+    // 请求体由 req 持有, 写线程写完之前保持有效
+    ServerSingleton::getInstance().artifactStore->write(
+        req->getParameter("key"),
+        *offset,
+        req->body(),
+        chunkSha256,
+        req,
+        resultResponder(req, std::move(callback))
+    );
+}
+
+void ArtifactCtrl::complete(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr &)>&& callback)
+{
+    if (!validKey(req, callback))
+    {
+        return;
+    }
+    const auto& sha256 = req->getParameter("sha256");
+    if (!YSolowork::util::isSha256Hex(sha256))
+    {
+        callback(errorResponse(req, k400BadRequest, "Invalid `sha256` 无效的 `sha256`"));
+        return;
+    }
+    ServerSingleton::getInstance().artifactStore->complete(
+        req->getParameter("key"),
+        sha256,
+        resultResponder(req, std::move(callback))
+    );
+}
+
+void ArtifactCtrl::download(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr &)>&& callback)
+{
+    if (!validKey(req, callback))
+    {
+        return;
+    }
+    const auto& store = ServerSingleton::getInstance().artifactStore;
+    const std::string& key = req->getParameter("key");
+    const auto path = store->completedPath(key);
+    std::error_code ec;
+    const auto size = path.empty() ? 0 : std::filesystem::file_size(path, ec);
+    if (path.empty() || ec)
+    {
+        callback(errorResponse(req, k404NotFound, "Artifact not found 找不到产物"));
+        return;
+    }
+
+    // Range: bytes=<begin>-[<end>], 客户端按段下载, 断点续传
+    std::uint64_t offset = 0;
+    std::uint64_t length = 0; // 0 表示到文件结尾
+    const auto& range = req->getHeader("range");
+    if (!range.empty())
+    {
+        const std::string_view spec(range);
+        const auto dash = spec.find('-');
+        const auto begin = spec.starts_with("bytes=") && dash != std::string_view::npos
+            ? parseUInt64(spec.substr(6, dash - 6)) : std::nullopt;
+        const auto end = dash + 1 < spec.size() ? parseUInt64(spec.substr(dash + 1)) : std::optional<std::uint64_t>{size - 1};
+        if (!begin || !end || *begin > *end || *begin >= size)
+        {
+            auto resp = errorResponse(req, k416RequestedRangeNotSatisfiable, "Invalid range 无效的范围");
+            resp->addHeader("Content-Range", "bytes */" + std::to_string(size));
+            callback(resp);
+            return;
+        }
+        offset = *begin;
+        length = std::min(*end, size - 1) - offset + 1;
+    }
+
+    // 文件内容由 drogon 通过 sendfile 发送, 不经过用户态内存
+    auto resp = HttpResponse::newFileResponse(
+        path.string(),
+        static_cast<size_t>(offset),
+        static_cast<size_t>(length),
+        !range.empty(),
+        "",
+        CT_APPLICATION_OCTET_STREAM
+    );
+    resp->addHeader("X-Content-SHA256", store->completedSha256(key));
+    Api::addCORSHeader(resp, req);
+    callback(resp);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <drogon/HttpController.h>
+
+using namespace drogon;
+
+namespace YLineServer
+{
+// 任务产物的分块上传和下载, 协议见 UTartifact.h
+class ArtifactCtrl : public drogon::HttpController<ArtifactCtrl>
+{
+  public:
+    METHOD_LIST_BEGIN
+    ADD_METHOD_TO(ArtifactCtrl::status, "/api/artifact/status", Get, "YLineServer::WorkerFilter");
+    ADD_METHOD_TO(ArtifactCtrl::uploadChunk, "/api/artifact/chunk", Put, "YLineServer::WorkerFilter");
+    ADD_METHOD_TO(ArtifactCtrl::complete, "/api/artifact/complete", Post, "YLineServer::WorkerFilter");
+    ADD_METHOD_TO(ArtifactCtrl::download, "/api/artifact", Get, "YLineServer::WorkerFilter");
+    METHOD_LIST_END
+
+    void status(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr &)>&& callback);
+    void uploadChunk(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr &)>&& callback);
+    void complete(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr &)>&& callback);
+    void download(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr &)>&& callback);
+};
+}
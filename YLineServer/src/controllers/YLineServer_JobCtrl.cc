@@ -1,14 +1,19 @@
 #include "YLineServer_JobCtrl.h"
 
+#include <chrono>
 #include <cstdint>
 #include "drogon/orm/CoroMapper.h"
 #include <spdlog/spdlog.h>
 #include <vector>
 #include "utils/api.h"
 #include "utils/server.h"
+#include "utils/metrics.h"
 #include "models/Jobs.h"
 #include "models/Tasks.h"
 #include "job.h"
+#include "components/consumer.h"
+#include "db/workerWriteBehind.h"
+#include "YLineServer_WorkerCtrl.h"
 
 using namespace YLineServer;
 using namespace drogon::orm;
@@ -66,6 +71,30 @@ unlockJobatRedis(const int64_t jobId, const std::string &server_instance_uuid, c
     }
 }
 
+void
+broadcastJobControl(const std::string &action, const int64_t jobId, const int64_t epoch = 0)
+{
+    // 集群模式下由所有实例 (包括本实例) 通过广播处理, 否则直接在本实例处理
+    const auto &membership = ServerSingleton::getInstance().membership;
+    if (membership)
+    {
+        Json::Value control;
+        control["action"] = action;
+        control["job_id"] = static_cast<Json::Int64>(jobId);
+        control["epoch"] = static_cast<Json::Int64>(epoch);
+        membership->broadcast(WorkerCtrl::jobControlChannel, DB::writeCompactJson(control));
+        return;
+    }
+    if (action == "cancel")
+    {
+        WorkerCtrl::cancelJob(jobId);
+    }
+    else
+    {
+        ServerSingleton::getInstance().jobCancellation->resume(jobId, epoch);
+    }
+}
+
 drogon::Task<void> 
 JobCtrl::queueJob(const HttpRequestPtr req, std::function<void(const HttpResponsePtr &)> callback)
 {   
@@ -90,6 +119,23 @@ JobCtrl::queueJob(const HttpRequestPtr req, std::function<void(const HttpRespons
     }
     int64_t jobId = (*json)["job_id"].asInt64();
 
+    // 集群模式: 任务由其所属实例处理, 其他实例返回 307 重定向 (保留请求方法和请求体)
+    if (const auto &membership = ServerSingleton::getInstance().membership)
+    {
+        const auto owner = membership->ownerOf(std::format("job:{}", jobId));
+        if (owner.instance_uuid != membership->self().instance_uuid)
+        {
+            auto resp = HttpResponse::newRedirectionResponse(
+                std::format("http://{}{}", owner.address, req->path()),
+                drogon::k307TemporaryRedirect
+            );
+            YLineServer::Api::addCORSHeader(resp, req);
+            callback(resp);
+            spdlog::info("Job - {} queue request redirected to instance {} 任务请求被重定向到所属实例", jobId, owner.address);
+            co_return;
+        }
+    }
+
     // 验证身份, 获取提交此操作的用户
     const auto &payload = req->attributes()->get<Json::Value>("JWTpayload");
     if (!payload.isMember("username") && !payload["username"].isString()) 
@@ -127,11 +173,14 @@ JobCtrl::queueJob(const HttpRequestPtr req, std::function<void(const HttpRespons
     try
     {
         // note %d not $d, this string format, not sql format
+        static auto &latency = Metrics::redisLatency("job_lock");
+        const auto start = std::chrono::steady_clock::now();
         const auto redis_lock_Result = co_await redis->execCommandCoro(
             "SET JobLock:%d %s NX",
             jobId,
             server_instance_uuid.c_str() // need to convert to c string
         );
+        latency.observeSince(start);
 
         if (redis_lock_Result.isNil()) 
         {
@@ -147,37 +196,41 @@ JobCtrl::queueJob(const HttpRequestPtr req, std::function<void(const HttpRespons
 
     // ------------------ below here, when error occurs, we need to unlock the job ------------------
 
-    // job lock acquired, now we can query job's tasks from database
-    drogon::orm::CoroMapper<Tasks> taskMapper(dbClient);
-    std::vector<Tasks> tasks;
+    // 重新提交已取消的作业: 取消的任务恢复为 pending, 排队代数加一
+    // 取消前发布的消息 (包括延迟重试的) 代数更旧, 各实例消费时丢弃, 不会和下面重新发布的副本重复执行
+    // 已结束的作业中有改回 pending 的任务 (例如人工处理后的隔离任务) 时同样重新打开, 新的代数让这些任务可以再次发布
     try
     {
-        tasks = co_await taskMapper.orderBy(
-            Tasks::Cols::_task_order, 
-            SortOrder::ASC
-        )
-        .findBy(
-            Criteria(
-                Tasks::Cols::_job_id,  
-                CompareOperator::EQ, 
-                // jobId // this will cause error, it's needs to be int.....
-                static_cast<int>(jobId)
-            )
+        const auto resumed = co_await dbClient->execSqlCoro(
+            "UPDATE jobs SET status = 'pending', queue_epoch = queue_epoch + 1 "
+            "WHERE id = $1 AND (status = 'cancelled' OR (status IN ('completed', 'failed', 'quarantined') "
+            "AND EXISTS (SELECT 1 FROM tasks WHERE job_id = $1 AND status = 'pending'))) RETURNING queue_epoch",
+            static_cast<int>(jobId)
         );
-
-        for(const auto &task : tasks)
+        if (!resumed.empty())
         {
-            spdlog::info(
-                "Task - {} {} {} {} {} {}",
-                *task.getTaskId(),
-                *task.getTaskName(),
-                *task.getTaskOrder(),
-                *task.getJobId(),
-                *task.getDependency(),
-                *task.getStatus()
+            co_await dbClient->execSqlCoro(
+                "UPDATE tasks SET status = 'pending' WHERE job_id = $1 AND status = 'cancelled'",
+                static_cast<int>(jobId)
             );
+            broadcastJobControl("resume", jobId, resumed.front()["queue_epoch"].as<int64_t>());
+            spdlog::info("Job - {} resumed by {} 已取消或已结束的作业重新提交", jobId, submit_user);
         }
     }
+    catch (const drogon::orm::DrogonDbException &e)
+    {
+        failedResp(req, "queueJob", std::format("Resume Job - Database Error 数据库异常: {}", e.base().what()), callback);
+        unlockJobatRedis(jobId, server_instance_uuid, "Resume Job - Database Error 数据库异常");
+        co_return;
+    }
+
+    // job lock acquired, now we can publish job's tasks
+    // 只有依赖全部完成的任务可以立即执行, 其他任务保持 pending, 依赖完成时由 advanceJob 发布
+    std::size_t queued = 0;
+    try
+    {
+        queued = co_await publishReadyTasks(jobId);
+    }
     catch (const drogon::orm::DrogonDbException &e) 
     {
         failedResp(req, "queueJob", std::format("Find Tasks - Database Error 数据库异常: {}", e.base().what()), callback);
@@ -186,9 +239,220 @@ JobCtrl::queueJob(const HttpRequestPtr req, std::function<void(const HttpRespons
         co_return;   
     }
 
-    // we get job and it's tasks, now we can queue the job
-    
+    Json::Value respJson;
+    respJson["job_id"] = static_cast<Json::Int64>(jobId);
+    respJson["queued_tasks"] = static_cast<Json::UInt64>(queued);
+    callback(YLineServer::Api::makeJsonResponse(respJson, drogon::k200OK, req));
 
     spdlog::info("Job - {} request execute from {} has being queued 任务请求执行成功, 已进入队列", jobId, submit_user);
     co_return;
-}
\ No newline at end of file
+}
+drogon::Task<void>
+JobCtrl::cancelJob(const HttpRequestPtr req, std::function<void(const HttpResponsePtr &)> callback)
+{
+    const auto json = req->getJsonObject();
+    if (!json)
+    {
+        failedResp(req, "cancelJob", "Invalid JSON 无效的 JSON", callback);
+        co_return;
+    }
+    if (!(*json)["job_id"].isInt64())
+    {
+        failedResp(req, "cancelJob", "Invalid JSON: `job_id` must be an integer `job_id` 类型错误", callback);
+        co_return;
+    }
+    const int64_t jobId = (*json)["job_id"].asInt64();
+
+    const auto &payload = req->attributes()->get<Json::Value>("JWTpayload");
+    const std::string submit_user = payload["username"].asString();
+
+    // 先更新数据库, 之后报告的任务结果不会覆盖 cancelled; 已经完成或失败的任务保持原状态
+    auto dbClient = drogon::app().getFastDbClient("YLinedb");
+    std::size_t cancelledTasks = 0;
+    try
+    {
+        const auto updated = co_await dbClient->execSqlCoro(
+            "UPDATE jobs SET status = 'cancelled' WHERE id = $1 AND status = 'pending' RETURNING id",
+            static_cast<int>(jobId)
+        );
+        if (updated.empty())
+        {
+            failedResp(req, "cancelJob", "Job not found or already finished 作业不存在或已结束", callback);
+            co_return;
+        }
+        const auto tasks = co_await dbClient->execSqlCoro(
+            "UPDATE tasks SET status = 'cancelled' WHERE job_id = $1 AND status = 'pending'",
+            static_cast<int>(jobId)
+        );
+        cancelledTasks = tasks.affectedRows();
+    }
+    catch (const drogon::orm::DrogonDbException &e)
+    {
+        failedResp(req, "cancelJob", std::format("Cancel Job - Database Error 数据库异常: {}", e.base().what()), callback);
+        co_return;
+    }
+
+    broadcastJobControl("cancel", jobId);
+
+    // queueJob 获取的作业锁没有过期时间, 入队成功后一直持有, 防止同一作业重复入队
+    // 取消后释放, 否则重新提交 (queue) 拿不到锁, 无法走到恢复已取消作业的流程; 在响应之前释放, 取消后立即重新提交也能成功
+    try
+    {
+        co_await drogon::app().getFastRedisClient("YLineRedis")->execCommandCoro("DEL JobLock:%lld", static_cast<long long>(jobId));
+    }
+    catch (const std::exception &e)
+    {
+        spdlog::error("Job - {} cancelled but failed to release Job Lock 作业已取消, 释放作业锁失败: {}", jobId, e.what());
+    }
+
+    Json::Value respJson;
+    respJson["job_id"] = static_cast<Json::Int64>(jobId);
+    respJson["cancelled_tasks"] = static_cast<Json::UInt64>(cancelledTasks);
+    callback(YLineServer::Api::makeJsonResponse(respJson, drogon::k200OK, req));
+
+    spdlog::info("Job - {} cancelled by {} 作业已取消, {} tasks", jobId, submit_user, cancelledTasks);
+    co_return;
+}
+
+drogon::Task<std::size_t>
+JobCtrl::publishReadyTasks(const std::int64_t jobId)
+{
+    // 认领和读取在同一条语句中: 多个依赖同时完成时, 行锁让后到的请求看到 queued_epoch 已经更新, 任务只发布一次
+    // payload 不在 ORM 模型中, 使用原始查询
+    auto dbClient = drogon::app().getFastDbClient("YLinedb");
+    static auto &latency = Metrics::dbLatency("job_tasks");
+    const auto start = std::chrono::steady_clock::now();
+    const auto tasks = co_await dbClient->execSqlCoro(
+        "WITH ready AS ("
+        "UPDATE tasks t SET queued_epoch = j.queue_epoch FROM jobs j "
+        "WHERE j.id = t.job_id AND t.job_id = $1 AND j.status = 'pending' AND t.status = 'pending' "
+        "AND t.queued_epoch IS DISTINCT FROM j.queue_epoch "
+        "AND NOT EXISTS ("
+        "SELECT 1 FROM tasks d WHERE d.job_id = t.job_id AND t.depends_on @> jsonb_build_array(d.task_id) AND d.status <> 'completed'"
+        ") "
+        "RETURNING t.task_id, t.task_name, t.task_order, t.payload::text AS payload, "
+        "COALESCE(j.retry_policy::text, '') AS retry_policy, j.priority, j.queue_epoch"
+        ") SELECT * FROM ready ORDER BY task_order ASC",
+        static_cast<int>(jobId)
+    );
+    latency.observeSince(start);
+    if (tasks.empty())
+    {
+        co_return 0;
+    }
+
+    // 每个任务作为一条持久化消息发布到默认队列, 由各工作机的 Consumer 取走执行
+    std::vector<std::string> messages;
+    messages.reserve(tasks.size());
+    const std::uint8_t priority = static_cast<std::uint8_t>(tasks.front()["priority"].as<int>());
+    const int64_t epoch = tasks.front()["queue_epoch"].as<int64_t>();
+    for (const auto &row : tasks)
+    {
+        Json::Value payload;
+        std::string errs;
+        if (!YLineServer::Api::parseJson(row["payload"].as<std::string>(), payload, errs))
+        {
+            payload = Json::Value(Json::objectValue);
+        }
+
+        // 服务器默认值 <- 作业的策略 <- 任务的 payload.retry, 提交时已经校验过
+        Scheduler::RetryPolicy retry = ServerSingleton::getInstance().defaultRetryPolicy();
+        Json::Value jobRetry;
+        if (!row["retry_policy"].as<std::string>().empty()
+            && YLineServer::Api::parseJson(row["retry_policy"].as<std::string>(), jobRetry, errs))
+        {
+            Scheduler::applyRetryPolicy(jobRetry, retry, errs);
+        }
+        Scheduler::applyRetryPolicy(payload["retry"], retry, errs);
+
+        Json::Value message;
+        message["job_id"] = static_cast<Json::Int64>(jobId);
+        message["task_id"] = row["task_id"].as<std::string>();
+        message["task_name"] = row["task_name"].as<std::string>();
+        message["payload"] = std::move(payload);
+        message["retry"] = Scheduler::retryPolicyToJson(retry);
+        message["priority"] = priority;
+        message["epoch"] = static_cast<Json::Int64>(epoch);
+        messages.push_back(DB::writeCompactJson(message));
+        if (const auto &eventJournal = ServerSingleton::getInstance().eventJournal)
+        {
+            eventJournal->record(
+                Storage::JournalEvent::TaskQueued, boost::uuids::uuid{}, 0, jobId, message["task_id"].asString(), priority
+            );
+        }
+    }
+
+    ServerSingleton::getInstance().amqpConnectionPool->runWithChannel(
+        [messages = std::move(messages), priority](AMQP::Channel &channel)
+        {
+            for (const auto &body : messages)
+            {
+                AMQP::Envelope envelope(body.data(), body.size());
+                envelope.setPersistent(true);
+                envelope.setContentType("application/json");
+                envelope.setPriority(priority);
+                channel.publish("", Queue::default_queue, envelope);
+            }
+            return messages.size();
+        }
+    );
+
+    // 高优先级作业: 空闲槽位不够时抢占本实例工作机上优先级更低的任务
+    const auto &config = ServerSingleton::getInstance().getConfigData();
+    if (config.preempt_enable && priority >= config.preempt_priority)
+    {
+        ServerSingleton::getInstance().consumerLoopIOThread->getLoop()->queueInLoop(
+            [priority, count = tasks.size()]()
+            {
+                WorkerCtrl::preemptFor(priority, count);
+            }
+        );
+    }
+
+    co_return tasks.size();
+}
+
+drogon::Task<void>
+JobCtrl::advanceJob(const std::int64_t jobId)
+{
+    try
+    {
+        const auto published = co_await publishReadyTasks(jobId);
+        if (published > 0)
+        {
+            spdlog::info("Job - {} released {} tasks whose dependencies completed 依赖已完成的任务进入队列", jobId, published);
+            co_return;
+        }
+
+        // 没有 pending 的任务时作业结束; 依赖于隔离任务的任务保持 pending, 作业也保持 pending, 等待人工处理后重新提交
+        auto dbClient = drogon::app().getFastDbClient("YLinedb");
+        const auto finished = co_await dbClient->execSqlCoro(
+            "UPDATE jobs SET status = (CASE WHEN EXISTS (SELECT 1 FROM tasks WHERE job_id = $1 AND status <> 'completed') "
+            "THEN 'failed' ELSE 'completed' END)::exec_status "
+            "WHERE id = $1 AND status = 'pending' "
+            "AND NOT EXISTS (SELECT 1 FROM tasks WHERE job_id = $1 AND status IN ('pending', 'cancelled')) "
+            "RETURNING status::text AS status",
+            static_cast<int>(jobId)
+        );
+        if (finished.empty())
+        {
+            co_return;
+        }
+        spdlog::info("Job - {} finished 作业已结束: {}", jobId, finished.front()["status"].as<std::string>());
+    }
+    catch (const drogon::orm::DrogonDbException &e)
+    {
+        spdlog::error("Job - {} failed to advance 推进作业失败: {}", jobId, e.base().what());
+        co_return;
+    }
+
+    // 作业结束, 释放作业锁, 之后可以再次提交 (例如隔离的任务改回 pending 后)
+    try
+    {
+        co_await drogon::app().getFastRedisClient("YLineRedis")->execCommandCoro("DEL JobLock:%lld", static_cast<long long>(jobId));
+    }
+    catch (const std::exception &e)
+    {
+        spdlog::error("Job - {} finished but failed to release Job Lock 作业已结束, 释放作业锁失败: {}", jobId, e.what());
+    }
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <drogon/HttpController.h>
+#include <cstddef>
+#include <cstdint>
 #include "drogon/utils/coroutine.h"
 
 
@@ -19,12 +21,32 @@ class JobCtrl : public drogon::HttpController<JobCtrl>
       Post,
       "YLineServer::LoginFilter"
     );
+    ADD_METHOD_TO(
+      JobCtrl::cancelJob,
+      "/api/job/cancel",
+      Post,
+      "YLineServer::LoginFilter"
+    );
 
     METHOD_LIST_END
+
+  // 认领并发布作业中所有可以执行的任务: pending, 依赖全部完成, 并且在当前排队代数中还没有发布过, 返回发布的数量
+  // 作业排队和任务完成时调用, 数据库异常时抛出 drogon::orm::DrogonDbException
+  static drogon::Task<std::size_t>
+  publishReadyTasks(std::int64_t jobId);
+
+  // 任务状态变化后推进作业: 发布依赖已完成的任务, 所有任务都结束后把作业标记为 completed (有失败的任务时为 failed)
+  static drogon::Task<void>
+  advanceJob(std::int64_t jobId);
+
   private:
 
   drogon::Task<void> 
   queueJob(const HttpRequestPtr req, std::function<void(const HttpResponsePtr &)> callback);
+
+  // 取消作业: 排队中的任务不再执行, 正在执行的任务在服务器配置的 cancel_grace 秒内结束, 重新提交 (queue) 后恢复
+  drogon::Task<void>
+  cancelJob(const HttpRequestPtr req, std::function<void(const HttpResponsePtr &)> callback);
   
 };
 }
@@ -4,6 +4,7 @@
 #include <spdlog/spdlog.h>
 #include "utils/api.h"
 #include "utils/server.h"
+#include "utils/metrics.h"
 #include "models/Jobs.h"
 
 using namespace YLineServer;
@@ -106,6 +107,8 @@ void JobStatusCtrl::handleNewMessage(const WebSocketConnectionPtr& wsConnPtr, st
 
 void JobStatusCtrl::handleNewConnection(const HttpRequestPtr &req, const WebSocketConnectionPtr& wsConnPtr)
 {
+    static auto& connections = Metrics::wsConnections("JobStatusCtrl");
+    connections.inc();
     const auto &wsPeerAddr = wsConnPtr->peerAddr();
     spdlog::debug("{} connected to JobCtrl WebSocket", wsPeerAddr.toIpPort());
     CommandsetJobCount(wsConnPtr);
@@ -113,6 +116,8 @@ void JobStatusCtrl::handleNewConnection(const HttpRequestPtr &req, const WebSock
 
 void JobStatusCtrl::handleConnectionClosed(const WebSocketConnectionPtr& wsConnPtr)
 {
+    static auto& connections = Metrics::wsConnections("JobStatusCtrl");
+    connections.dec();
     const auto &wsPeerAddr = wsConnPtr->peerAddr();
     spdlog::debug("{} disconnected from JobCtrl WebSocket", wsPeerAddr.toIpPort());
 }
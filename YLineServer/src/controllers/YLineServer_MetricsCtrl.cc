@@ -0,0 +1,15 @@
+#include "YLineServer_MetricsCtrl.h"
+
+#include "UTmetrics.h"
+
+using namespace YLineServer;
+
+void MetricsCtrl::asyncHandleHttpRequest(const HttpRequestPtr& req, std::function<void (const HttpResponsePtr &)> &&callback)
+{
+    // 各线程的分片在这里汇总, 采集本身不阻塞写入指标的线程
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setStatusCode(drogon::k200OK);
+    resp->setContentTypeString("text/plain; version=0.0.4; charset=utf-8");
+    resp->setBody(YSolowork::util::MetricsRegistry::instance().render());
+    callback(resp);
+}
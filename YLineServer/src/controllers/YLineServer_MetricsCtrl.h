@@ -0,0 +1,22 @@
+#pragma once
+
+#include <drogon/HttpSimpleController.h>
+
+using namespace drogon;
+
+namespace YLineServer
+{
+// Prometheus 采集端点, 只允许内网访问
+class MetricsCtrl : public drogon::HttpSimpleController<MetricsCtrl>
+{
+  public:
+    void asyncHandleHttpRequest(const HttpRequestPtr& req, std::function<void (const HttpResponsePtr &)> &&callback) override;
+    PATH_LIST_BEGIN
+    // list path definitions here;
+    // PATH_ADD("/path", "filter1", "filter2", HttpMethod1, HttpMethod2...);
+
+    PATH_ADD("/metrics", Get, "drogon::IntranetIpFilter");
+
+    PATH_LIST_END
+};
+}
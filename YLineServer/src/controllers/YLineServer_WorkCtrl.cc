@@ -8,10 +8,10 @@
 #include <unordered_map>
 #include <vector>
 #include "utils/api.h"
+#include "db/workerWriteBehind.h"
+#include "scheduler/retry.h"
+#include "scheduler/dag.h"
 
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/topological_sort.hpp>
-#include <boost/graph/exception.hpp> // 包含异常定义
 
 using namespace YLineServer;
 
@@ -57,183 +57,6 @@ WorkCtrl::validJobJson(const Json::Value &json, std::string &err)
     return true;
 }
 
-bool
-resolve_DAG
-(
-    std::vector<Components::Task> &task_Components,
-    const std::unordered_map<std::string, std::size_t> &taskID2Index,
-    const std::unordered_map<std::string, std::vector<std::string>> &Dependency,
-    std::string &err
-)
-{
-    using namespace boost;
-    using Graph = boost::adjacency_list<vecS, vecS, directedS>;
-
-    // build DAG
-    Graph DAG(task_Components.size());
-    for(const auto& [task_id, dependencies]: Dependency)
-    {
-        for(const auto& dependency: dependencies)
-        {   
-            // 添加依赖，表示 task_id 依赖于 dependency
-            add_edge(taskID2Index.at(dependency), taskID2Index.at(task_id), DAG);
-        }
-    }
-
-    // topological sort
-    try
-    {
-        std::vector<Graph::vertex_descriptor> sorted;
-        boost::topological_sort(DAG, std::back_inserter(sorted));
-        std::reverse(sorted.begin(), sorted.end()); // reverse the order
-
-        // print the sorted order
-        std::size_t order = 0;
-        for(auto v: sorted)
-        {
-            // correct the order
-            task_Components[v].order = order;
-            order++;
-        }
-    }
-    catch (const boost::not_a_dag &e)
-    {
-        err = "DAG Error: The task dependency resolved a cycle, 任务依赖关系形成了环";
-        return false;
-    }
-
-    return true;
-}
-
-bool
-WorkCtrl::resolveTasks(const Json::Value &json, std::string &err, std::vector<Components::Task> &task_Components, bool dependency)
-{
-    // job id needs to be gerenated by the database
-    // const std::string &job_id = json["job_id"].asString();
-    // std::vector<Components::Task> task_Components; // use pass in reference instead of return value
-
-    // valid task dict is actually done here
-    std::unordered_set<std::string> taskIDSet;
-    for (std::size_t i = 0; i < json["tasks"].size(); i++) 
-    {
-        const auto &task = json["tasks"].get(i, Json::nullValue);
-
-        
-        if (!task.isMember("task_id"))
-        {
-            err = "JSON Error: Missing `task_id` field in task, 缺少 `task_id` 字段";
-            return false;
-        }
-
-        if (!task["task_id"].isString())
-        {
-            err = "JSON Error: `task_id` field should be a string, `task_id` 字段应为字符串";
-            return false;
-        }
-
-        if (!task.isMember("name") && task.isString())
-        {
-            err = "JSON Error: Missing `name` field in task, 缺少 `name` 字段";
-            return false;
-        }
-
-        std::string task_id = task["task_id"].asString();
-        if(dependency)
-        {
-            if(!task.isMember("dependency"))
-            {
-                err = "JSON Error: Missing `dependency` field in task, 缺少 `dependency` 字段";
-                return false;
-            }
-
-            if(!task["dependency"].isArray())
-            {
-                err = "JSON Error: `dependency` field should be an array, `dependency` 字段应为数组";
-                return false;
-            }
-
-            taskIDSet.insert(task_id);
-        }
-    }
-
-    // need to use two-step to adaptive the dependency
-    std::unordered_map<std::string, std::size_t> taskID2Index;
-    std::unordered_map<std::string, std::vector<std::string>> Dependency;
-    for (std::size_t i = 0; i < json["tasks"].size(); i++) 
-    {
-        const auto &task = json["tasks"].get(i, Json::nullValue);
-        
-        const std::string &id = task["task_id"].asString();
-        const std::string &name = task["name"].asString();
-
-        // job id needs to be gerenated by the database
-        // const std::string &belongJob_id = job_id;
-
-        Components::Task taskCom{
-            id, 
-            static_cast<int>(i), // default order is submition order
-            name, 
-            // belongJob_id, // // use database generated job id
-            false, // default no dependency
-        };
-
-        if(dependency)
-        {
-            if (!task["dependency"].empty())
-            {
-                taskCom.dependency = true;
-            }
-            
-            for(const auto &dependency: task["dependency"])
-            {
-                if(!dependency.isString())
-                {
-                    err = "JSON Error: The dependent task id should be a string, 依赖任务 id 应为字符串";
-                    return false;
-                }
-                    
-                std::string dependencyId = dependency.asString();
-                if(taskIDSet.find(dependencyId) == taskIDSet.end())
-                {
-                    err = std::format("JSON Error: Task {} dependent on {} but it does not exist, 任务 {} 依赖于 {} 但是它不存在", id, dependencyId, id, dependencyId); 
-                    return false;
-                }
-
-                Dependency[id].push_back(dependencyId);
-            }
-        }
-
-        // add task component
-        taskID2Index[id] = i;
-        task_Components.push_back(taskCom);
-    }
-
-    // resolve DAG
-    if (dependency)
-    {
-        if (!resolve_DAG(task_Components, taskID2Index, Dependency, err))
-        {
-            return false;
-        }
-
-        // sort the task components according to the order, which is the topological order
-        std::sort
-        (
-            task_Components.begin(), task_Components.end(), 
-            [](const Components::Task &a, const Components::Task &b) 
-            {
-                return a.order < b.order;
-            }
-        );
-    }
-
-    const std::string &job_name = json["job_name"].asString();
-    const std::string &submit_user = json["submit_user"].asString();
-    spdlog::debug("Task of Job - {} submitted by {} has resolved", job_name, submit_user);
-    
-    return true;
-}
-
 bool
 WorkCtrl::resolveJob(const Json::Value &json, std::string &err, const HttpRequestPtr req, Components::Job &job_Component)
 {
@@ -269,9 +92,31 @@ WorkCtrl::resolveJob(const Json::Value &json, std::string &err, const HttpReques
     }
     const std::string &submit_user = payload["username"].asString();
 
+    // 作业的重试策略, 任务的 payload.retry 可以再覆盖
+    Scheduler::RetryPolicy jobRetry;
+    if (!Scheduler::applyRetryPolicy(json["retry"], jobRetry, err))
+    {
+        err = "JSON Error: `retry`: " + err;
+        return false;
+    }
+
+    // 作业优先级, 默认队列的 x-max-priority 为 100
+    int priority = 0;
+    if (json.isMember("priority"))
+    {
+        if (!json["priority"].isInt() || json["priority"].asInt() < 0 || json["priority"].asInt() > 100)
+        {
+            err = "JSON Error: `priority` should be an integer in [0, 100], `priority` 应为 0 到 100 的整数";
+            return false;
+        }
+        priority = json["priority"].asInt();
+    }
+
     job_Component = Components::Job{
         jobName,
         submit_user,
+        json["retry"].isObject() ? DB::writeCompactJson(json["retry"]) : std::string{},
+        priority,
     };
 
     spdlog::debug("job - {} submitted by {} has resolved", jobName, submit_user);
@@ -279,9 +124,34 @@ WorkCtrl::resolveJob(const Json::Value &json, std::string &err, const HttpReques
     return true;
 }
 
-drogon::Task<void>
+// 等待事务提交完成: 释放最后一个引用时事务才发出 COMMIT, 回调在提交结束后调用
+struct CommitAwaiter : public drogon::CallbackAwaiter<bool>
+{
+    explicit CommitAwaiter(std::shared_ptr<drogon::orm::Transaction> trans)
+        : m_trans(std::move(trans))
+    {
+    }
+
+    void
+    await_suspend(std::coroutine_handle<> handle)
+    {
+        m_trans->setCommitCallback(
+            [this, handle](bool committed)
+            {
+                setValue(committed);
+                handle.resume();
+            }
+        );
+        m_trans.reset();
+    }
+
+    std::shared_ptr<drogon::orm::Transaction> m_trans;
+};
+
+drogon::Task<std::optional<int>>
 WorkCtrl::jobSubmit2DBTrans(const Components::Job &job_Component, const std::vector<Components::Task> &task_Components)
 {
+    int job_id = 0;
     try
     {
         auto dbClient = drogon::app().getFastDbClient("YLinedb");
@@ -290,10 +160,12 @@ WorkCtrl::jobSubmit2DBTrans(const Components::Job &job_Component, const std::vec
         // 插入 job 并获取生成的 job_id
         auto result = co_await transPtr->execSqlCoro
         (
-            "INSERT INTO job (job_name, submit_user) "
-            "VALUES ($1, $2) RETURNING id",
+            "INSERT INTO jobs (job_name, submit_user, retry_policy, priority) "
+            "VALUES ($1, $2, NULLIF($3, '')::jsonb, $4) RETURNING id",
             job_Component.name,
-            job_Component.submit_user
+            job_Component.submit_user,
+            job_Component.retry_policy,
+            job_Component.priority
         );
 
         if (result.empty())
@@ -303,26 +175,37 @@ WorkCtrl::jobSubmit2DBTrans(const Components::Job &job_Component, const std::vec
                 "Job - {} submitted by {} failed to insert into database, return job_id is empty 任务提交失败, 返回的 job_id 为空", 
                 job_Component.name, job_Component.submit_user
             );
-            co_return;
+            co_return std::nullopt;
         }
 
         // 获取生成的 job id
-        int job_id = result[0]["id"].as<int>();
+        job_id = result[0]["id"].as<int>();
         // 插入 task
         for(const auto &task: task_Components)
         {
             co_await transPtr->execSqlCoro
             (
-                "INSERT INTO task (task_id, job_id, task_name, task_order, dependency) "
-                "VALUES ($1, $2, $3, $4, $5)",
+                "INSERT INTO tasks (task_id, job_id, task_name, task_order, dependency, payload, depends_on) "
+                "VALUES ($1, $2, $3, $4, $5, $6::jsonb, $7::jsonb)",
                 task.task_id,
                 job_id,
                 task.name,
                 task.order,
-                task.dependency
+                task.dependency,
+                task.payload,
+                task.depends_on
             );
         }
 
+        // 等待提交完成再返回, 客户端收到 job_id 后可以立即请求执行
+        if (!co_await CommitAwaiter(std::move(transPtr)))
+        {
+            spdlog::error(
+                "Job - {} submitted by {} failed to commit 任务提交失败, 事务提交失败", 
+                job_Component.name, job_Component.submit_user
+            );
+            co_return std::nullopt;
+        }
     }
     catch (const drogon::orm::DrogonDbException &e) 
     {
@@ -331,15 +214,15 @@ WorkCtrl::jobSubmit2DBTrans(const Components::Job &job_Component, const std::vec
             "Job - {} submitted by {} failed to insert into database, {} 任务提交失败, 数据库异常", 
             job_Component.name, job_Component.submit_user, e.base().what()
         );
-        co_return;
+        co_return std::nullopt;
     }
     
     spdlog::info(
-        "Job - {} submitted by {} is being inserted into database 任务提交成功, 已插入数据库", 
-        job_Component.name, job_Component.submit_user
+        "Job - {} submitted by {} has been inserted into database as job {} 任务提交成功, 已插入数据库", 
+        job_Component.name, job_Component.submit_user, job_id
     );
 
-    co_return;
+    co_return job_id;
 }
 
 drogon::Task<void> 
@@ -370,16 +253,24 @@ WorkCtrl::submitNonDependentJob(const HttpRequestPtr req, std::function<void(con
     }
 
     std::vector<Components::Task> task_Components;
-    if (!resolveTasks(*json, err, task_Components)) 
+    if (!Scheduler::resolveTasks(*json, err, task_Components)) 
     {
         callbackErrorJson(req, callback, err);
         co_return;
     }
 
-    co_await jobSubmit2DBTrans(job_Component, task_Components);
+    const auto job_id = co_await jobSubmit2DBTrans(job_Component, task_Components);
+    if (!job_id)
+    {
+        Json::Value respJson;
+        respJson["error"] = "Job failed to insert into database 任务写入数据库失败";
+        callback(YLineServer::Api::makeJsonResponse(respJson, drogon::k500InternalServerError, req));
+        co_return;
+    }
 
     Json::Value respJson;
     respJson["message"] = "Job submitted 任务提交成功";
+    respJson["job_id"] = *job_id;
     auto resp = YLineServer::Api::makeJsonResponse(respJson, drogon::k200OK, req);
     callback(resp);
 
@@ -416,16 +307,24 @@ WorkCtrl::submitDependentJob(const HttpRequestPtr req, std::function<void(const
     }
     
     std::vector<Components::Task> task_Components;
-    if (!resolveTasks(*json, err, task_Components, true)) 
+    if (!Scheduler::resolveTasks(*json, err, task_Components, true)) 
     {
         callbackErrorJson(req, callback, err);
         co_return;
     }
 
-    co_await jobSubmit2DBTrans(job_Component, task_Components);
+    const auto job_id = co_await jobSubmit2DBTrans(job_Component, task_Components);
+    if (!job_id)
+    {
+        Json::Value respJson;
+        respJson["error"] = "Job failed to insert into database 任务写入数据库失败";
+        callback(YLineServer::Api::makeJsonResponse(respJson, drogon::k500InternalServerError, req));
+        co_return;
+    }
 
     Json::Value respJson;
     respJson["message"] = "Job submitted 任务提交成功";
+    respJson["job_id"] = *job_id;
     auto resp = YLineServer::Api::makeJsonResponse(respJson, drogon::k200OK, req);
     callback(resp);
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <drogon/HttpController.h>
+#include <optional>
 #include <string>
 #include "drogon/utils/coroutine.h"
 
@@ -39,13 +40,11 @@ class WorkCtrl : public drogon::HttpController<WorkCtrl>
     bool 
     validJobJson(const Json::Value &json, std::string &err);
 
-    bool
-    resolveTasks(const Json::Value &json, std::string &err, std::vector<Components::Task> &task_Components, bool dependency = false);
-
     bool
     resolveJob(const Json::Value &json, std::string &err, const HttpRequestPtr req, Components::Job &job_Component);
 
-    drogon::Task<void>
+    // 返回生成的 job_id, 写入或者提交失败时返回空
+    drogon::Task<std::optional<int>>
     jobSubmit2DBTrans(const Components::Job &job_Component, const std::vector<Components::Task> &task_Components);
 
 };
@@ -3,64 +3,110 @@
 
 #include "spdlog/spdlog.h"
 #include "json/writer.h"
+#include <algorithm>
+#include <chrono>
 #include <format>
-#include <json/reader.h>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "utils/api.h"
 #include "utils/server.h"
+#include "utils/metrics.h"
+#include "UTlogFrame.h"
 
 
 using namespace YLineServer;
 
-void WorkerCtrl::writeUsage2redis(const Json::Value& usageJson, const WebSocketConnectionPtr& wsConnPtr) const
+WorkerCtrl::UsageRedisCommands
+WorkerCtrl::buildUsageRedisCommands(
+    const Json::Value& usageJson,
+    const Decode::UsageReport& report,
+    const std::string& workerUUIDStr,
+    const std::string& workerIP
+)
 {
-    auto redis = drogon::app().getFastRedisClient("YLineRedis");
-    const auto& workerUUID = ServerSingleton::getInstance().wsConnToWorkerUUID[wsConnPtr];
-    std::string workerUUIDStr = boost::uuids::to_string(workerUUID);
-    // std::vector<std::string> redisHashfileds;
-    std::vector<std::pair<std::string, std::string>> redisHashfileds;
+    UsageRedisCommands commands;
+    // redis hash 设置指令, 用于设置工作机的使用情况, 缺少的字段为 -1
+    commands.hash = std::format(
+        "HMSET WorkerUsage:{} workerIP {} cpuUsage {} cpuMemoryUsage {}",
+        workerUUIDStr, workerIP, report.cpu.cpuUsage, report.cpu.memoryUsage
+    );
+    commands.expire = std::format("EXPIRE WorkerUsage:{} 3", workerUUIDStr);
 
-    // redis hash 设置指令, 用于设置工作机的使用情况
-    redisHashfileds.emplace_back("workerIP", wsConnPtr->peerAddr().toIp());
-    if (usageJson.isMember("cpuUsage")) 
+    // Nvidia, 原样转存工作机上报的 gpuUsage.NVIDIA, 工作机新增的字段不会丢失
+    if (usageJson.isMember("gpuUsage") && usageJson["gpuUsage"].isMember("NVIDIA")) 
     {
-        redisHashfileds.emplace_back("cpuUsage", usageJson["cpuUsage"].asString());
-    }
-    else 
-    {
-        redisHashfileds.emplace_back("cpuUsage", "-1");
+        const auto& nvidiaUsages = usageJson["gpuUsage"]["NVIDIA"];
+        Json::FastWriter fastWriter;
+        std::string dumpedNvidiaUsages = fastWriter.write(nvidiaUsages);
+        // spdlog::debug("NVIDIA GPU Usage: {}", dumpedNvidiaUsages);
+        commands.nvidia = std::format("SETEX WorkerUsage:NVIDIA:{} 3 {}", workerUUIDStr, dumpedNvidiaUsages);
     }
+    return commands;
+}
 
-    if (usageJson.isMember("cpuMemoryUsage")) 
-    {
-        redisHashfileds.emplace_back("cpuMemoryUsage", usageJson["cpuMemoryUsage"].asString());
-    }
-    else 
+void WorkerCtrl::writeUsage2redis(const Json::Value& usageJson, const WebSocketConnectionPtr& wsConnPtr) const
+{
+    const auto workerUUID = ServerSingleton::getInstance().workerIndex.findByConnection(wsConnPtr);
+    if (!workerUUID)
     {
-        redisHashfileds.emplace_back("cpuMemoryUsage", "-1");
+        // 注册尚未完成的连接
+        SPDLOG_DEBUG("{} - Usage from unregistered Worker ignored 忽略未注册工作机的使用率", wsConnPtr->peerAddr().toIpPort());
+        return;
     }
-    std::string redisCommand = std::format(
-        "HMSET WorkerUsage:{}", 
-        workerUUIDStr
-    );
-    for(const auto& [field, value] : redisHashfileds) 
+
+    const Decode::UsageReport report = Decode::decodeUsage(usageJson);
+
+    // 记录到使用率历史, Redis 中只保留最新的样本
+    Storage::UsageSample sample;
+    sample.cpu = report.cpu.cpuUsage;
+    sample.memory = report.cpu.memoryUsage;
+    sample.gpus.reserve(report.nvidia.size());
+    for (const auto& gpu : report.nvidia)
     {
-        redisCommand += std::format(" {} {}", field, value);
+        sample.gpus.push_back(Storage::UsageSample::Gpu{
+            gpu.index,
+            gpu.usage.gpuUsage,
+            gpu.usage.gpuMemoryUsed,
+            gpu.usage.gpuTemperature,
+            gpu.usage.gpuPowerUsage,
+        });
     }
+    const auto now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+    ServerSingleton::getInstance().usageHistory->record(*workerUUID, now, sample);
+
+    auto redis = drogon::app().getFastRedisClient("YLineRedis");
+    const auto commands = buildUsageRedisCommands(usageJson, report, boost::uuids::to_string(*workerUUID), wsConnPtr->peerAddr().toIp());
+
     // 设置 WorkerUsage hash
+    static auto& latency = Metrics::redisLatency("worker_usage");
+    static auto& ingestLag = Metrics::workerUsageLag();
+    const auto start = std::chrono::steady_clock::now();
+    // 工作机的采样时间 (Unix 毫秒), 旧版本工作机没有
+    const std::int64_t sampledAt = report.ts;
     redis->execCommandAsync
     (
-        [](const drogon::nosql::RedisResult &r) 
+        [start, sampledAt](const drogon::nosql::RedisResult &r) 
         {
+            latency.observeSince(start);
+            if (sampledAt > 0)
+            {
+                const auto nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()
+                ).count();
+                // 时钟不同步时可能为负
+                ingestLag.observe(std::max<std::int64_t>(nowMs - sampledAt, 0) / 1000.0);
+            }
             // spdlog::debug("HMSET WorkerUsage result: {}", r.asString());
         },
         [wsConnPtr](const std::exception &err)
         {
             spdlog::error("{} - HMSET WorkerUsage error: {}", wsConnPtr->peerAddr().toIpPort(), err.what());
         },
-        redisCommand.c_str()
+        commands.hash.c_str()
     );
     // 设置 WorkerUsage hash 的过期时间
     redis->execCommandAsync
@@ -73,34 +119,25 @@ void WorkerCtrl::writeUsage2redis(const Json::Value& usageJson, const WebSocketC
         {
             spdlog::error("{} - EXPIRE WorkerUsage error: {}", wsConnPtr->peerAddr().toIpPort(), err.what());
         },
-        std::format("EXPIRE WorkerUsage:{} 3", workerUUIDStr).c_str()
+        commands.expire.c_str()
     );
 
     // 如果有 gpuUsage 字段, 则设置 gpuUsage 表
-    if (usageJson.isMember("gpuUsage")) 
+    if (!commands.nvidia.empty())
     {
-        // Nvidia
-        if (usageJson["gpuUsage"].isMember("NVIDIA")) 
-        {
-
-            const auto& nvidiaUsages = usageJson["gpuUsage"]["NVIDIA"];
-            Json::FastWriter fastWriter;
-            std::string dumpedNvidiaUsages = fastWriter.write(nvidiaUsages);
-            // spdlog::debug("NVIDIA GPU Usage: {}", dumpedNvidiaUsages);
-            // 设置 WorkerUsage:NVIDIA hash 同时设置过期时间
-            redis->execCommandAsync
-            (
-                [](const drogon::nosql::RedisResult &r) 
-                {
-                    // spdlog::debug("SETEX WorkerUsage:NVIDIA result: {}", r.asString());
-                },
-                [wsConnPtr](const std::exception &err)
-                {
-                    spdlog::error("{} - SETEX WorkerUsage:NVIDIA error: {}", wsConnPtr->peerAddr().toIpPort(), err.what());
-                },
-                std::format("SETEX WorkerUsage:NVIDIA:{} 3 {}", workerUUIDStr, dumpedNvidiaUsages).c_str()
-            );
-        }
+        // 设置 WorkerUsage:NVIDIA hash 同时设置过期时间
+        redis->execCommandAsync
+        (
+            [](const drogon::nosql::RedisResult &r) 
+            {
+                // spdlog::debug("SETEX WorkerUsage:NVIDIA result: {}", r.asString());
+            },
+            [wsConnPtr](const std::exception &err)
+            {
+                spdlog::error("{} - SETEX WorkerUsage:NVIDIA error: {}", wsConnPtr->peerAddr().toIpPort(), err.what());
+            },
+            commands.nvidia.c_str()
+        );
     }
 
     // don't know why redis->newTransactionAsync does not work
@@ -156,36 +193,90 @@ void WorkerCtrl::writeUsage2redis(const Json::Value& usageJson, const WebSocketC
 
 }
 
+void WorkerCtrl::appendTaskLog(std::string &&frame, const WebSocketConnectionPtr& wsConnPtr) const
+{
+    // 只接受已注册工作机的日志, 否则任何连接都可以写入任意任务的日志
+    const auto workerUUID = ServerSingleton::getInstance().workerIndex.findByConnection(wsConnPtr);
+    if (!workerUUID)
+    {
+        spdlog::warn("Message from {} : task log frame from unregistered connection 未注册的连接发送了任务日志帧", wsConnPtr->peerAddr().toIpPort());
+        return;
+    }
+
+    // 未确认的投递只能在消费者 I/O 线程上读取
+    ServerSingleton::getInstance().consumerLoopIOThread->getLoop()->queueInLoop(
+        [workerUUID = *workerUUID, frame = std::move(frame), peer = wsConnPtr->peerAddr().toIpPort()]()
+        {
+            YSolowork::util::LogFrameHeader header;
+            std::string_view payload;
+            if (!YSolowork::util::decodeLogFrame(frame, header, payload))
+            {
+                spdlog::error("Message from Worker - {} : Invalid task log frame 无效的任务日志帧", peer);
+                return;
+            }
+            // 日志必须属于这台工作机正在执行的投递或推测副本, 已经结束或回收的投递的日志也会被丢弃
+            if (!holdsCopy(Scheduler::Speculation::CopyRef{workerUUID, header.delivery_tag, header.generation, header.job_id, header.task_id}))
+            {
+                SPDLOG_DEBUG(
+                    "Message from Worker - {} : drop log of Task {} delivery {} not held by Worker 丢弃不属于工作机投递的任务日志",
+                    peer, header.task_id, header.delivery_tag
+                );
+                return;
+            }
+            // 推测副本的输出单独存放, 不与原副本的序号混在一起
+            if (Scheduler::isSpeculativeTag(header.delivery_tag))
+            {
+                header.stream += ".speculative";
+            }
+            // 只做校验和转交, 写入在任务日志存储的线程上进行
+            ServerSingleton::getInstance().taskLogSink->append(header, std::string(payload));
+        }
+    );
+}
+
 void WorkerCtrl::handleNewMessage(const WebSocketConnectionPtr& wsConnPtr, std::string &&message, const WebSocketMessageType &type)
 {
+    // 任何消息都视为心跳
+    auto& server = ServerSingleton::getInstance();
+    if (const auto workerUUID = server.workerIndex.findByConnection(wsConnPtr))
+    {
+        server.livenessTracker->heartbeat(*workerUUID);
+    }
+
     if (type == WebSocketMessageType::Text)
     {
         try {
             Json::Value root;
-            Json::CharReaderBuilder reader;
             std::string errs;
-            std::istringstream s(message);
-            if (Json::parseFromStream(reader, s, &root, &errs)) {
+            if (Api::parseJson(message, root, errs)) {
                 // spdlog::info("Message from Worker - {} : {}", wsConnPtr->peerAddr().toIpPort(), root.toStyledString());
                 // 根据 "command" 字段处理不同的指令
                 if (root.isMember("command")) 
                 {
-                    CommandType command;
-                    if (commandMap.find(root["command"].asString()) == commandMap.end()) 
-                    {
-                        command = CommandType::UNKNOWN;
-                    }
-                    else 
-                    {
-                        command = commandMap[root["command"].asString()];
-                    }
+                    const auto it = commandMap.find(root["command"].asString());
+                    const CommandType command = it == commandMap.end() ? CommandType::UNKNOWN : it->second;
                     switch (command) 
                     {
                         case CommandType::usage:
-                            spdlog::trace("Message from Worker - {} : Command: usage", wsConnPtr->peerAddr().toIpPort());
+                            SPDLOG_TRACE("Message from Worker - {} : Command: usage", wsConnPtr->peerAddr().toIpPort());
                             // spdlog::debug("Message from Worker - {} : Usage JSON: {}", wsConnPtr->peerAddr().toIpPort(), root.toStyledString());
                             writeUsage2redis(root, wsConnPtr);
                             break;
+                        case CommandType::taskStarted:
+                            taskStarted(root, wsConnPtr);
+                            break;
+                        case CommandType::taskFinished:
+                            taskFinished(root, wsConnPtr);
+                            break;
+                        case CommandType::taskRejected:
+                            taskRejected(root, wsConnPtr);
+                            break;
+                        case CommandType::cacheUpdate:
+                            cacheUpdate(root, wsConnPtr);
+                            break;
+                        case CommandType::taskCheckpoint:
+                            taskCheckpoint(root, wsConnPtr);
+                            break;
                         case CommandType::UNKNOWN:
                             spdlog::warn("Message from Worker - {} : Unknown Command: {}", wsConnPtr->peerAddr().toIpPort(), root["command"].asString());
                             break;
@@ -203,6 +294,11 @@ void WorkerCtrl::handleNewMessage(const WebSocketConnectionPtr& wsConnPtr, std::
             spdlog::error("Message from Worker - {} : Failed to parse JSON message, {}", wsConnPtr->peerAddr().toIpPort(), e.what());
         }
     }
+    else if (type == WebSocketMessageType::Binary)
+    {
+        // 二进制消息目前只有任务日志帧
+        appendTaskLog(std::move(message), wsConnPtr);
+    }
     
 }
 
@@ -217,6 +313,8 @@ bool verifyRegisterSecret(const Json::Value& reqJson, const std::string& registe
 
 void WorkerCtrl::handleNewConnection(const HttpRequestPtr &req, const WebSocketConnectionPtr& wsConnPtr)
 {
+    static auto& connections = Metrics::wsConnections("WorkerCtrl");
+    connections.inc();
     // const auto& reqPeerAddr = req->getPeerAddr();
     const auto& wsPeerAddr = wsConnPtr->peerAddr();
     spdlog::debug("{} connected to WorkerCtrl WebSocket", wsPeerAddr.toIpPort());
@@ -247,38 +345,41 @@ void WorkerCtrl::handleNewConnection(const HttpRequestPtr &req, const WebSocketC
             return;
         }
 
-        // 回调地狱，但是没辙 wsCtrl 不支持协程写法
-        // callback hell but no choice, wsCtrl does not support coroutine
+        // wsCtrl 不支持协程写法, registerWorker 内部启动注册协程
+        // wsCtrl does not support coroutine, registerWorker spawns the registration coroutine
         registerWorker((*reqJson)["worker_uuid"].asString(), (*reqJson)["worker_info"], wsConnPtr);
     }
-
-    if (!req->getJsonError().empty()) 
+    else
     {
+        // 没有注册请求 (或者无法解析) 的连接不是工作机, 不保留
         wsConnPtr->shutdown(CloseCode::kInvalidMessage, "Invalid Worker Register JSON");
-        spdlog::error("Request JSON error: {}", req->getJsonError());
+        spdlog::error("{} connected without a Worker register request 连接没有附带工作机注册请求: {}", wsPeerAddr.toIpPort(), req->getJsonError());
     }
 
 }
 
 void WorkerCtrl::handleConnectionClosed(const WebSocketConnectionPtr& wsConnPtr)
 {
+    static auto& connections = Metrics::wsConnections("WorkerCtrl");
+    connections.dec();
     const auto& wsPeerAddr = wsConnPtr->peerAddr();
 
+    // 标记工作机离线, 保留实体和未完成的任务, 宽限期内重连可以继续执行
+    // 超过宽限期由存活追踪回收任务并销毁实体
+    // 已被新连接替换的旧连接不在连接索引中, 不会影响重连后的工作机
+    auto& server = ServerSingleton::getInstance();
+    const auto workerUUID = server.workerIndex.findByConnection(wsConnPtr);
+    if (workerUUID)
     {
-
-    // 从 hash 表 和 EnTT 注册表中删除工作机
-    std::unique_lock<std::shared_mutex> lock(ServerSingleton::getInstance().workerUUIDMapMutex);
-    std::unique_lock<std::shared_mutex> lock2(ServerSingleton::getInstance().wsConnMapMutex);
-    auto it = ServerSingleton::getInstance().wsConnToWorkerUUID.find(wsConnPtr);
-    if (it != ServerSingleton::getInstance().wsConnToWorkerUUID.end())
-    {
-        EnTTidType workerEnTTid = ServerSingleton::getInstance().WorkerUUIDtoEnTTid[it->second];
-        ServerSingleton::getInstance().Registry.destroy(workerEnTTid);
-        ServerSingleton::getInstance().WorkerUUIDtoEnTTid.erase(it->second);
-        ServerSingleton::getInstance().wsConnToWorkerUUID.erase(it);
+        server.workerIndex.setOnline(*workerUUID, false);
+        server.livenessTracker->markOffline(*workerUUID);
+        syncConsumer(*workerUUID);
+        if (server.eventJournal)
+        {
+            server.eventJournal->record(Storage::JournalEvent::WorkerOffline, *workerUUID, Storage::JournalReason::Disconnected);
+        }
+        spdlog::info("{} - Worker {} offline 工作机离线", wsPeerAddr.toIpPort(), boost::uuids::to_string(*workerUUID));
     }
 
-    } // end of lock scope
-
     spdlog::debug("{} disconnected from WorkerCtrl WebSocket", wsPeerAddr.toIpPort());
 }
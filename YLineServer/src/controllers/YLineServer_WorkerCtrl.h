@@ -3,12 +3,23 @@
 #include "drogon/WebSocketConnection.h"
 #include "json/value.h"
 #include <drogon/WebSocketController.h>
+#include <drogon/utils/coroutine.h>
 #include <entt/entt.hpp>
 
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cluster/membership.h"
+#include "scheduler/speculation.h"
+#include "utils/decode.h"
 
 using namespace drogon;
 using EnTTidType = entt::registry::entity_type;
@@ -29,25 +40,115 @@ class WorkerCtrl : public drogon::WebSocketController<WorkerCtrl>
     // WS_PATH_ADD("/path", "filter1", "filter2", ...);
     WS_PATH_ADD("/ws/worker");
     WS_PATH_LIST_END
+
+    // 集群模式: 将工作机重定向到其所属实例
+    static void redirectWorker(const WebSocketConnectionPtr& wsConnPtr, const Cluster::Member& owner);
+
+    // 集群模式: 成员变化后, 将不再属于本实例的工作机移交给新的所属实例
+    // 有未完成任务的工作机先暂停消费, 任务全部结束后再移交, 避免同一任务在两个实例上执行; 可以在任意线程调用
+    static void handOffForeignWorkers();
+
+    // 按工作机当前状态暂停或恢复它的消费者: 离线或者正在等待移交时暂停, 已投递的任务保留; 可以在任意线程调用
+    static void syncConsumer(const boost::uuids::uuid& workerUUID);
+
+    // 存活追踪: 心跳超时, 断开工作机连接
+    static void disconnectLostWorker(const boost::uuids::uuid& workerUUID);
+
+    // 存活追踪: 宽限期内未重连, 回收未完成的任务并销毁工作机实体, 在消费者 I/O 线程上调用
+    static void reclaimDeadWorker(const boost::uuids::uuid& workerUUID);
+
+    // 推测执行: 预取槽位没有占满的在线工作机及其空闲槽位数, 在消费者 I/O 线程上调用
+    static std::vector<std::pair<boost::uuids::uuid, std::size_t>> idleWorkers();
+
+    // 推测执行: 向工作机发送推测副本
+    static bool dispatchSpeculative(const boost::uuids::uuid& workerUUID, const Json::Value& dispatch);
+
+    // 集群模式: 作业取消/重新提交的广播频道, 消息为 {"action": "cancel" | "resume", "job_id": ..., "epoch": ...}
+    inline static const std::string jobControlChannel = "YLine:JobControl";
+
+    // 取消作业: 排队中的任务在消费时丢弃, 工作机上正在执行的副本在 cancel_grace 秒内结束, 可以在任意线程调用
+    static void cancelJob(std::int64_t jobID);
+
+    // 抢占: 为 count 个 priority 优先级的任务腾出槽位, 空闲槽位不足时抢占优先级更低的任务, 在消费者 I/O 线程上调用
+    static void preemptFor(std::uint8_t priority, std::size_t count);
+
+    // 使用率上报对应的 Redis 指令, nvidia 为空表示没有 GPU 使用率
+    struct UsageRedisCommands
+    {
+        std::string hash;    // HMSET WorkerUsage:<uuid> ...
+        std::string expire;  // EXPIRE WorkerUsage:<uuid> 3
+        std::string nvidia;  // SETEX WorkerUsage:NVIDIA:<uuid> 3 ...
+    };
+
+    // 由使用率上报构建 Redis 指令, 不访问网络, 可以在任意线程调用
+    // hash 使用解码后的 report, NVIDIA 的值为 usageJson 中原始的 gpuUsage.NVIDIA 数组
+    static UsageRedisCommands buildUsageRedisCommands(
+        const Json::Value& usageJson,
+        const Decode::UsageReport& report,
+        const std::string& workerUUIDStr,
+        const std::string& workerIP
+    );
   
   private:
     void registerWorker(const std::string& workerUUID, const Json::Value& workerInfo, const WebSocketConnectionPtr& wsConnPtr) const;
+    // 注册流程: 工作机索引查找 + 一次数据库 upsert, 参数按值传递以保证协程挂起期间有效; start 为收到注册请求的时间
+    static drogon::Task<void> registerWorkerCoro(const std::string workerUUID, const Json::Value workerInfo, const WebSocketConnectionPtr wsConnPtr, std::chrono::steady_clock::time_point start);
     // void registerNewWorkerDatabase(const std::string& workerUUID, const Json::Value& workerInfo, EnTTidType workerEnTTid, const WebSocketConnectionPtr& wsConnPtr) const;
     // void registerWorkerEnTT(const std::string& workerUUID, const Json::Value& workerInfo, const WebSocketConnectionPtr& wsConnPtr) const;
 
+    // 确认或拒绝工作机持有的投递, 推测副本没有对应的消息, 直接忽略
+    // 投递不属于工作机当前的 Channel (代数不同) 或者任务不符时, 消费者拒绝执行
+    static void settleDelivery(const Scheduler::Speculation::CopyRef& copy, bool ack, bool requeue = false);
+
+    // 工作机确实持有这个副本: 原副本是其 Consumer 当前 Channel 上未确认的投递, 推测副本是分发给它的副本; 在消费者 I/O 线程上调用
+    static bool holdsCopy(const Scheduler::Speculation::CopyRef& copy);
+
+    // 失败的任务按重试策略重新入队或隔离, 并记录到数据库
+    static void retryDelivery(
+        const Scheduler::Speculation::CopyRef& original,
+        const std::string& failedOn,
+        std::int64_t jobID,
+        const std::string& taskID,
+        std::string error
+    );
+
+    // 取消工作机上的任务副本, grace 为 SIGTERM 到 SIGKILL 的等待时间 (秒), 为空时使用工作机的默认值
+    // preempt 为 true 时工作机报告任务被抢占, 服务器将其重新入队
+    static void cancelCopy(
+        const Scheduler::Speculation::CopyRef& copy,
+        std::optional<double> grace = std::nullopt,
+        bool preempt = false
+    );
+
     // Commands
     enum class CommandType {
       usage,
+      taskStarted,
+      taskFinished,
+      taskRejected,
+      cacheUpdate,
+      taskCheckpoint,
       UNKNOWN  // 用于处理未识别的指令
     };
 
     // Command Map
     inline static std::unordered_map<std::string, CommandType> commandMap = {
-        {"usage", CommandType::usage}
+        {"usage", CommandType::usage},
+        {"taskStarted", CommandType::taskStarted},
+        {"taskFinished", CommandType::taskFinished},
+        {"taskRejected", CommandType::taskRejected},
+        {"cacheUpdate", CommandType::cacheUpdate},
+        {"taskCheckpoint", CommandType::taskCheckpoint}
     };
 
     // command functions
     void writeUsage2redis(const Json::Value& usageJson, const WebSocketConnectionPtr& wsConnPtr) const;
+    void taskStarted(const Json::Value& reportJson, const WebSocketConnectionPtr& wsConnPtr) const;
+    void taskFinished(const Json::Value& reportJson, const WebSocketConnectionPtr& wsConnPtr) const;
+    void taskRejected(const Json::Value& reportJson, const WebSocketConnectionPtr& wsConnPtr) const;
+    void cacheUpdate(const Json::Value& updateJson, const WebSocketConnectionPtr& wsConnPtr) const;
+    void taskCheckpoint(const Json::Value& reportJson, const WebSocketConnectionPtr& wsConnPtr) const;
+    void appendTaskLog(std::string &&frame, const WebSocketConnectionPtr& wsConnPtr) const;
 };
 
 
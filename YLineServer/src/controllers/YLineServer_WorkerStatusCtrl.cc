@@ -1,13 +1,18 @@
 #include "YLineServer_WorkerStatusCtrl.h"
 #include "spdlog/spdlog.h"
 #include "utils/server.h"
+#include "utils/metrics.h"
 #include "utils/api.h"
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <json/value.h>
 #include "models/Workers.h"
 #include <format>
 #include <magic_enum.hpp>
 
+#include <boost/uuid/string_generator.hpp>
+
 using namespace YLineServer;
 
 void WorkerStatusCtrl::handleNewMessage(const WebSocketConnectionPtr& wsConnPtr, std::string &&message, const WebSocketMessageType &type)
@@ -98,6 +103,33 @@ void WorkerStatusCtrl::handleNewMessage(const WebSocketConnectionPtr& wsConnPtr,
                 CommandrequireWorkerStatus(wsConnPtr, json["workerUUID"].asString());
                 break;
             }
+            case CommandType::requireWorkerHistory:
+            {
+                if (!json.isMember("workerUUID") || !json.isMember("from"))
+                {
+                    spdlog::error("{} - No workerUUID or from in requireWorkerHistory command", wsConnPtr->peerAddr().toIpPort());
+                    return;
+                }
+                if (!json["from"].isInt64() || (json.isMember("to") && !json["to"].isInt64()) 
+                    || (json.isMember("resolution") && !json["resolution"].isInt64()))
+                {
+                    spdlog::error("{} - from, to or resolution is not int64 in requireWorkerHistory command", wsConnPtr->peerAddr().toIpPort());
+                    return;
+                }
+
+                // to 默认为现在, resolution 默认自动选择
+                const Json::Int64 now = std::chrono::duration_cast<std::chrono::seconds>(
+                    std::chrono::system_clock::now().time_since_epoch()
+                ).count();
+                CommandrequireWorkerHistory(
+                    wsConnPtr, 
+                    json["workerUUID"].asString(), 
+                    json["from"].asInt64(), 
+                    json.get("to", now).asInt64(), 
+                    json.get("resolution", 0).asInt64()
+                );
+                break;
+            }
         
             default:
                 spdlog::error("{} - Unrecognized command: {}", wsConnPtr->peerAddr().toIpPort(), json["command"].asString());
@@ -109,6 +141,8 @@ void WorkerStatusCtrl::handleNewMessage(const WebSocketConnectionPtr& wsConnPtr,
 
 void WorkerStatusCtrl::handleNewConnection(const HttpRequestPtr &req, const WebSocketConnectionPtr& wsConnPtr)
 {
+    static auto& connections = Metrics::wsConnections("WorkerStatusCtrl");
+    connections.inc();
     const auto& wsPeerAddr = wsConnPtr->peerAddr();
     spdlog::debug("{} connected to WorkerStatusCtrl WebSocket", wsPeerAddr.toIpPort());
     CommandsetWorkerCount(wsConnPtr);
@@ -116,6 +150,8 @@ void WorkerStatusCtrl::handleNewConnection(const HttpRequestPtr &req, const WebS
 
 void WorkerStatusCtrl::handleConnectionClosed(const WebSocketConnectionPtr& wsConnPtr)
 {
+    static auto& connections = Metrics::wsConnections("WorkerStatusCtrl");
+    connections.dec();
     const auto& wsPeerAddr = wsConnPtr->peerAddr();
     spdlog::debug("{} disconnected from WorkerStatusCtrl WebSocket", wsPeerAddr.toIpPort());
 }
@@ -247,7 +283,7 @@ void WorkerStatusCtrl::CommandrequireWorkerInfo(const WebSocketConnectionPtr& ws
 
 void WorkerStatusCtrl::CommandrequireWorkerStatus(const WebSocketConnectionPtr& wsConnPtr, const std::string& workerUUID)
 {
-    spdlog::debug("{} Requested Worker {} Status 请求工作机状态", wsConnPtr->peerAddr().toIpPort(), workerUUID);
+    SPDLOG_DEBUG("{} Requested Worker {} Status 请求工作机状态", wsConnPtr->peerAddr().toIpPort(), workerUUID);
     auto redis = drogon::app().getFastRedisClient("YLineRedis");
     redis->execCommandAsync(
         [wsConnPtr, workerUUID](const drogon::nosql::RedisResult &r) 
@@ -263,7 +299,7 @@ void WorkerStatusCtrl::CommandrequireWorkerStatus(const WebSocketConnectionPtr&
                 {
                     json["data"]["status"] = false;
                     wsConnPtr->sendJson(json);
-                    spdlog::debug("Worker {} Status is Nil, So it's not Online 工作机不在线", workerUUID);
+                    SPDLOG_DEBUG("Worker {} Status is Nil, So it's not Online 工作机不在线", workerUUID);
                     return;
                 }
 
@@ -273,7 +309,7 @@ void WorkerStatusCtrl::CommandrequireWorkerStatus(const WebSocketConnectionPtr&
                     if (workers[i].type() == drogon::nosql::RedisResultType::kString && workers[i + 1].type() == drogon::nosql::RedisResultType::kString)
                     {
                         json["data"][workers[i].asString()] = workers[i + 1].asString();
-                        spdlog::debug("Worker {} Status: {} = {}", workerUUID, workers[i].asString(), workers[i + 1].asString());
+                        SPDLOG_DEBUG("Worker {} Status: {} = {}", workerUUID, workers[i].asString(), workers[i + 1].asString());
                     }
                     else
                     {
@@ -333,4 +369,76 @@ void WorkerStatusCtrl::CommandrequireWorkerStatus(const WebSocketConnectionPtr&
         },
         std::format("HGETALL WorkerUsage:{}", workerUUID).c_str()
     );
-}
\ No newline at end of file
+}
+
+void WorkerStatusCtrl::CommandrequireWorkerHistory(const WebSocketConnectionPtr& wsConnPtr, const std::string& workerUUID, Json::Int64 from, Json::Int64 to, Json::Int64 resolution)
+{
+    SPDLOG_DEBUG("{} Requested Worker {} History 请求工作机使用率历史", wsConnPtr->peerAddr().toIpPort(), workerUUID);
+
+    Json::Value json;
+    json["command"] = "setWorkerHistory";
+    json["data"]["workerUUID"] = workerUUID;
+
+    boost::uuids::uuid uuid;
+    try
+    {
+        uuid = boost::uuids::string_generator()(workerUUID);
+    }
+    catch (const std::exception&)
+    {
+        spdlog::error("{} - Invalid workerUUID in requireWorkerHistory command: {}", wsConnPtr->peerAddr().toIpPort(), workerUUID);
+        return;
+    }
+    const auto& widths = Storage::UsageHistory::WIDTHS;
+    if (resolution != 0 && std::find(widths.begin(), widths.end(), resolution) == widths.end())
+    {
+        spdlog::error("{} - Invalid resolution in requireWorkerHistory command: {}", wsConnPtr->peerAddr().toIpPort(), resolution);
+        return;
+    }
+
+    // 集群模式下只有工作机所在的实例有历史, 其他实例返回 status = false
+    const auto series = ServerSingleton::getInstance().usageHistory->query(uuid, from, to, resolution);
+    if (!series)
+    {
+        json["data"]["status"] = false;
+        wsConnPtr->sendJson(json);
+        return;
+    }
+
+    json["data"]["status"] = true;
+    json["data"]["resolution"] = static_cast<Json::Int64>(series->width);
+    json["data"]["metrics"] = Json::arrayValue;
+    for (const auto& metric : series->metrics)
+    {
+        json["data"]["metrics"].append(metric);
+    }
+
+    // 每个时间桶一个点, min/avg/max 与 metrics 一一对应, 没有样本的指标为 null
+    json["data"]["points"] = Json::arrayValue;
+    const std::size_t metricCount = series->metrics.size();
+    for (std::size_t i = 0; i < series->starts.size(); ++i)
+    {
+        Json::Value point;
+        point["t"] = static_cast<Json::Int64>(series->starts[i]);
+        point["min"] = Json::arrayValue;
+        point["avg"] = Json::arrayValue;
+        point["max"] = Json::arrayValue;
+        for (std::size_t m = 0; m < metricCount; ++m)
+        {
+            const auto& stat = series->stats[i * metricCount + m];
+            if (stat.count == 0)
+            {
+                point["min"].append(Json::nullValue);
+                point["avg"].append(Json::nullValue);
+                point["max"].append(Json::nullValue);
+                continue;
+            }
+            point["min"].append(stat.min);
+            point["avg"].append(stat.avg());
+            point["max"].append(stat.max);
+        }
+        json["data"]["points"].append(std::move(point));
+    }
+
+    wsConnPtr->sendJson(json);
+}
@@ -31,6 +31,7 @@ class WorkerStatusCtrl : public drogon::WebSocketController<WorkerStatusCtrl>
     auth,
     requireWorkers,
     requireWorkerStatus,
+    requireWorkerHistory,
     UNKNOWN  // 用于处理未识别的指令
   };
 
@@ -38,13 +39,16 @@ class WorkerStatusCtrl : public drogon::WebSocketController<WorkerStatusCtrl>
   inline static std::unordered_map<std::string, CommandType> commandMap = {
     {"auth", CommandType::auth},
     {"requireWorkers", CommandType::requireWorkers},
-    {"requireWorkerStatus", CommandType::requireWorkerStatus}
+    {"requireWorkerStatus", CommandType::requireWorkerStatus},
+    {"requireWorkerHistory", CommandType::requireWorkerHistory}
   };
 
   // Command Fucntions
   void CommandsetWorkerCount(const WebSocketConnectionPtr& wsConnPtr);
   void CommandrequireWorkerInfo(const WebSocketConnectionPtr& wsConnPtr, const Json::Int64 fist, const Json::Int64 last);
   void CommandrequireWorkerStatus(const WebSocketConnectionPtr& wsConnPtr, const std::string& workerUUID);
+  // 使用率历史, from/to 为 Unix 秒, resolution 为时间桶宽度 (秒), 0 表示自动选择
+  void CommandrequireWorkerHistory(const WebSocketConnectionPtr& wsConnPtr, const std::string& workerUUID, Json::Int64 from, Json::Int64 to, Json::Int64 resolution);
     
 }; // class WorkerStatusCtrl
 
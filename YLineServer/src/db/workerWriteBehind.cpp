@@ -0,0 +1,226 @@
+#include "db/workerWriteBehind.h"
+#include "utils/metrics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+
+#include <drogon/HttpAppFramework.h>
+#include <drogon/orm/DbClient.h>
+#include <json/writer.h>
+#include <spdlog/spdlog.h>
+
+namespace YLineServer::DB {
+
+std::string writeCompactJson(const Json::Value& json)
+{
+    thread_local const Json::StreamWriterBuilder writer = []() {
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        return builder;
+    }();
+    return Json::writeString(writer, json);
+}
+
+WorkerWriteBehind::WorkerWriteBehind(double batch_delay, std::size_t batch_size)
+    : m_batchDelay(batch_delay), m_batchSize(batch_size)
+{
+}
+
+void
+WorkerWriteBehind::start(trantor::EventLoop * loop)
+{
+    m_loop = loop;
+    spdlog::info(
+        "Worker registration write-behind started, batch delay {}s, batch size {} 工作机注册写缓冲已启动",
+        m_batchDelay, m_batchSize
+    );
+}
+
+void
+WorkerWriteBehind::submit(WorkerUpsert&& row, ResultCallback&& onResult, ErrorCallback&& onError)
+{
+    bool flushNow = false;
+    bool scheduleFlush = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_pendingIndex.find(row.worker_uuid);
+        if (it != m_pendingIndex.end())
+        {
+            // 同一工作机在窗口内重复注册, 只保留最新的数据
+            auto& pending = m_pending[it->second];
+            pending.row = std::move(row);
+            pending.callbacks.emplace_back(std::move(onResult), std::move(onError));
+        }
+        else
+        {
+            m_pendingIndex.emplace(row.worker_uuid, m_pending.size());
+            auto& pending = m_pending.emplace_back();
+            pending.row = std::move(row);
+            pending.callbacks.emplace_back(std::move(onResult), std::move(onError));
+        }
+
+        if (m_pending.size() >= m_batchSize)
+        {
+            flushNow = true;
+        }
+        else if (!m_flushScheduled)
+        {
+            m_flushScheduled = true;
+            scheduleFlush = true;
+        }
+    }
+
+    if (flushNow)
+    {
+        m_loop->queueInLoop([this]() { flush(); });
+    }
+    else if (scheduleFlush)
+    {
+        m_loop->runAfter(m_batchDelay, [this]() { flush(); });
+    }
+}
+
+void
+WorkerWriteBehind::flush()
+{
+    std::vector<Pending> batch;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        batch.swap(m_pending);
+        m_pendingIndex.clear();
+        m_flushScheduled = false;
+    }
+    if (batch.empty())
+    {
+        return;
+    }
+
+    // 非 fast 客户端, 写缓冲不运行在 drogon 的 I/O 线程上
+    auto dbClient = drogon::app().getDbClient("YLinedb");
+
+    // 按 batch size 分段, 避免超过 Postgres 单条语句的参数数量上限
+    for (std::size_t begin = 0; begin < batch.size(); begin += m_batchSize)
+    {
+        const std::size_t end = std::min(batch.size(), begin + m_batchSize);
+        auto chunk = std::make_shared<std::vector<Pending>>(
+            std::make_move_iterator(batch.begin() + begin),
+            std::make_move_iterator(batch.begin() + end)
+        );
+
+        std::string sql = "INSERT INTO workers (worker_uuid, server_instance_uuid, worker_entt_id, worker_info) VALUES ";
+        for (std::size_t i = 0; i < chunk->size(); ++i)
+        {
+            const std::size_t p = i * 4;
+            sql += std::format(
+                "{}(${}::uuid, ${}::uuid, ${}, ${}::jsonb)",
+                i == 0 ? "" : ", ", p + 1, p + 2, p + 3, p + 4
+            );
+        }
+        sql +=
+            " ON CONFLICT (worker_uuid) DO UPDATE SET "
+            "server_instance_uuid = EXCLUDED.server_instance_uuid, "
+            "worker_entt_id = EXCLUDED.worker_entt_id, "
+            "worker_info = EXCLUDED.worker_info "
+            "RETURNING worker_uuid::text AS worker_uuid, id, (xmax = 0) AS inserted";
+
+        static auto& latency = Metrics::dbLatency("worker_upsert");
+        const auto start = std::chrono::steady_clock::now();
+        auto binder = *dbClient << std::move(sql);
+        for (const auto& pending : *chunk)
+        {
+            binder << pending.row.worker_uuid
+                   << pending.row.server_instance_uuid
+                   << pending.row.worker_entt_id
+                   << pending.row.worker_info;
+        }
+        binder >> [chunk, start](const drogon::orm::Result& result)
+        {
+            latency.observeSince(start);
+            std::unordered_map<std::string, WorkerUpsertResult> results;
+            results.reserve(result.size());
+            for (const auto& row : result)
+            {
+                results.emplace(
+                    row["worker_uuid"].as<std::string>(),
+                    WorkerUpsertResult{row["id"].as<int>(), row["inserted"].as<bool>()}
+                );
+            }
+            spdlog::debug("Worker registration batch written 工作机注册批量写入: {} rows", results.size());
+
+            for (const auto& pending : *chunk)
+            {
+                auto it = results.find(pending.row.worker_uuid);
+                for (const auto& [onResult, onError] : pending.callbacks)
+                {
+                    if (it != results.end())
+                    {
+                        onResult(it->second);
+                    }
+                    else
+                    {
+                        onError(std::make_exception_ptr(std::runtime_error(
+                            "Worker upsert returned no row 工作机 upsert 未返回结果: " + pending.row.worker_uuid
+                        )));
+                    }
+                }
+            }
+        }
+        >> [chunk](const drogon::orm::DrogonDbException& e)
+        {
+            spdlog::error(
+                "Worker registration batch of {} failed 工作机注册批量写入失败: {}",
+                chunk->size(), e.base().what()
+            );
+            // DrogonDbException 拷贝后会丢失具体异常, 转为 runtime_error 保留错误信息
+            const auto exception = std::make_exception_ptr(std::runtime_error(e.base().what()));
+            for (const auto& pending : *chunk)
+            {
+                for (const auto& [onResult, onError] : pending.callbacks)
+                {
+                    onError(exception);
+                }
+            }
+        };
+    }
+}
+
+void
+WorkerWriteBehind::UpsertAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    // 回到调用者的 EventLoop 恢复协程
+    auto * loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+    auto resume = [loop, handle]() {
+        if (loop)
+        {
+            loop->queueInLoop([handle]() { handle.resume(); });
+        }
+        else
+        {
+            handle.resume();
+        }
+    };
+
+    m_buffer.submit(
+        std::move(m_row),
+        [this, resume](const WorkerUpsertResult& result) {
+            setValue(result);
+            resume();
+        },
+        [this, resume](const std::exception_ptr& exception) {
+            setException(exception);
+            resume();
+        }
+    );
+}
+
+drogon::Task<WorkerUpsertResult>
+WorkerWriteBehind::upsertCoro(WorkerUpsert row)
+{
+    co_return co_await UpsertAwaiter(*this, std::move(row));
+}
+
+} // namespace YLineServer::DB
@@ -0,0 +1,47 @@
+/**
+ *
+ *  YLineServer_WorkerFilter.cc
+ *
+ */
+
+#include "YLineServer_WorkerFilter.h"
+#include "spdlog/spdlog.h"
+#include <json/value.h>
+#include <string>
+#include "UTartifact.h"
+#include "utils/jwt.h"
+#include "utils/server.h"
+
+using namespace drogon;
+using namespace YLineServer;
+
+void WorkerFilter::doFilter(const HttpRequestPtr &req,
+                         FilterCallback &&fcb,
+                         FilterChainCallback &&fccb)
+{
+    // 工作机: 注册密钥
+    const auto& secret = req->getHeader(std::string(YSolowork::util::ARTIFACT_SECRET_HEADER));
+    if (!secret.empty() && secret == ServerSingleton::getInstance().getConfigData().register_secret)
+    {
+        fccb();
+        return;
+    }
+
+    // 用户: 登录令牌
+    const auto& authHeader = req->getHeader("Authorization");
+    Json::Value payload;
+    std::string err;
+    if (!authHeader.empty() && Jwt::validateBearerToken(authHeader, payload, err))
+    {
+        req->attributes()->insert("JWTpayload", payload);
+        fccb();
+        return;
+    }
+
+    Json::Value json;
+    json["error"] = "Authorization Failed 鉴权失败";
+    auto res = drogon::HttpResponse::newHttpJsonResponse(json);
+    res->setStatusCode(k401Unauthorized);
+    fcb(res);
+    spdlog::warn("{} - Worker authorization Failed 工作机鉴权失败", req->getPeerAddr().toIpPort());
+}
@@ -0,0 +1,25 @@
+/**
+ *
+ *  YLineServer_WorkerFilter.h
+ *
+ */
+
+#pragma once
+
+#include <drogon/HttpFilter.h>
+
+using namespace drogon;
+namespace YLineServer
+{
+
+// 工作机通过注册密钥访问, 用户通过登录令牌访问
+class WorkerFilter : public HttpFilter<WorkerFilter>
+{
+  public:
+    WorkerFilter() {}
+    void doFilter(const HttpRequestPtr &req,
+                  FilterCallback &&fcb,
+                  FilterChainCallback &&fccb) override;
+};
+
+}
@@ -0,0 +1,148 @@
+#include "scheduler/cacheAffinity.h"
+
+#include <mutex>
+
+#include <boost/uuid/uuid_io.hpp>
+
+namespace YLineServer::Scheduler
+{
+
+std::size_t CacheAffinity::UuidHash::operator()(const boost::uuids::uuid& uuid) const noexcept
+{
+    return boost::uuids::hash_value(uuid);
+}
+
+void
+CacheAffinity::reset(const boost::uuids::uuid& worker, const Json::Value& hashes)
+{
+    std::unique_lock lock(m_mutex);
+    removeLocked(worker);
+    if (!hashes.isArray())
+    {
+        return;
+    }
+    for (const auto& hash : hashes)
+    {
+        if (hash.isString())
+        {
+            addLocked(worker, hash.asString());
+        }
+    }
+}
+
+void
+CacheAffinity::update(const boost::uuids::uuid& worker, const Json::Value& added, const Json::Value& evicted)
+{
+    std::unique_lock lock(m_mutex);
+    if (evicted.isArray())
+    {
+        for (const auto& hash : evicted)
+        {
+            if (hash.isString())
+            {
+                evictLocked(worker, hash.asString());
+            }
+        }
+    }
+    if (added.isArray())
+    {
+        for (const auto& hash : added)
+        {
+            if (hash.isString())
+            {
+                addLocked(worker, hash.asString());
+            }
+        }
+    }
+}
+
+void
+CacheAffinity::remove(const boost::uuids::uuid& worker)
+{
+    std::unique_lock lock(m_mutex);
+    removeLocked(worker);
+}
+
+std::size_t
+CacheAffinity::count(const boost::uuids::uuid& worker, const std::vector<std::string>& hashes) const
+{
+    std::shared_lock lock(m_mutex);
+    auto it = m_workers.find(worker);
+    if (it == m_workers.end())
+    {
+        return 0;
+    }
+    std::size_t n = 0;
+    for (const auto& hash : hashes)
+    {
+        n += it->second.count(hash);
+    }
+    return n;
+}
+
+std::vector<boost::uuids::uuid>
+CacheAffinity::holders(const std::vector<std::string>& hashes) const
+{
+    std::shared_lock lock(m_mutex);
+    std::unordered_set<boost::uuids::uuid, UuidHash> result;
+    for (const auto& hash : hashes)
+    {
+        auto it = m_holders.find(hash);
+        if (it != m_holders.end())
+        {
+            result.insert(it->second.begin(), it->second.end());
+        }
+    }
+    return {result.begin(), result.end()};
+}
+
+void
+CacheAffinity::addLocked(const boost::uuids::uuid& worker, const std::string& hash)
+{
+    m_workers[worker].insert(hash);
+    m_holders[hash].insert(worker);
+}
+
+void
+CacheAffinity::evictLocked(const boost::uuids::uuid& worker, const std::string& hash)
+{
+    auto workerIt = m_workers.find(worker);
+    if (workerIt != m_workers.end())
+    {
+        workerIt->second.erase(hash);
+    }
+    auto holderIt = m_holders.find(hash);
+    if (holderIt != m_holders.end())
+    {
+        holderIt->second.erase(worker);
+        if (holderIt->second.empty())
+        {
+            m_holders.erase(holderIt);
+        }
+    }
+}
+
+void
+CacheAffinity::removeLocked(const boost::uuids::uuid& worker)
+{
+    auto workerIt = m_workers.find(worker);
+    if (workerIt == m_workers.end())
+    {
+        return;
+    }
+    for (const auto& hash : workerIt->second)
+    {
+        auto holderIt = m_holders.find(hash);
+        if (holderIt != m_holders.end())
+        {
+            holderIt->second.erase(worker);
+            if (holderIt->second.empty())
+            {
+                m_holders.erase(holderIt);
+            }
+        }
+    }
+    m_workers.erase(workerIt);
+}
+
+} // namespace YLineServer::Scheduler
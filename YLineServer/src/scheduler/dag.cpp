@@ -0,0 +1,233 @@
+#include "scheduler/dag.h"
+
+#include <algorithm>
+#include <format>
+#include <unordered_set>
+
+#include <spdlog/spdlog.h>
+
+#include "db/workerWriteBehind.h"
+#include "scheduler/retry.h"
+
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/topological_sort.hpp>
+#include <boost/graph/exception.hpp> // 包含异常定义
+
+namespace YLineServer::Scheduler
+{
+
+bool
+resolveDAG
+(
+    std::vector<Components::Task> &task_Components,
+    const std::unordered_map<std::string, std::size_t> &taskID2Index,
+    const std::unordered_map<std::string, std::vector<std::string>> &Dependency,
+    std::string &err
+)
+{
+    using namespace boost;
+    using Graph = boost::adjacency_list<vecS, vecS, directedS>;
+
+    // build DAG
+    Graph DAG(task_Components.size());
+    for(const auto& [task_id, dependencies]: Dependency)
+    {
+        for(const auto& dependency: dependencies)
+        {   
+            // 添加依赖，表示 task_id 依赖于 dependency
+            add_edge(taskID2Index.at(dependency), taskID2Index.at(task_id), DAG);
+        }
+    }
+
+    // topological sort
+    try
+    {
+        std::vector<Graph::vertex_descriptor> sorted;
+        boost::topological_sort(DAG, std::back_inserter(sorted));
+        std::reverse(sorted.begin(), sorted.end()); // reverse the order
+
+        // print the sorted order
+        std::size_t order = 0;
+        for(auto v: sorted)
+        {
+            // correct the order
+            task_Components[v].order = order;
+            order++;
+        }
+    }
+    catch (const boost::not_a_dag &e)
+    {
+        err = "DAG Error: The task dependency resolved a cycle, 任务依赖关系形成了环";
+        return false;
+    }
+
+    return true;
+}
+
+bool
+resolveTasks(const Json::Value &json, std::string &err, std::vector<Components::Task> &task_Components, bool dependency)
+{
+    // job id needs to be gerenated by the database
+    // const std::string &job_id = json["job_id"].asString();
+    // std::vector<Components::Task> task_Components; // use pass in reference instead of return value
+
+    // valid task dict is actually done here
+    std::unordered_set<std::string> taskIDSet;
+    for (std::size_t i = 0; i < json["tasks"].size(); i++) 
+    {
+        const auto &task = json["tasks"].get(i, Json::nullValue);
+
+        
+        if (!task.isMember("task_id"))
+        {
+            err = "JSON Error: Missing `task_id` field in task, 缺少 `task_id` 字段";
+            return false;
+        }
+
+        if (!task["task_id"].isString())
+        {
+            err = "JSON Error: `task_id` field should be a string, `task_id` 字段应为字符串";
+            return false;
+        }
+
+        if (!task.isMember("name") && task.isString())
+        {
+            err = "JSON Error: Missing `name` field in task, 缺少 `name` 字段";
+            return false;
+        }
+
+        if (task.isMember("payload") && !task["payload"].isObject())
+        {
+            err = "JSON Error: `payload` field should be an object, `payload` 字段应为对象";
+            return false;
+        }
+
+        if (task["payload"].isMember("resources") && !task["payload"]["resources"].isObject())
+        {
+            err = "JSON Error: `payload.resources` field should be an object, `payload.resources` 字段应为对象";
+            return false;
+        }
+
+        if (task["payload"].isMember("inputs") && !task["payload"]["inputs"].isArray())
+        {
+            err = "JSON Error: `payload.inputs` field should be an array, `payload.inputs` 字段应为数组";
+            return false;
+        }
+
+        if (task["payload"].isMember("outputs") && !task["payload"]["outputs"].isArray())
+        {
+            err = "JSON Error: `payload.outputs` field should be an array, `payload.outputs` 字段应为数组";
+            return false;
+        }
+
+        RetryPolicy taskRetry;
+        if (!applyRetryPolicy(task["payload"]["retry"], taskRetry, err))
+        {
+            err = "JSON Error: `payload.retry`: " + err;
+            return false;
+        }
+
+        std::string task_id = task["task_id"].asString();
+        if(dependency)
+        {
+            if(!task.isMember("dependency"))
+            {
+                err = "JSON Error: Missing `dependency` field in task, 缺少 `dependency` 字段";
+                return false;
+            }
+
+            if(!task["dependency"].isArray())
+            {
+                err = "JSON Error: `dependency` field should be an array, `dependency` 字段应为数组";
+                return false;
+            }
+
+            taskIDSet.insert(task_id);
+        }
+    }
+
+    // need to use two-step to adaptive the dependency
+    std::unordered_map<std::string, std::size_t> taskID2Index;
+    std::unordered_map<std::string, std::vector<std::string>> Dependency;
+    for (std::size_t i = 0; i < json["tasks"].size(); i++) 
+    {
+        const auto &task = json["tasks"].get(i, Json::nullValue);
+        
+        const std::string &id = task["task_id"].asString();
+        const std::string &name = task["name"].asString();
+
+        // job id needs to be gerenated by the database
+        // const std::string &belongJob_id = job_id;
+
+        Components::Task taskCom{
+            id, 
+            static_cast<int>(i), // default order is submition order
+            name, 
+            // belongJob_id, // // use database generated job id
+            false, // default no dependency
+        };
+
+        if (task.isMember("payload"))
+        {
+            taskCom.payload = DB::writeCompactJson(task["payload"]);
+        }
+
+        if(dependency)
+        {
+            if (!task["dependency"].empty())
+            {
+                taskCom.dependency = true;
+                taskCom.depends_on = DB::writeCompactJson(task["dependency"]);
+            }
+            
+            for(const auto &dependency: task["dependency"])
+            {
+                if(!dependency.isString())
+                {
+                    err = "JSON Error: The dependent task id should be a string, 依赖任务 id 应为字符串";
+                    return false;
+                }
+                    
+                std::string dependencyId = dependency.asString();
+                if(taskIDSet.find(dependencyId) == taskIDSet.end())
+                {
+                    err = std::format("JSON Error: Task {} dependent on {} but it does not exist, 任务 {} 依赖于 {} 但是它不存在", id, dependencyId, id, dependencyId); 
+                    return false;
+                }
+
+                Dependency[id].push_back(dependencyId);
+            }
+        }
+
+        // add task component
+        taskID2Index[id] = i;
+        task_Components.push_back(taskCom);
+    }
+
+    // resolve DAG
+    if (dependency)
+    {
+        if (!resolveDAG(task_Components, taskID2Index, Dependency, err))
+        {
+            return false;
+        }
+
+        // sort the task components according to the order, which is the topological order
+        std::sort
+        (
+            task_Components.begin(), task_Components.end(), 
+            [](const Components::Task &a, const Components::Task &b) 
+            {
+                return a.order < b.order;
+            }
+        );
+    }
+
+    const std::string &job_name = json["job_name"].asString();
+    const std::string &submit_user = json["submit_user"].asString();
+    spdlog::debug("Task of Job - {} submitted by {} has resolved", job_name, submit_user);
+    
+    return true;
+}
+
+} // namespace YLineServer::Scheduler
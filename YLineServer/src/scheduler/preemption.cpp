@@ -0,0 +1,60 @@
+#include "scheduler/preemption.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace YLineServer::Scheduler
+{
+
+std::vector<RunningDelivery>
+selectVictims(std::vector<RunningDelivery> candidates, std::uint8_t priority, std::size_t count)
+{
+    std::erase_if(candidates, [priority](const RunningDelivery& delivery) {
+        return delivery.priority >= priority;
+    });
+    std::sort(candidates.begin(), candidates.end(), [](const RunningDelivery& a, const RunningDelivery& b) {
+        if (a.priority != b.priority)
+        {
+            return a.priority < b.priority;
+        }
+        return a.dispatched > b.dispatched;
+    });
+    if (candidates.size() > count)
+    {
+        candidates.resize(count);
+    }
+    return candidates;
+}
+
+bool
+JobCancellation::cancel(std::int64_t job_id)
+{
+    std::unique_lock lock(m_mutex);
+    return m_jobs.insert(job_id).second;
+}
+
+void
+JobCancellation::resume(std::int64_t job_id, std::int64_t epoch)
+{
+    std::unique_lock lock(m_mutex);
+    m_jobs.erase(job_id);
+    auto & current = m_epochs[job_id];
+    current = std::max(current, epoch);
+}
+
+bool
+JobCancellation::isCancelled(std::int64_t job_id) const
+{
+    std::shared_lock lock(m_mutex);
+    return m_jobs.contains(job_id);
+}
+
+bool
+JobCancellation::isStale(std::int64_t job_id, std::int64_t epoch) const
+{
+    std::shared_lock lock(m_mutex);
+    const auto it = m_epochs.find(job_id);
+    return it != m_epochs.end() && epoch < it->second;
+}
+
+} // namespace YLineServer::Scheduler
@@ -0,0 +1,138 @@
+#include "scheduler/retry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+#include <boost/uuid/uuid_io.hpp>
+
+namespace YLineServer::Scheduler
+{
+
+bool
+applyRetryPolicy(const Json::Value& json, RetryPolicy& policy, std::string& err)
+{
+    if (json.isNull())
+    {
+        return true;
+    }
+    if (!json.isObject())
+    {
+        err = "retry policy should be an object, 重试策略应为对象";
+        return false;
+    }
+
+    if (json.isMember("max_attempts"))
+    {
+        if (!json["max_attempts"].isUInt() || json["max_attempts"].asUInt() == 0)
+        {
+            err = "retry.max_attempts should be a positive integer, retry.max_attempts 应为正整数";
+            return false;
+        }
+        policy.max_attempts = json["max_attempts"].asUInt();
+    }
+    if (json.isMember("backoff_base"))
+    {
+        if (!json["backoff_base"].isNumeric() || json["backoff_base"].asDouble() < 0)
+        {
+            err = "retry.backoff_base should be a non-negative number, retry.backoff_base 应为非负数";
+            return false;
+        }
+        policy.backoff_base = json["backoff_base"].asDouble();
+    }
+    if (json.isMember("backoff_max"))
+    {
+        if (!json["backoff_max"].isNumeric() || json["backoff_max"].asDouble() < 0)
+        {
+            err = "retry.backoff_max should be a non-negative number, retry.backoff_max 应为非负数";
+            return false;
+        }
+        policy.backoff_max = json["backoff_max"].asDouble();
+    }
+    return true;
+}
+
+Json::Value
+retryPolicyToJson(const RetryPolicy& policy)
+{
+    Json::Value json;
+    json["max_attempts"] = policy.max_attempts;
+    json["backoff_base"] = policy.backoff_base;
+    json["backoff_max"] = policy.backoff_max;
+    return json;
+}
+
+std::uint32_t
+backoffSeconds(const RetryPolicy& policy, std::uint32_t attempt)
+{
+    // base * 2^(attempt - 1), 指数部分先截断, 避免溢出
+    const double exponent = static_cast<double>(std::min<std::uint32_t>(std::max<std::uint32_t>(attempt, 1) - 1, 30));
+    const double delay = std::min(policy.backoff_base * std::exp2(exponent), policy.backoff_max);
+    return static_cast<std::uint32_t>(std::ceil(std::max(delay, 0.0)));
+}
+
+std::size_t WorkerBlacklist::UuidHash::operator()(const boost::uuids::uuid& uuid) const noexcept
+{
+    return boost::uuids::hash_value(uuid);
+}
+
+WorkerBlacklist::WorkerBlacklist(const BlacklistOptions& options)
+    : m_options(options)
+{
+}
+
+bool
+WorkerBlacklist::recordFailure(std::int64_t job_id, const boost::uuids::uuid& worker)
+{
+    if (m_options.failures == 0)
+    {
+        return false;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    std::unique_lock lock(m_mutex);
+    pruneLocked(now);
+    auto& failures = m_jobs[job_id][worker];
+    ++failures.count;
+    failures.last = now;
+    return failures.count == m_options.failures;
+}
+
+bool
+WorkerBlacklist::isBlacklisted(std::int64_t job_id, const boost::uuids::uuid& worker) const
+{
+    if (m_options.failures == 0)
+    {
+        return false;
+    }
+
+    std::shared_lock lock(m_mutex);
+    const auto jobIt = m_jobs.find(job_id);
+    if (jobIt == m_jobs.end())
+    {
+        return false;
+    }
+    const auto it = jobIt->second.find(worker);
+    if (it == jobIt->second.end() || it->second.count < m_options.failures)
+    {
+        return false;
+    }
+    const std::chrono::duration<double> age = std::chrono::steady_clock::now() - it->second.last;
+    return age.count() < m_options.ttl;
+}
+
+void
+WorkerBlacklist::pruneLocked(std::chrono::steady_clock::time_point now)
+{
+    for (auto jobIt = m_jobs.begin(); jobIt != m_jobs.end();)
+    {
+        auto& workers = jobIt->second;
+        std::erase_if(workers, [this, now](const auto& entry) {
+            const std::chrono::duration<double> age = now - entry.second.last;
+            return age.count() >= m_options.ttl;
+        });
+        jobIt = workers.empty() ? m_jobs.erase(jobIt) : std::next(jobIt);
+    }
+}
+
+} // namespace YLineServer::Scheduler
@@ -0,0 +1,436 @@
+#include "scheduler/speculation.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <boost/uuid/uuid_io.hpp>
+#include <spdlog/spdlog.h>
+
+namespace YLineServer::Scheduler
+{
+
+// 没有运行中的任务超过该时间后, 不再保留作业的统计信息
+constexpr std::chrono::minutes JOB_RETENTION{10};
+
+std::size_t Speculation::UuidHash::operator()(const boost::uuids::uuid& uuid) const noexcept
+{
+    return boost::uuids::hash_value(uuid);
+}
+
+Speculation::Speculation(const SpeculationOptions& options)
+    : m_options(options)
+{
+    m_options.percentile = std::clamp(m_options.percentile, 0.0, 1.0);
+    m_options.min_samples = std::max<std::size_t>(1, m_options.min_samples);
+}
+
+void
+Speculation::start(trantor::EventLoop * loop)
+{
+    if (!m_options.enable)
+    {
+        spdlog::info("Speculative execution disabled 推测执行已关闭");
+        return;
+    }
+    spdlog::info(
+        "Speculative execution started, p{:.0f} x {} of finished siblings, scan every {}s 推测执行已启动",
+        m_options.percentile * 100, m_options.multiplier, m_options.interval
+    );
+    loop->runEvery(m_options.interval, [this]() { scan(); });
+}
+
+bool
+Speculation::isCompleted(std::int64_t job_id, const std::string& task_id) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_jobs.find(job_id);
+    return it != m_jobs.end() && it->second.completed.contains(task_id);
+}
+
+std::vector<Speculation::Copy>::iterator
+Speculation::findCopy(TaskState& state, const boost::uuids::uuid& worker, std::uint64_t deliveryTag, std::uint64_t generation)
+{
+    return std::find_if(state.copies.begin(), state.copies.end(), [&worker, deliveryTag, generation](const Copy& copy) {
+        return copy.worker == worker && copy.delivery_tag == deliveryTag && copy.generation == generation;
+    });
+}
+
+std::vector<Speculation::CopyRef>
+Speculation::dropCopy(JobState& job, const std::string& task_id, const boost::uuids::uuid& worker, std::uint64_t deliveryTag, std::uint64_t generation)
+{
+    std::vector<CopyRef> requeue;
+    const auto taskIt = job.running.find(task_id);
+    if (taskIt == job.running.end())
+    {
+        return requeue;
+    }
+    auto& state = taskIt->second;
+    if (const auto copy = findCopy(state, worker, deliveryTag, generation); copy != state.copies.end())
+    {
+        state.copies.erase(copy);
+    }
+    if (state.copies.empty())
+    {
+        // 已失败的原副本在等待其他副本的结果, 其他副本没有结果, 让任务重新执行
+        requeue = std::move(state.deferred);
+        job.running.erase(taskIt);
+    }
+    return requeue;
+}
+
+void
+Speculation::onDispatched(const boost::uuids::uuid& worker, std::uint64_t deliveryTag, std::uint64_t generation, const Json::Value& task)
+{
+    if (!task["task_id"].isString() || !task["job_id"].isIntegral())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& job = m_jobs[task["job_id"].asInt64()];
+    job.lastActivity = std::chrono::steady_clock::now();
+
+    auto& state = job.running[task["task_id"].asString()];
+    if (state.task.isNull())
+    {
+        state.task = task;
+    }
+    if (findCopy(state, worker, deliveryTag, generation) == state.copies.end())
+    {
+        state.copies.push_back(Copy{worker, deliveryTag, generation});
+    }
+}
+
+void
+Speculation::onStarted(const boost::uuids::uuid& worker, std::uint64_t deliveryTag, std::uint64_t generation, std::int64_t job_id, const std::string& task_id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto jobIt = m_jobs.find(job_id);
+    if (jobIt == m_jobs.end())
+    {
+        return;
+    }
+    const auto taskIt = jobIt->second.running.find(task_id);
+    if (taskIt == jobIt->second.running.end())
+    {
+        return;
+    }
+    if (const auto copy = findCopy(taskIt->second, worker, deliveryTag, generation); copy != taskIt->second.copies.end())
+    {
+        copy->started = true;
+        copy->startTime = std::chrono::steady_clock::now();
+    }
+}
+
+Speculation::Verdict
+Speculation::onFinished(
+    const boost::uuids::uuid& worker,
+    std::uint64_t deliveryTag,
+    std::uint64_t generation,
+    std::int64_t job_id,
+    const std::string& task_id,
+    bool success,
+    double duration
+)
+{
+    Verdict verdict;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto jobIt = m_jobs.find(job_id);
+    if (jobIt == m_jobs.end())
+    {
+        // 未追踪的任务 (例如服务器重启前分发的), 按普通任务处理
+        return verdict;
+    }
+    auto& job = jobIt->second;
+    job.lastActivity = std::chrono::steady_clock::now();
+
+    if (job.completed.contains(task_id))
+    {
+        // 其他副本已经成功, 本副本是被取消的或者晚到的结果
+        verdict.record = false;
+        return verdict;
+    }
+
+    const auto taskIt = job.running.find(task_id);
+    if (taskIt == job.running.end())
+    {
+        return verdict;
+    }
+    auto& state = taskIt->second;
+    const auto self = findCopy(state, worker, deliveryTag, generation);
+
+    if (success)
+    {
+        job.completed.insert(task_id);
+        job.durations.push_back(duration);
+        for (auto it = state.copies.begin(); it != state.copies.end(); ++it)
+        {
+            if (it != self)
+            {
+                verdict.cancel.push_back(CopyRef{it->worker, it->delivery_tag, it->generation, job_id, task_id});
+            }
+        }
+        verdict.settle = std::move(state.deferred);
+        job.running.erase(taskIt);
+        return verdict;
+    }
+
+    const std::size_t others = state.copies.size() - (self != state.copies.end() ? 1 : 0);
+    if (others > 0)
+    {
+        // 还有其他副本在执行, 等待它们的结果; 原副本的消息延后确认, 其他副本都失败时再确认
+        verdict.record = false;
+        if (!isSpeculativeTag(deliveryTag))
+        {
+            verdict.ack = false;
+            state.deferred.push_back(CopyRef{worker, deliveryTag, generation, job_id, task_id});
+        }
+        if (self != state.copies.end())
+        {
+            state.copies.erase(self);
+        }
+        return verdict;
+    }
+
+    // 最后一个副本也失败了
+    verdict.settle = std::move(state.deferred);
+    job.running.erase(taskIt);
+    return verdict;
+}
+
+std::vector<Speculation::CopyRef>
+Speculation::onRejected(const boost::uuids::uuid& worker, std::uint64_t deliveryTag, std::uint64_t generation, std::int64_t job_id, const std::string& task_id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto jobIt = m_jobs.find(job_id);
+    if (jobIt == m_jobs.end())
+    {
+        return {};
+    }
+    if (const auto taskIt = jobIt->second.running.find(task_id); taskIt != jobIt->second.running.end())
+    {
+        // 资源不足的工作机不再用于该任务的推测副本
+        taskIt->second.rejectedBy.insert(worker);
+    }
+    return dropCopy(jobIt->second, task_id, worker, deliveryTag, generation);
+}
+
+std::vector<Speculation::CopyRef>
+Speculation::onCancelled(const boost::uuids::uuid& worker, std::uint64_t deliveryTag, std::uint64_t generation, std::int64_t job_id, const std::string& task_id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto jobIt = m_jobs.find(job_id);
+    if (jobIt == m_jobs.end())
+    {
+        return {};
+    }
+    return dropCopy(jobIt->second, task_id, worker, deliveryTag, generation);
+}
+
+std::vector<Speculation::CopyRef>
+Speculation::copiesOf(std::int64_t job_id) const
+{
+    std::vector<CopyRef> copies;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto jobIt = m_jobs.find(job_id);
+    if (jobIt == m_jobs.end())
+    {
+        return copies;
+    }
+    for (const auto& [task_id, state] : jobIt->second.running)
+    {
+        for (const auto& copy : state.copies)
+        {
+            copies.push_back(CopyRef{copy.worker, copy.delivery_tag, copy.generation, job_id, task_id});
+        }
+    }
+    return copies;
+}
+
+std::vector<Speculation::CopyRef>
+Speculation::onWorkerLost(const boost::uuids::uuid& worker)
+{
+    std::vector<CopyRef> requeue;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& [job_id, job] : m_jobs)
+    {
+        for (auto taskIt = job.running.begin(); taskIt != job.running.end();)
+        {
+            auto& state = taskIt->second;
+            // 该工作机上的原副本已经被回收重新发布, 不再需要确认
+            std::erase_if(state.deferred, [&worker](const CopyRef& ref) { return ref.worker == worker; });
+            std::erase_if(state.copies, [&worker](const Copy& copy) { return copy.worker == worker; });
+            if (!state.copies.empty())
+            {
+                ++taskIt;
+                continue;
+            }
+            requeue.insert(requeue.end(), state.deferred.begin(), state.deferred.end());
+            taskIt = job.running.erase(taskIt);
+        }
+    }
+    m_idleLastScan.erase(worker);
+    return requeue;
+}
+
+void
+Speculation::scan()
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    // 连续两次扫描都空闲的工作机
+    std::vector<std::pair<boost::uuids::uuid, std::size_t>> idle;
+    std::unordered_set<boost::uuids::uuid, UuidHash> idleNow;
+    if (m_idleWorkers)
+    {
+        for (auto& [worker, freeSlots] : m_idleWorkers())
+        {
+            idleNow.insert(worker);
+            if (m_idleLastScan.contains(worker))
+            {
+                idle.emplace_back(worker, freeSlots);
+            }
+        }
+    }
+    m_idleLastScan = std::move(idleNow);
+
+    struct Straggler
+    {
+        std::int64_t job_id;
+        std::string task_id;
+        double ratio; // 运行时间 / 阈值
+    };
+
+    struct Dispatch
+    {
+        std::int64_t job_id;
+        std::string task_id;
+        boost::uuids::uuid worker;
+        Json::Value message;
+    };
+
+    std::vector<Dispatch> dispatches;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        std::unordered_map<boost::uuids::uuid, std::size_t, UuidHash> speculativeCopies;
+        for (auto jobIt = m_jobs.begin(); jobIt != m_jobs.end();)
+        {
+            if (jobIt->second.running.empty() && now - jobIt->second.lastActivity > JOB_RETENTION)
+            {
+                jobIt = m_jobs.erase(jobIt);
+                continue;
+            }
+            for (const auto& [task_id, state] : jobIt->second.running)
+            {
+                for (const auto& copy : state.copies)
+                {
+                    if (copy.speculative)
+                    {
+                        ++speculativeCopies[copy.worker];
+                    }
+                }
+            }
+            ++jobIt;
+        }
+
+        // 推测副本也占用槽位, 但不计入 broker 的预取数量
+        for (auto& [worker, freeSlots] : idle)
+        {
+            const std::size_t used = speculativeCopies[worker];
+            freeSlots = freeSlots > used ? freeSlots - used : 0;
+        }
+        std::erase_if(idle, [](const auto& entry) { return entry.second == 0; });
+        if (idle.empty())
+        {
+            return;
+        }
+
+        std::vector<Straggler> stragglers;
+        for (const auto& [job_id, job] : m_jobs)
+        {
+            if (job.running.empty() || job.durations.size() < m_options.min_samples)
+            {
+                continue;
+            }
+
+            std::vector<double> durations = job.durations;
+            const std::size_t rank = static_cast<std::size_t>(
+                std::ceil(m_options.percentile * static_cast<double>(durations.size()))
+            );
+            const auto nth = durations.begin() + static_cast<std::ptrdiff_t>(std::clamp<std::size_t>(rank, 1, durations.size()) - 1);
+            std::nth_element(durations.begin(), nth, durations.end());
+            const double threshold = std::max(m_options.min_runtime, *nth * m_options.multiplier);
+
+            for (const auto& [task_id, state] : job.running)
+            {
+                if (state.speculated || state.copies.size() != 1 || !state.copies.front().started)
+                {
+                    continue;
+                }
+                const double elapsed = std::chrono::duration<double>(now - state.copies.front().startTime).count();
+                if (elapsed > threshold)
+                {
+                    stragglers.push_back(Straggler{job_id, task_id, elapsed / threshold});
+                }
+            }
+        }
+
+        // 拖得最久的任务优先
+        std::sort(stragglers.begin(), stragglers.end(), [](const Straggler& a, const Straggler& b) {
+            return a.ratio > b.ratio;
+        });
+
+        for (const auto& straggler : stragglers)
+        {
+            auto& state = m_jobs[straggler.job_id].running[straggler.task_id];
+            const auto target = std::find_if(idle.begin(), idle.end(), [&state](const auto& entry) {
+                return entry.second > 0
+                    && entry.first != state.copies.front().worker
+                    && !state.rejectedBy.contains(entry.first);
+            });
+            if (target == idle.end())
+            {
+                continue;
+            }
+
+            const std::uint64_t deliveryTag = SPECULATIVE_TAG_BIT | ++m_nextTag;
+            state.copies.push_back(Copy{target->first, deliveryTag, 0, true});
+            state.speculated = true;
+            --target->second;
+
+            Json::Value dispatch;
+            dispatch["command"] = "dispatch";
+            dispatch["delivery_tag"] = static_cast<Json::UInt64>(deliveryTag);
+            dispatch["generation"] = static_cast<Json::UInt64>(0);
+            dispatch["dispatch_ts"] = static_cast<Json::Int64>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()
+                ).count()
+            );
+            dispatch["speculative"] = true;
+            dispatch["task"] = state.task;
+            dispatches.push_back(Dispatch{straggler.job_id, straggler.task_id, target->first, std::move(dispatch)});
+        }
+    }
+
+    // 在锁外发送, 发送失败时撤销副本
+    for (const auto& dispatch : dispatches)
+    {
+        if (m_dispatch && m_dispatch(dispatch.worker, dispatch.message))
+        {
+            spdlog::info(
+                "Speculative copy of Task {} of Job {} dispatched to Worker {} 拖尾任务的推测副本已分发",
+                dispatch.task_id, dispatch.job_id, boost::uuids::to_string(dispatch.worker)
+            );
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (const auto jobIt = m_jobs.find(dispatch.job_id); jobIt != m_jobs.end())
+        {
+            dropCopy(jobIt->second, dispatch.task_id, dispatch.worker, dispatch.message["delivery_tag"].asUInt64(), 0);
+        }
+    }
+}
+
+} // namespace YLineServer::Scheduler
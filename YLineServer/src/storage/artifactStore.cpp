@@ -0,0 +1,268 @@
+#include "storage/artifactStore.h"
+
+#include <fstream>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace YLineServer::Storage
+{
+
+namespace fs = std::filesystem;
+
+// 超过该时间没有写入的上传状态会被释放 (秒), 之后续传时从 .part 重新计算
+constexpr double UPLOAD_IDLE_INTERVAL = 600.0;
+
+// 重新计算 SHA-256 时的读取缓冲区大小
+constexpr std::size_t REHASH_BUFFER_SIZE = 1024 * 1024;
+
+ArtifactStore::ArtifactStore(fs::path dir)
+    : m_dir(std::move(dir))
+{
+}
+
+void
+ArtifactStore::start()
+{
+    fs::create_directories(m_dir);
+    m_thread = std::make_unique<trantor::EventLoopThread>("ArtifactStore");
+    m_thread->run();
+    m_thread->getLoop()->runEvery(UPLOAD_IDLE_INTERVAL, [this]() { dropIdle(); });
+    spdlog::info("Artifact store started, writing to {} 产物存储已启动", m_dir.string());
+}
+
+fs::path
+ArtifactStore::finalPath(const std::string& key) const
+{
+    return m_dir / fs::path(key);
+}
+
+fs::path
+ArtifactStore::partPath(const std::string& key) const
+{
+    return m_dir / fs::path(key + ".part");
+}
+
+fs::path
+ArtifactStore::completedPath(const std::string& key) const
+{
+    std::error_code ec;
+    const auto path = finalPath(key);
+    return fs::is_regular_file(path, ec) ? path : fs::path{};
+}
+
+std::string
+ArtifactStore::completedSha256(const std::string& key) const
+{
+    std::ifstream file(m_dir / fs::path(key + ".sha256"));
+    std::string sha256;
+    file >> sha256;
+    return YSolowork::util::isSha256Hex(sha256) ? sha256 : std::string{};
+}
+
+void
+ArtifactStore::status(const std::string& key, StatusCallback&& callback)
+{
+    m_thread->getLoop()->queueInLoop(
+        [this, key, callback = std::move(callback)]()
+        {
+            callback(statusOf(key));
+        }
+    );
+}
+
+ArtifactStatus
+ArtifactStore::statusOf(const std::string& key) const
+{
+    ArtifactStatus status;
+    std::error_code ec;
+    if (const auto size = fs::file_size(finalPath(key), ec); !ec)
+    {
+        status.complete = true;
+        status.size = size;
+        status.sha256 = completedSha256(key);
+        return status;
+    }
+    if (const auto it = m_uploads.find(key); it != m_uploads.end())
+    {
+        status.size = it->second.size;
+        return status;
+    }
+    ec.clear();
+    const auto size = fs::file_size(partPath(key), ec);
+    status.size = ec ? 0 : size;
+    return status;
+}
+
+ArtifactStore::Upload*
+ArtifactStore::uploadOf(const std::string& key)
+{
+    const auto part = partPath(key);
+    std::error_code ec;
+    const auto partSize = fs::file_size(part, ec);
+    const std::uint64_t size = ec ? 0 : partSize;
+
+    auto it = m_uploads.find(key);
+    if (it != m_uploads.end() && it->second.size == size)
+    {
+        return &it->second;
+    }
+
+    // 服务器重启或状态已释放, 从已收到的数据重新计算
+    Upload upload;
+    upload.lastWrite = std::chrono::steady_clock::now();
+    if (size > 0)
+    {
+        std::ifstream file(part, std::ios::binary);
+        std::vector<char> buffer(REHASH_BUFFER_SIZE);
+        while (file)
+        {
+            file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            upload.hasher.update(buffer.data(), static_cast<std::size_t>(file.gcount()));
+            upload.size += static_cast<std::uint64_t>(file.gcount());
+        }
+        if (file.bad() || upload.size != size)
+        {
+            spdlog::error("Failed to read partial artifact 读取未完成的产物失败: {}", part.string());
+            return nullptr;
+        }
+    }
+    return &(m_uploads.insert_or_assign(key, std::move(upload)).first->second);
+}
+
+void
+ArtifactStore::write(
+    const std::string& key,
+    std::uint64_t offset,
+    std::string_view data,
+    const std::string& chunkSha256,
+    std::shared_ptr<const void> keepAlive,
+    ResultCallback&& callback
+)
+{
+    m_thread->getLoop()->queueInLoop(
+        [this, key, offset, data, chunkSha256, keepAlive = std::move(keepAlive), callback = std::move(callback)]()
+        {
+            if (fs::exists(finalPath(key)))
+            {
+                callback(ArtifactResult::already_complete, statusOf(key));
+                return;
+            }
+
+            // 先校验数据块, 损坏的块不写入
+            YSolowork::util::Sha256 chunkHasher;
+            chunkHasher.update(data);
+            if (chunkHasher.hexDigest() != chunkSha256)
+            {
+                callback(ArtifactResult::chunk_corrupted, statusOf(key));
+                return;
+            }
+
+            std::error_code ec;
+            fs::create_directories(partPath(key).parent_path(), ec);
+            auto* upload = uploadOf(key);
+            if (!upload)
+            {
+                callback(ArtifactResult::io_error, statusOf(key));
+                return;
+            }
+            if (upload->size != offset)
+            {
+                callback(ArtifactResult::offset_mismatch, statusOf(key));
+                return;
+            }
+
+            std::ofstream part(partPath(key), std::ios::binary | std::ios::app);
+            part.write(data.data(), static_cast<std::streamsize>(data.size()));
+            part.close();
+            if (!part)
+            {
+                // 写了一部分的数据块会让大小与状态不一致, 下次从文件重新计算
+                m_uploads.erase(key);
+                spdlog::error("Failed to write artifact chunk 写入产物数据块失败: {}", key);
+                callback(ArtifactResult::io_error, statusOf(key));
+                return;
+            }
+
+            upload->hasher.update(data);
+            upload->size += data.size();
+            upload->lastWrite = std::chrono::steady_clock::now();
+            callback(ArtifactResult::ok, statusOf(key));
+        }
+    );
+}
+
+void
+ArtifactStore::complete(const std::string& key, const std::string& sha256, ResultCallback&& callback)
+{
+    m_thread->getLoop()->queueInLoop(
+        [this, key, sha256, callback = std::move(callback)]()
+        {
+            if (fs::exists(finalPath(key)))
+            {
+                const auto status = statusOf(key);
+                callback(status.sha256 == sha256 ? ArtifactResult::ok : ArtifactResult::already_complete, status);
+                return;
+            }
+
+            auto* upload = uploadOf(key);
+            if (!upload)
+            {
+                callback(ArtifactResult::io_error, statusOf(key));
+                return;
+            }
+
+            // hexDigest 会结束计算, 复制一份, 校验失败时不影响状态
+            auto hasher = upload->hasher;
+            const std::string actual = hasher.hexDigest();
+            std::error_code ec;
+            if (actual != sha256)
+            {
+                spdlog::warn(
+                    "Artifact {} checksum mismatch, discarded 产物校验失败, 已丢弃: expected {}, got {}",
+                    key, sha256, actual
+                );
+                m_uploads.erase(key);
+                fs::remove(partPath(key), ec);
+                callback(ArtifactResult::file_corrupted, statusOf(key));
+                return;
+            }
+
+            // 空文件没有数据块, 也就没有 .part
+            if (!fs::exists(partPath(key)))
+            {
+                fs::create_directories(partPath(key).parent_path(), ec);
+                std::ofstream empty(partPath(key), std::ios::binary);
+            }
+
+            // 先写 SHA-256, 重命名之后产物即对外可见
+            {
+                std::ofstream sidecar(m_dir / fs::path(key + ".sha256"), std::ios::trunc);
+                sidecar << actual;
+            }
+            fs::rename(partPath(key), finalPath(key), ec);
+            m_uploads.erase(key);
+            if (ec)
+            {
+                spdlog::error("Failed to finalize artifact 完成产物失败: {}, {}", key, ec.message());
+                callback(ArtifactResult::io_error, statusOf(key));
+                return;
+            }
+
+            const auto status = statusOf(key);
+            spdlog::info("Artifact stored 产物已保存: {} ({:.1f} MB)", key, static_cast<double>(status.size) / (1024.0 * 1024));
+            callback(ArtifactResult::ok, status);
+        }
+    );
+}
+
+void
+ArtifactStore::dropIdle()
+{
+    const auto deadline = std::chrono::steady_clock::now() - std::chrono::duration<double>(UPLOAD_IDLE_INTERVAL);
+    std::erase_if(m_uploads, [deadline](const auto& entry) {
+        return entry.second.lastWrite < deadline;
+    });
+}
+
+} // namespace YLineServer::Storage
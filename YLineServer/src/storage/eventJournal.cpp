@@ -0,0 +1,360 @@
+#include "storage/eventJournal.h"
+
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <system_error>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <spdlog/spdlog.h>
+
+namespace YLineServer::Storage
+{
+
+// 创建段文件失败后, 该线程在这段时间内丢弃记录, 避免每条记录都重试
+constexpr std::chrono::seconds CREATE_RETRY_INTERVAL{10};
+
+namespace
+{
+
+constexpr std::array<std::string_view, 9> EVENT_NAMES = {
+    "", "queued", "dispatched", "acked", "completed", "requeued", "dropped", "online", "offline"
+};
+
+constexpr std::array<std::string_view, 7> REASON_NAMES = {
+    "", "rejected", "reclaimed", "retry", "quarantined", "disconnected", "timeout"
+};
+
+std::int64_t
+nowNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+}
+
+} // namespace
+
+std::string_view
+journalEventName(JournalEvent event)
+{
+    const auto index = static_cast<std::size_t>(event);
+    return index < EVENT_NAMES.size() ? EVENT_NAMES[index] : std::string_view{};
+}
+
+std::optional<JournalEvent>
+parseJournalEvent(std::string_view name)
+{
+    for (std::size_t i = 1; i < EVENT_NAMES.size(); ++i)
+    {
+        if (EVENT_NAMES[i] == name)
+        {
+            return static_cast<JournalEvent>(i);
+        }
+    }
+    return std::nullopt;
+}
+
+std::string_view
+journalReasonName(JournalReason reason)
+{
+    const auto index = static_cast<std::size_t>(reason);
+    return index < REASON_NAMES.size() ? REASON_NAMES[index] : std::string_view{};
+}
+
+// 每个线程一个, 只有所属线程访问
+class EventJournal::Writer
+{
+public:
+    Writer(std::shared_ptr<State> state, std::uint32_t thread)
+        : m_state(std::move(state)), m_thread(thread)
+    {
+    }
+
+    ~Writer()
+    {
+        close();
+    }
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    inline const std::shared_ptr<State>&
+    state() const
+    {
+        return m_state;
+    }
+
+    // 下一条记录的位置, 当前段写满时创建新的段, 失败时返回 nullptr
+    JournalRecord*
+    slot()
+    {
+        if (m_records && m_next < m_capacity)
+        {
+            return &m_records[m_next++];
+        }
+        if (!roll())
+        {
+            return nullptr;
+        }
+        return &m_records[m_next++];
+    }
+
+private:
+    std::shared_ptr<State> m_state;
+    std::uint32_t m_thread;
+
+    boost::interprocess::mapped_region m_region;
+    JournalRecord* m_records = nullptr;
+    std::size_t m_capacity = 0;
+    std::size_t m_next = 0;
+    std::string m_path;
+    std::chrono::steady_clock::time_point m_retryAt;
+
+    void
+    close()
+    {
+        if (m_path.empty())
+        {
+            return;
+        }
+        m_region = boost::interprocess::mapped_region();
+        m_records = nullptr;
+        m_next = 0;
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        m_state->active.erase(m_path);
+        m_path.clear();
+    }
+
+    bool
+    roll()
+    {
+        close();
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now < m_retryAt)
+        {
+            return false;
+        }
+
+        const auto& options = m_state->options;
+        const std::int64_t created = nowNanoseconds();
+        const std::size_t capacity = std::max<std::size_t>(options.segment_records, 1);
+        const auto path = options.dir / std::format("{:020}_{}{}", created, m_thread, JOURNAL_EXTENSION);
+        try
+        {
+            std::filesystem::create_directories(options.dir);
+            {
+                std::ofstream file(path, std::ios::binary | std::ios::trunc);
+                if (!file)
+                {
+                    throw std::runtime_error("cannot create file");
+                }
+            }
+            // 预先分配整个段, 未写入的记录全为 0
+            std::filesystem::resize_file(path, sizeof(JournalHeader) + capacity * sizeof(JournalRecord));
+
+            boost::interprocess::file_mapping mapping(path.string().c_str(), boost::interprocess::read_write);
+            m_region = boost::interprocess::mapped_region(mapping, boost::interprocess::read_write);
+        }
+        catch (const std::exception& e)
+        {
+            spdlog::error("Failed to create event journal segment 创建调度事件日志段失败: {}: {}", path.string(), e.what());
+            m_region = boost::interprocess::mapped_region();
+            m_retryAt = now + CREATE_RETRY_INTERVAL;
+            return false;
+        }
+
+        JournalHeader header{};
+        header.magic = JournalHeader::MAGIC;
+        header.version = JournalHeader::VERSION;
+        header.record_size = sizeof(JournalRecord);
+        header.capacity = capacity;
+        header.created = created;
+        header.thread = m_thread;
+        auto* base = static_cast<char*>(m_region.get_address());
+        std::memcpy(base, &header, sizeof(header));
+
+        m_records = reinterpret_cast<JournalRecord*>(base + sizeof(JournalHeader));
+        m_capacity = capacity;
+        m_next = 0;
+        m_path = path.string();
+
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        m_state->active.insert(m_path);
+        prune();
+        return true;
+    }
+
+    // 删除最旧的段文件, 调用者持有 m_state->mutex
+    void
+    prune()
+    {
+        const auto& options = m_state->options;
+        auto files = EventJournal::segments(options.dir);
+        if (files.size() <= options.max_segments)
+        {
+            return;
+        }
+        std::size_t excess = files.size() - options.max_segments;
+        for (const auto& file : files)
+        {
+            if (excess == 0)
+            {
+                break;
+            }
+            if (m_state->active.contains(file.string()))
+            {
+                continue;
+            }
+            std::error_code ec;
+            std::filesystem::remove(file, ec);
+            if (ec)
+            {
+                spdlog::warn("Failed to remove event journal segment 删除调度事件日志段失败: {}: {}", file.string(), ec.message());
+            }
+            --excess;
+        }
+    }
+};
+
+EventJournal::EventJournal(EventJournalOptions options)
+    : m_state(std::make_shared<State>())
+{
+    m_state->options = std::move(options);
+}
+
+EventJournal::Writer&
+EventJournal::writer()
+{
+    // 线程退出时关闭自己的段文件; 日志重新创建时丢弃旧的写入器
+    thread_local std::unique_ptr<Writer> t_writer;
+    if (!t_writer || t_writer->state() != m_state)
+    {
+        t_writer.reset();
+        t_writer = std::make_unique<Writer>(m_state, m_state->threads.fetch_add(1, std::memory_order_relaxed));
+    }
+    return *t_writer;
+}
+
+void
+EventJournal::record(
+    JournalEvent event,
+    const boost::uuids::uuid& worker,
+    std::uint64_t deliveryTag,
+    std::int64_t jobID,
+    std::string_view taskID,
+    std::uint8_t detail
+)
+{
+    JournalRecord* record = writer().slot();
+    if (!record)
+    {
+        m_state->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    record->time = nowNanoseconds();
+    record->delivery_tag = deliveryTag;
+    record->job_id = jobID;
+    std::copy(worker.begin(), worker.end(), record->worker.begin());
+    record->task_hash = taskID.empty() ? 0 : journalTaskHash(taskID);
+    const std::size_t length = std::min(taskID.size(), JournalRecord::TASK_ID_SIZE);
+    std::copy_n(taskID.data(), length, record->task_id.begin());
+    record->detail = detail;
+    // type 最后写入, 崩溃时读取器看到的记录要么完整, 要么 type 为 0
+    std::atomic_signal_fence(std::memory_order_release);
+    record->type = static_cast<std::uint8_t>(event);
+}
+
+void
+EventJournal::record(JournalEvent event, const boost::uuids::uuid& worker, JournalReason reason)
+{
+    record(event, worker, 0, 0, {}, static_cast<std::uint8_t>(reason));
+}
+
+std::uint64_t
+EventJournal::dropped() const
+{
+    return m_state->dropped.load(std::memory_order_relaxed);
+}
+
+std::vector<std::filesystem::path>
+EventJournal::segments(const std::filesystem::path& dir)
+{
+    std::vector<std::filesystem::path> files;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec))
+    {
+        if (entry.is_regular_file(ec) && entry.path().extension() == JOURNAL_EXTENSION)
+        {
+            files.push_back(entry.path());
+        }
+    }
+    // 文件名以补 0 的创建时间开头, 按文件名排序即按时间排序
+    std::sort(files.begin(), files.end(),
+        [](const auto& a, const auto& b) { return a.filename() < b.filename(); });
+    return files;
+}
+
+JournalReader::JournalReader(const std::filesystem::path& path)
+    : m_file(path, std::ios::binary)
+{
+    if (!m_file)
+    {
+        throw std::runtime_error("Cannot open " + path.string());
+    }
+    if (!m_file.read(reinterpret_cast<char*>(&m_header), sizeof(m_header))
+        || m_header.magic != JournalHeader::MAGIC)
+    {
+        throw std::runtime_error("Not an event journal segment: " + path.string());
+    }
+    if (m_header.version != JournalHeader::VERSION || m_header.record_size != sizeof(JournalRecord))
+    {
+        throw std::runtime_error(std::format(
+            "Unsupported event journal version {} (record size {}): {}",
+            m_header.version, m_header.record_size, path.string()
+        ));
+    }
+    m_remaining = m_header.capacity;
+}
+
+std::optional<JournalRecord>
+JournalReader::next()
+{
+    if (m_position == m_buffer.size())
+    {
+        if (m_end || m_remaining == 0)
+        {
+            return std::nullopt;
+        }
+        // 一次读取一批记录
+        constexpr std::uint64_t BATCH = 4096;
+        m_buffer.resize(static_cast<std::size_t>(std::min(m_remaining, BATCH)));
+        m_file.read(reinterpret_cast<char*>(m_buffer.data()), static_cast<std::streamsize>(m_buffer.size() * sizeof(JournalRecord)));
+        const auto count = static_cast<std::size_t>(m_file.gcount()) / sizeof(JournalRecord);
+        m_buffer.resize(count);
+        m_remaining = count == 0 ? 0 : m_remaining - count;
+        m_position = 0;
+        if (count == 0)
+        {
+            return std::nullopt;
+        }
+    }
+
+    const JournalRecord& record = m_buffer[m_position++];
+    if (record.type == 0)
+    {
+        // 未写入的部分, 后面都是 0
+        m_end = true;
+        m_buffer.clear();
+        m_position = 0;
+        return std::nullopt;
+    }
+    return record;
+}
+
+} // namespace YLineServer::Storage
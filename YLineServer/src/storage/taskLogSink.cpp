@@ -0,0 +1,146 @@
+#include "storage/taskLogSink.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace YLineServer::Storage
+{
+
+// 超过该时间没有写入的日志文件会被关闭 (秒)
+constexpr double IDLE_CLOSE_INTERVAL = 30.0;
+
+namespace
+{
+
+// task_id 由用户提交, 只保留安全字符, 避免路径穿越
+std::string sanitizeFileName(const std::string& name)
+{
+    std::string result;
+    result.reserve(name.size());
+    for (const char c : name)
+    {
+        const bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+            || c == '-' || c == '_' || c == '.';
+        result.push_back(safe ? c : '_');
+    }
+    if (result.empty() || result.find_first_not_of('.') == std::string::npos)
+    {
+        result = "_" + result;
+    }
+    return result;
+}
+
+} // namespace
+
+TaskLogSink::TaskLogSink(std::filesystem::path dir, std::size_t max_pending_bytes)
+    : m_dir(std::move(dir)), m_maxPendingBytes(max_pending_bytes)
+{
+}
+
+void
+TaskLogSink::start()
+{
+    std::filesystem::create_directories(m_dir);
+    m_thread = std::make_unique<trantor::EventLoopThread>("TaskLogSink");
+    m_thread->run();
+    m_thread->getLoop()->runEvery(IDLE_CLOSE_INTERVAL, [this]() { closeIdle(); });
+    spdlog::info("Task log sink started, writing to {} 任务日志存储已启动", m_dir.string());
+}
+
+std::filesystem::path
+TaskLogSink::pathOf(std::int64_t job_id, const std::string& task_id, const std::string& stream) const
+{
+    return m_dir / std::to_string(job_id) / (sanitizeFileName(task_id) + "." + sanitizeFileName(stream) + ".log.gz");
+}
+
+void
+TaskLogSink::append(const YSolowork::util::LogFrameHeader& header, std::string&& payload)
+{
+    const std::size_t size = payload.size();
+    const std::size_t pending = m_pendingBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    if (pending > m_maxPendingBytes)
+    {
+        m_pendingBytes.fetch_sub(size, std::memory_order_relaxed);
+        // 只在第一次和之后每 1000 次丢弃时打印, 避免日志本身刷屏
+        const auto dropped = m_droppedChunks.fetch_add(1, std::memory_order_relaxed);
+        if (dropped % 1000 == 0)
+        {
+            spdlog::warn(
+                "Task log sink is behind, dropped {} chunks so far 任务日志写入跟不上, 已丢弃日志块",
+                dropped + 1
+            );
+        }
+        return;
+    }
+
+    m_thread->getLoop()->queueInLoop(
+        [this, header, payload = std::move(payload)]()
+        {
+            write(header, payload);
+            m_pendingBytes.fetch_sub(payload.size(), std::memory_order_relaxed);
+        }
+    );
+}
+
+void
+TaskLogSink::write(const YSolowork::util::LogFrameHeader& header, const std::string& payload)
+{
+    const auto path = pathOf(header.job_id, header.task_id, header.stream);
+    const std::string key = path.string();
+
+    auto it = m_openLogs.find(key);
+    if (it == m_openLogs.end())
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+        OpenLog log;
+        log.file.open(path, std::ios::binary | std::ios::app);
+        if (!log.file.is_open())
+        {
+            spdlog::error("Failed to open task log 打开任务日志失败: {}", key);
+            return;
+        }
+        // 服务器重启后无法得知已写入的序号, 从收到的第一块开始
+        log.nextSeq = header.seq;
+        it = m_openLogs.emplace(key, std::move(log)).first;
+    }
+
+    auto& log = it->second;
+    if (header.seq < log.nextSeq)
+    {
+        // 工作机重连后重发的块
+        spdlog::debug("Duplicate task log chunk ignored 忽略重复的日志块: {} seq {}", key, header.seq);
+        return;
+    }
+    if (header.seq > log.nextSeq)
+    {
+        spdlog::warn("Task log chunks missing 日志块缺失: {} seq {} - {}", key, log.nextSeq, header.seq - 1);
+    }
+    if (header.dropped > 0)
+    {
+        spdlog::warn("Worker dropped {} bytes of task output 工作机丢弃了任务输出: {}", header.dropped, key);
+    }
+
+    log.file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    log.nextSeq = header.seq + 1;
+    log.lastWrite = std::chrono::steady_clock::now();
+
+    if (header.eof)
+    {
+        log.file.close();
+        m_openLogs.erase(it);
+    }
+}
+
+void
+TaskLogSink::closeIdle()
+{
+    const auto deadline = std::chrono::steady_clock::now() - std::chrono::duration<double>(IDLE_CLOSE_INTERVAL);
+    std::erase_if(m_openLogs, [deadline](const auto& entry) {
+        return entry.second.lastWrite < deadline;
+    });
+}
+
+} // namespace YLineServer::Storage
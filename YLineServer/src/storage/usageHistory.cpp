@@ -0,0 +1,293 @@
+#include "storage/usageHistory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace YLineServer::Storage
+{
+
+namespace
+{
+
+// 工作机上报的负数表示获取失败, 不参与统计
+float
+metricValue(double value)
+{
+    return value < 0 ? std::numeric_limits<float>::quiet_NaN() : static_cast<float>(value);
+}
+
+std::int64_t
+bucketStart(std::int64_t time, std::int64_t width)
+{
+    // 向下取整, 兼容负数时间
+    const std::int64_t q = time / width;
+    return (q * width > time ? q - 1 : q) * width;
+}
+
+} // namespace
+
+void
+UsageStat::add(float value)
+{
+    if (count == 0)
+    {
+        min = value;
+        max = value;
+    }
+    else
+    {
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+    sum += value;
+    if (count < std::numeric_limits<std::uint16_t>::max())
+    {
+        ++count;
+    }
+}
+
+UsageHistory::Tier::Tier(std::int64_t width, std::size_t capacity, std::size_t metrics)
+    : m_width(width)
+    , m_capacity(std::max<std::size_t>(capacity, 1))
+    , m_metrics(metrics)
+    , m_starts(m_capacity, 0)
+    , m_stats(m_capacity * metrics)
+{
+}
+
+void
+UsageHistory::Tier::add(std::int64_t time, const std::vector<float>& values)
+{
+    const std::int64_t start = bucketStart(time, m_width);
+    std::size_t slot;
+    const std::size_t newest = (m_head + m_size + m_capacity - 1) % m_capacity;
+    if (m_size > 0 && start <= m_starts[newest])
+    {
+        // 同一个时间桶; 时钟回拨的样本也并入最新的时间桶
+        slot = newest;
+    }
+    else
+    {
+        if (m_size < m_capacity)
+        {
+            slot = (m_head + m_size) % m_capacity;
+            ++m_size;
+        }
+        else
+        {
+            // 覆盖最旧的时间桶
+            slot = m_head;
+            m_head = (m_head + 1) % m_capacity;
+        }
+        m_starts[slot] = start;
+        std::fill_n(m_stats.begin() + static_cast<std::ptrdiff_t>(slot * m_metrics), m_metrics, UsageStat{});
+    }
+
+    UsageStat* stats = m_stats.data() + slot * m_metrics;
+    for (std::size_t i = 0; i < m_metrics && i < values.size(); ++i)
+    {
+        if (!std::isnan(values[i]))
+        {
+            stats[i].add(values[i]);
+        }
+    }
+}
+
+bool
+UsageHistory::Tier::covers(std::int64_t from) const
+{
+    // 还没有覆盖过旧数据时, 这里就是全部的历史
+    return m_size > 0 && (m_size < m_capacity || m_starts[m_head] <= from);
+}
+
+void
+UsageHistory::Tier::collect(std::int64_t from, std::int64_t to, UsageSeries& series) const
+{
+    for (std::size_t i = 0; i < m_size; ++i)
+    {
+        const std::size_t slot = (m_head + i) % m_capacity;
+        const std::int64_t start = m_starts[slot];
+        if (start + m_width <= from)
+        {
+            continue;
+        }
+        if (start > to)
+        {
+            break;
+        }
+        series.starts.push_back(start);
+        const auto first = m_stats.begin() + static_cast<std::ptrdiff_t>(slot * m_metrics);
+        series.stats.insert(series.stats.end(), first, first + static_cast<std::ptrdiff_t>(m_metrics));
+    }
+}
+
+std::size_t
+UsageHistory::UuidHash::operator()(const boost::uuids::uuid& uuid) const noexcept
+{
+    return boost::uuids::hash_value(uuid);
+}
+
+UsageHistory::UsageHistory(UsageHistoryOptions options)
+    : m_options(options)
+{
+}
+
+void
+UsageHistory::resetLocked(WorkerHistory& history, const UsageSample& sample) const
+{
+    history.gpus.clear();
+    history.metrics = {"cpu", "memory"};
+    for (const auto& gpu : sample.gpus)
+    {
+        history.gpus.push_back(gpu.index);
+        const std::string prefix = "gpu" + std::to_string(gpu.index) + ".";
+        history.metrics.push_back(prefix + "usage");
+        history.metrics.push_back(prefix + "memory_used");
+        history.metrics.push_back(prefix + "temperature");
+        history.metrics.push_back(prefix + "power");
+    }
+
+    const std::array<std::size_t, WIDTHS.size()> counts = {
+        m_options.raw_count, m_options.minute_count, m_options.hour_count
+    };
+    history.tiers.clear();
+    for (std::size_t i = 0; i < WIDTHS.size(); ++i)
+    {
+        history.tiers.emplace_back(WIDTHS[i], counts[i], history.metrics.size());
+    }
+}
+
+void
+UsageHistory::record(const boost::uuids::uuid& worker, std::int64_t time, const UsageSample& sample)
+{
+    std::shared_ptr<WorkerHistory> history;
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        const auto it = m_workers.find(worker);
+        if (it != m_workers.end())
+        {
+            history = it->second;
+        }
+    }
+    if (!history)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        auto& slot = m_workers[worker];
+        if (!slot)
+        {
+            slot = std::make_shared<WorkerHistory>();
+        }
+        history = slot;
+    }
+
+    std::vector<float> values;
+    values.reserve(2 + sample.gpus.size() * 4);
+    values.push_back(metricValue(sample.cpu));
+    values.push_back(metricValue(sample.memory));
+    for (const auto& gpu : sample.gpus)
+    {
+        values.push_back(metricValue(gpu.usage));
+        values.push_back(metricValue(gpu.memory_used));
+        values.push_back(metricValue(gpu.temperature));
+        values.push_back(metricValue(gpu.power));
+    }
+
+    std::lock_guard<std::mutex> lock(history->mutex);
+    const bool sameGpus = history->gpus.size() == sample.gpus.size()
+        && std::equal(
+            history->gpus.begin(), history->gpus.end(), sample.gpus.begin(),
+            [](unsigned int index, const UsageSample::Gpu& gpu) { return index == gpu.index; }
+        );
+    if (history->tiers.empty() || !sameGpus)
+    {
+        // 第一个样本, 或者 GPU 变化 (例如驱动重新加载), 旧历史的指标对不上, 直接清空
+        resetLocked(*history, sample);
+    }
+    for (auto& tier : history->tiers)
+    {
+        tier.add(time, values);
+    }
+    history->lastSample = time;
+}
+
+std::optional<UsageSeries>
+UsageHistory::query(const boost::uuids::uuid& worker, std::int64_t from, std::int64_t to, std::int64_t width) const
+{
+    std::shared_ptr<WorkerHistory> history;
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        const auto it = m_workers.find(worker);
+        if (it == m_workers.end())
+        {
+            return std::nullopt;
+        }
+        history = it->second;
+    }
+
+    std::lock_guard<std::mutex> lock(history->mutex);
+    if (history->tiers.empty())
+    {
+        return std::nullopt;
+    }
+
+    const Tier* chosen = nullptr;
+    if (width != 0)
+    {
+        for (const auto& tier : history->tiers)
+        {
+            if (tier.width() == width)
+            {
+                chosen = &tier;
+            }
+        }
+        if (!chosen)
+        {
+            return std::nullopt;
+        }
+    }
+    else
+    {
+        // 覆盖查询起点且时间桶数量不超过 max_points 的最精细的精度, 都不满足时使用最粗的
+        chosen = &history->tiers.back();
+        for (const auto& tier : history->tiers)
+        {
+            const std::int64_t points = (to - from) / tier.width() + 1;
+            if (tier.covers(from) && points <= static_cast<std::int64_t>(m_options.max_points))
+            {
+                chosen = &tier;
+                break;
+            }
+        }
+    }
+
+    UsageSeries series;
+    series.width = chosen->width();
+    series.metrics = history->metrics;
+    chosen->collect(from, to, series);
+    return series;
+}
+
+void
+UsageHistory::prune(std::int64_t now, std::int64_t maxIdle)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    for (auto it = m_workers.begin(); it != m_workers.end();)
+    {
+        bool idle;
+        {
+            std::lock_guard<std::mutex> historyLock(it->second->mutex);
+            idle = now - it->second->lastSample > maxIdle;
+        }
+        if (idle)
+        {
+            it = m_workers.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+} // namespace YLineServer::Storage
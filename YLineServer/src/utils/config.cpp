@@ -3,6 +3,7 @@
 #include "utils/logger.h"
 #include "vendor_include/toml.hpp"
 
+#include <algorithm>
 #include <cstddef>
 #include <spdlog/spdlog.h>
 #include <stdexcept>
@@ -54,6 +55,14 @@ Config parseConfig() {
         throw std::runtime_error("Register secret is empty");
     }
     std::uint32_t consumerAMQPConnection = worker["consumer_AMQP_connection"].value_or(1); // 默认 4
+    // 工作机存活检测: 超过 heartbeat_timeout 未收到任何消息视为失联, 离线超过 reclaim_grace 后回收其任务
+    float workerHeartbeatTimeout = worker["heartbeat_timeout"].value_or(10.0);
+    float workerReclaimGrace = worker["reclaim_grace"].value_or(30.0);
+    if (workerHeartbeatTimeout <= 0 || workerReclaimGrace < 0)
+    {
+        spdlog::error("Invalid worker heartbeat_timeout or reclaim_grace 无效的工作机心跳超时或回收宽限期");
+        throw std::runtime_error("Invalid worker heartbeat_timeout or reclaim_grace");
+    }
 
     // 读取 middleware 部分
     const auto& middleware = getTable("middleware", YLineServerConfig);
@@ -101,6 +110,14 @@ Config parseConfig() {
     const std::string& dbName = database["db_name"].value_or("yline");
     size_t dbConnectionNumber = database["connection_number"].value_or(10);
     float dbTimeout = database["timeout"].value_or(5.0);
+    // 工作机注册写缓冲: 合并等待时间 (秒) 和单条语句最大行数
+    float dbRegisterBatchDelay = database["register_batch_delay"].value_or(0.005);
+    size_t dbRegisterBatchSize = database["register_batch_size"].value_or(500);
+    if (dbRegisterBatchSize == 0)
+    {
+        spdlog::warn("Invalid database register_batch_size 无效的注册批量大小: 0, using 1");
+        dbRegisterBatchSize = 1;
+    }
 
     // 读取 redis 部分
     const auto& redis = getTable("redis", YLineServerConfig);
@@ -130,6 +147,23 @@ Config parseConfig() {
         spdlog::warn("Invalid log level 无效的日志等级: {}", logLevelStr);
         spdlog::warn("Using default log level 使用默认日志等级: info");
     }
+    bool logAsync = loggerTbl["async"].value_or(true);
+    size_t logQueueSize = loggerTbl["queue_size"].value_or(8192);
+    if (logQueueSize == 0)
+    {
+        spdlog::warn("Invalid logger queue_size 无效的日志队列容量: 0, using 8192");
+        logQueueSize = 8192;
+    }
+    const std::string& logOverflowStr = loggerTbl["overflow"].value_or("overrun_oldest");
+    auto logOverflowPolicy = spdlog::async_overflow_policy::overrun_oldest;
+    if (const auto it = YLineServer::logOverflowPolicyMap.find(logOverflowStr); it != YLineServer::logOverflowPolicyMap.end())
+    {
+        logOverflowPolicy = it->second;
+    }
+    else
+    {
+        spdlog::warn("Invalid logger overflow 无效的日志队列策略: {}, using overrun_oldest", logOverflowStr);
+    }
 
     // 读取 dbmate 部分
     bool migration = YLineServerConfig["dbmate"]["migration"].value_or(true);
@@ -141,6 +175,107 @@ Config parseConfig() {
         const std::string& dbmate_download_name = YLineServerConfig["dbmate"]["win_name"].value_or("dbmate-windows-amd64.exe");
     #endif
 
+    // 读取 cluster 部分, 可选
+    bool clusterEnable = YLineServerConfig["cluster"]["enable"].value_or(false);
+    // 其他实例重定向工作机时使用的地址, 默认为本实例监听地址
+    const std::string& clusterAdvertiseAddress = YLineServerConfig["cluster"]["advertise_address"].value_or(
+        std::format("{}:{}", serverIp, serverPort)
+    );
+    float clusterHeartbeatInterval = YLineServerConfig["cluster"]["heartbeat_interval"].value_or(2.0);
+    int clusterMemberTTL = YLineServerConfig["cluster"]["member_ttl"].value_or(6);
+    if (clusterEnable && clusterMemberTTL <= clusterHeartbeatInterval)
+    {
+        spdlog::error("Cluster member_ttl must be greater than heartbeat_interval 集群成员过期时间必须大于心跳间隔");
+        throw std::runtime_error("Cluster member_ttl must be greater than heartbeat_interval");
+    }
+
+    // 读取 task_log 部分, 可选
+    // 相对路径相对于可执行文件目录
+    std::filesystem::path taskLogDir = YLineServerConfig["task_log"]["dir"].value_or("task_logs");
+    if (taskLogDir.is_relative())
+    {
+        taskLogDir = exePath / taskLogDir;
+    }
+    // 等待写入磁盘的日志超过该大小时丢弃新的日志块, 保护 I/O 线程和内存
+    size_t taskLogMaxPendingBytes = YLineServerConfig["task_log"]["max_pending_bytes"].value_or(64 * 1024 * 1024);
+
+    // 读取 artifact 部分, 可选
+    // 相对路径相对于可执行文件目录
+    std::filesystem::path artifactDir = YLineServerConfig["artifact"]["dir"].value_or("artifacts");
+    if (artifactDir.is_relative())
+    {
+        artifactDir = exePath / artifactDir;
+    }
+    // 单个上传数据块的最大字节数, 同时作为 HTTP 请求体的大小上限
+    size_t artifactMaxChunkBytes = YLineServerConfig["artifact"]["max_chunk_bytes"].value_or(16 * 1024 * 1024);
+
+    // 读取 scheduler 部分, 可选
+    bool speculativeEnable = YLineServerConfig["scheduler"]["speculative"].value_or(true);
+    float speculativeInterval = YLineServerConfig["scheduler"]["speculative_interval"].value_or(5.0);
+    float speculativePercentile = YLineServerConfig["scheduler"]["speculative_percentile"].value_or(0.75);
+    float speculativeMultiplier = YLineServerConfig["scheduler"]["speculative_multiplier"].value_or(1.5);
+    size_t speculativeMinSamples = YLineServerConfig["scheduler"]["speculative_min_samples"].value_or(3);
+    float speculativeMinRuntime = YLineServerConfig["scheduler"]["speculative_min_runtime"].value_or(30.0);
+    bool cacheAffinity = YLineServerConfig["scheduler"]["cache_affinity"].value_or(true);
+    if (speculativePercentile <= 0 || speculativePercentile > 1)
+    {
+        spdlog::warn("Invalid scheduler speculative_percentile 无效的推测执行分位数: {}, using 0.75", speculativePercentile);
+        speculativePercentile = 0.75;
+    }
+
+    // 读取 retry 部分, 可选; 作业和任务可以覆盖 max_attempts, backoff_base, backoff_max
+    std::uint32_t retryMaxAttempts = YLineServerConfig["retry"]["max_attempts"].value_or(3u);
+    float retryBackoffBase = YLineServerConfig["retry"]["backoff_base"].value_or(10.0);
+    float retryBackoffMax = YLineServerConfig["retry"]["backoff_max"].value_or(600.0);
+    std::uint32_t retryBlacklistFailures = YLineServerConfig["retry"]["blacklist_failures"].value_or(2u);
+    float retryBlacklistTTL = YLineServerConfig["retry"]["blacklist_ttl"].value_or(3600.0);
+    float retryBlacklistDefer = YLineServerConfig["retry"]["blacklist_defer"].value_or(5.0);
+    if (retryMaxAttempts == 0)
+    {
+        spdlog::warn("Invalid retry max_attempts 无效的最大执行次数: 0, using 1");
+        retryMaxAttempts = 1;
+    }
+
+    // 读取 scheduler 部分的抢占与取消选项, 可选
+    bool preemptEnable = YLineServerConfig["scheduler"]["preempt"].value_or(true);
+    int preemptPriority = YLineServerConfig["scheduler"]["preempt_priority"].value_or(50);
+    float preemptGrace = YLineServerConfig["scheduler"]["preempt_grace"].value_or(30.0);
+    size_t preemptMax = YLineServerConfig["scheduler"]["preempt_max"].value_or(16);
+    float cancelGrace = YLineServerConfig["scheduler"]["cancel_grace"].value_or(10.0);
+    if (preemptPriority < 1 || preemptPriority > 100)
+    {
+        spdlog::warn("Invalid scheduler preempt_priority 无效的抢占优先级: {}, using 50", preemptPriority);
+        preemptPriority = 50;
+    }
+    preemptGrace = std::max(preemptGrace, 0.0f);
+    cancelGrace = std::max(cancelGrace, 0.0f);
+
+    // 读取 monitor 部分, 可选; 事件循环超过 stall_threshold 秒没有响应时记录调用栈
+    float loopProbeInterval = YLineServerConfig["monitor"]["loop_probe_interval"].value_or(0.1);
+    float loopStallThreshold = YLineServerConfig["monitor"]["loop_stall_threshold"].value_or(0.5);
+    float loopLogInterval = YLineServerConfig["monitor"]["loop_log_interval"].value_or(60.0);
+    if (loopProbeInterval <= 0)
+    {
+        spdlog::warn("Invalid monitor loop_probe_interval 无效的事件循环探测间隔: {}, using 0.1", loopProbeInterval);
+        loopProbeInterval = 0.1;
+    }
+
+    // 读取 usage_history 部分, 可选; 每个精度保留的时间桶数量
+    size_t usageHistoryRaw = YLineServerConfig["usage_history"]["raw_seconds"].value_or(300);
+    size_t usageHistoryMinutes = YLineServerConfig["usage_history"]["minutes"].value_or(720);
+    size_t usageHistoryHours = YLineServerConfig["usage_history"]["hours"].value_or(336);
+    size_t usageHistoryMaxPoints = YLineServerConfig["usage_history"]["max_points"].value_or(1000);
+
+    // 读取 journal 部分, 可选
+    bool journalEnable = YLineServerConfig["journal"]["enable"].value_or(true);
+    std::filesystem::path journalDir = YLineServerConfig["journal"]["dir"].value_or("journal");
+    if (journalDir.is_relative())
+    {
+        journalDir = exePath / journalDir;
+    }
+    size_t journalSegmentRecords = YLineServerConfig["journal"]["segment_records"].value_or(1048576);
+    size_t journalMaxSegments = YLineServerConfig["journal"]["max_segments"].value_or(64);
+
     spdlog::info(
         "\n----------End of parsing YLineServer config file 解析 YLineServer 配置文件结束----------\n"
         );
@@ -175,10 +310,54 @@ Config parseConfig() {
         amqpUser,
         amqpPassword,
         logLevel,
+        logAsync,
+        logQueueSize,
+        logOverflowPolicy,
         migration,
         dbmate_download_url,
         dbmate_download_name,
-        exePath
+        exePath,
+        clusterEnable,
+        clusterAdvertiseAddress,
+        clusterHeartbeatInterval,
+        clusterMemberTTL,
+        dbRegisterBatchDelay,
+        dbRegisterBatchSize,
+        workerHeartbeatTimeout,
+        workerReclaimGrace,
+        taskLogDir,
+        taskLogMaxPendingBytes,
+        artifactDir,
+        artifactMaxChunkBytes,
+        speculativeEnable,
+        speculativeInterval,
+        speculativePercentile,
+        speculativeMultiplier,
+        speculativeMinSamples,
+        speculativeMinRuntime,
+        cacheAffinity,
+        retryMaxAttempts,
+        retryBackoffBase,
+        retryBackoffMax,
+        retryBlacklistFailures,
+        retryBlacklistTTL,
+        retryBlacklistDefer,
+        preemptEnable,
+        static_cast<std::uint8_t>(preemptPriority),
+        preemptGrace,
+        preemptMax,
+        cancelGrace,
+        loopProbeInterval,
+        loopStallThreshold,
+        loopLogInterval,
+        usageHistoryRaw,
+        usageHistoryMinutes,
+        usageHistoryHours,
+        usageHistoryMaxPoints,
+        journalEnable,
+        journalDir,
+        journalSegmentRecords,
+        journalMaxSegments
         };
 }
 
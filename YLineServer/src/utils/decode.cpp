@@ -0,0 +1,51 @@
+#include "utils/decode.h"
+
+namespace YLineServer::Decode {
+
+namespace {
+
+// const Json::Value 的 operator[] 不会插入成员, 缺少时返回 null
+inline double
+number(const Json::Value& json, const char* key)
+{
+    const Json::Value& value = json[key];
+    return value.isNumeric() ? value.asDouble() : -1.0;
+}
+
+} // namespace
+
+UsageReport
+decodeUsage(const Json::Value& json)
+{
+    UsageReport report;
+    report.cpu.cpuUsage = number(json, "cpuUsage");
+    report.cpu.memoryUsage = number(json, "cpuMemoryUsage");
+    if (json["ts"].isInt64())
+    {
+        report.ts = json["ts"].asInt64();
+    }
+
+    const Json::Value& nvidia = json["gpuUsage"]["NVIDIA"];
+    if (!nvidia.isArray())
+    {
+        return report;
+    }
+    report.nvidia.reserve(nvidia.size());
+    for (const auto& gpu : nvidia)
+    {
+        GpuUsage& device = report.nvidia.emplace_back();
+        device.index = gpu["index"].isUInt() ? gpu["index"].asUInt() : 0;
+        device.usage.gpuUsage = number(gpu, "gpuUsage");
+        device.usage.gpuMemoryUsed = number(gpu, "gpuMemoryUsed");
+        device.usage.gpuTemperature = number(gpu, "gpuTemperature");
+        device.usage.gpuPowerUsage = number(gpu, "gpuPowerUsage");
+        const Json::Value& clock = gpu["gpuClockInfo"];
+        device.usage.gpuClockInfo.graphicsClock = number(clock, "graphicsClock");
+        device.usage.gpuClockInfo.smClock = number(clock, "smClock");
+        device.usage.gpuClockInfo.memClock = number(clock, "memClock");
+        device.usage.gpuClockInfo.videoClock = number(clock, "videoClock");
+    }
+    return report;
+}
+
+} // namespace YLineServer::Decode
@@ -0,0 +1,228 @@
+#include "utils/metrics.h"
+
+#include "UTloopMonitor.h"
+#include "utils/server.h"
+#include "utils/logger.h"
+#include "components/consumer.h"
+#include "components/worker.h"
+
+#include <array>
+#include <drogon/HttpAppFramework.h>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <unordered_map>
+#include <utility>
+
+namespace YLineServer::Metrics
+{
+
+namespace
+{
+
+using YSolowork::util::MetricsRegistry;
+
+// 路由前缀 -> 控制器, 按顺序匹配第一个
+constexpr std::array<std::pair<std::string_view, std::string_view>, 9> CONTROLLER_ROUTES = {{
+    {"/api/job/", "JobCtrl"},
+    {"/api/work/", "WorkCtrl"},
+    {"/api/users", "UserCtrl"},
+    {"/api/user", "UserCtrl"},
+    {"/api/auth/", "UserCtrl"},
+    {"/api/artifact", "ArtifactCtrl"},
+    {"/metrics", "MetricsCtrl"},
+    {"/alive", "HealthCheckCtrl"},
+    {"/api", "HealthCheckCtrl"},
+}};
+
+// EnTT 注册表不是线程安全的, 采集时持有 registryMutex 读取组件数量
+template <typename Component>
+double componentCount()
+{
+    auto& server = ServerSingleton::getInstance();
+    std::lock_guard<std::mutex> lock(server.registryMutex);
+    return static_cast<double>(server.Registry.view<Component>().size());
+}
+
+} // namespace
+
+std::string controllerOf(std::string_view pathPattern)
+{
+    for (const auto& [prefix, controller] : CONTROLLER_ROUTES)
+    {
+        if (pathPattern.starts_with(prefix))
+        {
+            return std::string(controller);
+        }
+    }
+    return "other";
+}
+
+void observeRequest(const drogon::HttpRequestPtr& req, const drogon::HttpResponsePtr& resp)
+{
+    // 每个 I/O 线程缓存自己用到的序列, 热路径上不访问注册表的锁
+    struct RouteMetrics
+    {
+        Histogram* latency;
+        Counter* errors;
+    };
+    thread_local std::unordered_map<std::string, RouteMetrics> cache;
+
+    const std::string_view pattern = req->getMatchedPathPattern();
+    std::string route = pattern.empty() ? std::string("unmatched") : std::string(pattern);
+    std::string key = std::string(req->getMethodString()) + ' ' + route;
+
+    auto it = cache.find(key);
+    if (it == cache.end())
+    {
+        const YSolowork::util::MetricLabels labels = {
+            {"controller", controllerOf(pattern)},
+            {"route", route},
+            {"method", std::string(req->getMethodString())},
+        };
+        auto& registry = MetricsRegistry::instance();
+        it = cache.emplace(
+            std::move(key),
+            RouteMetrics{
+                &registry.histogram("yline_http_request_duration_seconds", "HTTP request latency by controller and route", labels),
+                &registry.counter("yline_http_request_errors_total", "HTTP responses with status >= 400", labels),
+            }
+        ).first;
+    }
+
+    const auto elapsed = trantor::Date::now().microSecondsSinceEpoch() - req->creationDate().microSecondsSinceEpoch();
+    it->second.latency->observe(static_cast<double>(elapsed) / 1e6);
+    if (resp && static_cast<int>(resp->statusCode()) >= 400)
+    {
+        it->second.errors->inc();
+    }
+}
+
+Histogram& dbLatency(const std::string& op)
+{
+    return MetricsRegistry::instance().histogram(
+        "yline_db_query_duration_seconds", "PostgreSQL query latency by call site", {{"op", op}}
+    );
+}
+
+Histogram& redisLatency(const std::string& op)
+{
+    return MetricsRegistry::instance().histogram(
+        "yline_redis_command_duration_seconds", "Redis command latency by call site", {{"op", op}}
+    );
+}
+
+Histogram& workerRegisterLatency()
+{
+    return MetricsRegistry::instance().histogram(
+        "yline_worker_register_duration_seconds", "Worker registration time from request to registered reply"
+    );
+}
+
+Histogram& workerUsageLag()
+{
+    return MetricsRegistry::instance().histogram(
+        "yline_worker_usage_lag_seconds", "Worker usage ingest lag from sample time to Redis write"
+    );
+}
+
+Gauge& wsConnections(const std::string& controller)
+{
+    return MetricsRegistry::instance().gauge(
+        "yline_websocket_connections", "Open WebSocket connections by controller", {{"controller", controller}}
+    );
+}
+
+Counter& deliveries(const std::string& result)
+{
+    return MetricsRegistry::instance().counter(
+        "yline_amqp_deliveries_total", "Task deliveries settled by consumers", {{"result", result}}
+    );
+}
+
+void install()
+{
+    drogon::app().registerPostHandlingAdvice(&observeRequest);
+
+    auto& registry = MetricsRegistry::instance();
+
+    const std::string help = "EnTT registry entities by component";
+    registry.gaugeCallback("yline_registry_entities", help, {{"component", "worker"}}, &componentCount<Components::Worker>);
+    registry.gaugeCallback("yline_registry_entities", help, {{"component", "consumer"}}, &componentCount<Components::Consumer>);
+    registry.gaugeCallback("yline_registry_entities", help, {{"component", "user"}}, &componentCount<Components::User>);
+
+    registry.gaugeCallback("yline_workers", "Workers in the index by state", {{"state", "online"}}, []() -> double
+    {
+        std::size_t online = 0;
+        ServerSingleton::getInstance().workerIndex.forEach(
+            [&online](const boost::uuids::uuid&, const Components::WorkerIndexEntry& entry)
+            {
+                online += entry.online ? 1 : 0;
+            }
+        );
+        return static_cast<double>(online);
+    });
+    registry.gaugeCallback("yline_workers", "Workers in the index by state", {{"state", "offline"}}, []() -> double
+    {
+        std::size_t offline = 0;
+        ServerSingleton::getInstance().workerIndex.forEach(
+            [&offline](const boost::uuids::uuid&, const Components::WorkerIndexEntry& entry)
+            {
+                offline += entry.online ? 0 : 1;
+            }
+        );
+        return static_cast<double>(offline);
+    });
+
+    registry.gaugeCallback("yline_journal_records_dropped", "Scheduler journal records dropped because a segment could not be created", {}, []() -> double
+    {
+        const auto& journal = ServerSingleton::getInstance().eventJournal;
+        return journal ? static_cast<double>(journal->dropped()) : 0.0;
+    });
+
+    // 异步日志队列已满时被覆盖的日志, 同步日志时始终为 0
+    registry.gaugeCallback("yline_log_messages_dropped", "Log messages overwritten because the async log queue was full", {},
+        []() { return static_cast<double>(droppedLogMessages()); });
+}
+
+void installLoopMonitor(const Config& config)
+{
+    YSolowork::util::LoopMonitorOptions options;
+    options.interval = config.loop_probe_interval;
+    options.stall_threshold = config.loop_stall_threshold;
+    options.log_interval = config.loop_log_interval;
+    options.on_stall = [](const YSolowork::util::LoopStall& stall)
+    {
+        std::string stack;
+        for (const auto& frame : stall.stack)
+        {
+            stack += "\n    " + frame;
+        }
+        spdlog::warn("Event loop `{}` blocked for {:.3f}s 事件循环阻塞{}", stall.loop, stall.blocked, stack);
+    };
+    // 正常的事件循环只在 debug 级别汇总, 避免每个 I/O 循环定期刷屏
+    options.on_summary = [threshold = config.loop_stall_threshold](const std::vector<YSolowork::util::LoopSummary>& summaries)
+    {
+        for (const auto& summary : summaries)
+        {
+            const bool slow = summary.stalls > 0 || summary.max_lag > threshold || summary.max_queue_delay > threshold;
+            spdlog::log(
+                slow ? spdlog::level::info : spdlog::level::debug,
+                "Event loop `{}` max lag {:.3f}s, max queue delay {:.3f}s, {} stalls 事件循环状态",
+                summary.loop, summary.max_lag, summary.max_queue_delay, summary.stalls
+            );
+        }
+    };
+    YSolowork::util::LoopMonitor::instance().setOptions(std::move(options));
+}
+
+void watchDrogonLoops()
+{
+    auto& monitor = YSolowork::util::LoopMonitor::instance();
+    monitor.watch(drogon::app().getLoop(), "main");
+    for (size_t i = 0; i < drogon::app().getThreadNum(); ++i)
+    {
+        monitor.watch(drogon::app().getIOLoop(i), "io" + std::to_string(i));
+    }
+}
+
+} // namespace YLineServer::Metrics
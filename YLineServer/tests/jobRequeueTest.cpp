@@ -0,0 +1,170 @@
+// 集成测试: 取消作业后重新提交 (queue) 必须成功并恢复已取消的任务
+// integration test: queue -> cancel -> queue against a running YLineServer
+//
+// 服务器和测试账号通过环境变量指定, 没有指定或者服务器无法连接时跳过 (退出码 77):
+//   YLINE_TEST_HOST      default 127.0.0.1
+//   YLINE_TEST_PORT      default 33383
+//   YLINE_TEST_USER      login user
+//   YLINE_TEST_PASSWORD  login password
+// 不跟随集群模式的 307 重定向, 请指向单实例服务器
+// 作业会真实写入数据库和队列, 请使用独立的 Postgres/Redis/RabbitMQ (例如 docker-compose.yml)
+
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <drogon/HttpClient.h>
+#include <json/json.h>
+#include <trantor/net/EventLoopThread.h>
+
+namespace
+{
+
+constexpr int EXIT_SKIP = 77;
+constexpr double REQUEST_TIMEOUT = 30.0;
+constexpr Json::Int64 TASKS = 2;
+
+struct Response
+{
+    drogon::HttpStatusCode status = drogon::kUnknown;
+    std::shared_ptr<Json::Value> json;
+    std::string error;
+};
+
+std::string
+env(const char* name, const std::string& fallback = {})
+{
+    const char* value = std::getenv(name);
+    return value ? value : fallback;
+}
+
+std::string
+compact(const Json::Value& value)
+{
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "";
+    return Json::writeString(writer, value);
+}
+
+Response
+post(const drogon::HttpClientPtr& client, const std::string& path, const Json::Value& body, const std::string& token = {})
+{
+    auto req = drogon::HttpRequest::newHttpRequest();
+    req->setMethod(drogon::Post);
+    req->setPath(path);
+    req->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+    req->setBody(compact(body));
+    if (!token.empty())
+    {
+        req->addHeader("Authorization", "Bearer " + token);
+    }
+
+    auto [result, resp] = client->sendRequest(req, REQUEST_TIMEOUT);
+    if (result != drogon::ReqResult::Ok || !resp)
+    {
+        return Response{drogon::kUnknown, nullptr, drogon::to_string(result)};
+    }
+    Response response{resp->getStatusCode(), resp->getJsonObject(), {}};
+    if (response.status != drogon::k200OK)
+    {
+        response.error = response.json && (*response.json)["error"].isString()
+            ? (*response.json)["error"].asString()
+            : std::format("HTTP {}", static_cast<int>(response.status));
+    }
+    return response;
+}
+
+// 检查响应, 失败时输出原因
+bool
+expectOk(const std::string& step, const Response& response)
+{
+    if (response.status == drogon::k200OK && response.json)
+    {
+        std::cout << "[ OK ] " << step << '\n';
+        return true;
+    }
+    std::cerr << "[FAIL] " << step << ": " << response.error << '\n';
+    return false;
+}
+
+bool
+expectQueued(const std::string& step, const Response& response)
+{
+    if (!expectOk(step, response))
+    {
+        return false;
+    }
+    const auto queued = (*response.json)["queued_tasks"].asInt64();
+    if (queued != TASKS)
+    {
+        std::cerr << "[FAIL] " << step << ": queued " << queued << " tasks, expected " << TASKS << '\n';
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main()
+{
+    const std::string user = env("YLINE_TEST_USER");
+    const std::string password = env("YLINE_TEST_PASSWORD");
+    if (user.empty() || password.empty())
+    {
+        std::cout << "YLINE_TEST_USER / YLINE_TEST_PASSWORD not set, skipped 未指定测试账号, 跳过\n";
+        return EXIT_SKIP;
+    }
+    const std::string origin = std::format("http://{}:{}", env("YLINE_TEST_HOST", "127.0.0.1"), env("YLINE_TEST_PORT", "33383"));
+
+    trantor::EventLoopThread loopThread("jobRequeueTest");
+    loopThread.run();
+    const auto client = drogon::HttpClient::newHttpClient(origin, loopThread.getLoop());
+
+    Json::Value credentials;
+    credentials["username"] = user;
+    credentials["password"] = password;
+    const auto login = post(client, "/api/auth/login", credentials);
+    if (login.status == drogon::kUnknown)
+    {
+        std::cout << "Server " << origin << " unreachable, skipped 服务器无法连接, 跳过: " << login.error << '\n';
+        return EXIT_SKIP;
+    }
+    if (!expectOk("login", login) || !(*login.json)["access_token"].isString())
+    {
+        return EXIT_FAILURE;
+    }
+    const std::string token = (*login.json)["access_token"].asString();
+
+    Json::Value job;
+    job["jobName"] = "jobRequeueTest";
+    job["priority"] = 0;
+    job["tasks"] = Json::Value(Json::arrayValue);
+    for (Json::Int64 i = 0; i < TASKS; ++i)
+    {
+        Json::Value task;
+        task["task_id"] = std::format("t{}", i);
+        task["name"] = std::format("jobRequeueTest-{}", i);
+        task["payload"]["cmd"].append("true");
+        job["tasks"].append(std::move(task));
+    }
+    const auto submitted = post(client, "/api/work/submitNonDependentJob", job, token);
+    if (!expectOk("submit", submitted) || !(*submitted.json)["job_id"].isInt64())
+    {
+        return EXIT_FAILURE;
+    }
+
+    Json::Value jobRef;
+    jobRef["job_id"] = (*submitted.json)["job_id"].asInt64();
+    std::cout << "Job " << jobRef["job_id"].asInt64() << '\n';
+
+    const bool passed = expectQueued("queue", post(client, "/api/job/queue", jobRef, token))
+        && expectOk("cancel", post(client, "/api/job/cancel", jobRef, token))
+        // 取消释放了作业锁, 重新提交恢复所有已取消的任务
+        && expectQueued("queue after cancel", post(client, "/api/job/queue", jobRef, token))
+        && expectOk("cancel again", post(client, "/api/job/cancel", jobRef, token));
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
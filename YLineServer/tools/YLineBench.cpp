@@ -0,0 +1,693 @@
+// yline_bench: 端到端作业提交压测, 提交合成 DAG 作业并请求执行, 统计吞吐量和延迟分位数
+// end-to-end job submission load generator: submit -> DB commit -> queued
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <drogon/HttpClient.h>
+#include <json/json.h>
+#include <trantor/net/EventLoopThreadPool.h>
+
+namespace
+{
+
+constexpr std::string_view USAGE = R"(Usage: yline_bench [options]
+
+Submit synthetic DAG jobs to a running YLineServer and request their execution,
+then report throughput and p50/p99/p999 latency of each stage:
+  submit  POST /api/work/submit*Job returns after the job and its tasks are committed
+  queue   POST /api/job/queue returns after the ready tasks are published to RabbitMQ
+  total   submit + queue
+向运行中的 YLineServer 提交合成 DAG 作业并请求执行, 统计吞吐量和各阶段的延迟分位数
+作业会真实写入数据库和队列, 请使用独立的 Postgres/Redis/RabbitMQ (例如 docker-compose.yml) 压测
+
+Server 服务器:
+  --host <address>        default 127.0.0.1
+  --port <port>           default 33383
+  --user <name>           login user (required)
+  --password <password>   login password (required)
+
+Load 负载:
+  --jobs <n>              measured jobs, default 1000
+  --warmup <n>            jobs submitted before measuring, default 50
+  --concurrency <n>       concurrent submitters, default 16
+  --io-threads <n>        HTTP client I/O threads, default 2
+  --rate <jobs/s>         open loop at a fixed arrival rate, latency counted from the scheduled
+                          start; 0 runs closed loop as fast as possible, default 0
+  --no-queue              only submit, skip /api/job/queue
+
+DAG 作业形状:
+  --shape <name>          flat     independent tasks (submitNonDependentJob)
+                          chain    each task depends on the previous one
+                          fanout   one root, every other task depends on it
+                          fanin    every other task is a dependency of the last one
+                          diamond  root -> layers of --width tasks -> sink
+                          layered  layers of --width tasks, each depends on --degree tasks of the previous layer
+                          random   each task depends on up to --degree random earlier tasks
+                          default layered
+  --tasks <n>             tasks per job, default 10
+  --width <n>             layer width for diamond/layered, default 4
+  --degree <n>            dependencies per task for layered/random, default 2
+  --payload-bytes <n>     padding added to each task payload, default 0
+  --priority <0-100>      job priority, default 0
+  --seed <n>              random seed, default 1
+
+Output 输出:
+  --json <file>           also write the results as JSON
+  --help
+)";
+
+using Clock = std::chrono::steady_clock;
+
+enum class Shape
+{
+    Flat,
+    Chain,
+    FanOut,
+    FanIn,
+    Diamond,
+    Layered,
+    Random
+};
+
+struct Options
+{
+    std::string host = "127.0.0.1";
+    std::uint16_t port = 33383;
+    std::string user;
+    std::string password;
+
+    std::size_t jobs = 1000;
+    std::size_t warmup = 50;
+    std::size_t concurrency = 16;
+    std::size_t ioThreads = 2;
+    double rate = 0;
+    bool queue = true;
+
+    Shape shape = Shape::Layered;
+    std::size_t tasks = 10;
+    std::size_t width = 4;
+    std::size_t degree = 2;
+    std::size_t payloadBytes = 0;
+    int priority = 0;
+    std::uint64_t seed = 1;
+
+    std::string json;
+};
+
+template <typename T>
+T
+parseNumber(std::string_view text, std::string_view option)
+{
+    T value{};
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || end != text.data() + text.size())
+    {
+        throw std::invalid_argument(std::format("Invalid value for {}: {}", option, text));
+    }
+    return value;
+}
+
+Shape
+parseShape(std::string_view name)
+{
+    if (name == "flat") return Shape::Flat;
+    if (name == "chain") return Shape::Chain;
+    if (name == "fanout") return Shape::FanOut;
+    if (name == "fanin") return Shape::FanIn;
+    if (name == "diamond") return Shape::Diamond;
+    if (name == "layered") return Shape::Layered;
+    if (name == "random") return Shape::Random;
+    throw std::invalid_argument(std::format("Unknown shape: {}", name));
+}
+
+std::string
+taskID(std::size_t index)
+{
+    return std::format("t{}", index);
+}
+
+// 每个任务的依赖 (任务下标), 只依赖下标更小的任务, 保证无环
+std::vector<std::vector<std::size_t>>
+buildDependencies(const Options& options, std::mt19937_64& rng)
+{
+    const std::size_t n = options.tasks;
+    const std::size_t width = std::max<std::size_t>(options.width, 1);
+    std::vector<std::vector<std::size_t>> deps(n);
+
+    switch (options.shape)
+    {
+    case Shape::Flat:
+        break;
+    case Shape::Chain:
+        for (std::size_t i = 1; i < n; ++i)
+        {
+            deps[i].push_back(i - 1);
+        }
+        break;
+    case Shape::FanOut:
+        for (std::size_t i = 1; i < n; ++i)
+        {
+            deps[i].push_back(0);
+        }
+        break;
+    case Shape::FanIn:
+        for (std::size_t i = 0; i + 1 < n; ++i)
+        {
+            deps[n - 1].push_back(i);
+        }
+        break;
+    case Shape::Diamond:
+        // 0 为根, n - 1 为汇点, 中间按 width 分层, 相邻两层全连接
+        if (n < 3)
+        {
+            for (std::size_t i = 1; i < n; ++i)
+            {
+                deps[i].push_back(i - 1);
+            }
+            break;
+        }
+        for (std::size_t i = 1; i + 1 < n; ++i)
+        {
+            const std::size_t layer = (i - 1) / width;
+            if (layer == 0)
+            {
+                deps[i].push_back(0);
+                continue;
+            }
+            const std::size_t begin = 1 + (layer - 1) * width;
+            for (std::size_t j = begin; j < begin + width; ++j)
+            {
+                deps[i].push_back(j);
+            }
+        }
+        {
+            const std::size_t last = (n - 3) / width;
+            for (std::size_t j = 1 + last * width; j + 1 < n; ++j)
+            {
+                deps[n - 1].push_back(j);
+            }
+        }
+        break;
+    case Shape::Layered:
+        for (std::size_t i = width; i < n; ++i)
+        {
+            const std::size_t begin = (i / width - 1) * width;
+            std::vector<std::size_t> previous(width);
+            for (std::size_t j = 0; j < width; ++j)
+            {
+                previous[j] = begin + j;
+            }
+            std::shuffle(previous.begin(), previous.end(), rng);
+            previous.resize(std::min(options.degree, width));
+            deps[i] = std::move(previous);
+        }
+        break;
+    case Shape::Random:
+        for (std::size_t i = 1; i < n; ++i)
+        {
+            std::uniform_int_distribution<std::size_t> pick(0, i - 1);
+            const std::size_t count = std::min(options.degree, i);
+            while (deps[i].size() < count)
+            {
+                const std::size_t dep = pick(rng);
+                if (std::find(deps[i].begin(), deps[i].end(), dep) == deps[i].end())
+                {
+                    deps[i].push_back(dep);
+                }
+            }
+        }
+        break;
+    }
+    return deps;
+}
+
+// 作业请求体
+std::string
+buildJob(const Options& options, const std::string& name, std::mt19937_64& rng)
+{
+    const auto deps = buildDependencies(options, rng);
+    const bool dependent = options.shape != Shape::Flat;
+
+    Json::Value job;
+    job["jobName"] = name;
+    job["priority"] = options.priority;
+    Json::Value& tasks = job["tasks"] = Json::Value(Json::arrayValue);
+    for (std::size_t i = 0; i < options.tasks; ++i)
+    {
+        Json::Value task;
+        task["task_id"] = taskID(i);
+        task["name"] = std::format("{}-{}", name, i);
+        task["payload"]["cmd"].append("true");
+        if (options.payloadBytes > 0)
+        {
+            task["payload"]["env"]["YLINE_BENCH_PADDING"] = std::string(options.payloadBytes, 'x');
+        }
+        if (dependent)
+        {
+            Json::Value& dependency = task["dependency"] = Json::Value(Json::arrayValue);
+            for (const auto dep : deps[i])
+            {
+                dependency.append(taskID(dep));
+            }
+        }
+        tasks.append(std::move(task));
+    }
+
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "";
+    return Json::writeString(writer, job);
+}
+
+struct Response
+{
+    drogon::HttpStatusCode status = drogon::kUnknown;
+    std::shared_ptr<Json::Value> json;
+    std::string error;
+};
+
+// 每个提交者一个, 按 origin 复用连接, 并跟随集群模式的 307 重定向
+class Session
+{
+public:
+    Session(std::string origin, trantor::EventLoop* loop, std::string token)
+        : m_origin(std::move(origin)), m_loop(loop), m_token(std::move(token))
+    {
+    }
+
+    Response
+    post(const std::string& path, const std::string& body)
+    {
+        std::string origin = m_origin;
+        for (int redirects = 0; redirects < 3; ++redirects)
+        {
+            auto req = drogon::HttpRequest::newHttpRequest();
+            req->setMethod(drogon::Post);
+            req->setPath(path);
+            req->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+            req->setBody(body);
+            if (!m_token.empty())
+            {
+                req->addHeader("Authorization", "Bearer " + m_token);
+            }
+
+            auto [result, resp] = client(origin)->sendRequest(req, REQUEST_TIMEOUT);
+            if (result != drogon::ReqResult::Ok || !resp)
+            {
+                return Response{drogon::kUnknown, nullptr, drogon::to_string(result)};
+            }
+            if (resp->getStatusCode() == drogon::k307TemporaryRedirect)
+            {
+                const auto& location = resp->getHeader("location");
+                const auto pathStart = location.find('/', location.find("://") + 3);
+                origin = location.substr(0, pathStart);
+                continue;
+            }
+
+            Response response{resp->getStatusCode(), resp->getJsonObject(), {}};
+            if (response.status != drogon::k200OK)
+            {
+                response.error = response.json && (*response.json)["error"].isString()
+                    ? (*response.json)["error"].asString()
+                    : std::format("HTTP {}", static_cast<int>(response.status));
+            }
+            return response;
+        }
+        return Response{drogon::kUnknown, nullptr, "Too many redirects"};
+    }
+
+private:
+    static constexpr double REQUEST_TIMEOUT = 30.0;
+
+    std::string m_origin;
+    trantor::EventLoop* m_loop;
+    std::string m_token;
+    std::unordered_map<std::string, drogon::HttpClientPtr> m_clients;
+
+    const drogon::HttpClientPtr&
+    client(const std::string& origin)
+    {
+        auto& client = m_clients[origin];
+        if (!client)
+        {
+            client = drogon::HttpClient::newHttpClient(origin, m_loop);
+        }
+        return client;
+    }
+};
+
+// 每个阶段的延迟 (微秒)
+struct Latencies
+{
+    std::vector<std::int64_t> submit;
+    std::vector<std::int64_t> queue;
+    std::vector<std::int64_t> total;
+    std::size_t submitErrors = 0;
+    std::size_t queueErrors = 0;
+    std::string lastError;
+
+    void
+    merge(Latencies&& other)
+    {
+        submit.insert(submit.end(), other.submit.begin(), other.submit.end());
+        queue.insert(queue.end(), other.queue.begin(), other.queue.end());
+        total.insert(total.end(), other.total.begin(), other.total.end());
+        submitErrors += other.submitErrors;
+        queueErrors += other.queueErrors;
+        if (!other.lastError.empty())
+        {
+            lastError = std::move(other.lastError);
+        }
+    }
+};
+
+std::int64_t
+microseconds(Clock::duration duration)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+// 提交并执行一个作业, 成功的阶段记录延迟; scheduled 为计划开始时间
+void
+runJob(Session& session, const Options& options, const std::string& body, Clock::time_point scheduled, Latencies& out)
+{
+    const std::string submitPath = options.shape == Shape::Flat
+        ? "/api/work/submitNonDependentJob"
+        : "/api/work/submitDependentJob";
+
+    auto submitted = session.post(submitPath, body);
+    const auto committed = Clock::now();
+    if (submitted.status != drogon::k200OK || !submitted.json || !(*submitted.json)["job_id"].isInt64())
+    {
+        ++out.submitErrors;
+        out.lastError = submitted.error.empty() ? "Response without `job_id`" : submitted.error;
+        return;
+    }
+    out.submit.push_back(microseconds(committed - scheduled));
+    if (!options.queue)
+    {
+        out.total.push_back(microseconds(committed - scheduled));
+        return;
+    }
+
+    Json::Value queueBody;
+    queueBody["job_id"] = (*submitted.json)["job_id"].asInt64();
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "";
+    auto queued = session.post("/api/job/queue", Json::writeString(writer, queueBody));
+    const auto finished = Clock::now();
+    if (queued.status != drogon::k200OK)
+    {
+        ++out.queueErrors;
+        out.lastError = queued.error;
+        return;
+    }
+    out.queue.push_back(microseconds(finished - committed));
+    out.total.push_back(microseconds(finished - scheduled));
+}
+
+struct Percentiles
+{
+    std::size_t count = 0;
+    double p50 = 0;
+    double p99 = 0;
+    double p999 = 0;
+    double max = 0;
+    double mean = 0;
+};
+
+// 最近秩分位数, 单位毫秒
+Percentiles
+percentiles(std::vector<std::int64_t>& samples)
+{
+    Percentiles result;
+    result.count = samples.size();
+    if (samples.empty())
+    {
+        return result;
+    }
+    std::sort(samples.begin(), samples.end());
+    const auto at = [&](double q) {
+        const auto rank = static_cast<std::size_t>(std::ceil(q * static_cast<double>(samples.size())));
+        return samples[std::clamp<std::size_t>(rank, 1, samples.size()) - 1] / 1000.0;
+    };
+    result.p50 = at(0.50);
+    result.p99 = at(0.99);
+    result.p999 = at(0.999);
+    result.max = samples.back() / 1000.0;
+    double sum = 0;
+    for (const auto sample : samples)
+    {
+        sum += static_cast<double>(sample);
+    }
+    result.mean = sum / static_cast<double>(samples.size()) / 1000.0;
+    return result;
+}
+
+std::optional<std::string>
+login(const Options& options, const std::string& origin, trantor::EventLoop* loop, std::string& err)
+{
+    Json::Value body;
+    body["username"] = options.user;
+    body["password"] = options.password;
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "";
+
+    Session session(origin, loop, {});
+    auto resp = session.post("/api/auth/login", Json::writeString(writer, body));
+    if (resp.status != drogon::k200OK || !resp.json || !(*resp.json)["access_token"].isString())
+    {
+        err = resp.error.empty() ? "Response without `access_token`" : resp.error;
+        return std::nullopt;
+    }
+    return (*resp.json)["access_token"].asString();
+}
+
+// 所有提交者共同执行 count 个作业, 返回合并后的延迟
+Latencies
+runPhase(
+    const Options& options,
+    const std::string& origin,
+    const std::string& token,
+    trantor::EventLoopThreadPool& pool,
+    const std::string& prefix,
+    std::size_t count,
+    Clock::duration& elapsed
+)
+{
+    std::atomic<std::size_t> next = 0;
+    std::vector<Latencies> results(options.concurrency);
+    std::vector<std::thread> submitters;
+    const auto start = Clock::now();
+
+    for (std::size_t s = 0; s < options.concurrency; ++s)
+    {
+        submitters.emplace_back([&, s]() {
+            Session session(origin, pool.getNextLoop(), token);
+            std::mt19937_64 rng(options.seed + s);
+            while (true)
+            {
+                const std::size_t index = next.fetch_add(1, std::memory_order_relaxed);
+                if (index >= count)
+                {
+                    break;
+                }
+                // 请求体在计时之外生成
+                const auto body = buildJob(options, std::format("{}-{}", prefix, index), rng);
+
+                auto scheduled = Clock::now();
+                if (options.rate > 0)
+                {
+                    // 开环: 按计划时间发起, 延迟从计划时间开始计算, 服务变慢时排队的时间也计入
+                    scheduled = start + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(static_cast<double>(index) / options.rate)
+                    );
+                    std::this_thread::sleep_until(scheduled);
+                }
+                runJob(session, options, body, scheduled, results[s]);
+            }
+        });
+    }
+    for (auto& submitter : submitters)
+    {
+        submitter.join();
+    }
+    elapsed = Clock::now() - start;
+
+    Latencies merged;
+    for (auto& result : results)
+    {
+        merged.merge(std::move(result));
+    }
+    return merged;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string_view arg = argv[i];
+            const auto value = [&]() -> std::string_view {
+                if (i + 1 >= argc)
+                {
+                    throw std::invalid_argument(std::format("Missing value for {}", arg));
+                }
+                return argv[++i];
+            };
+
+            if (arg == "--help" || arg == "-h")
+            {
+                std::cout << USAGE;
+                return EXIT_SUCCESS;
+            }
+            else if (arg == "--host") options.host = value();
+            else if (arg == "--port") options.port = parseNumber<std::uint16_t>(value(), arg);
+            else if (arg == "--user") options.user = value();
+            else if (arg == "--password") options.password = value();
+            else if (arg == "--jobs") options.jobs = parseNumber<std::size_t>(value(), arg);
+            else if (arg == "--warmup") options.warmup = parseNumber<std::size_t>(value(), arg);
+            else if (arg == "--concurrency") options.concurrency = std::max<std::size_t>(parseNumber<std::size_t>(value(), arg), 1);
+            else if (arg == "--io-threads") options.ioThreads = std::max<std::size_t>(parseNumber<std::size_t>(value(), arg), 1);
+            else if (arg == "--rate") options.rate = parseNumber<double>(value(), arg);
+            else if (arg == "--no-queue") options.queue = false;
+            else if (arg == "--shape") options.shape = parseShape(value());
+            else if (arg == "--tasks") options.tasks = std::max<std::size_t>(parseNumber<std::size_t>(value(), arg), 1);
+            else if (arg == "--width") options.width = std::max<std::size_t>(parseNumber<std::size_t>(value(), arg), 1);
+            else if (arg == "--degree") options.degree = std::max<std::size_t>(parseNumber<std::size_t>(value(), arg), 1);
+            else if (arg == "--payload-bytes") options.payloadBytes = parseNumber<std::size_t>(value(), arg);
+            else if (arg == "--priority") options.priority = std::clamp(parseNumber<int>(value(), arg), 0, 100);
+            else if (arg == "--seed") options.seed = parseNumber<std::uint64_t>(value(), arg);
+            else if (arg == "--json") options.json = value();
+            else throw std::invalid_argument(std::format("Unknown option: {}", arg));
+        }
+        if (options.user.empty())
+        {
+            throw std::invalid_argument("Missing --user");
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << "\n\n" << USAGE;
+        return EXIT_FAILURE;
+    }
+
+    trantor::EventLoopThreadPool pool(options.ioThreads, "yline_bench");
+    pool.start();
+
+    const std::string origin = std::format("http://{}:{}", options.host, options.port);
+    std::string err;
+    const auto token = login(options, origin, pool.getNextLoop(), err);
+    if (!token)
+    {
+        std::cerr << std::format("Login failed 登录失败: {}\n", err);
+        return EXIT_FAILURE;
+    }
+
+    // 作业名前缀区分每次运行
+    const auto run = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+    Clock::duration elapsed{};
+
+    if (options.warmup > 0)
+    {
+        std::cout << std::format("Warming up with {} jobs 预热...\n", options.warmup);
+        auto warm = runPhase(options, origin, *token, pool, std::format("bench-{}-warmup", run), options.warmup, elapsed);
+        if (warm.submit.empty())
+        {
+            std::cerr << std::format("All warmup jobs failed 预热作业全部失败: {}\n", warm.lastError);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << std::format("Running {} jobs x {} tasks, concurrency {} 运行...\n", options.jobs, options.tasks, options.concurrency);
+    auto result = runPhase(options, origin, *token, pool, std::format("bench-{}", run), options.jobs, elapsed);
+
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    const std::size_t completed = result.total.size();
+    const double jobsPerSecond = seconds > 0 ? static_cast<double>(completed) / seconds : 0;
+    const double tasksPerSecond = jobsPerSecond * static_cast<double>(options.tasks);
+    const auto submit = percentiles(result.submit);
+    const auto queue = percentiles(result.queue);
+    const auto total = percentiles(result.total);
+
+    std::cout << std::format(
+        "\n{} jobs completed in {:.2f} s, {} submit errors, {} queue errors\n"
+        "throughput 吞吐量: {:.1f} jobs/s, {:.1f} tasks/s\n\n",
+        completed, seconds, result.submitErrors, result.queueErrors, jobsPerSecond, tasksPerSecond
+    );
+    std::cout << std::format("{:<8}{:>10}{:>10}{:>10}{:>10}{:>10}{:>10}  (ms)\n", "stage", "count", "mean", "p50", "p99", "p999", "max");
+    const auto row = [](std::string_view name, const Percentiles& p) {
+        std::cout << std::format("{:<8}{:>10}{:>10.2f}{:>10.2f}{:>10.2f}{:>10.2f}{:>10.2f}\n", name, p.count, p.mean, p.p50, p.p99, p.p999, p.max);
+    };
+    row("submit", submit);
+    if (options.queue)
+    {
+        row("queue", queue);
+    }
+    row("total", total);
+    if (!result.lastError.empty())
+    {
+        std::cout << std::format("\nlast error 最后的错误: {}\n", result.lastError);
+    }
+
+    if (!options.json.empty())
+    {
+        const auto stage = [](const Percentiles& p) {
+            Json::Value value;
+            value["count"] = static_cast<Json::UInt64>(p.count);
+            value["mean_ms"] = p.mean;
+            value["p50_ms"] = p.p50;
+            value["p99_ms"] = p.p99;
+            value["p999_ms"] = p.p999;
+            value["max_ms"] = p.max;
+            return value;
+        };
+        Json::Value report;
+        report["jobs"] = static_cast<Json::UInt64>(options.jobs);
+        report["tasks_per_job"] = static_cast<Json::UInt64>(options.tasks);
+        report["concurrency"] = static_cast<Json::UInt64>(options.concurrency);
+        report["rate"] = options.rate;
+        report["elapsed_s"] = seconds;
+        report["jobs_per_s"] = jobsPerSecond;
+        report["tasks_per_s"] = tasksPerSecond;
+        report["submit_errors"] = static_cast<Json::UInt64>(result.submitErrors);
+        report["queue_errors"] = static_cast<Json::UInt64>(result.queueErrors);
+        report["submit"] = stage(submit);
+        if (options.queue)
+        {
+            report["queue"] = stage(queue);
+        }
+        report["total"] = stage(total);
+
+        std::ofstream file(options.json);
+        file << report.toStyledString();
+        if (!file)
+        {
+            std::cerr << std::format("Cannot write 无法写入 {}\n", options.json);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return result.submitErrors + result.queueErrors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
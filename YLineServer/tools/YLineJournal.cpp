@@ -0,0 +1,465 @@
+// YLineJournal: 离线解码和过滤 YLineServer 的调度事件日志
+// offline decoder for the YLineServer scheduler event journal
+
+#include "storage/eventJournal.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <ctime>
+#include <format>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/uuid/string_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+using namespace YLineServer::Storage;
+
+namespace
+{
+
+constexpr std::string_view USAGE = R"(Usage: YLineJournal [options] <segment file or directory>...
+
+Decode scheduler event journal segments (*.ylj), merged in time order.
+解码调度事件日志段 (*.ylj), 按时间合并输出
+
+Filters 过滤:
+  --event <names>     comma separated: queued, dispatched, acked, completed, requeued, dropped, online, offline
+  --worker <uuid>     worker UUID
+  --job <id>          job id
+  --task <id>         full task id (ids are printed truncated to 14 characters)
+  --delivery <tag>    delivery tag
+  --since <seconds>   Unix time, inclusive
+  --until <seconds>   Unix time, exclusive
+
+Output 输出:
+  --format <text|csv|jsonl>   default text
+  --summary                   count events by type and reason instead of printing records
+  --help
+)";
+
+enum class Format
+{
+    Text,
+    Csv,
+    Jsonl
+};
+
+struct Filter
+{
+    std::vector<JournalEvent> events;
+    std::optional<boost::uuids::uuid> worker;
+    std::optional<std::int64_t> job;
+    std::optional<std::string> task;
+    std::optional<std::uint64_t> delivery;
+    std::optional<std::int64_t> since;  // 纳秒
+    std::optional<std::int64_t> until;  // 纳秒
+
+    bool
+    matches(const JournalRecord& record) const
+    {
+        if (!events.empty() && std::find(events.begin(), events.end(), static_cast<JournalEvent>(record.type)) == events.end())
+        {
+            return false;
+        }
+        if (worker && !std::equal(worker->begin(), worker->end(), record.worker.begin()))
+        {
+            return false;
+        }
+        if (job && record.job_id != *job)
+        {
+            return false;
+        }
+        if (task && record.task_hash != journalTaskHash(*task))
+        {
+            return false;
+        }
+        if (delivery && record.delivery_tag != *delivery)
+        {
+            return false;
+        }
+        if (since && record.time < *since)
+        {
+            return false;
+        }
+        if (until && record.time >= *until)
+        {
+            return false;
+        }
+        return true;
+    }
+};
+
+template <typename T>
+T
+parseNumber(std::string_view text, std::string_view option)
+{
+    T value{};
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || end != text.data() + text.size())
+    {
+        throw std::invalid_argument(std::format("Invalid value for {}: {}", option, text));
+    }
+    return value;
+}
+
+// ISO 8601 UTC, 微秒精度
+std::string
+formatTime(std::int64_t nanoseconds)
+{
+    std::int64_t seconds = nanoseconds / 1'000'000'000;
+    std::int64_t remainder = nanoseconds % 1'000'000'000;
+    if (remainder < 0)
+    {
+        --seconds;
+        remainder += 1'000'000'000;
+    }
+    const std::time_t time = static_cast<std::time_t>(seconds);
+    std::tm tm{};
+#if defined(_WIN32)
+    gmtime_s(&tm, &time);
+#else
+    gmtime_r(&time, &tm);
+#endif
+    return std::format(
+        "{:04}-{:02}-{:02}T{:02}:{:02}:{:02}.{:06}Z",
+        tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, remainder / 1000
+    );
+}
+
+std::string
+workerString(const JournalRecord& record)
+{
+    boost::uuids::uuid uuid{};
+    std::copy(record.worker.begin(), record.worker.end(), uuid.begin());
+    return uuid.is_nil() ? std::string{} : boost::uuids::to_string(uuid);
+}
+
+// detail 的含义取决于事件
+std::string
+detailString(const JournalRecord& record)
+{
+    switch (static_cast<JournalEvent>(record.type))
+    {
+        case JournalEvent::TaskRequeued:
+        case JournalEvent::TaskDropped:
+        case JournalEvent::WorkerOffline:
+            return std::string(journalReasonName(static_cast<JournalReason>(record.detail)));
+        case JournalEvent::TaskCompleted:
+        {
+            constexpr std::array<std::string_view, 4> STATUS = {"failed", "success", "preempted", "cancelled"};
+            return std::string(record.detail < STATUS.size() ? STATUS[record.detail] : std::string_view{"unknown"});
+        }
+        case JournalEvent::TaskDispatched:
+            return record.detail != 0 ? std::format("attempt={}", record.detail) : std::string{};
+        case JournalEvent::TaskQueued:
+            return std::format("priority={}", record.detail);
+        default:
+            return record.detail != 0 ? std::to_string(record.detail) : std::string{};
+    }
+}
+
+std::string
+jsonEscape(std::string_view text)
+{
+    std::string result;
+    result.reserve(text.size());
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            result.push_back('\\');
+            result.push_back(c);
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            result += std::format("\\u{:04x}", static_cast<unsigned int>(c));
+        }
+        else
+        {
+            result.push_back(c);
+        }
+    }
+    return result;
+}
+
+std::string
+csvEscape(std::string_view text)
+{
+    if (text.find_first_of(",\"\n") == std::string_view::npos)
+    {
+        return std::string(text);
+    }
+    std::string result = "\"";
+    for (const char c : text)
+    {
+        if (c == '"')
+        {
+            result.push_back('"');
+        }
+        result.push_back(c);
+    }
+    result.push_back('"');
+    return result;
+}
+
+void
+printRecord(const JournalRecord& record, Format format, std::ostream& out)
+{
+    const auto event = journalEventName(static_cast<JournalEvent>(record.type));
+    const std::string worker = workerString(record);
+    const std::string detail = detailString(record);
+    switch (format)
+    {
+        case Format::Text:
+            out << formatTime(record.time) << ' ' << event;
+            if (!worker.empty())
+            {
+                out << " worker=" << worker;
+            }
+            if (record.delivery_tag != 0)
+            {
+                out << " delivery=" << record.delivery_tag;
+            }
+            if (record.job_id != 0 || !record.taskID().empty())
+            {
+                out << " job=" << record.job_id << " task=" << record.taskID();
+            }
+            if (!detail.empty())
+            {
+                out << ' ' << detail;
+            }
+            out << '\n';
+            break;
+        case Format::Csv:
+            out << formatTime(record.time) << ',' << event << ',' << worker << ',' << record.delivery_tag << ','
+                << record.job_id << ',' << csvEscape(record.taskID()) << ',' << detail << '\n';
+            break;
+        case Format::Jsonl:
+            out << std::format(
+                R"({{"time":"{}","ns":{},"event":"{}","worker":"{}","delivery":{},"job":{},"task":"{}","detail":"{}"}})",
+                formatTime(record.time), record.time, event, worker, record.delivery_tag,
+                record.job_id, jsonEscape(record.taskID()), detail
+            ) << '\n';
+            break;
+    }
+}
+
+// 段文件的当前记录, 用于按时间合并
+struct Cursor
+{
+    std::unique_ptr<JournalReader> reader;
+    JournalRecord record;
+};
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::ios::sync_with_stdio(false);
+
+    Filter filter;
+    Format format = Format::Text;
+    bool summary = false;
+    std::vector<std::filesystem::path> inputs;
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string_view arg = argv[i];
+            const auto value = [&]() -> std::string_view {
+                if (i + 1 >= argc)
+                {
+                    throw std::invalid_argument(std::format("Missing value for {}", arg));
+                }
+                return argv[++i];
+            };
+
+            if (arg == "--help" || arg == "-h")
+            {
+                std::cout << USAGE;
+                return EXIT_SUCCESS;
+            }
+            else if (arg == "--event")
+            {
+                std::string_view names = value();
+                while (!names.empty())
+                {
+                    const auto comma = names.find(',');
+                    const auto name = names.substr(0, comma);
+                    const auto event = parseJournalEvent(name);
+                    if (!event)
+                    {
+                        throw std::invalid_argument(std::format("Unknown event: {}", name));
+                    }
+                    filter.events.push_back(*event);
+                    names = comma == std::string_view::npos ? std::string_view{} : names.substr(comma + 1);
+                }
+            }
+            else if (arg == "--worker")
+            {
+                filter.worker = boost::uuids::string_generator()(std::string(value()));
+            }
+            else if (arg == "--job")
+            {
+                filter.job = parseNumber<std::int64_t>(value(), arg);
+            }
+            else if (arg == "--task")
+            {
+                filter.task = std::string(value());
+            }
+            else if (arg == "--delivery")
+            {
+                filter.delivery = parseNumber<std::uint64_t>(value(), arg);
+            }
+            else if (arg == "--since")
+            {
+                filter.since = parseNumber<std::int64_t>(value(), arg) * 1'000'000'000;
+            }
+            else if (arg == "--until")
+            {
+                filter.until = parseNumber<std::int64_t>(value(), arg) * 1'000'000'000;
+            }
+            else if (arg == "--format")
+            {
+                const auto name = value();
+                if (name == "text") format = Format::Text;
+                else if (name == "csv") format = Format::Csv;
+                else if (name == "jsonl") format = Format::Jsonl;
+                else throw std::invalid_argument(std::format("Unknown format: {}", name));
+            }
+            else if (arg == "--summary")
+            {
+                summary = true;
+            }
+            else if (arg.starts_with("--"))
+            {
+                throw std::invalid_argument(std::format("Unknown option: {}", arg));
+            }
+            else
+            {
+                inputs.emplace_back(arg);
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << "\n\n" << USAGE;
+        return EXIT_FAILURE;
+    }
+
+    if (inputs.empty())
+    {
+        std::cerr << USAGE;
+        return EXIT_FAILURE;
+    }
+
+    // 展开目录
+    std::vector<std::filesystem::path> files;
+    for (const auto& input : inputs)
+    {
+        if (std::filesystem::is_directory(input))
+        {
+            const auto segments = EventJournal::segments(input);
+            files.insert(files.end(), segments.begin(), segments.end());
+        }
+        else
+        {
+            files.push_back(input);
+        }
+    }
+
+    // 每个段文件内按时间顺序写入, 用最小堆按时间合并
+    std::vector<Cursor> cursors;
+    for (const auto& file : files)
+    {
+        try
+        {
+            auto reader = std::make_unique<JournalReader>(file);
+            if (filter.until && reader->header().created >= *filter.until)
+            {
+                continue;
+            }
+            if (auto record = reader->next())
+            {
+                cursors.push_back(Cursor{std::move(reader), *record});
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Skipping 跳过: " << e.what() << '\n';
+        }
+    }
+
+    const auto later = [&cursors](std::size_t a, std::size_t b) {
+        return cursors[a].record.time > cursors[b].record.time;
+    };
+    std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(later)> heap(later);
+    for (std::size_t i = 0; i < cursors.size(); ++i)
+    {
+        heap.push(i);
+    }
+
+    std::map<std::pair<std::string_view, std::string>, std::uint64_t> counts;
+    std::uint64_t matched = 0;
+    if (!summary && format == Format::Csv)
+    {
+        std::cout << "time,event,worker,delivery,job,task,detail\n";
+    }
+    while (!heap.empty())
+    {
+        const std::size_t index = heap.top();
+        heap.pop();
+        Cursor& cursor = cursors[index];
+
+        if (filter.matches(cursor.record))
+        {
+            ++matched;
+            if (summary)
+            {
+                const auto event = static_cast<JournalEvent>(cursor.record.type);
+                const bool hasReason = event == JournalEvent::TaskRequeued || event == JournalEvent::TaskDropped
+                    || event == JournalEvent::WorkerOffline || event == JournalEvent::TaskCompleted;
+                ++counts[{journalEventName(event), hasReason ? detailString(cursor.record) : std::string{}}];
+            }
+            else
+            {
+                printRecord(cursor.record, format, std::cout);
+            }
+        }
+
+        if (auto record = cursor.reader->next())
+        {
+            cursor.record = *record;
+            heap.push(index);
+        }
+        else
+        {
+            cursor.reader.reset();
+        }
+    }
+
+    if (summary)
+    {
+        for (const auto& [key, count] : counts)
+        {
+            std::cout << key.first;
+            if (!key.second.empty())
+            {
+                std::cout << " (" << key.second << ')';
+            }
+            std::cout << ": " << count << '\n';
+        }
+        std::cout << "total: " << matched << '\n';
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,7 +1,10 @@
 #ifndef YLINEWORKER_CONFIG_H
 #define YLINEWORKER_CONFIG_H
 
+#include <cstdint>
+#include <filesystem>
 #include <spdlog/spdlog.h>
+#include <spdlog/async_logger.h>
 
 namespace YLineWorker {
 
@@ -24,6 +27,40 @@ struct Config {
 
     // log
     spdlog::level::level_enum log_level;
+    bool log_async;                                     // 异步写日志, 调用线程不做文件 I/O
+    std::uint32_t log_queue_size;                       // 异步队列容量 (条)
+    spdlog::async_overflow_policy log_overflow_policy;  // 异步队列已满时的策略
+
+    // executor
+    std::uint32_t executor_slots;              // 0 表示根据机器资源推导
+    std::uint32_t executor_cpu_cores_per_slot; // 0 表示每个任务占用整台机器的 CPU
+
+    // task log 任务日志
+    std::uint32_t log_chunk_size;           // 每块日志压缩前的最大字节数
+    std::uint32_t log_buffer_size;          // 每个输出流的环形缓冲区大小, 溢出时丢弃最旧的数据
+    double log_flush_interval;              // 秒
+    std::uint32_t log_max_bytes_per_second; // 每个输出流的上传速率上限
+
+    // asset cache 输入文件缓存
+    std::filesystem::path cache_dir;
+    double cache_quota_gb;
+    std::uint32_t cache_fetch_threads;
+
+    // pipeline 流水线
+    std::uint32_t executor_lookahead;  // 额外预取的任务数, 在前面的任务运行时准备输入
+    std::uint32_t upload_threads;      // 输出上传线程数
+
+    // artifact
+    std::uint32_t artifact_chunk_size; // 产物上传/下载的分块大小, 不能超过服务器的 max_chunk_bytes
+
+    // cancel 取消
+    double cancel_grace;               // 服务器没有指定时, SIGTERM 之后等待进程退出的秒数, 超时后 SIGKILL 整个进程组
+
+    // monitor 事件循环监控
+    double loop_probe_interval;        // 探测定时器间隔
+    double loop_stall_threshold;       // 事件循环超过该秒数没有响应时记录调用栈
+    double loop_log_interval;          // 汇总日志间隔, 0 表示不输出
+    std::uint32_t usage_history;       // 本地状态接口保留的使用率样本数 (每秒一个)
 };
 
 // 函数: 解析配置文件
@@ -2,6 +2,7 @@
 #define YLINEWORKER_LOGGER_H
 
 #include <spdlog/spdlog.h>
+#include <spdlog/async_logger.h>
 #include <trantor/utils/Logger.h>
 
 namespace YLineWorker {
@@ -9,6 +10,20 @@ namespace YLineWorker {
 // 函数: 创建日志记录器
 std::shared_ptr<spdlog::logger> createLogger();
 
+// 函数: 创建异步日志记录器, 复用 logger 的 sink 和设置, 并设置为默认日志记录器
+// 格式化后的日志进入有界队列, 由后台线程写入控制台和文件 (包括文件滚动), 调用线程不做 I/O
+std::shared_ptr<spdlog::logger> createAsyncLogger(
+    const std::shared_ptr<spdlog::logger>& logger, 
+    std::size_t queueSize, 
+    spdlog::async_overflow_policy policy
+);
+
+// 函数: 异步队列已满时被覆盖的日志数量
+std::size_t droppedLogMessages();
+
+// 哈希表: 映射字符串到异步队列已满时的策略
+extern const std::unordered_map<std::string, spdlog::async_overflow_policy> logOverflowPolicyMap;
+
 // 哈希表: 映射字符串到 spdlog 的日志等级
 extern const std::unordered_map<std::string, spdlog::level::level_enum> logLevelMap;
 
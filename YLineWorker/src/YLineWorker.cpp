@@ -27,6 +27,12 @@ int main() {
 
     // set log level
     logger->set_level(config.log_level);
+    // 切换为异步日志, 之后 I/O 线程上的日志不再直接写文件
+    if (config.log_async)
+    {
+        logger = YLineWorker::createAsyncLogger(logger, config.log_queue_size, config.log_overflow_policy);
+        spdlog::info("Async logging enabled 异步日志已启用, queue size 队列容量: {}", config.log_queue_size);
+    }
     // log level output here
     spdlog::info("Log level 日志等级: {}", YLineWorker::reverseLogLevelMap.at(logger->level()));
 
@@ -0,0 +1,318 @@
+#include "artifactClient.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include <drogon/HttpClient.h>
+#include <spdlog/spdlog.h>
+
+#include "UTartifact.h"
+#include "UThash.h"
+
+namespace YLineWorker {
+
+namespace fs = std::filesystem;
+
+// 单个请求的超时 (秒)
+constexpr double ARTIFACT_REQUEST_TIMEOUT = 120.0;
+
+// 连续失败超过该次数后放弃
+constexpr int ARTIFACT_MAX_FAILURES = 5;
+
+namespace {
+
+// key, 十六进制哈希和数字都不需要编码
+drogon::HttpRequestPtr makeRequest(drogon::HttpMethod method, const std::string& path, const std::string& secret)
+{
+    auto req = drogon::HttpRequest::newHttpRequest();
+    req->setMethod(method);
+    req->setPathEncode(false);
+    req->setPath(path);
+    req->addHeader(std::string(YSolowork::util::ARTIFACT_SECRET_HEADER), secret);
+    return req;
+}
+
+std::optional<ArtifactStatus> toStatus(const drogon::HttpResponsePtr& resp)
+{
+    const auto json = resp->getJsonObject();
+    if (!json || !(*json)["size"].isUInt64())
+    {
+        return std::nullopt;
+    }
+    return ArtifactStatus{
+        (*json)["complete"].asBool(),
+        (*json)["size"].asUInt64(),
+        (*json)["sha256"].asString(),
+    };
+}
+
+// 计算文件前 length 字节的哈希, 续传时恢复增量哈希的状态
+bool hashPrefix(std::ifstream& file, std::uint64_t length, YSolowork::util::Sha256& hasher, std::vector<char>& buffer)
+{
+    hasher.reset();
+    file.clear();
+    file.seekg(0);
+    while (length > 0 && file)
+    {
+        const auto n = static_cast<std::size_t>(std::min<std::uint64_t>(length, buffer.size()));
+        file.read(buffer.data(), static_cast<std::streamsize>(n));
+        const auto got = static_cast<std::size_t>(file.gcount());
+        hasher.update(buffer.data(), got);
+        length -= got;
+    }
+    return length == 0;
+}
+
+void backoff(int failures)
+{
+    std::this_thread::sleep_for(std::chrono::seconds(1 << std::min(failures, 5)));
+}
+
+}
+
+bool parseArtifactUrl(const std::string& url, std::string& key)
+{
+    if (!url.starts_with(YSolowork::util::ARTIFACT_SCHEME))
+    {
+        return false;
+    }
+    key = url.substr(YSolowork::util::ARTIFACT_SCHEME.size());
+    return true;
+}
+
+ArtifactClient::ArtifactClient(std::string server, std::string secret, std::size_t chunkSize)
+    : m_server(std::move(server)),
+      m_secret(std::move(secret)),
+      m_chunkSize(std::max<std::size_t>(64 * 1024, chunkSize))
+{
+}
+
+void ArtifactClient::setServer(std::string server)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_server = std::move(server);
+}
+
+std::string ArtifactClient::server() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return "http://" + m_server;
+}
+
+std::optional<ArtifactStatus> ArtifactClient::status(const std::string& key, std::string& err) const
+{
+    if (!YSolowork::util::isValidArtifactKey(key))
+    {
+        err = "Invalid artifact key 无效的产物 key: " + key;
+        return std::nullopt;
+    }
+    auto client = drogon::HttpClient::newHttpClient(server());
+    auto [result, resp] = client->sendRequest(
+        makeRequest(drogon::Get, "/api/artifact/status?key=" + key, m_secret),
+        ARTIFACT_REQUEST_TIMEOUT
+    );
+    if (result != drogon::ReqResult::Ok || !resp || resp->getStatusCode() != drogon::k200OK)
+    {
+        err = "Failed to query artifact 查询产物失败: " + key;
+        return std::nullopt;
+    }
+    auto status = toStatus(resp);
+    if (!status)
+    {
+        err = "Invalid artifact status 无效的产物状态: " + key;
+    }
+    return status;
+}
+
+bool ArtifactClient::upload(const fs::path& file, const std::string& key, std::uint64_t& sent, std::string& err) const
+{
+    sent = 0;
+    std::error_code ec;
+    const std::uint64_t fileSize = fs::file_size(file, ec);
+    std::ifstream input(file, std::ios::binary);
+    if (ec || !input)
+    {
+        err = "Cannot open output 无法打开输出 " + file.string();
+        return false;
+    }
+
+    auto client = drogon::HttpClient::newHttpClient(server());
+    std::vector<char> buffer(m_chunkSize);
+    YSolowork::util::Sha256 hasher;
+    std::uint64_t offset = 0;
+    bool synced = false;        // 本地哈希状态与服务器的续传位置一致
+    int failures = 0;
+
+    while (failures < ARTIFACT_MAX_FAILURES)
+    {
+        if (!synced)
+        {
+            auto status = this->status(key, err);
+            if (!status)
+            {
+                backoff(++failures);
+                continue;
+            }
+            if (status->complete)
+            {
+                // 产物已存在 (例如推测副本已上传), 内容相同时视为成功
+                const auto local = YSolowork::util::sha256File(file, ec);
+                if (!ec && local == status->sha256)
+                {
+                    return true;
+                }
+                err = "Artifact already exists with different content 产物已存在且内容不同: " + key;
+                return false;
+            }
+            if (status->size > fileSize)
+            {
+                err = "Server has more data than the local file 服务器上的数据比本地文件多: " + key;
+                return false;
+            }
+            offset = status->size;
+            if (!hashPrefix(input, offset, hasher, buffer))
+            {
+                err = "Failed to read output 读取输出失败 " + file.string();
+                return false;
+            }
+            if (offset > 0)
+            {
+                spdlog::info("Resuming artifact upload 续传产物 {} at {} / {} bytes", key, offset, fileSize);
+            }
+            synced = true;
+        }
+
+        if (offset == fileSize)
+        {
+            // 完成: 服务器比较增量计算的 SHA-256
+            auto checkHasher = hasher;
+            const std::string sha256 = checkHasher.hexDigest();
+            auto [result, resp] = client->sendRequest(
+                makeRequest(drogon::Post, "/api/artifact/complete?key=" + key + "&sha256=" + sha256, m_secret),
+                ARTIFACT_REQUEST_TIMEOUT
+            );
+            if (result == drogon::ReqResult::Ok && resp && resp->getStatusCode() == drogon::k200OK)
+            {
+                return true;
+            }
+            // 校验失败时服务器已丢弃数据, 重新查询后从头上传
+            synced = false;
+            backoff(++failures);
+            continue;
+        }
+
+        input.clear();
+        input.seekg(static_cast<std::streamoff>(offset));
+        const auto length = static_cast<std::size_t>(std::min<std::uint64_t>(fileSize - offset, buffer.size()));
+        input.read(buffer.data(), static_cast<std::streamsize>(length));
+        if (static_cast<std::size_t>(input.gcount()) != length)
+        {
+            err = "Failed to read output 读取输出失败 " + file.string();
+            return false;
+        }
+
+        YSolowork::util::Sha256 chunkHasher;
+        chunkHasher.update(buffer.data(), length);
+        auto req = makeRequest(
+            drogon::Put,
+            "/api/artifact/chunk?key=" + key + "&offset=" + std::to_string(offset) + "&sha256=" + chunkHasher.hexDigest(),
+            m_secret
+        );
+        req->setContentTypeCode(drogon::CT_APPLICATION_OCTET_STREAM);
+        req->setBody(std::string(buffer.data(), length));
+        auto [result, resp] = client->sendRequest(req, ARTIFACT_REQUEST_TIMEOUT);
+        if (result == drogon::ReqResult::Ok && resp && resp->getStatusCode() == drogon::k200OK)
+        {
+            hasher.update(buffer.data(), length);
+            offset += length;
+            sent += length;
+            failures = 0;
+            continue;
+        }
+
+        // 网络错误, 数据块损坏或位置不一致, 都从服务器的状态重新同步
+        spdlog::warn(
+            "Artifact chunk upload failed, retrying 产物数据块上传失败, 重试: {} at {}, status {}",
+            key, offset, resp ? static_cast<int>(resp->getStatusCode()) : 0
+        );
+        synced = false;
+        backoff(++failures);
+    }
+
+    if (err.empty())
+    {
+        err = "Failed to upload artifact 上传产物失败: " + key;
+    }
+    return false;
+}
+
+std::string ArtifactClient::download(const std::string& key, const fs::path& dest, std::uint64_t& size, std::string& err) const
+{
+    size = 0;
+    auto status = this->status(key, err);
+    if (!status)
+    {
+        return {};
+    }
+    if (!status->complete)
+    {
+        err = "Artifact is not complete 产物尚未上传完成: " + key;
+        return {};
+    }
+
+    std::ofstream output(dest, std::ios::binary | std::ios::trunc);
+    if (!output)
+    {
+        err = "Cannot open 无法打开 " + dest.string();
+        return {};
+    }
+
+    auto client = drogon::HttpClient::newHttpClient(server());
+    YSolowork::util::Sha256 hasher;
+    int failures = 0;
+    while (size < status->size)
+    {
+        if (failures >= ARTIFACT_MAX_FAILURES)
+        {
+            err = "Failed to download artifact 下载产物失败: " + key;
+            return {};
+        }
+
+        // 每次只请求一个数据块, 响应体大小有上限
+        const std::uint64_t last = std::min<std::uint64_t>(size + m_chunkSize, status->size) - 1;
+        auto req = makeRequest(drogon::Get, "/api/artifact?key=" + key, m_secret);
+        req->addHeader("Range", "bytes=" + std::to_string(size) + "-" + std::to_string(last));
+        auto [result, resp] = client->sendRequest(req, ARTIFACT_REQUEST_TIMEOUT);
+        if (result != drogon::ReqResult::Ok || !resp || resp->getStatusCode() != drogon::k206PartialContent
+            || resp->body().size() != last - size + 1)
+        {
+            backoff(++failures);
+            continue;
+        }
+
+        const auto body = resp->body();
+        output.write(body.data(), static_cast<std::streamsize>(body.size()));
+        if (!output)
+        {
+            err = "Failed to write 写入失败 " + dest.string();
+            return {};
+        }
+        hasher.update(body.data(), body.size());
+        size += body.size();
+        failures = 0;
+    }
+    output.close();
+
+    const std::string sha256 = hasher.hexDigest();
+    if (sha256 != status->sha256)
+    {
+        err = "Artifact checksum mismatch 产物校验失败: " + key;
+        return {};
+    }
+    return sha256;
+}
+
+} // namespace YLineWorker
@@ -0,0 +1,58 @@
+#ifndef YLINEWORKER_ARTIFACT_CLIENT_H
+#define YLINEWORKER_ARTIFACT_CLIENT_H
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace YLineWorker {
+
+// 结构体: 服务器上产物的状态
+struct ArtifactStatus {
+    bool complete = false;
+    std::uint64_t size = 0;    // 未完成时为服务器已收到的字节数
+    std::string sha256;
+};
+
+// 函数: 是否为 artifact://<key> 形式的路径, 是则取出 key
+bool parseArtifactUrl(const std::string& url, std::string& key);
+
+/*
+产物客户端, 与服务器的 ArtifactCtrl 通信, 协议见 UTartifact.h
+
+上传按 chunk_size 分块, 每块附带自身的 SHA-256, 整个文件的 SHA-256 随读取增量计算
+中断 (网络错误, 服务器重启) 后从服务器已收到的位置续传, 本地只需要重新计算已上传部分的哈希
+下载按 chunk_size 分段请求 Range, 边写边计算哈希, 最后与服务器记录的 SHA-256 比较
+内存占用只有一个数据块, 与文件大小无关
+
+所有函数都是同步的, 只能在上传/下载线程上调用, 不能在 drogon 的 EventLoop 上调用
+*/
+class ArtifactClient {
+public:
+    ArtifactClient(std::string server, std::string secret, std::size_t chunkSize);
+
+    // 工作机被重定向到其他服务器实例
+    void setServer(std::string server);
+
+    std::optional<ArtifactStatus> status(const std::string& key, std::string& err) const;
+
+    // 上传文件, 返回本次实际发送的字节数 (已存在的相同产物不会重复上传)
+    bool upload(const std::filesystem::path& file, const std::string& key, std::uint64_t& sent, std::string& err) const;
+
+    // 下载到 dest, 返回内容的 SHA-256, 失败时返回空字符串
+    std::string download(const std::string& key, const std::filesystem::path& dest, std::uint64_t& size, std::string& err) const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::string m_server;
+    std::string m_secret;
+    std::size_t m_chunkSize;
+
+    std::string server() const;
+};
+
+} // namespace YLineWorker
+
+#endif // YLINEWORKER_ARTIFACT_CLIENT_H
@@ -0,0 +1,570 @@
+#include "assetCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <json/reader.h>
+#include <json/writer.h>
+#include <spdlog/spdlog.h>
+#include <trantor/utils/ConcurrentTaskQueue.h>
+
+#include "UThash.h"
+#include "artifactClient.h"
+
+namespace YLineWorker {
+
+namespace fs = std::filesystem;
+
+// 下载时的缓冲区大小
+constexpr std::size_t FETCH_BUFFER_SIZE = 1024 * 1024;
+
+std::optional<std::vector<InputSpec>> parseInputs(const Json::Value& inputs, std::string& err)
+{
+    std::vector<InputSpec> result;
+    if (inputs.isNull())
+    {
+        return result;
+    }
+    if (!inputs.isArray())
+    {
+        err = "payload.inputs must be an array";
+        return std::nullopt;
+    }
+
+    for (const auto& input : inputs)
+    {
+        InputSpec spec;
+        if (input.isString())
+        {
+            spec.path = input.asString();
+        }
+        else if (input.isObject() && input["path"].isString())
+        {
+            spec.path = input["path"].asString();
+            spec.hash = input["hash"].isString() ? input["hash"].asString() : std::string{};
+            spec.as = input["as"].isString() ? input["as"].asString() : std::string{};
+        }
+        else
+        {
+            err = "payload.inputs must contain paths or objects with a `path` string";
+            return std::nullopt;
+        }
+
+        if (spec.path.empty())
+        {
+            err = "payload.inputs path must not be empty";
+            return std::nullopt;
+        }
+        if (!spec.hash.empty() && !YSolowork::util::isSha256Hex(spec.hash))
+        {
+            err = "payload.inputs hash must be a lowercase hex SHA-256: " + spec.hash;
+            return std::nullopt;
+        }
+        result.push_back(std::move(spec));
+    }
+    return result;
+}
+
+AssetCache::AssetCache(trantor::EventLoop* loop, AssetCacheOptions options)
+    : m_loop(loop),
+      m_options(std::move(options)),
+      m_fetchQueue(std::make_unique<trantor::ConcurrentTaskQueue>(std::max<std::size_t>(1, m_options.fetch_threads), "AssetFetch"))
+{
+}
+
+AssetCache::~AssetCache()
+{
+    m_fetchQueue->stop();
+}
+
+fs::path AssetCache::objectPath(const std::string& hash) const
+{
+    return m_options.dir / "objects" / hash.substr(0, 2) / hash;
+}
+
+void AssetCache::start()
+{
+    std::error_code ec;
+    fs::create_directories(m_options.dir / "objects", ec);
+    // 上次退出时没有完成的下载
+    fs::remove_all(m_options.dir / "tmp", ec);
+    fs::create_directories(m_options.dir / "tmp", ec);
+    if (ec)
+    {
+        spdlog::error("Failed to create asset cache directory 创建缓存目录失败: {}", ec.message());
+        throw std::runtime_error("Failed to create asset cache directory");
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // 按修改时间恢复 LRU 顺序, 命中时会更新修改时间
+    std::vector<std::pair<fs::file_time_type, std::string>> found;
+    for (const auto& entry : fs::recursive_directory_iterator(m_options.dir / "objects", ec))
+    {
+        const std::string hash = entry.path().filename().string();
+        if (!entry.is_regular_file() || !YSolowork::util::isSha256Hex(hash))
+        {
+            continue;
+        }
+        std::error_code entryEc;
+        const auto size = entry.file_size(entryEc);
+        const auto mtime = entry.last_write_time(entryEc);
+        if (entryEc)
+        {
+            continue;
+        }
+        m_objects[hash].size = size;
+        m_totalBytes += size;
+        found.emplace_back(mtime, hash);
+    }
+    std::sort(found.begin(), found.end());
+    for (const auto& [mtime, hash] : found)
+    {
+        m_objects[hash].lastUse = ++m_clock;
+    }
+
+    // 读取索引, 丢弃指向已不存在文件的条目
+    std::ifstream indexFile(m_options.dir / "index.json");
+    if (indexFile)
+    {
+        Json::Value index;
+        Json::CharReaderBuilder reader;
+        std::string errs;
+        if (Json::parseFromStream(reader, indexFile, &index, &errs) && index.isObject())
+        {
+            for (const auto& key : index.getMemberNames())
+            {
+                const std::string hash = index[key].asString();
+                if (m_objects.contains(hash))
+                {
+                    m_index[key] = hash;
+                }
+            }
+        }
+    }
+
+    evictLocked();
+    spdlog::info(
+        "Asset cache loaded 缓存已加载: {} files, {:.2f} GB / {:.2f} GB, dir 目录: {}",
+        m_objects.size(),
+        static_cast<double>(m_totalBytes) / (1024.0 * 1024 * 1024),
+        static_cast<double>(m_options.quota_bytes) / (1024.0 * 1024 * 1024),
+        m_options.dir.string()
+    );
+}
+
+void AssetCache::stage(std::uint64_t owner, const std::string& cwd, std::vector<InputSpec> inputs, StagedCallback&& callback)
+{
+    if (inputs.empty())
+    {
+        m_loop->queueInLoop([callback = std::move(callback)]() { callback({}, {}); });
+        return;
+    }
+
+    // 所有输入共享的状态, 最后一个完成的下载线程负责链接和回调
+    struct StageState {
+        std::mutex mutex;
+        std::vector<InputSpec> inputs;
+        std::vector<std::string> hashes;
+        std::size_t remaining;
+        std::string error;
+        StagedCallback callback;
+    };
+    auto state = std::make_shared<StageState>();
+    state->hashes.resize(inputs.size());
+    state->remaining = inputs.size();
+    state->inputs = std::move(inputs);
+    state->callback = std::move(callback);
+
+    for (std::size_t i = 0; i < state->inputs.size(); ++i)
+    {
+        m_fetchQueue->runTaskInQueue([this, state, i, owner, cwd]() {
+            std::string err;
+            const std::string hash = resolve(state->inputs[i], owner, err);
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->hashes[i] = hash;
+                if (hash.empty() && state->error.empty())
+                {
+                    state->error = err;
+                }
+                if (--state->remaining > 0)
+                {
+                    return;
+                }
+            }
+
+            std::vector<fs::path> localPaths;
+            std::string error = state->error;
+            if (error.empty())
+            {
+                const fs::path workDir = cwd.empty() ? fs::current_path() : fs::path(cwd);
+                for (std::size_t j = 0; j < state->inputs.size(); ++j)
+                {
+                    localPaths.push_back(objectPath(state->hashes[j]));
+                    const auto& as = state->inputs[j].as;
+                    if (!as.empty() && !materialize(localPaths.back(), fs::path(as).is_absolute() ? fs::path(as) : workDir / as, error))
+                    {
+                        break;
+                    }
+                }
+            }
+            m_loop->queueInLoop([state, localPaths = std::move(localPaths), error = std::move(error)]() mutable {
+                state->callback(std::move(localPaths), std::move(error));
+            });
+        });
+    }
+}
+
+std::string AssetCache::resolve(const InputSpec& input, std::uint64_t owner, std::string& err)
+{
+    std::error_code ec;
+
+    // 声明了哈希且已缓存时完全不访问源文件
+    if (!input.hash.empty())
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (const auto it = m_objects.find(input.hash); it != m_objects.end())
+        {
+            it->second.lastUse = ++m_clock;
+            ++it->second.pins;
+            m_pins[owner].push_back(input.hash);
+            lock.unlock();
+            fs::last_write_time(objectPath(input.hash), fs::file_time_type::clock::now(), ec);
+            return input.hash;
+        }
+    }
+
+    const std::string sourceKey = sourceKeyOf(input, err);
+    if (sourceKey.empty())
+    {
+        return {};
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        std::string hash = input.hash;
+        if (hash.empty())
+        {
+            const auto indexed = m_index.find(sourceKey);
+            hash = indexed == m_index.end() ? std::string{} : indexed->second;
+        }
+        if (!hash.empty())
+        {
+            if (const auto it = m_objects.find(hash); it != m_objects.end())
+            {
+                it->second.lastUse = ++m_clock;
+                ++it->second.pins;
+                m_pins[owner].push_back(hash);
+                lock.unlock();
+                fs::last_write_time(objectPath(hash), fs::file_time_type::clock::now(), ec);
+                return hash;
+            }
+        }
+        if (!m_fetching.contains(sourceKey))
+        {
+            break;
+        }
+        // 其他任务正在下载同一个文件
+        m_fetched.wait(lock);
+    }
+    m_fetching.insert(sourceKey);
+    lock.unlock();
+
+    std::uint64_t size = 0;
+    const std::string hash = download(input, size, err);
+
+    lock.lock();
+    m_fetching.erase(sourceKey);
+    m_fetched.notify_all();
+    if (hash.empty())
+    {
+        return {};
+    }
+
+    m_index[sourceKey] = hash;
+    std::vector<std::string> added;
+    auto [it, inserted] = m_objects.try_emplace(hash);
+    if (inserted)
+    {
+        it->second.size = size;
+        m_totalBytes += size;
+        added.push_back(hash);
+    }
+    it->second.lastUse = ++m_clock;
+    ++it->second.pins;
+    m_pins[owner].push_back(hash);
+
+    auto evicted = evictLocked();
+    saveIndexLocked();
+    lock.unlock();
+
+    notifyChange(std::move(added), std::move(evicted));
+    return hash;
+}
+
+std::string AssetCache::sourceKeyOf(const InputSpec& input, std::string& err) const
+{
+    std::string artifactKey;
+    if (parseArtifactUrl(input.path, artifactKey))
+    {
+        // 产物完成后不可变, 以服务器上的 SHA-256 作为版本
+        if (!m_artifacts)
+        {
+            err = "Artifact inputs are not available 无法使用产物输入: " + input.path;
+            return {};
+        }
+        const auto status = m_artifacts->status(artifactKey, err);
+        if (!status)
+        {
+            return {};
+        }
+        if (!status->complete)
+        {
+            err = "Artifact is not complete 产物尚未上传完成: " + input.path;
+            return {};
+        }
+        return input.path + "|" + status->sha256;
+    }
+
+    // 源文件的 (路径, 大小, 修改时间) 作为索引 key, 文件被修改后自然失效
+    std::error_code ec;
+    const auto sourceSize = fs::file_size(input.path, ec);
+    const auto sourceTime = ec ? fs::file_time_type{} : fs::last_write_time(input.path, ec);
+    if (ec)
+    {
+        err = "Cannot stat input 无法读取输入文件 " + input.path + ": " + ec.message();
+        return {};
+    }
+    return input.path + "|" + std::to_string(sourceSize) + "|"
+        + std::to_string(sourceTime.time_since_epoch().count());
+}
+
+std::string AssetCache::copySource(const std::string& path, const fs::path& tmp, std::uint64_t& size, std::string& err)
+{
+    std::ifstream source(path, std::ios::binary);
+    std::ofstream target(tmp, std::ios::binary | std::ios::trunc);
+    if (!source || !target)
+    {
+        err = "Cannot open input 无法打开输入文件: " + path;
+        return {};
+    }
+
+    // 边复制边计算哈希, 只读取一遍源文件
+    YSolowork::util::Sha256 hasher;
+    std::vector<char> buffer(FETCH_BUFFER_SIZE);
+    size = 0;
+    while (source)
+    {
+        source.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        const auto n = static_cast<std::size_t>(source.gcount());
+        hasher.update(buffer.data(), n);
+        target.write(buffer.data(), static_cast<std::streamsize>(n));
+        size += n;
+    }
+    target.close();
+
+    if (source.bad() || !target)
+    {
+        err = "Failed to copy input 复制输入文件失败: " + path;
+        return {};
+    }
+    return hasher.hexDigest();
+}
+
+std::string AssetCache::download(const InputSpec& input, std::uint64_t& size, std::string& err)
+{
+    static std::atomic<std::uint64_t> tmpCounter = 0;
+    const fs::path tmp = m_options.dir / "tmp" / (std::to_string(tmpCounter.fetch_add(1)) + ".part");
+    const auto startTime = std::chrono::steady_clock::now();
+
+    std::string artifactKey;
+    const std::string hash = parseArtifactUrl(input.path, artifactKey)
+        ? m_artifacts->download(artifactKey, tmp, size, err)
+        : copySource(input.path, tmp, size, err);
+
+    std::error_code ec;
+    if (hash.empty())
+    {
+        fs::remove(tmp, ec);
+        return {};
+    }
+    if (!input.hash.empty() && input.hash != hash)
+    {
+        fs::remove(tmp, ec);
+        err = "Input hash mismatch 输入文件哈希不一致: " + input.path + ", expected " + input.hash + ", got " + hash;
+        return {};
+    }
+
+    // 只读, 任务通过硬链接访问时不能修改缓存内容
+    fs::permissions(tmp, fs::perms::owner_read | fs::perms::group_read | fs::perms::others_read, ec);
+
+    const fs::path object = objectPath(hash);
+    fs::create_directories(object.parent_path(), ec);
+    if (fs::exists(object, ec))
+    {
+        // 不同路径的相同内容已经在缓存中
+        fs::remove(tmp, ec);
+        return hash;
+    }
+    fs::rename(tmp, object, ec);
+    if (ec)
+    {
+        fs::remove(tmp, ec);
+        err = "Failed to store input in cache 缓存输入文件失败: " + ec.message();
+        return {};
+    }
+
+    spdlog::info(
+        "Fetched input 已下载输入文件 {} ({:.1f} MB) in {:.2f}s",
+        input.path,
+        static_cast<double>(size) / (1024.0 * 1024),
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count()
+    );
+    return hash;
+}
+
+bool AssetCache::materialize(const fs::path& object, const fs::path& dest, std::string& err)
+{
+    std::error_code ec;
+    fs::create_directories(dest.parent_path(), ec);
+    fs::remove(dest, ec);
+    fs::create_hard_link(object, dest, ec);
+    if (!ec)
+    {
+        return true;
+    }
+    // 跨文件系统不能硬链接, 复制一份
+    ec.clear();
+    fs::copy_file(object, dest, fs::copy_options::overwrite_existing, ec);
+    if (ec)
+    {
+        err = "Failed to place input at 放置输入文件失败 " + dest.string() + ": " + ec.message();
+        return false;
+    }
+    return true;
+}
+
+void AssetCache::release(std::uint64_t owner)
+{
+    std::vector<std::string> evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto pinned = m_pins.find(owner);
+        if (pinned == m_pins.end())
+        {
+            return;
+        }
+        for (const auto& hash : pinned->second)
+        {
+            if (const auto it = m_objects.find(hash); it != m_objects.end() && it->second.pins > 0)
+            {
+                --it->second.pins;
+            }
+        }
+        m_pins.erase(pinned);
+        // 使用中的文件可能让缓存暂时超过配额
+        evicted = evictLocked();
+        if (!evicted.empty())
+        {
+            saveIndexLocked();
+        }
+    }
+    notifyChange({}, std::move(evicted));
+}
+
+std::vector<std::string> AssetCache::evictLocked()
+{
+    std::vector<std::string> evicted;
+    while (m_totalBytes > m_options.quota_bytes)
+    {
+        // 淘汰很少发生, 线性查找最久未使用且没有被使用的文件
+        auto victim = m_objects.end();
+        for (auto it = m_objects.begin(); it != m_objects.end(); ++it)
+        {
+            if (it->second.pins == 0 && (victim == m_objects.end() || it->second.lastUse < victim->second.lastUse))
+            {
+                victim = it;
+            }
+        }
+        if (victim == m_objects.end())
+        {
+            break;
+        }
+
+        std::error_code ec;
+        fs::remove(objectPath(victim->first), ec);
+        m_totalBytes -= std::min(m_totalBytes, victim->second.size);
+        evicted.push_back(victim->first);
+        m_objects.erase(victim);
+    }
+
+    if (!evicted.empty())
+    {
+        const std::unordered_set<std::string> removed(evicted.begin(), evicted.end());
+        std::erase_if(m_index, [&removed](const auto& entry) { return removed.contains(entry.second); });
+        spdlog::info("Evicted {} files from asset cache 缓存超过配额, 已淘汰文件", evicted.size());
+    }
+    return evicted;
+}
+
+void AssetCache::saveIndexLocked() const
+{
+    Json::Value index(Json::objectValue);
+    for (const auto& [key, hash] : m_index)
+    {
+        index[key] = hash;
+    }
+
+    // 先写临时文件再替换, 避免写到一半时退出损坏索引
+    const fs::path path = m_options.dir / "index.json";
+    const fs::path tmp = m_options.dir / "index.json.tmp";
+    {
+        std::ofstream file(tmp, std::ios::trunc);
+        Json::StreamWriterBuilder writer;
+        writer["indentation"] = "";
+        file << Json::writeString(writer, index);
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec)
+    {
+        spdlog::warn("Failed to save asset cache index 保存缓存索引失败: {}", ec.message());
+    }
+}
+
+void AssetCache::notifyChange(std::vector<std::string>&& added, std::vector<std::string>&& evicted)
+{
+    if (!m_onChange || (added.empty() && evicted.empty()))
+    {
+        return;
+    }
+    m_loop->queueInLoop([this, added = std::move(added), evicted = std::move(evicted)]() mutable {
+        m_onChange(std::move(added), std::move(evicted));
+    });
+}
+
+std::vector<std::string> AssetCache::hashes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::string> result;
+    result.reserve(m_objects.size());
+    for (const auto& [hash, object] : m_objects)
+    {
+        result.push_back(hash);
+    }
+    return result;
+}
+
+AssetCacheStats AssetCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return AssetCacheStats{m_objects.size(), m_totalBytes, m_options.quota_bytes, m_fetching.size()};
+}
+
+} // namespace YLineWorker
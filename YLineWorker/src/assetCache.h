@@ -0,0 +1,147 @@
+#ifndef YLINEWORKER_ASSET_CACHE_H
+#define YLINEWORKER_ASSET_CACHE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <json/value.h>
+#include <trantor/net/EventLoop.h>
+
+namespace trantor {
+class ConcurrentTaskQueue;
+}
+
+namespace YLineWorker {
+
+class ArtifactClient;
+
+// 结构体: 任务声明的输入文件
+struct InputSpec {
+    std::string path; // 源文件, 通常在网络文件服务器上, 或者 artifact://<key> 从服务器下载
+    std::string hash; // SHA-256, 可选; 声明后服务器可以按缓存亲和性分发, 并校验下载的内容
+    std::string as;   // 可选, 链接到任务工作目录下的路径 (相对路径相对于 cwd)
+};
+
+// 函数: 解析任务 payload 中的 inputs, 不存在时返回空列表, 格式错误时返回 nullopt 并设置 err
+std::optional<std::vector<InputSpec>> parseInputs(const Json::Value& inputs, std::string& err);
+
+// 结构体: 缓存选项
+struct AssetCacheOptions {
+    std::filesystem::path dir;
+    std::uint64_t quota_bytes = 50ull * 1024 * 1024 * 1024;
+    std::size_t fetch_threads = 2;
+};
+
+// 结构体: 缓存状态, 用于本地状态接口
+struct AssetCacheStats {
+    std::size_t objects = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t quota_bytes = 0;
+    std::size_t fetching = 0;  // 正在下载的源文件数量
+};
+
+/*
+内容寻址的输入文件缓存
+
+<dir>/objects/<hash 前两位>/<hash> 按内容的 SHA-256 存放, 同一内容只下载一次, 不同路径的相同文件共用一份
+未声明哈希的输入通过 (路径, 大小, 修改时间) 索引找到哈希, 命中时只需要一次 stat, 索引保存在 <dir>/index.json
+
+下载在独立的线程池上进行, 任务在执行器中排队 (前一个任务还在运行) 时就开始准备输入
+同一个源文件同时只下载一次, 其他任务等待下载完成
+总大小超过配额时按最近最少使用 (LRU) 淘汰, 正在被排队或运行中的任务使用的文件不会被淘汰
+
+缓存文件设置为只读, 通过硬链接放到任务工作目录 (跨文件系统时复制), 任务不能修改缓存的内容
+回调在构造时传入的 EventLoop 上调用, 其余函数可以在任意线程调用
+*/
+class AssetCache {
+public:
+    // 输入准备完成, localPaths 与 inputs 一一对应; 失败时 error 不为空
+    using StagedCallback = std::function<void(std::vector<std::filesystem::path> localPaths, std::string error)>;
+    // 缓存内容变化, 上报给服务器用于缓存亲和性分发
+    using ChangeCallback = std::function<void(std::vector<std::string> added, std::vector<std::string> evicted)>;
+
+    AssetCache(trantor::EventLoop* loop, AssetCacheOptions options);
+    ~AssetCache();
+
+    AssetCache(const AssetCache&) = delete;
+    AssetCache& operator=(const AssetCache&) = delete;
+
+    // 扫描缓存目录并读取索引
+    void start();
+
+    inline void setChangeCallback(ChangeCallback&& callback) { m_onChange = std::move(callback); }
+
+    inline void setArtifactClient(std::shared_ptr<ArtifactClient> artifacts) { m_artifacts = std::move(artifacts); }
+
+    // 为 owner (任务的 delivery_tag) 准备输入, 文件在 release 之前不会被淘汰
+    void stage(std::uint64_t owner, const std::string& cwd, std::vector<InputSpec> inputs, StagedCallback&& callback);
+
+    // 任务结束, 释放 owner 使用的文件
+    void release(std::uint64_t owner);
+
+    // 缓存中所有文件的哈希
+    std::vector<std::string> hashes() const;
+
+    AssetCacheStats stats() const;
+
+private:
+    struct Object {
+        std::uint64_t size = 0;
+        std::uint64_t lastUse = 0;
+        std::uint32_t pins = 0;
+    };
+
+    trantor::EventLoop* m_loop;
+    AssetCacheOptions m_options;
+    std::unique_ptr<trantor::ConcurrentTaskQueue> m_fetchQueue;
+    ChangeCallback m_onChange;
+    std::shared_ptr<ArtifactClient> m_artifacts;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_fetched;
+    std::unordered_map<std::string, Object> m_objects;                     // hash -> 文件
+    std::unordered_map<std::string, std::string> m_index;                  // 源文件 key -> hash
+    std::unordered_map<std::uint64_t, std::vector<std::string>> m_pins;    // owner -> hash
+    std::unordered_set<std::string> m_fetching;                            // 正在下载的源文件 key
+    std::uint64_t m_totalBytes = 0;
+    std::uint64_t m_clock = 0;                                             // LRU 时钟
+
+    std::filesystem::path objectPath(const std::string& hash) const;
+
+    // 在下载线程上获取一个输入, 返回哈希, 失败时返回空字符串并设置 err
+    std::string resolve(const InputSpec& input, std::uint64_t owner, std::string& err);
+
+    // 源文件的索引 key, 失败时返回空字符串并设置 err
+    std::string sourceKeyOf(const InputSpec& input, std::string& err) const;
+
+    // 下载到临时文件并计算哈希, 放入对象目录, 返回哈希
+    std::string download(const InputSpec& input, std::uint64_t& size, std::string& err);
+
+    // 复制源文件到 tmp 并计算哈希
+    static std::string copySource(const std::string& path, const std::filesystem::path& tmp, std::uint64_t& size, std::string& err);
+
+    // 把缓存文件放到任务工作目录
+    static bool materialize(const std::filesystem::path& object, const std::filesystem::path& dest, std::string& err);
+
+    // 超过配额时淘汰, 返回被淘汰的哈希 (调用者持有锁)
+    std::vector<std::string> evictLocked();
+
+    // 保存索引 (调用者持有锁)
+    void saveIndexLocked() const;
+
+    // 在 EventLoop 上通知缓存变化
+    void notifyChange(std::vector<std::string>&& added, std::vector<std::string>&& evicted);
+};
+
+} // namespace YLineWorker
+
+#endif // YLINEWORKER_ASSET_CACHE_H
@@ -0,0 +1,277 @@
+#include "logStream.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <drogon/utils/Utilities.h>
+#include <spdlog/spdlog.h>
+#include <trantor/net/Channel.h>
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace YLineWorker {
+
+namespace {
+
+// 标记行的最大长度, 更长的行按普通输出处理
+constexpr std::size_t MARKER_LINE_MAX = 4096;
+
+}
+
+RingBuffer::RingBuffer(std::size_t capacity)
+    : m_buffer(std::max<std::size_t>(1, capacity))
+{
+}
+
+void RingBuffer::write(const char* data, std::size_t len)
+{
+    const std::size_t capacity = m_buffer.size();
+    if (len >= capacity)
+    {
+        // 只保留最后 capacity 字节
+        m_dropped += m_size + (len - capacity);
+        data += len - capacity;
+        len = capacity;
+        m_head = 0;
+        m_size = 0;
+    }
+    else if (m_size + len > capacity)
+    {
+        const std::size_t overflow = m_size + len - capacity;
+        m_head = (m_head + overflow) % capacity;
+        m_size -= overflow;
+        m_dropped += overflow;
+    }
+
+    std::size_t tail = (m_head + m_size) % capacity;
+    const std::size_t first = std::min(len, capacity - tail);
+    std::copy_n(data, first, m_buffer.data() + tail);
+    std::copy_n(data + first, len - first, m_buffer.data());
+    m_size += len;
+}
+
+std::size_t RingBuffer::peek(std::string& out, std::size_t maxLen) const
+{
+    const std::size_t capacity = m_buffer.size();
+    const std::size_t len = std::min(maxLen, m_size);
+    const std::size_t first = std::min(len, capacity - m_head);
+    out.append(m_buffer.data() + m_head, first);
+    out.append(m_buffer.data(), len - first);
+    return len;
+}
+
+void RingBuffer::consume(std::size_t len)
+{
+    len = std::min(len, m_size);
+    m_head = (m_head + len) % m_buffer.size();
+    m_size -= len;
+}
+
+LogStream::LogStream(
+    trantor::EventLoop* loop,
+    int fd,
+    YSolowork::util::LogFrameHeader identity,
+    const LogStreamOptions& options,
+    ChunkSink sink
+)
+    : m_loop(loop),
+      m_fd(fd),
+      m_header(std::move(identity)),
+      m_options(options),
+      m_sink(std::move(sink)),
+      m_ring(options.buffer_size),
+      m_tokens(static_cast<double>(options.max_bytes_per_second)),
+      m_lastRefill(std::chrono::steady_clock::now())
+{
+#if !defined(_WIN32)
+    ::fcntl(m_fd, F_SETFL, ::fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+    m_channel = std::make_unique<trantor::Channel>(m_loop, m_fd);
+    m_channel->setReadCallback([this]() { onReadable(); });
+    m_channel->enableReading();
+#endif
+}
+
+LogStream::~LogStream()
+{
+    closePipe();
+}
+
+void LogStream::closePipe()
+{
+    if (m_fd < 0)
+    {
+        return;
+    }
+    if (m_channel)
+    {
+        m_channel->disableAll();
+        m_channel->remove();
+    }
+#if !defined(_WIN32)
+    ::close(m_fd);
+#endif
+    m_fd = -1;
+}
+
+void LogStream::onReadable()
+{
+#if !defined(_WIN32)
+    // 每个线程共用一块读缓冲区, 数据立即复制到环形缓冲区
+    thread_local char buffer[64 * 1024];
+    while (m_fd >= 0)
+    {
+        const ssize_t n = ::read(m_fd, buffer, sizeof(buffer));
+        if (n > 0)
+        {
+            m_ring.write(buffer, static_cast<std::size_t>(n));
+            if (m_onMarker)
+            {
+                scanMarkers(buffer, static_cast<std::size_t>(n));
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        // EOF 或错误, 子进程 (及其子进程) 已关闭输出
+        closePipe();
+    }
+#endif
+
+    // 攒够一块时立即上传, 否则等待定时上传
+    if (m_ring.size() >= m_options.chunk_size)
+    {
+        flush();
+    }
+}
+
+void LogStream::setMarkerCallback(std::string prefix, MarkerCallback&& callback)
+{
+    m_markerPrefix = std::move(prefix);
+    m_onMarker = std::move(callback);
+}
+
+void LogStream::scanMarkers(const char* data, std::size_t len)
+{
+    const char* end = data + len;
+    while (data < end)
+    {
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', static_cast<std::size_t>(end - data)));
+        const char* segmentEnd = newline ? newline : end;
+        if (!m_skipLine)
+        {
+            m_line.append(data, segmentEnd);
+            // 前缀不匹配或者行太长时不再保留, 普通输出只比较开头几个字节
+            const std::size_t compared = std::min(m_line.size(), m_markerPrefix.size());
+            if (m_line.compare(0, compared, m_markerPrefix, 0, compared) != 0 || m_line.size() > MARKER_LINE_MAX)
+            {
+                m_skipLine = true;
+                m_line.clear();
+            }
+        }
+        if (!newline)
+        {
+            break;
+        }
+        if (!m_skipLine && m_line.size() >= m_markerPrefix.size())
+        {
+            std::string_view value(m_line);
+            value.remove_prefix(m_markerPrefix.size());
+            if (!value.empty() && value.back() == '\r')
+            {
+                value.remove_suffix(1);
+            }
+            m_onMarker(value);
+        }
+        m_line.clear();
+        m_skipLine = false;
+        data = newline + 1;
+    }
+}
+
+void LogStream::flush()
+{
+    if (m_options.max_bytes_per_second == 0)
+    {
+        send(m_ring.size(), false);
+        return;
+    }
+
+    // 令牌桶: 最多积累 1 秒的配额
+    const auto now = std::chrono::steady_clock::now();
+    const double rate = static_cast<double>(m_options.max_bytes_per_second);
+    m_tokens = std::min(rate, m_tokens + rate * std::chrono::duration<double>(now - m_lastRefill).count());
+    m_lastRefill = now;
+
+    const std::size_t sent = send(static_cast<std::size_t>(m_tokens), false);
+    m_tokens -= static_cast<double>(sent);
+}
+
+void LogStream::finish()
+{
+    if (m_eofSent)
+    {
+        return;
+    }
+    onReadable();
+    // 剩余数据不超过环形缓冲区大小, 不再限速
+    send(m_ring.size(), true);
+}
+
+std::size_t LogStream::send(std::size_t budget, bool eof)
+{
+    std::size_t sent = 0;
+    std::string chunk;
+    while (!m_ring.empty() && sent < budget)
+    {
+        chunk.clear();
+        const std::size_t len = m_ring.peek(chunk, std::min(m_options.chunk_size, budget - sent));
+
+        auto header = m_header;
+        header.dropped = m_ring.dropped();
+        header.eof = eof && len == m_ring.size();
+        if (!m_sink(header, drogon::utils::gzipCompress(chunk.data(), chunk.size())))
+        {
+            // 未连接, 数据留在缓冲区, 溢出时丢弃最旧的部分
+            return sent;
+        }
+
+        if (header.dropped > 0)
+        {
+            spdlog::warn(
+                "Task {} {} dropped {} bytes of output 任务输出溢出, 已丢弃",
+                m_header.task_id, m_header.stream, header.dropped
+            );
+        }
+        m_ring.consume(len);
+        m_ring.resetDropped();
+        ++m_header.seq;
+        sent += len;
+        m_eofSent = header.eof;
+    }
+
+    if (eof && !m_eofSent && m_ring.empty())
+    {
+        // 没有剩余数据, 单独发送结束块
+        auto header = m_header;
+        header.dropped = m_ring.dropped();
+        header.eof = true;
+        if (m_sink(header, {}))
+        {
+            ++m_header.seq;
+            m_eofSent = true;
+        }
+    }
+    return sent;
+}
+
+} // namespace YLineWorker
@@ -0,0 +1,126 @@
+#ifndef YLINEWORKER_LOG_STREAM_H
+#define YLINEWORKER_LOG_STREAM_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <trantor/net/EventLoop.h>
+
+#include "UTlogFrame.h"
+
+namespace trantor {
+class Channel;
+}
+
+namespace YLineWorker {
+
+// 固定容量的环形缓冲区, 写满时覆盖最旧的数据并记录丢弃的字节数
+class RingBuffer {
+public:
+    explicit RingBuffer(std::size_t capacity);
+
+    void write(const char* data, std::size_t len);
+
+    // 复制最多 maxLen 字节到 out (不消费)
+    std::size_t peek(std::string& out, std::size_t maxLen) const;
+
+    // 消费 len 字节
+    void consume(std::size_t len);
+
+    inline std::size_t size() const { return m_size; }
+    inline bool empty() const { return m_size == 0; }
+    inline std::uint64_t dropped() const { return m_dropped; }
+    inline void resetDropped() { m_dropped = 0; }
+
+private:
+    std::vector<char> m_buffer;
+    std::size_t m_head = 0; // 最旧数据的位置
+    std::size_t m_size = 0;
+    std::uint64_t m_dropped = 0;
+};
+
+// 结构体: 日志上传选项
+struct LogStreamOptions {
+    std::size_t chunk_size = 64 * 1024;
+    std::size_t buffer_size = 1024 * 1024;
+    double flush_interval = 0.5;
+    std::size_t max_bytes_per_second = 1024 * 1024;
+};
+
+/*
+任务的一个输出流 (stdout / stderr)
+
+管道设置为非阻塞, 由 EventLoop 通知可读后读入环形缓冲区, 读取永远不会阻塞子进程太久:
+上传跟不上时环形缓冲区覆盖最旧的输出, 而不是停止读取让子进程阻塞在写管道上
+每块上传前用 gzip 压缩, 按令牌桶限速, 避免输出很多的任务占满连接和服务器的 I/O 线程
+*/
+class LogStream {
+public:
+    // 发送一块日志, 未连接到服务器时返回 false, 数据保留在缓冲区中
+    using ChunkSink = std::function<bool(const YSolowork::util::LogFrameHeader&, std::string_view)>;
+    // 以指定前缀开头的输出行 (例如检查点标记), value 为前缀之后的内容
+    using MarkerCallback = std::function<void(std::string_view value)>;
+
+    LogStream(
+        trantor::EventLoop* loop,
+        int fd,
+        YSolowork::util::LogFrameHeader identity,
+        const LogStreamOptions& options,
+        ChunkSink sink
+    );
+    ~LogStream();
+
+    LogStream(const LogStream&) = delete;
+    LogStream& operator=(const LogStream&) = delete;
+
+    // 识别以 prefix 开头的行并回调, 标记行本身也照常上传
+    void setMarkerCallback(std::string prefix, MarkerCallback&& callback);
+
+    // 上传缓冲区中的数据, 受速率限制
+    void flush();
+
+    // 子进程退出后调用: 读完管道中剩余的数据, 不受速率限制全部上传, 并发送结束块
+    void finish();
+
+    // 缓冲区中等待上传的字节数
+    inline std::size_t backlog() const { return m_ring.size(); }
+
+private:
+    trantor::EventLoop* m_loop;
+    int m_fd;
+    std::unique_ptr<trantor::Channel> m_channel;
+    YSolowork::util::LogFrameHeader m_header; // seq 为下一块的序号
+    LogStreamOptions m_options;
+    ChunkSink m_sink;
+    RingBuffer m_ring;
+
+    double m_tokens;
+    std::chrono::steady_clock::time_point m_lastRefill;
+    bool m_eofSent = false;
+
+    std::string m_markerPrefix;
+    MarkerCallback m_onMarker;
+    std::string m_line;                   // 当前行, 只保留可能是标记的行
+    bool m_skipLine = false;              // 当前行不是标记, 跳到下一个换行
+
+    // 在新读入的数据中查找标记行
+    void scanMarkers(const char* data, std::size_t len);
+
+    // 读取管道直到没有数据
+    void onReadable();
+
+    // 关闭管道
+    void closePipe();
+
+    // 上传最多 budget 字节, 返回实际上传的字节数
+    std::size_t send(std::size_t budget, bool eof);
+};
+
+} // namespace YLineWorker
+
+#endif // YLINEWORKER_LOG_STREAM_H
@@ -0,0 +1,152 @@
+#include "outputUploader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+#include <spdlog/spdlog.h>
+#include <trantor/utils/ConcurrentTaskQueue.h>
+
+#include "artifactClient.h"
+
+namespace YLineWorker {
+
+namespace fs = std::filesystem;
+
+std::optional<std::vector<OutputSpec>> parseOutputs(const Json::Value& outputs, std::string& err)
+{
+    std::vector<OutputSpec> result;
+    if (outputs.isNull())
+    {
+        return result;
+    }
+    if (!outputs.isArray())
+    {
+        err = "payload.outputs must be an array";
+        return std::nullopt;
+    }
+
+    for (const auto& output : outputs)
+    {
+        if (!output.isObject() || !output["path"].isString() || !output["dest"].isString())
+        {
+            err = "payload.outputs must contain objects with `path` and `dest` strings";
+            return std::nullopt;
+        }
+        OutputSpec spec{output["path"].asString(), output["dest"].asString()};
+        if (spec.path.empty() || spec.dest.empty())
+        {
+            err = "payload.outputs path and dest must not be empty";
+            return std::nullopt;
+        }
+        result.push_back(std::move(spec));
+    }
+    return result;
+}
+
+OutputUploader::OutputUploader(trantor::EventLoop* loop, std::size_t threads, std::shared_ptr<ArtifactClient> artifacts)
+    : m_loop(loop),
+      m_uploadQueue(std::make_unique<trantor::ConcurrentTaskQueue>(std::max<std::size_t>(1, threads), "OutputUpload")),
+      m_artifacts(std::move(artifacts))
+{
+}
+
+OutputUploader::~OutputUploader()
+{
+    m_uploadQueue->stop();
+}
+
+void OutputUploader::upload(const std::string& cwd, std::vector<OutputSpec> outputs, UploadedCallback&& callback)
+{
+    ++m_pending;
+    m_uploadQueue->runTaskInQueue([this, cwd, outputs = std::move(outputs), callback = std::move(callback)]() mutable {
+        const auto startTime = std::chrono::steady_clock::now();
+        const fs::path workDir = cwd.empty() ? fs::current_path() : fs::path(cwd);
+        std::uint64_t bytes = 0;
+        std::string error;
+
+        for (const auto& output : outputs)
+        {
+            const fs::path source = fs::path(output.path).is_absolute() ? fs::path(output.path) : workDir / output.path;
+            std::error_code ec;
+            if (fs::is_directory(source, ec))
+            {
+                // 目录按相对路径递归上传
+                for (fs::recursive_directory_iterator it(source, ec), end; !ec && it != end; it.increment(ec))
+                {
+                    if (!it->is_regular_file(ec))
+                    {
+                        continue;
+                    }
+                    bytes += uploadFile(it->path(), output.dest + "/" + fs::relative(it->path(), source, ec).generic_string(), error);
+                    if (!error.empty())
+                    {
+                        break;
+                    }
+                }
+                if (ec && error.empty())
+                {
+                    error = "Failed to read output directory 读取输出目录失败 " + source.string() + ": " + ec.message();
+                }
+            }
+            else
+            {
+                bytes += uploadFile(source, output.dest, error);
+            }
+            if (!error.empty())
+            {
+                break;
+            }
+        }
+
+        const double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        m_loop->queueInLoop([this, bytes, duration, error = std::move(error), callback = std::move(callback)]() mutable {
+            --m_pending;
+            callback(bytes, duration, std::move(error));
+        });
+    });
+}
+
+std::uint64_t OutputUploader::uploadFile(const fs::path& source, const std::string& dest, std::string& err) const
+{
+    std::string key;
+    if (!parseArtifactUrl(dest, key))
+    {
+        return copyFile(source, fs::path(dest), err);
+    }
+    std::uint64_t sent = 0;
+    m_artifacts->upload(source, key, sent, err);
+    return sent;
+}
+
+std::uint64_t OutputUploader::copyFile(const fs::path& source, const fs::path& dest, std::string& err)
+{
+    static std::atomic<std::uint64_t> tmpCounter = 0;
+    std::error_code ec;
+    const auto size = fs::file_size(source, ec);
+    if (ec)
+    {
+        err = "Output not found 找不到输出 " + source.string() + ": " + ec.message();
+        return 0;
+    }
+
+    fs::create_directories(dest.parent_path(), ec);
+    fs::path tmp = dest;
+    tmp += ".part" + std::to_string(tmpCounter.fetch_add(1));
+    // libstdc++ 在 Linux 上通过 copy_file_range/sendfile 在内核中复制, 数据不经过用户态
+    fs::copy_file(source, tmp, fs::copy_options::overwrite_existing, ec);
+    if (!ec)
+    {
+        fs::rename(tmp, dest, ec);
+    }
+    if (ec)
+    {
+        std::error_code ignored;
+        fs::remove(tmp, ignored);
+        err = "Failed to upload output 上传输出失败 " + source.string() + " -> " + dest.string() + ": " + ec.message();
+        return 0;
+    }
+    return size;
+}
+
+} // namespace YLineWorker
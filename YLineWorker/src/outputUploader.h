@@ -0,0 +1,71 @@
+#ifndef YLINEWORKER_OUTPUT_UPLOADER_H
+#define YLINEWORKER_OUTPUT_UPLOADER_H
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <json/value.h>
+#include <trantor/net/EventLoop.h>
+
+namespace trantor {
+class ConcurrentTaskQueue;
+}
+
+namespace YLineWorker {
+
+class ArtifactClient;
+
+// 结构体: 任务声明的输出
+struct OutputSpec {
+    std::string path; // 任务产生的文件或目录, 相对路径相对于 cwd
+    std::string dest; // 上传目标, 网络文件服务器上的路径, 或者 artifact://<key> 上传到服务器; 目录会递归上传
+};
+
+// 函数: 解析任务 payload 中的 outputs, 不存在时返回空列表, 格式错误时返回 nullopt 并设置 err
+std::optional<std::vector<OutputSpec>> parseOutputs(const Json::Value& outputs, std::string& err);
+
+/*
+任务输出上传, 在独立的线程池上进行
+
+任务进程退出后立即释放它占用的槽位和资源, 下一个 (输入已经提前准备好的) 任务马上开始计算
+上一个任务的输出同时在上传线程上复制到目标位置, 上传完成后才报告任务结束, 服务器此时才确认消息
+每个文件先写到目标旁边的临时文件再重命名, 读取方不会看到写了一半的输出
+回调在构造时传入的 EventLoop 上调用
+*/
+class OutputUploader {
+public:
+    // 上传完成, 失败时 error 不为空
+    using UploadedCallback = std::function<void(std::uint64_t bytes, double duration, std::string error)>;
+
+    OutputUploader(trantor::EventLoop* loop, std::size_t threads, std::shared_ptr<ArtifactClient> artifacts);
+    ~OutputUploader();
+
+    OutputUploader(const OutputUploader&) = delete;
+    OutputUploader& operator=(const OutputUploader&) = delete;
+
+    void upload(const std::string& cwd, std::vector<OutputSpec> outputs, UploadedCallback&& callback);
+
+    // 正在上传的任务数量
+    inline std::size_t pending() const { return m_pending; }
+
+private:
+    trantor::EventLoop* m_loop;
+    std::unique_ptr<trantor::ConcurrentTaskQueue> m_uploadQueue;
+    std::shared_ptr<ArtifactClient> m_artifacts;
+    std::size_t m_pending = 0;                 // 只在 EventLoop 上修改
+
+    // 上传一个文件, 返回上传的字节数
+    std::uint64_t uploadFile(const std::filesystem::path& source, const std::string& dest, std::string& err) const;
+
+    // 复制一个文件, 返回复制的字节数
+    static std::uint64_t copyFile(const std::filesystem::path& source, const std::filesystem::path& dest, std::string& err);
+};
+
+} // namespace YLineWorker
+
+#endif // YLINEWORKER_OUTPUT_UPLOADER_H
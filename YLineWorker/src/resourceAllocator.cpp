@@ -0,0 +1,301 @@
+#include "resourceAllocator.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "UTmachineInfo.h"
+
+#if defined(__linux__)
+    #include <sched.h>
+#endif
+
+namespace YLineWorker {
+
+// 浮点数记账的容差
+constexpr double RESOURCE_EPSILON = 1e-6;
+
+std::optional<ResourceRequest> parseResourceRequest(const Json::Value& resources, std::string& err)
+{
+    ResourceRequest request;
+    if (resources.isNull())
+    {
+        request.whole_machine = true;
+        return request;
+    }
+    if (!resources.isObject())
+    {
+        err = "payload.resources must be an object";
+        return std::nullopt;
+    }
+
+    if (resources.isMember("cores"))
+    {
+        if (!resources["cores"].isUInt() || resources["cores"].asUInt() == 0)
+        {
+            err = "resources.cores must be a positive integer";
+            return std::nullopt;
+        }
+        request.cores = resources["cores"].asUInt();
+    }
+    if (resources.isMember("ram_gb"))
+    {
+        if (!resources["ram_gb"].isNumeric() || resources["ram_gb"].asDouble() < 0)
+        {
+            err = "resources.ram_gb must be a non-negative number";
+            return std::nullopt;
+        }
+        request.ram_gb = resources["ram_gb"].asDouble();
+    }
+    if (resources.isMember("gpus"))
+    {
+        if (!resources["gpus"].isUInt())
+        {
+            err = "resources.gpus must be a non-negative integer";
+            return std::nullopt;
+        }
+        request.gpus = resources["gpus"].asUInt();
+    }
+    if (resources.isMember("vram_gb"))
+    {
+        if (!resources["vram_gb"].isNumeric() || resources["vram_gb"].asDouble() < 0)
+        {
+            err = "resources.vram_gb must be a non-negative number";
+            return std::nullopt;
+        }
+        request.vram_gb = resources["vram_gb"].asDouble();
+    }
+    return request;
+}
+
+MachineResources detectMachineResources(double ramGB, const std::vector<GpuResource>& gpus)
+{
+    MachineResources resources;
+    resources.ram_gb = ramGB;
+    resources.gpus = gpus;
+
+#if defined(__linux__)
+    // 只使用当前进程允许的核心 (taskset / cgroup cpuset)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (unsigned int core = 0; core < CPU_SETSIZE; ++core)
+        {
+            if (CPU_ISSET(core, &set))
+            {
+                resources.core_ids.push_back(core);
+            }
+        }
+    }
+#endif
+    if (resources.core_ids.empty())
+    {
+        resources.core_ids.resize(std::max(1u, YSolowork::util::getCPUcores()));
+        std::iota(resources.core_ids.begin(), resources.core_ids.end(), 0u);
+    }
+    return resources;
+}
+
+Json::Value resourcesToJson(const MachineResources& resources)
+{
+    Json::Value json;
+    json["cores"] = static_cast<Json::UInt>(resources.core_ids.size());
+    json["ram_gb"] = resources.ram_gb;
+    json["gpus"] = Json::Value(Json::arrayValue);
+    for (const auto& gpu : resources.gpus)
+    {
+        Json::Value gpuJson;
+        gpuJson["index"] = gpu.index;
+        gpuJson["vram_gb"] = gpu.vram_gb;
+        json["gpus"].append(gpuJson);
+    }
+    return json;
+}
+
+ResourceAllocator::ResourceAllocator(MachineResources total)
+    : m_total(std::move(total)),
+      m_coreUsed(m_total.core_ids.size(), false),
+      m_freeRam(m_total.ram_gb)
+{
+    for (const auto& gpu : m_total.gpus)
+    {
+        m_gpus.push_back(GpuState{gpu.index, gpu.vram_gb, gpu.vram_gb});
+    }
+}
+
+ResourceRequest ResourceAllocator::normalize(const ResourceRequest& request) const
+{
+    if (!request.whole_machine)
+    {
+        return request;
+    }
+    return ResourceRequest{
+        .cores = static_cast<unsigned int>(m_total.core_ids.size()),
+        .ram_gb = m_total.ram_gb,
+        .gpus = static_cast<unsigned int>(m_gpus.size()),
+        .vram_gb = 0.0,
+    };
+}
+
+bool ResourceAllocator::fitsMachine(const ResourceRequest& request) const
+{
+    const auto normalized = normalize(request);
+    if (normalized.cores > m_total.core_ids.size() || normalized.ram_gb > m_total.ram_gb + RESOURCE_EPSILON)
+    {
+        return false;
+    }
+    const auto enoughVram = std::count_if(m_gpus.begin(), m_gpus.end(), [&normalized](const GpuState& gpu) {
+        return gpu.total + RESOURCE_EPSILON >= normalized.vram_gb;
+    });
+    return static_cast<std::size_t>(enoughVram) >= normalized.gpus;
+}
+
+std::optional<std::vector<std::size_t>> ResourceAllocator::pickCores(unsigned int count) const
+{
+    // 最短的可容纳连续空闲区间
+    std::size_t bestStart = 0;
+    std::size_t bestLength = 0;
+    for (std::size_t i = 0; i < m_coreUsed.size();)
+    {
+        if (m_coreUsed[i])
+        {
+            ++i;
+            continue;
+        }
+        std::size_t end = i;
+        while (end < m_coreUsed.size() && !m_coreUsed[end])
+        {
+            ++end;
+        }
+        const std::size_t length = end - i;
+        if (length >= count && (bestLength == 0 || length < bestLength))
+        {
+            bestStart = i;
+            bestLength = length;
+        }
+        i = end;
+    }
+
+    std::vector<std::size_t> picked;
+    picked.reserve(count);
+    if (bestLength > 0)
+    {
+        for (std::size_t i = bestStart; i < bestStart + count; ++i)
+        {
+            picked.push_back(i);
+        }
+        return picked;
+    }
+
+    // 没有足够长的连续区间, 选择编号最小的空闲核心
+    for (std::size_t i = 0; i < m_coreUsed.size() && picked.size() < count; ++i)
+    {
+        if (!m_coreUsed[i])
+        {
+            picked.push_back(i);
+        }
+    }
+    if (picked.size() < count)
+    {
+        return std::nullopt;
+    }
+    return picked;
+}
+
+std::optional<std::vector<std::size_t>> ResourceAllocator::pickGpus(unsigned int count, double vram_gb) const
+{
+    std::vector<std::size_t> candidates;
+    for (std::size_t i = 0; i < m_gpus.size(); ++i)
+    {
+        const auto& gpu = m_gpus[i];
+        const bool fits = vram_gb > 0
+            ? gpu.free + RESOURCE_EPSILON >= vram_gb
+            : gpu.users == 0;
+        if (fits)
+        {
+            candidates.push_back(i);
+        }
+    }
+    if (candidates.size() < count)
+    {
+        return std::nullopt;
+    }
+
+    // best-fit: 剩余显存最少的 GPU 优先, 保留空闲的 GPU 给大任务
+    std::sort(candidates.begin(), candidates.end(), [this](std::size_t a, std::size_t b) {
+        return m_gpus[a].free < m_gpus[b].free;
+    });
+    candidates.resize(count);
+    return candidates;
+}
+
+std::optional<Allocation> ResourceAllocator::allocate(const ResourceRequest& request)
+{
+    const auto normalized = normalize(request);
+    if (normalized.ram_gb > m_freeRam + RESOURCE_EPSILON)
+    {
+        return std::nullopt;
+    }
+    auto cores = pickCores(normalized.cores);
+    if (!cores)
+    {
+        return std::nullopt;
+    }
+    auto gpus = pickGpus(normalized.gpus, normalized.vram_gb);
+    if (!gpus)
+    {
+        return std::nullopt;
+    }
+
+    Allocation allocation;
+    allocation.ram_gb = normalized.ram_gb;
+    allocation.vram_gb = normalized.vram_gb;
+    allocation.exclusive_gpu = normalized.vram_gb <= 0;
+
+    m_freeRam -= normalized.ram_gb;
+    for (const auto i : *cores)
+    {
+        m_coreUsed[i] = true;
+        allocation.cores.push_back(m_total.core_ids[i]);
+    }
+    for (const auto i : *gpus)
+    {
+        auto& gpu = m_gpus[i];
+        gpu.free = allocation.exclusive_gpu ? 0.0 : gpu.free - normalized.vram_gb;
+        ++gpu.users;
+        allocation.gpus.push_back(gpu.index);
+    }
+    return allocation;
+}
+
+void ResourceAllocator::release(const Allocation& allocation)
+{
+    m_freeRam = std::min(m_total.ram_gb, m_freeRam + allocation.ram_gb);
+    for (const auto core : allocation.cores)
+    {
+        const auto it = std::find(m_total.core_ids.begin(), m_total.core_ids.end(), core);
+        if (it != m_total.core_ids.end())
+        {
+            m_coreUsed[static_cast<std::size_t>(it - m_total.core_ids.begin())] = false;
+        }
+    }
+    for (const auto index : allocation.gpus)
+    {
+        for (auto& gpu : m_gpus)
+        {
+            if (gpu.index != index)
+            {
+                continue;
+            }
+            gpu.free = allocation.exclusive_gpu ? gpu.total : std::min(gpu.total, gpu.free + allocation.vram_gb);
+            gpu.users = gpu.users > 0 ? gpu.users - 1 : 0;
+        }
+    }
+}
+
+std::size_t ResourceAllocator::freeCores() const
+{
+    return static_cast<std::size_t>(std::count(m_coreUsed.begin(), m_coreUsed.end(), false));
+}
+
+} // namespace YLineWorker
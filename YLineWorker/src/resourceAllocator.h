@@ -0,0 +1,104 @@
+#ifndef YLINEWORKER_RESOURCE_ALLOCATOR_H
+#define YLINEWORKER_RESOURCE_ALLOCATOR_H
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <json/value.h>
+
+namespace YLineWorker {
+
+// 结构体: 任务声明的资源需求
+struct ResourceRequest {
+    unsigned int cores = 1;
+    double ram_gb = 0.0;
+    unsigned int gpus = 0;
+    double vram_gb = 0.0;       // 每块 GPU 需要的显存, 0 表示独占整块 GPU
+    bool whole_machine = false; // 未声明资源的任务独占整台机器, 与之前的行为一致
+};
+
+// 结构体: GPU 资源
+struct GpuResource {
+    unsigned int index; // nvml 索引
+    double vram_gb;
+};
+
+// 结构体: 工作机可分配的资源
+struct MachineResources {
+    std::vector<unsigned int> core_ids; // 当前进程允许使用的逻辑核心
+    double ram_gb = 0.0;
+    std::vector<GpuResource> gpus;
+};
+
+// 结构体: 分配给一个任务的资源
+struct Allocation {
+    std::vector<unsigned int> cores; // 逻辑核心编号, 用于设置 CPU 亲和性
+    double ram_gb = 0.0;
+    std::vector<unsigned int> gpus;  // nvml 索引, 用于设置 CUDA_VISIBLE_DEVICES
+    double vram_gb = 0.0;            // 每块 GPU
+    bool exclusive_gpu = false;
+};
+
+// 函数: 解析任务 payload 中的 resources, 不存在时返回整台机器的需求, 格式错误时返回 nullopt 并设置 err
+std::optional<ResourceRequest> parseResourceRequest(const Json::Value& resources, std::string& err);
+
+// 函数: 探测本机资源
+MachineResources detectMachineResources(double ramGB, const std::vector<GpuResource>& gpus);
+
+// 函数: 资源的 JSON 表示, 注册时上报给服务器
+Json::Value resourcesToJson(const MachineResources& resources);
+
+/*
+工作机资源分配器, 将任务装箱 (bin-packing) 到 CPU 核心, 内存和 GPU 上
+
+- 核心: 优先选择能容纳需求的最短连续空闲区间 (best-fit), 保留大的连续区间给大任务; 没有连续区间时选择编号最小的空闲核心
+- GPU: vram_gb > 0 时可以与其他任务共享, 选择剩余显存最少且足够的 GPU (best-fit); vram_gb = 0 时独占空闲的 GPU
+- 内存: 只做记账, 不做强制限制
+
+所有函数都需要在执行器的 EventLoop 上调用
+*/
+class ResourceAllocator {
+public:
+    explicit ResourceAllocator(MachineResources total);
+
+    inline const MachineResources& total() const { return m_total; }
+
+    // 空闲时能否容纳该需求, 不能容纳的任务应该交给其他工作机
+    bool fitsMachine(const ResourceRequest& request) const;
+
+    // 分配资源, 当前资源不足时返回 nullopt
+    std::optional<Allocation> allocate(const ResourceRequest& request);
+
+    // 释放资源
+    void release(const Allocation& allocation);
+
+    // 空闲核心数
+    std::size_t freeCores() const;
+
+private:
+    struct GpuState {
+        unsigned int index;
+        double total;
+        double free;
+        unsigned int users = 0;
+    };
+
+    MachineResources m_total;
+    std::vector<bool> m_coreUsed; // 与 m_total.core_ids 一一对应
+    double m_freeRam;
+    std::vector<GpuState> m_gpus;
+
+    // 整台机器的需求转换为具体数量
+    ResourceRequest normalize(const ResourceRequest& request) const;
+
+    // 选择核心, 返回 core_ids 的下标
+    std::optional<std::vector<std::size_t>> pickCores(unsigned int count) const;
+
+    // 选择 GPU, 返回 m_gpus 的下标
+    std::optional<std::vector<std::size_t>> pickGpus(unsigned int count, double vram_gb) const;
+};
+
+} // namespace YLineWorker
+
+#endif // YLINEWORKER_RESOURCE_ALLOCATOR_H
@@ -0,0 +1,803 @@
+#include "taskExecutor.h"
+
+#include <algorithm>
+#include <system_error>
+
+#include <spdlog/spdlog.h>
+#include <trantor/net/Channel.h>
+
+#include "UTartifact.h"
+
+#include <boost/process.hpp>
+
+#if !defined(_WIN32)
+    #include <boost/process/extend.hpp>
+    #include <boost/process/posix.hpp>
+    #include <csignal>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+#if defined(__linux__)
+    #include <sched.h>
+#endif
+#if defined(__linux__)
+    #include <sys/syscall.h>
+#endif
+
+namespace YLineWorker {
+
+namespace bp = boost::process;
+
+// 无法使用 pidfd 时检查子进程是否退出的间隔 (秒)
+constexpr double REAP_POLL_INTERVAL = 0.2;
+
+struct TaskExecutor::Running {
+    TaskSpec spec;
+    FinishedCallback onFinished;
+    bp::child child;
+    std::chrono::steady_clock::time_point startTime;
+
+    int pidfd = -1;
+    std::unique_ptr<trantor::Channel> channel;
+    std::optional<trantor::TimerId> pollTimer;
+
+    std::vector<std::unique_ptr<LogStream>> logs; // stdout, stderr
+    Allocation allocation;
+    bool cancelled = false;
+    std::optional<trantor::TimerId> killTimer;    // 取消后的 SIGKILL 期限
+};
+
+#if !defined(_WIN32)
+// 创建输出管道, 两端都设置 close-on-exec, 子进程中由 dup2 得到的 1/2 号描述符不受影响
+static bool makeOutputPipe(int fds[2], std::error_code& ec)
+{
+    if (::pipe(fds) != 0)
+    {
+        ec = std::error_code(errno, std::system_category());
+        return false;
+    }
+    ::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    ::fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+}
+#endif
+
+std::optional<TaskSpec> parseTaskSpec(const Json::Value& dispatch, std::string& err)
+{
+    const Json::Value& task = dispatch["task"];
+    const Json::Value& payload = task["payload"];
+
+    if (!dispatch["delivery_tag"].isUInt64())
+    {
+        err = "missing delivery_tag";
+        return std::nullopt;
+    }
+    if (!payload["cmd"].isArray() || payload["cmd"].empty())
+    {
+        err = "payload.cmd must be a non-empty array";
+        return std::nullopt;
+    }
+
+    TaskSpec spec;
+    spec.delivery_tag = dispatch["delivery_tag"].asUInt64();
+    spec.generation = dispatch["generation"].asUInt64();
+    spec.task_id = task["task_id"].asString();
+    spec.job_id = task["job_id"].asInt64();
+
+    for (const auto& arg : payload["cmd"])
+    {
+        if (!arg.isString())
+        {
+            err = "payload.cmd must only contain strings";
+            return std::nullopt;
+        }
+        spec.cmd.push_back(arg.asString());
+    }
+
+    if (payload["cwd"].isString())
+    {
+        spec.cwd = payload["cwd"].asString();
+    }
+
+    if (payload["env"].isObject())
+    {
+        for (const auto& name : payload["env"].getMemberNames())
+        {
+            spec.env[name] = payload["env"][name].asString();
+        }
+    }
+
+    auto resources = parseResourceRequest(payload["resources"], err);
+    if (!resources)
+    {
+        return std::nullopt;
+    }
+    spec.resources = *resources;
+
+    auto inputs = parseInputs(payload["inputs"], err);
+    if (!inputs)
+    {
+        return std::nullopt;
+    }
+    spec.inputs = std::move(*inputs);
+
+    auto outputs = parseOutputs(payload["outputs"], err);
+    if (!outputs)
+    {
+        return std::nullopt;
+    }
+    spec.outputs = std::move(*outputs);
+
+    // 服务器记录的最新检查点, 只有重新入队的任务才有
+    const Json::Value& checkpoint = dispatch["checkpoint"];
+    if (checkpoint["key"].isString() && YSolowork::util::isValidArtifactKey(checkpoint["key"].asString()))
+    {
+        spec.resume_checkpoint = checkpoint["key"].asString();
+        spec.inputs.push_back(InputSpec{.path = std::string(YSolowork::util::ARTIFACT_SCHEME) + spec.resume_checkpoint});
+    }
+
+    return spec;
+}
+
+std::size_t deriveTaskSlots(
+    const MachineResources& resources,
+    std::uint32_t configuredSlots,
+    std::uint32_t cpuCoresPerSlot
+)
+{
+    // 1. 配置文件指定
+    if (configuredSlots > 0)
+    {
+        return configuredSlots;
+    }
+
+    const std::size_t cores = std::max<std::size_t>(1, resources.core_ids.size());
+
+    // 2. 按 CPU 核心数划分
+    if (cpuCoresPerSlot > 0)
+    {
+        return std::max<std::size_t>(1, cores / cpuCoresPerSlot);
+    }
+
+    // 3. 每个任务至少占用一个核心, 实际并发由资源分配器决定
+    return cores;
+}
+
+TaskExecutor::TaskExecutor(
+    trantor::EventLoop* loop,
+    std::size_t slots,
+    std::size_t lookahead,
+    MachineResources resources,
+    const LogStreamOptions& logOptions,
+    LogStream::ChunkSink logSink
+)
+    : m_allocator(std::move(resources)),
+      m_loop(loop),
+      m_slots(std::max<std::size_t>(1, slots)),
+      m_lookahead(lookahead),
+      m_logOptions(logOptions),
+      m_logSink(std::move(logSink))
+{
+    // 定时上传所有任务的输出
+    m_logFlushTimer = m_loop->runEvery(m_logOptions.flush_interval, [this]() {
+        for (auto* tasks : {&m_running, &m_terminating})
+        {
+            for (auto& [deliveryTag, running] : *tasks)
+            {
+                for (auto& log : running->logs)
+                {
+                    log->flush();
+                }
+            }
+        }
+    });
+}
+
+TaskExecutor::~TaskExecutor()
+{
+    m_loop->invalidateTimer(m_logFlushTimer);
+
+    // 子进程随 worker 一起退出, 不留下孤儿进程
+    for (auto* tasks : {&m_running, &m_terminating})
+    {
+        for (auto& [deliveryTag, running] : *tasks)
+        {
+#if !defined(_WIN32)
+            signalTask(*running, SIGKILL);
+#endif
+            std::error_code ec;
+            running->child.terminate(ec);
+            if (running->killTimer)
+            {
+                m_loop->invalidateTimer(*running->killTimer);
+            }
+            if (running->channel)
+            {
+                running->channel->disableAll();
+                running->channel->remove();
+            }
+#if defined(__linux__)
+            if (running->pidfd >= 0)
+            {
+                ::close(running->pidfd);
+            }
+#endif
+        }
+    }
+}
+
+std::vector<RunningTaskInfo> TaskExecutor::runningTasks() const
+{
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<RunningTaskInfo> tasks;
+    tasks.reserve(m_running.size() + m_terminating.size());
+    for (const auto* group : {&m_running, &m_terminating})
+    {
+        for (const auto& [deliveryTag, running] : *group)
+        {
+            RunningTaskInfo info;
+            info.delivery_tag = deliveryTag;
+            info.task_id = running->spec.task_id;
+            info.job_id = running->spec.job_id;
+            info.pid = static_cast<int>(running->child.id());
+            info.runtime = std::chrono::duration<double>(now - running->startTime).count();
+            for (const auto& log : running->logs)
+            {
+                info.log_backlog += log->backlog();
+            }
+            info.cancelled = running->cancelled;
+            tasks.push_back(std::move(info));
+        }
+    }
+    return tasks;
+}
+
+std::size_t TaskExecutor::logBacklog() const
+{
+    std::size_t backlog = 0;
+    for (const auto* group : {&m_running, &m_terminating})
+    {
+        for (const auto& [deliveryTag, running] : *group)
+        {
+            for (const auto& log : running->logs)
+            {
+                backlog += log->backlog();
+            }
+        }
+    }
+    return backlog;
+}
+
+bool TaskExecutor::submit(TaskSpec&& spec, StartedCallback&& onStarted, FinishedCallback&& onFinished)
+{
+    if (!hasFreeSlot())
+    {
+        return false;
+    }
+
+    if (!m_allocator.fitsMachine(spec.resources))
+    {
+        spdlog::warn("Task {} requests more resources than this worker has 任务需要的资源超过本工作机总量", spec.task_id);
+        return false;
+    }
+
+    const std::uint64_t deliveryTag = spec.delivery_tag;
+    const TaskSpec* existing = nullptr;
+    if (const auto it = m_running.find(deliveryTag); it != m_running.end())
+    {
+        existing = &it->second->spec;
+    }
+    else if (const auto it = m_terminating.find(deliveryTag); it != m_terminating.end())
+    {
+        existing = &it->second->spec;
+    }
+    else if (const auto it = std::find_if(m_queue.begin(), m_queue.end(), [deliveryTag](const Queued& task) {
+                 return task.spec.delivery_tag == deliveryTag;
+             });
+             it != m_queue.end())
+    {
+        existing = &it->spec;
+    }
+    if (existing)
+    {
+        if (existing->generation == spec.generation && existing->task_id == spec.task_id && !m_terminating.contains(deliveryTag))
+        {
+            spdlog::warn("Task {} is already accepted, ignoring duplicate dispatch 任务已接收, 忽略重复分发", spec.task_id);
+            return true;
+        }
+        // 服务器重建 Channel 后 delivery tag 重新编号, 旧任务还在运行 (或等待回收) 时不能用同一个 tag 接收新任务
+        spdlog::warn(
+            "Delivery tag {} of Task {} (generation {}) is held by Task {} (generation {}), rejecting delivery tag 已被其他任务占用, 拒绝任务",
+            deliveryTag, spec.task_id, spec.generation, existing->task_id, existing->generation
+        );
+        return false;
+    }
+
+    const bool ready = spec.inputs.empty();
+    m_queue.push_back(Queued{std::move(spec), std::move(onStarted), std::move(onFinished), ready});
+    schedule();
+    return true;
+}
+
+bool TaskExecutor::inputsStaged(std::uint64_t deliveryTag, const std::vector<std::filesystem::path>& localPaths, const std::string& error)
+{
+    const auto it = std::find_if(m_queue.begin(), m_queue.end(), [deliveryTag](const Queued& task) {
+        return task.spec.delivery_tag == deliveryTag;
+    });
+    if (it == m_queue.end())
+    {
+        return false;
+    }
+
+    if (!error.empty())
+    {
+        Queued task = std::move(*it);
+        m_queue.erase(it);
+        spdlog::error("Task {} failed to stage inputs 任务输入准备失败: {}", task.spec.task_id, error);
+        task.onFinished(TaskResult{
+            .delivery_tag = deliveryTag,
+            .generation = task.spec.generation,
+            .task_id = task.spec.task_id,
+            .job_id = task.spec.job_id,
+            .error = error,
+        });
+        return true;
+    }
+
+    std::size_t inputCount = localPaths.size();
+    if (!it->spec.resume_checkpoint.empty() && inputCount > 0)
+    {
+        --inputCount;
+        it->spec.env["YLINE_CHECKPOINT_RESUME"] = localPaths.back().string();
+    }
+    for (std::size_t i = 0; i < inputCount; ++i)
+    {
+        it->spec.env["YLINE_INPUT_" + std::to_string(i)] = localPaths[i].string();
+    }
+    it->ready = true;
+    schedule();
+    return true;
+}
+
+void TaskExecutor::schedule()
+{
+    // 按到达顺序尝试, 放不下的任务留在队列中, 后面较小的任务可以先启动
+    for (auto it = m_queue.begin(); it != m_queue.end();)
+    {
+        if (!it->ready)
+        {
+            ++it;
+            continue;
+        }
+        auto allocation = m_allocator.allocate(it->spec.resources);
+        if (!allocation)
+        {
+            ++it;
+            continue;
+        }
+        Queued task = std::move(*it);
+        it = m_queue.erase(it);
+        start(std::move(task), std::move(*allocation));
+    }
+
+    if (!m_queue.empty())
+    {
+        SPDLOG_DEBUG(
+            "{} tasks waiting for resources, {} cores free 任务等待资源",
+            m_queue.size(), m_allocator.freeCores()
+        );
+    }
+}
+
+#if !defined(_WIN32)
+// 子进程成为新进程组的组长, 取消时信号发给整个进程组, 任务启动的子进程 (渲染器, 脚本) 一起结束
+struct ProcessGroup : bp::extend::handler {
+    template<typename Executor>
+    void on_exec_setup(Executor&) const
+    {
+        ::setpgid(0, 0);
+    }
+};
+#endif
+
+#if defined(__linux__)
+// 在子进程 exec 之前绑定 CPU 核心, 子进程及其创建的线程都继承该亲和性
+struct CpuAffinity : bp::extend::handler {
+    std::vector<unsigned int> cores;
+
+    template<typename Executor>
+    void on_exec_setup(Executor&) const
+    {
+        if (cores.empty())
+        {
+            return;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (const auto core : cores)
+        {
+            CPU_SET(core, &set);
+        }
+        ::sched_setaffinity(0, sizeof(set), &set);
+    }
+};
+#endif
+
+void TaskExecutor::start(Queued&& task, Allocation&& allocation)
+{
+    TaskSpec& spec = task.spec;
+    const std::uint64_t deliveryTag = spec.delivery_tag;
+    const auto startTime = std::chrono::steady_clock::now();
+
+    TaskResult failed{
+        .delivery_tag = deliveryTag,
+        .generation = spec.generation,
+        .task_id = spec.task_id,
+        .job_id = spec.job_id,
+    };
+    auto fail = [this, &task, &allocation, &failed](std::string error) {
+        failed.error = std::move(error);
+        spdlog::error("Task {} failed to start 任务启动失败: {}", failed.task_id, failed.error);
+        m_allocator.release(allocation);
+        task.onFinished(failed);
+    };
+
+    // 没有路径分隔符时在 PATH 中查找可执行文件
+    boost::filesystem::path exe = spec.cmd.front();
+    if (!exe.has_parent_path())
+    {
+        exe = bp::search_path(spec.cmd.front());
+    }
+    if (exe.empty())
+    {
+        fail("Executable not found 找不到可执行文件: " + spec.cmd.front());
+        return;
+    }
+
+    // 复制当前环境变量, 只影响子进程
+    bp::environment env = boost::this_process::environment();
+    for (const auto& [name, value] : spec.env)
+    {
+        env[name] = value;
+    }
+
+    // 只暴露分配的 GPU, 未申请 GPU 的任务看不到任何 GPU
+    // 分配使用 nvml 索引, 需要 CUDA 也按 PCI 总线顺序编号才能对应
+    if (!m_allocator.total().gpus.empty())
+    {
+        std::string visible;
+        for (const auto index : allocation.gpus)
+        {
+            visible += (visible.empty() ? "" : ",") + std::to_string(index);
+        }
+        env["CUDA_DEVICE_ORDER"] = "PCI_BUS_ID";
+        env["CUDA_VISIBLE_DEVICES"] = visible;
+    }
+
+    const std::vector<std::string> args(spec.cmd.begin() + 1, spec.cmd.end());
+    const std::string cwd = spec.cwd.empty() ? boost::filesystem::current_path().string() : spec.cwd;
+
+    std::error_code ec;
+#if !defined(_WIN32)
+    int outPipe[2] = {-1, -1};
+    int errPipe[2] = {-1, -1};
+    if (!makeOutputPipe(outPipe, ec) || !makeOutputPipe(errPipe, ec))
+    {
+        for (int fd : {outPipe[0], outPipe[1]})
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+        }
+        fail(ec.message());
+        return;
+    }
+
+#if defined(__linux__)
+    CpuAffinity affinity;
+    affinity.cores = allocation.cores;
+#endif
+
+    bp::child child(
+        bp::exe = exe,
+        bp::args = args,
+        bp::start_dir = cwd,
+        bp::env = env,
+        bp::std_in < bp::null,
+        bp::posix::fd.bind(STDOUT_FILENO, outPipe[1]),
+        bp::posix::fd.bind(STDERR_FILENO, errPipe[1]),
+        ProcessGroup{},
+#if defined(__linux__)
+        affinity,
+#endif
+        ec
+    );
+
+    // 父进程只保留读端, 子进程退出后读端才能读到 EOF
+    ::close(outPipe[1]);
+    ::close(errPipe[1]);
+    if (ec)
+    {
+        ::close(outPipe[0]);
+        ::close(errPipe[0]);
+    }
+#else
+    bp::child child(
+        bp::exe = exe,
+        bp::args = args,
+        bp::start_dir = cwd,
+        bp::env = env,
+        bp::std_in < bp::null,
+        bp::std_out > bp::null,
+        bp::std_err > bp::null,
+        ec
+    );
+#endif
+
+    if (ec)
+    {
+        fail(ec.message());
+        return;
+    }
+
+    const int pid = static_cast<int>(child.id());
+    spdlog::info(
+        "Task {} started 任务已启动, pid: {}, cores 核心: {}, gpus: {}",
+        spec.task_id, pid, allocation.cores.size(), allocation.gpus.size()
+    );
+
+    auto running = std::make_unique<Running>();
+    running->spec = std::move(spec);
+    running->onFinished = std::move(task.onFinished);
+    running->child = std::move(child);
+    running->startTime = startTime;
+    running->allocation = std::move(allocation);
+
+#if !defined(_WIN32)
+    YSolowork::util::LogFrameHeader identity{
+        .delivery_tag = deliveryTag,
+        .task_id = running->spec.task_id,
+        .job_id = running->spec.job_id,
+        .generation = running->spec.generation,
+    };
+    identity.stream = "stdout";
+    running->logs.push_back(std::make_unique<LogStream>(m_loop, outPipe[0], identity, m_logOptions, m_logSink));
+    running->logs.back()->setMarkerCallback(std::string(CHECKPOINT_MARKER), [this, deliveryTag, cwd](std::string_view value) {
+        const auto it = m_running.find(deliveryTag);
+        if (it == m_running.end() || !m_onCheckpoint || value.empty())
+        {
+            return;
+        }
+        std::filesystem::path file(value);
+        if (file.is_relative())
+        {
+            file = std::filesystem::path(cwd) / file;
+        }
+        m_onCheckpoint(it->second->spec, std::move(file));
+    });
+    identity.stream = "stderr";
+    running->logs.push_back(std::make_unique<LogStream>(m_loop, errPipe[0], identity, m_logOptions, m_logSink));
+#endif
+
+    auto& ref = *running;
+    m_running.emplace(deliveryTag, std::move(running));
+    watch(deliveryTag, ref);
+
+    if (task.onStarted)
+    {
+        task.onStarted(ref.spec, pid, ref.allocation);
+    }
+}
+
+void TaskExecutor::watch(std::uint64_t deliveryTag, Running& running)
+{
+#if defined(__linux__) && defined(SYS_pidfd_open)
+    // pidfd 在子进程退出时变为可读, 由 EventLoop 的 poller 通知, 不需要阻塞等待或 SIGCHLD
+    const int pidfd = static_cast<int>(::syscall(SYS_pidfd_open, running.child.id(), 0));
+    if (pidfd >= 0)
+    {
+        running.pidfd = pidfd;
+        running.channel = std::make_unique<trantor::Channel>(m_loop, pidfd);
+        running.channel->setReadCallback([this, deliveryTag]() { tryReap(deliveryTag); });
+        running.channel->enableReading();
+        return;
+    }
+    spdlog::debug("pidfd_open unavailable, polling task process pidfd_open 不可用, 定时检查任务进程");
+#endif
+
+    running.pollTimer = m_loop->runEvery(REAP_POLL_INTERVAL, [this, deliveryTag]() { tryReap(deliveryTag); });
+}
+
+bool TaskExecutor::cancel(std::uint64_t deliveryTag, std::uint64_t generation, double grace, bool preempt)
+{
+    // 旧 Channel 的取消指令不能结束占用相同 tag 的其他任务
+    const auto queued = std::find_if(m_queue.begin(), m_queue.end(), [deliveryTag, generation](const Queued& task) {
+        return task.spec.delivery_tag == deliveryTag && task.spec.generation == generation;
+    });
+    if (queued != m_queue.end())
+    {
+        Queued task = std::move(*queued);
+        m_queue.erase(queued);
+        spdlog::info("Queued task {} cancelled 排队中的任务已取消", task.spec.task_id);
+        task.onFinished(TaskResult{
+            .delivery_tag = deliveryTag,
+            .generation = task.spec.generation,
+            .task_id = task.spec.task_id,
+            .job_id = task.spec.job_id,
+            .cancelled = true,
+            .preempted = preempt,
+            .error = preempt ? "preempted" : "cancelled",
+        });
+        return true;
+    }
+
+    const auto it = m_running.find(deliveryTag);
+    if (it == m_running.end() || it->second->spec.generation != generation)
+    {
+        // 已经在取消中
+        const auto terminating = m_terminating.find(deliveryTag);
+        return terminating != m_terminating.end() && terminating->second->spec.generation == generation;
+    }
+    std::unique_ptr<Running> running = std::move(it->second);
+    m_running.erase(it);
+    running->cancelled = true;
+    spdlog::info(
+        "{} task {}, SIGKILL in {:.1f}s 正在{}任务",
+        preempt ? "Pre-empting" : "Cancelling", running->spec.task_id, grace, preempt ? "抢占" : "取消"
+    );
+
+    // 先礼后兵: SIGTERM 让任务有机会保存检查点并清理, 宽限期后 SIGKILL
+#if !defined(_WIN32)
+    signalTask(*running, grace > 0 ? SIGTERM : SIGKILL);
+    if (grace > 0)
+    {
+        running->killTimer = m_loop->runAfter(grace, [this, deliveryTag]() {
+            const auto it = m_terminating.find(deliveryTag);
+            if (it != m_terminating.end())
+            {
+                spdlog::warn("Task {} ignored SIGTERM, killing 任务未响应 SIGTERM, 强制结束", it->second->spec.task_id);
+                it->second->killTimer.reset();
+                signalTask(*it->second, SIGKILL);
+            }
+        });
+    }
+#else
+    signalTask(*running, 0);
+#endif
+
+    // 不等待进程退出, 立即释放资源并报告, 进程在 m_terminating 中等待回收
+    TaskResult result{
+        .delivery_tag = deliveryTag,
+        .generation = running->spec.generation,
+        .task_id = running->spec.task_id,
+        .job_id = running->spec.job_id,
+        .exit_code = -1,
+        .spawned = true,
+        .cancelled = true,
+        .preempted = preempt,
+        .error = preempt ? "preempted" : "cancelled",
+        .duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - running->startTime).count(),
+    };
+    m_allocator.release(running->allocation);
+    auto onFinished = std::move(running->onFinished);
+    m_terminating[deliveryTag] = std::move(running);
+
+    onFinished(result);
+    schedule();
+
+    // 进程可能已经退出
+    tryReap(deliveryTag);
+    return true;
+}
+
+void TaskExecutor::signalTask(Running& running, int sig)
+{
+#if !defined(_WIN32)
+    const pid_t pid = static_cast<pid_t>(running.child.id());
+    if (pid <= 0)
+    {
+        return;
+    }
+    // 进程组不存在时 (setpgid 之前就被取消) 退化为只发给子进程
+    if (::kill(-pid, sig) != 0)
+    {
+        ::kill(pid, sig);
+    }
+#else
+    std::error_code ec;
+    running.child.terminate(ec);
+    if (ec)
+    {
+        spdlog::warn("Failed to terminate task {} 结束任务进程失败: {}", running.spec.task_id, ec.message());
+    }
+#endif
+}
+
+void TaskExecutor::tryReap(std::uint64_t deliveryTag)
+{
+    // 已取消的任务已经报告过结果, 只需要回收进程
+    auto* tasks = &m_running;
+    auto it = m_running.find(deliveryTag);
+    if (it == m_running.end())
+    {
+        tasks = &m_terminating;
+        it = m_terminating.find(deliveryTag);
+        if (it == m_terminating.end())
+        {
+            return;
+        }
+    }
+    const bool terminating = tasks == &m_terminating;
+    Running& running = *it->second;
+
+    // running() 内部为非阻塞 waitpid, 进程退出时会记录退出码
+    std::error_code ec;
+    if (running.child.running(ec) && !ec)
+    {
+        return;
+    }
+
+    TaskResult result{
+        .delivery_tag = deliveryTag,
+        .generation = running.spec.generation,
+        .task_id = running.spec.task_id,
+        .job_id = running.spec.job_id,
+        .exit_code = ec || running.cancelled ? -1 : running.child.exit_code(),
+        .spawned = true,
+        .cancelled = running.cancelled,
+        .error = running.cancelled ? "cancelled" : ec ? ec.message() : std::string{},
+        .duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - running.startTime).count(),
+    };
+
+    // 停止退出通知
+    if (running.channel)
+    {
+        running.channel->disableAll();
+        running.channel->remove();
+    }
+    if (running.pollTimer)
+    {
+        m_loop->invalidateTimer(*running.pollTimer);
+    }
+    if (running.killTimer)
+    {
+        m_loop->invalidateTimer(*running.killTimer);
+    }
+#if defined(__linux__)
+    if (running.pidfd >= 0)
+    {
+        ::close(running.pidfd);
+        running.pidfd = -1;
+    }
+#endif
+
+    // 先上传剩余的输出, 服务器收到 taskFinished 时日志已经完整
+    for (auto& log : running.logs)
+    {
+        log->finish();
+    }
+
+    // 当前可能在 Channel 自己的回调中, 延后到下一轮事件循环再销毁
+    std::shared_ptr<Running> finished(std::move(it->second));
+    tasks->erase(it);
+    m_loop->queueInLoop([finished]() {});
+
+    if (terminating)
+    {
+        spdlog::info("Cancelled task {} exited 已取消的任务进程已退出", result.task_id);
+        return;
+    }
+    m_allocator.release(finished->allocation);
+
+    spdlog::info(
+        "Task {} exited 任务已退出, exit code 退出码: {}, duration 耗时: {:.3f}s",
+        result.task_id, result.exit_code, result.duration
+    );
+    finished->onFinished(result);
+
+    // 资源已释放, 启动排队中的任务
+    schedule();
+}
+
+} // namespace YLineWorker
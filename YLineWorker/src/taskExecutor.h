@@ -0,0 +1,186 @@
+#ifndef YLINEWORKER_TASK_EXECUTOR_H
+#define YLINEWORKER_TASK_EXECUTOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <json/value.h>
+#include <trantor/net/EventLoop.h>
+
+#include "assetCache.h"
+#include "logStream.h"
+#include "outputUploader.h"
+#include "resourceAllocator.h"
+
+namespace YLineWorker {
+
+// 结构体: 服务器分发的任务
+struct TaskSpec {
+    std::uint64_t delivery_tag = 0;        // AMQP delivery tag, 完成时用于确认
+    std::uint64_t generation = 0;          // 服务器 Channel 的代数, delivery tag 只在同一代内唯一, 报告时原样带回
+    std::string task_id;
+    std::int64_t job_id = 0;
+    std::vector<std::string> cmd;          // 可执行文件 + 参数
+    std::string cwd;                       // 空表示继承工作机的工作目录
+    std::unordered_map<std::string, std::string> env; // 追加到工作机环境变量
+    ResourceRequest resources;
+    std::vector<InputSpec> inputs;         // 输入文件, 由缓存准备好之后才启动
+    std::vector<OutputSpec> outputs;       // 输出, 进程退出后上传
+    std::string resume_checkpoint;         // 重新入队的任务从该检查点 (artifact key) 恢复, 作为最后一个输入下载
+};
+
+// 任务输出中的检查点标记: 单独一行 "YLINE_CHECKPOINT <path>", 相对路径相对于任务工作目录
+// 标记之后任务不应再修改该文件, 下一个检查点写到新文件, 或者写临时文件后重命名覆盖
+inline constexpr std::string_view CHECKPOINT_MARKER = "YLINE_CHECKPOINT ";
+
+// 结构体: 任务执行结果
+struct TaskResult {
+    std::uint64_t delivery_tag = 0;
+    std::uint64_t generation = 0;
+    std::string task_id;
+    std::int64_t job_id = 0;
+    int exit_code = -1;
+    bool spawned = false;                  // false 表示进程没有启动, error 中为原因
+    bool cancelled = false;                // 被服务器取消
+    bool preempted = false;                // 被服务器抢占, 服务器会重新入队
+    std::string error;
+    double duration = 0.0;                 // 秒
+};
+
+// 结构体: 运行中任务的状态, 用于本地状态接口
+struct RunningTaskInfo {
+    std::uint64_t delivery_tag = 0;
+    std::string task_id;
+    std::int64_t job_id = 0;
+    int pid = 0;
+    double runtime = 0.0;                  // 秒
+    std::size_t log_backlog = 0;           // 等待上传的日志字节数
+    bool cancelled = false;                // 已取消, 等待进程退出
+};
+
+// 函数: 从 dispatch 消息解析任务, 失败时返回 nullopt 并设置 err
+std::optional<TaskSpec> parseTaskSpec(const Json::Value& dispatch, std::string& err);
+
+// 函数: 根据配置和机器资源推导并发槽位数 (同时接收的任务数量, 包括等待资源的任务)
+std::size_t deriveTaskSlots(
+    const MachineResources& resources,
+    std::uint32_t configuredSlots,
+    std::uint32_t cpuCoresPerSlot
+);
+
+/*
+任务执行器, 通过 Boost.Process 启动任务进程
+
+所有函数都需要在构造时传入的 EventLoop 上调用, 回调也在该 EventLoop 上执行
+进程回收是异步的: Linux 上使用 pidfd 注册到 trantor 的 EventLoop, 进程退出时 pidfd 变为可读
+pidfd 不可用时 (旧内核, Windows) 退化为定时非阻塞检查
+stdout/stderr 通过非阻塞管道读入 LogStream 并分块上传 (Windows 上暂不捕获)
+
+任务按声明的资源由 ResourceAllocator 装箱, 资源足够时多个任务同时运行
+资源暂时不足的任务在本地排队, 有任务退出时按顺序启动能放下的任务 (允许小任务越过大任务)
+除了 slots 之外还额外接收 lookahead 个任务, 它们的输入在前面的任务运行时准备, 槽位空出时可以立即启动
+子进程绑定到分配的 CPU 核心 (Linux), 并通过 CUDA_VISIBLE_DEVICES 只看到分配的 GPU
+*/
+class TaskExecutor {
+public:
+    using StartedCallback = std::function<void(const TaskSpec&, int pid, const Allocation&)>;
+    using FinishedCallback = std::function<void(const TaskResult&)>;
+    // 任务输出了检查点标记, file 已经按任务工作目录解析为绝对路径
+    using CheckpointCallback = std::function<void(const TaskSpec&, std::filesystem::path file)>;
+
+    TaskExecutor(
+        trantor::EventLoop* loop,
+        std::size_t slots,
+        std::size_t lookahead,
+        MachineResources resources,
+        const LogStreamOptions& logOptions,
+        LogStream::ChunkSink logSink
+    );
+    ~TaskExecutor();
+
+    TaskExecutor(const TaskExecutor&) = delete;
+    TaskExecutor& operator=(const TaskExecutor&) = delete;
+
+    inline std::size_t slots() const { return m_slots; }
+    inline std::size_t lookahead() const { return m_lookahead; }
+    inline std::size_t running() const { return m_running.size(); }
+    inline std::size_t queued() const { return m_queue.size(); }
+    inline std::size_t terminating() const { return m_terminating.size(); }
+    inline bool hasFreeSlot() const { return m_running.size() + m_queue.size() < m_slots + m_lookahead; }
+    inline const ResourceAllocator& allocator() const { return m_allocator; }
+
+    // 运行中和已取消等待退出的任务
+    std::vector<RunningTaskInfo> runningTasks() const;
+
+    // 所有任务等待上传的日志字节数
+    std::size_t logBacklog() const;
+
+    inline void setCheckpointCallback(CheckpointCallback&& callback) { m_onCheckpoint = std::move(callback); }
+
+    // 接收任务, 资源足够且输入准备好时立即启动, 否则排队
+    // 没有空闲槽位 (包括 lookahead), 或者本机资源总量放不下该任务时返回 false
+    // 同一投递的重复分发被忽略; delivery tag 已被其他投递 (服务器重建 Channel 前的任务) 占用时返回 false
+    // 进程启动失败时同样会调用 onFinished (spawned = false)
+    bool submit(TaskSpec&& spec, StartedCallback&& onStarted, FinishedCallback&& onFinished);
+
+    // 输入准备完成, 通过 YLINE_INPUT_<i> 环境变量把本地路径传给任务; error 不为空时任务以失败结束
+    // 恢复的检查点通过 YLINE_CHECKPOINT_RESUME 传给任务
+    // 任务已经不在队列中 (例如被取消) 时返回 false
+    bool inputsStaged(std::uint64_t deliveryTag, const std::vector<std::filesystem::path>& localPaths, const std::string& error);
+
+    // 取消任务: 排队中的直接移除; 运行中的先向进程组发送 SIGTERM, grace 秒后仍未退出则 SIGKILL
+    // 两种情况都立即释放槽位和资源并调用 onFinished (cancelled = true), 不等待进程退出, 服务器可以马上分发新任务
+    // preempt 表示被更高优先级的任务抢占, 结果中 preempted = true; 找不到任务或者代数不符时返回 false
+    bool cancel(std::uint64_t deliveryTag, std::uint64_t generation, double grace, bool preempt = false);
+
+private:
+    struct Running;
+
+    struct Queued {
+        TaskSpec spec;
+        StartedCallback onStarted;
+        FinishedCallback onFinished;
+        bool ready = true;                 // 输入已准备好
+    };
+
+    ResourceAllocator m_allocator;
+    std::deque<Queued> m_queue;
+
+    trantor::EventLoop* m_loop;
+    std::size_t m_slots;
+    std::size_t m_lookahead;
+    LogStreamOptions m_logOptions;
+    LogStream::ChunkSink m_logSink;
+    CheckpointCallback m_onCheckpoint;
+    trantor::TimerId m_logFlushTimer;
+    std::unordered_map<std::uint64_t, std::unique_ptr<Running>> m_running; // delivery_tag -> 任务
+    std::unordered_map<std::uint64_t, std::unique_ptr<Running>> m_terminating; // 已取消, 等待退出的进程, 不占用槽位
+
+    // 启动排队中资源足够的任务
+    void schedule();
+
+    // 启动进程
+    void start(Queued&& task, Allocation&& allocation);
+
+    // 注册退出通知
+    void watch(std::uint64_t deliveryTag, Running& running);
+
+    // 进程可能已退出, 非阻塞检查并回收
+    void tryReap(std::uint64_t deliveryTag);
+
+    // 向任务的进程组发送信号, Windows 上直接结束进程
+    static void signalTask(Running& running, int sig);
+};
+
+} // namespace YLineWorker
+
+#endif // YLINEWORKER_TASK_EXECUTOR_H
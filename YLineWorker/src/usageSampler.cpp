@@ -0,0 +1,73 @@
+#include "usageSampler.h"
+
+#include <algorithm>
+
+namespace YLineWorker {
+
+UsageSampler::UsageSampler(SampleFunction sample, std::size_t capacity)
+    : m_sample(std::move(sample))
+    , m_capacity(std::max<std::size_t>(capacity, 1))
+{
+}
+
+UsageSampler::~UsageSampler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeup.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void UsageSampler::start()
+{
+    if (!m_thread.joinable())
+    {
+        m_thread = std::thread(&UsageSampler::run, this);
+    }
+}
+
+std::optional<UsageSample> UsageSampler::latest() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_samples.empty())
+    {
+        return std::nullopt;
+    }
+    return m_samples.back();
+}
+
+std::vector<UsageSample> UsageSampler::history(std::size_t maxSamples) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::size_t count = std::min(maxSamples, m_samples.size());
+    return std::vector<UsageSample>(m_samples.end() - static_cast<std::ptrdiff_t>(count), m_samples.end());
+}
+
+void UsageSampler::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping)
+    {
+        // 采样本身需要 1 秒 (CPU 使用率), 也就是采样间隔, 采样期间不持有锁
+        const auto next = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        lock.unlock();
+        UsageSample sample = m_sample();
+        lock.lock();
+
+        m_samples.push_back(std::move(sample));
+        while (m_samples.size() > m_capacity)
+        {
+            m_samples.pop_front();
+        }
+
+        // 采样函数没有阻塞时 (例如获取失败) 等到下一秒, 避免空转
+        m_wakeup.wait_until(lock, next, [this] { return m_stopping; });
+    }
+}
+
+} // namespace YLineWorker
@@ -0,0 +1,74 @@
+#ifndef YLINEWORKER_USAGE_SAMPLER_H
+#define YLINEWORKER_USAGE_SAMPLER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "UTnvml.h"
+
+namespace YLineWorker {
+
+// 结构体: 一块 GPU 的使用率
+struct GpuUsageSample {
+    unsigned int index = 0;
+    YSolowork::util::nvUsageInfoGPU usage;
+};
+
+// 结构体: 一次使用率采样
+struct UsageSample {
+    std::chrono::system_clock::time_point time;
+    double cpuUsage = -1.0;      // 百分比, -1 表示获取失败
+    double memoryUsage = -1.0;   // 百分比
+    std::vector<GpuUsageSample> gpus;
+};
+
+/*
+使用率采样器, 在独立线程上循环采样, 保留最近 capacity 个样本
+
+CPU 使用率需要间隔 1 秒读取两次系统时间, 采样函数会阻塞 1 秒, 所以不能放在 EventLoop 上
+采样函数只在采样线程上调用; latest 和 history 可以在任意线程调用
+*/
+class UsageSampler {
+public:
+    using SampleFunction = std::function<UsageSample()>;
+
+    UsageSampler(SampleFunction sample, std::size_t capacity);
+    ~UsageSampler();
+
+    UsageSampler(const UsageSampler&) = delete;
+    UsageSampler& operator=(const UsageSampler&) = delete;
+
+    // 启动采样线程
+    void start();
+
+    // 最新的样本, 还没有采样时为空
+    std::optional<UsageSample> latest() const;
+
+    // 最近最多 maxSamples 个样本, 从旧到新
+    std::vector<UsageSample> history(std::size_t maxSamples) const;
+
+    inline std::size_t capacity() const { return m_capacity; }
+
+private:
+    SampleFunction m_sample;
+    std::size_t m_capacity;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    bool m_stopping = false;
+    std::deque<UsageSample> m_samples;
+    std::thread m_thread;
+
+    void run();
+};
+
+} // namespace YLineWorker
+
+#endif // YLINEWORKER_USAGE_SAMPLER_H
@@ -5,6 +5,7 @@
 
 
 #include <spdlog/spdlog.h>
+#include <algorithm>
 #include <stdexcept>
 #include <string>
 
@@ -72,6 +73,85 @@ Config parseConfig() {
         spdlog::warn("Invalid log level 无效的日志等级: {}", logLevelStr);
         spdlog::warn("Using default log level 使用默认日志等级: info");
     }
+    bool logAsync = loggerTbl["async"].value_or(true);
+    std::uint32_t logQueueSize = loggerTbl["queue_size"].value_or(8192u);
+    if (logQueueSize == 0)
+    {
+        spdlog::warn("Invalid logger queue_size 无效的日志队列容量: 0, using 8192");
+        logQueueSize = 8192;
+    }
+    const std::string& logOverflowStr = loggerTbl["overflow"].value_or("overrun_oldest");
+    auto logOverflowPolicy = spdlog::async_overflow_policy::overrun_oldest;
+    if (const auto it = YLineWorker::logOverflowPolicyMap.find(logOverflowStr); it != YLineWorker::logOverflowPolicyMap.end())
+    {
+        logOverflowPolicy = it->second;
+    }
+    else
+    {
+        spdlog::warn("Invalid logger overflow 无效的日志队列策略: {}, using overrun_oldest", logOverflowStr);
+    }
+
+    // 读取 executor 部分, 可选
+    std::uint32_t executorSlots = YLineWorkerConfig["executor"]["slots"].value_or(0u);
+    std::uint32_t executorCpuCoresPerSlot = YLineWorkerConfig["executor"]["cpu_cores_per_slot"].value_or(0u);
+
+    // 读取 task_log 部分, 可选
+    std::uint32_t logChunkSize = YLineWorkerConfig["task_log"]["chunk_size"].value_or(64u * 1024);
+    std::uint32_t logBufferSize = YLineWorkerConfig["task_log"]["buffer_size"].value_or(1024u * 1024);
+    double logFlushInterval = YLineWorkerConfig["task_log"]["flush_interval"].value_or(0.5);
+    std::uint32_t logMaxBytesPerSecond = YLineWorkerConfig["task_log"]["max_bytes_per_second"].value_or(1024u * 1024);
+    if (logChunkSize == 0 || logBufferSize < logChunkSize)
+    {
+        spdlog::warn("Invalid task_log chunk_size / buffer_size 无效的任务日志分块大小, using defaults 使用默认值");
+        logChunkSize = 64u * 1024;
+        logBufferSize = std::max(logBufferSize, logChunkSize);
+    }
+
+    // 读取 asset_cache 部分, 可选
+    // 相对路径相对于可执行文件目录
+    std::filesystem::path cacheDir = YLineWorkerConfig["asset_cache"]["dir"].value_or("asset_cache");
+    if (cacheDir.is_relative())
+    {
+        cacheDir = exePath / cacheDir;
+    }
+    double cacheQuotaGB = YLineWorkerConfig["asset_cache"]["quota_gb"].value_or(50.0);
+    std::uint32_t cacheFetchThreads = YLineWorkerConfig["asset_cache"]["fetch_threads"].value_or(2u);
+    if (cacheFetchThreads == 0)
+    {
+        spdlog::warn("Invalid asset_cache fetch_threads 无效的缓存下载线程数: 0, using 1");
+        cacheFetchThreads = 1;
+    }
+
+    // 读取 pipeline 部分, 可选
+    std::uint32_t executorLookahead = YLineWorkerConfig["pipeline"]["lookahead"].value_or(1u);
+    std::uint32_t uploadThreads = YLineWorkerConfig["pipeline"]["upload_threads"].value_or(2u);
+    if (uploadThreads == 0)
+    {
+        spdlog::warn("Invalid pipeline upload_threads 无效的上传线程数: 0, using 1");
+        uploadThreads = 1;
+    }
+
+    // 读取 artifact 部分, 可选
+    std::uint32_t artifactChunkSize = YLineWorkerConfig["artifact"]["chunk_size"].value_or(8u * 1024 * 1024);
+
+    // 读取 executor 部分的取消宽限期, 可选
+    double cancelGrace = YLineWorkerConfig["executor"]["cancel_grace"].value_or(10.0);
+    if (cancelGrace < 0)
+    {
+        spdlog::warn("Invalid executor cancel_grace 无效的取消宽限期: {}, using 0", cancelGrace);
+        cancelGrace = 0;
+    }
+
+    // 读取 monitor 部分, 可选
+    double loopProbeInterval = YLineWorkerConfig["monitor"]["loop_probe_interval"].value_or(0.1);
+    double loopStallThreshold = YLineWorkerConfig["monitor"]["loop_stall_threshold"].value_or(0.5);
+    double loopLogInterval = YLineWorkerConfig["monitor"]["loop_log_interval"].value_or(60.0);
+    if (loopProbeInterval <= 0)
+    {
+        spdlog::warn("Invalid monitor loop_probe_interval 无效的事件循环探测间隔: {}, using 0.1", loopProbeInterval);
+        loopProbeInterval = 0.1;
+    }
+    std::uint32_t usageHistory = YLineWorkerConfig["monitor"]["usage_history"].value_or(300u);
 
     return Config{
         YLineWorkerIp,
@@ -82,6 +162,26 @@ Config parseConfig() {
         intranetIpFilter,
         localHostFilter,
         logLevel,
+        logAsync,
+        logQueueSize,
+        logOverflowPolicy,
+        executorSlots,
+        executorCpuCoresPerSlot,
+        logChunkSize,
+        logBufferSize,
+        logFlushInterval,
+        logMaxBytesPerSecond,
+        cacheDir,
+        cacheQuotaGB,
+        cacheFetchThreads,
+        executorLookahead,
+        uploadThreads,
+        artifactChunkSize,
+        cancelGrace,
+        loopProbeInterval,
+        loopStallThreshold,
+        loopLogInterval,
+        usageHistory,
         };
 }
 
@@ -2,6 +2,7 @@
 #include "UTtime.h"
 #include "UTmachineInfo.h"
 
+#include <spdlog/async.h>
 #include <spdlog/sinks/rotating_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <memory>
@@ -40,6 +41,49 @@ std::shared_ptr<spdlog::logger> createLogger() {
     return logger;
 }
 
+// 创建异步日志记录器
+std::shared_ptr<spdlog::logger> createAsyncLogger(
+    const std::shared_ptr<spdlog::logger>& logger, 
+    std::size_t queueSize, 
+    spdlog::async_overflow_policy policy
+)
+{
+    // 只用一个后台线程, 保证日志顺序
+    spdlog::init_thread_pool(queueSize, 1);
+
+    // sink 是线程安全的 _mt 版本, 可以直接共享
+    // 默认策略 overrun_oldest 在队列满时覆盖最旧的日志, I/O 线程永远不会因为磁盘慢或文件滚动而阻塞
+    auto asyncLogger = std::make_shared<spdlog::async_logger>(
+        logger->name(), 
+        logger->sinks().begin(), 
+        logger->sinks().end(), 
+        spdlog::thread_pool(), 
+        policy
+    );
+
+    // 设置与同步日志记录器一致
+    asyncLogger->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] %v");
+    asyncLogger->set_level(logger->level());
+    asyncLogger->flush_on(logger->flush_level());
+
+    spdlog::set_default_logger(asyncLogger);
+
+    return asyncLogger;
+}
+
+// 异步队列已满时被覆盖的日志数量
+std::size_t droppedLogMessages()
+{
+    const auto threadPool = spdlog::thread_pool();
+    return threadPool ? threadPool->overrun_counter() : 0;
+}
+
+// 哈希表: 映射字符串到异步队列已满时的策略
+const std::unordered_map<std::string, spdlog::async_overflow_policy> logOverflowPolicyMap = {
+    {"block", spdlog::async_overflow_policy::block},
+    {"overrun_oldest", spdlog::async_overflow_policy::overrun_oldest}
+};
+
 // 哈希表: 映射字符串到 spdlog 的日志等级
 const std::unordered_map<std::string, spdlog::level::level_enum> logLevelMap = {
     {"trace", spdlog::level::trace},
@@ -2,25 +2,74 @@
 #include "drogon/IntranetIpFilter.h"
 #include "drogon/LocalHostFilter.h"
 #include "json/value.h"
+#include <json/reader.h>
 #include <drogon/drogon.h>
 #include "utils/logger.h"
 #include "utils/api.h"
 
+#include <algorithm>
+#include <cmath>
 #include <format>
 #include <functional>
+#include <memory>
 #include <spdlog/logger.h>
 #include <spdlog/spdlog.h>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <trantor/utils/Logger.h>
 #include <magic_enum.hpp>
 
 #include <boost/uuid/uuid_generators.hpp>
 #include <iostream>
 #include "UTappdata.h"
+#include "UTloopMonitor.h"
 
 namespace YLineWorker {
 
+// 重连的退避间隔 (秒): 第 n 次等待 min(base * 2^n, max)
+constexpr double RECONNECT_BASE_DELAY = 1.0;
+constexpr double RECONNECT_MAX_DELAY = 60.0;
+
+// 函数: 事件循环监控, 卡顿 (附调用栈) 和周期汇总写入日志; 需要在 app().run() 之后 I/O 循环存在时调用
+static void watchEventLoops(const Config& config)
+{
+    YSolowork::util::LoopMonitorOptions options;
+    options.interval = config.loop_probe_interval;
+    options.stall_threshold = config.loop_stall_threshold;
+    options.log_interval = config.loop_log_interval;
+    options.on_stall = [](const YSolowork::util::LoopStall& stall)
+    {
+        std::string stack;
+        for (const auto& frame : stall.stack)
+        {
+            stack += "\n    " + frame;
+        }
+        spdlog::warn("Event loop `{}` blocked for {:.3f}s 事件循环阻塞{}", stall.loop, stall.blocked, stack);
+    };
+    options.on_summary = [threshold = config.loop_stall_threshold](const std::vector<YSolowork::util::LoopSummary>& summaries)
+    {
+        for (const auto& summary : summaries)
+        {
+            const bool slow = summary.stalls > 0 || summary.max_lag > threshold || summary.max_queue_delay > threshold;
+            spdlog::log(
+                slow ? spdlog::level::info : spdlog::level::debug,
+                "Event loop `{}` max lag {:.3f}s, max queue delay {:.3f}s, {} stalls 事件循环状态",
+                summary.loop, summary.max_lag, summary.max_queue_delay, summary.stalls
+            );
+        }
+    };
+
+    auto& monitor = YSolowork::util::LoopMonitor::instance();
+    monitor.setOptions(std::move(options));
+    // 主循环运行 WebSocket 客户端, 使用率定时器和任务执行器
+    monitor.watch(drogon::app().getLoop(), "main");
+    for (size_t i = 0; i < drogon::app().getThreadNum(); ++i)
+    {
+        monitor.watch(drogon::app().getIOLoop(i), "io" + std::to_string(i));
+    }
+}
+
 void spawnWorker(const Config& config, const std::shared_ptr<spdlog::logger> custom_logger)
 {
     // 获取机器信息
@@ -75,7 +124,8 @@ void spawnWorker(const Config& config, const std::shared_ptr<spdlog::logger> cus
     WorkerSingleton::getInstance().setWorkerData({
         .register_secret = config.register_secret,
         .client = client,
-        .worker_machineInfo = machineInfo
+        .worker_machineInfo = machineInfo,
+        .server_address = std::format("{}:{}", config.YLineServer_ip, config.YLineServer_port)
     });
 
     // 初始化 nvml
@@ -90,16 +140,29 @@ void spawnWorker(const Config& config, const std::shared_ptr<spdlog::logger> cus
         spdlog::warn("This maynot be a problem if you do not have Nvidia GPU 如果您没有 Nvidia GPU, 这可能不是问题");
     }
 
-    
+    // 使用率在独立线程上每秒采样一次, 连接后上报最新的样本
+    WorkerSingleton::getInstance().initUsageSampler(config.usage_history);
+
+    // 初始化任务执行器, 进程回收在 WebSocket client 所在的 EventLoop 上进行
+    WorkerSingleton::getInstance().initExecutor(drogon::app().getLoop(), config);
+
+    // 本地 /metrics 和 /status 接口, 监控可以直接采集工作机, 不经过服务器
+    WorkerSingleton::getInstance().registerStatusHandlers(config);
 
     // 连接到服务器
     spdlog::info("Connecting to server 连接到服务器: {}", conn_str);
     WorkerSingleton::getInstance().connectToServer();
     
 
+    // 事件循环监控, 延迟和卡顿见日志
+    drogon::app().getLoop()->queueInLoop([config]() { watchEventLoops(config); });
+
     spdlog::info("YLineWorker Service started 服务已启动");
     drogon::app().run();
 
+    // 事件循环退出后不再投递探测
+    YSolowork::util::LoopMonitor::instance().stop();
+
 }
 
 void WorkerSingleton::saveUUIDtoAppData(const boost::uuids::uuid& uuid, const std::filesystem::path& path)
@@ -176,6 +239,7 @@ void WSconnectCallback(ReqResult result, const HttpResponsePtr& resp, const WebS
 
     if (result == ReqResult::Ok) {
         spdlog::info("Connected to server 成功连接到服务器");
+        connectionEvents("connected").inc();
         // 获取当前的 event loop
         auto loop = trantor::EventLoop::getEventLoopOfCurrentThread();
         if (!loop) {
@@ -187,7 +251,7 @@ void WSconnectCallback(ReqResult result, const HttpResponsePtr& resp, const WebS
         auto _usageInfotimer = loop->runEvery(1.0, [wsClient]() {
             const Json::Value& json = WorkerSingleton::getInstance().getUsageJson();
             
-            if (wsClient && wsClient->getConnection() && wsClient->getConnection()->connected())
+            if (!json.isNull() && wsClient && wsClient->getConnection() && wsClient->getConnection()->connected())
             {
                 wsClient->getConnection()->sendJson(json);
             }
@@ -197,19 +261,79 @@ void WSconnectCallback(ReqResult result, const HttpResponsePtr& resp, const WebS
 
     } else {
         spdlog::error("Failed to connect to server 连接服务器失败: {}", to_string(result));
+        connectionEvents("failed").inc();
+        WorkerSingleton::getInstance().scheduleReconnect();
     }
 
 }
 
 
+// 服务器指令
+enum class ServerCommandType {
+    redirect,
+    registered,
+    dispatch,
+    cancelTask,
+    preemptTask,
+    UNKNOWN  // 用于处理未识别的指令
+};
+
+// 服务器指令 Map
+const std::unordered_map<std::string, ServerCommandType> serverCommandMap = {
+    {"redirect", ServerCommandType::redirect},
+    {"registered", ServerCommandType::registered},
+    {"dispatch", ServerCommandType::dispatch},
+    {"cancelTask", ServerCommandType::cancelTask},
+    {"preemptTask", ServerCommandType::preemptTask}
+};
+
 Task<> msgAsyncCallback(std::string&& message,
                        const WebSocketClientPtr& client,
                        const WebSocketMessageType& type)
 {
     if (type == WebSocketMessageType::Text)
     {
-        // 打印接收到的消息
-        spdlog::info("Received message: {}", message);
+        // 每个线程复用一个解析器, 直接读取消息缓冲区
+        thread_local const std::unique_ptr<Json::CharReader> reader(Json::CharReaderBuilder().newCharReader());
+        Json::Value root;
+        std::string errs;
+        if (!reader->parse(message.data(), message.data() + message.size(), &root, &errs) || !root.isMember("command"))
+        {
+            spdlog::warn("Received unrecognized message 收到无法识别的消息: {}", message);
+            co_return;
+        }
+
+        const auto it = serverCommandMap.find(root["command"].asString());
+        const ServerCommandType command = it == serverCommandMap.end() ? ServerCommandType::UNKNOWN : it->second;
+        switch (command)
+        {
+            case ServerCommandType::redirect:
+            {
+                const std::string address = root["server"].asString();
+                // 不能在当前 client 的回调中替换 client, 放到下一轮事件循环
+                trantor::EventLoop::getEventLoopOfCurrentThread()->queueInLoop([address]() {
+                    WorkerSingleton::getInstance().redirectToServer(address);
+                });
+                break;
+            }
+            case ServerCommandType::registered:
+                spdlog::info("Registered to server 已注册到服务器, id: {}", root["id"].asInt64());
+                WorkerSingleton::getInstance().resetReconnectBackoff();
+                WorkerSingleton::getInstance().flushReports();
+                break;
+            case ServerCommandType::dispatch:
+                WorkerSingleton::getInstance().dispatchTask(root);
+                break;
+            case ServerCommandType::cancelTask:
+                WorkerSingleton::getInstance().cancelTask(root, false);
+                break;
+            case ServerCommandType::preemptTask:
+                WorkerSingleton::getInstance().cancelTask(root, true);
+                break;
+            case ServerCommandType::UNKNOWN:
+                spdlog::warn("Received unknown command 收到未知指令: {}", root["command"].asString());
+                break;
+        }
     }
     
 
@@ -221,6 +345,7 @@ Task<> msgAsyncCallback(std::string&& message,
 
 void WSconnectClosedCallback(const WebSocketClientPtr& wsClient) {
     spdlog::warn("Server Connection closed 服务器连接已断开");
+    connectionEvents("closed").inc();
     // 取消定时器
     auto loop = trantor::EventLoop::getEventLoopOfCurrentThread();
     if (!loop) {
@@ -228,6 +353,68 @@ void WSconnectClosedCallback(const WebSocketClientPtr& wsClient) {
         return;
     }
     loop->invalidateTimer(WorkerSingleton::getInstance().usageInfotimer);
+
+    // 服务器重启或网络中断, 退避后重新连接, 重新注册后补发暂存的报告
+    WorkerSingleton::getInstance().scheduleReconnect();
+}
+
+void WorkerSingleton::replaceClient()
+{
+    // 停止旧连接, 清除其回调以免关闭事件影响新连接的定时器
+    auto& oldClient = workerData_.client;
+    if (oldClient)
+    {
+        oldClient->setConnectionClosedHandler([](const WebSocketClientPtr&) {});
+        oldClient->stop();
+    }
+    if (auto loop = trantor::EventLoop::getEventLoopOfCurrentThread())
+    {
+        loop->invalidateTimer(usageInfotimer);
+    }
+
+    workerData_.client = drogon::WebSocketClient::newWebSocketClient(std::format("ws://{}", workerData_.server_address));
+    connectToServer();
+}
+
+void WorkerSingleton::scheduleReconnect()
+{
+    if (reconnectTimer_)
+    {
+        return;
+    }
+
+    const double delay = std::min(
+        RECONNECT_MAX_DELAY,
+        RECONNECT_BASE_DELAY * std::pow(2.0, static_cast<double>(std::min<std::uint32_t>(reconnectAttempts_, 16)))
+    );
+    ++reconnectAttempts_;
+    connectionEvents("reconnect").inc();
+    spdlog::info("Reconnecting to server in {:.0f}s 秒后重新连接服务器, attempt 第 {} 次", delay, reconnectAttempts_);
+
+    reconnectTimer_ = drogon::app().getLoop()->runAfter(delay, [this]() {
+        reconnectTimer_.reset();
+        replaceClient();
+    });
+}
+
+void WorkerSingleton::redirectToServer(const std::string& address)
+{
+    spdlog::info("Redirected by server, reconnecting to 被服务器重定向, 重新连接到: {}", address);
+    connectionEvents("redirect").inc();
+
+    // 重定向立即连接新的实例, 不再等待之前安排的重连
+    if (reconnectTimer_)
+    {
+        drogon::app().getLoop()->invalidateTimer(*reconnectTimer_);
+        reconnectTimer_.reset();
+    }
+
+    workerData_.server_address = address;
+    if (artifactClient_)
+    {
+        artifactClient_->setServer(address);
+    }
+    replaceClient();
 }
 
 void WorkerSingleton::connectToServer() {
@@ -238,6 +425,7 @@ void WorkerSingleton::connectToServer() {
     auto req = drogon::HttpRequest::newHttpJsonRequest(json);
     req->setPath("/ws/worker");
     
+    connectionEvents("attempt").inc();
     client->setAsyncMessageHandler(msgAsyncCallback);
     client->setConnectionClosedHandler(WSconnectClosedCallback);
     client->connectToServer(
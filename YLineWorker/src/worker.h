@@ -9,9 +9,18 @@
 
 #include "UTmachineInfo.h"
 #include "UTnvml.h"
+#include "taskExecutor.h"
+#include "assetCache.h"
+#include "artifactClient.h"
+#include "usageSampler.h"
+#include "UTmetrics.h"
 
 #include <boost/uuid/uuid.hpp>
 
+#include <map>
+#include <unordered_map>
+#include <utility>
+
 using namespace drogon;
 
 namespace YLineWorker {
@@ -27,6 +36,9 @@ struct worker {
     // machine info
     YSolowork::util::MachineInfo worker_machineInfo;
 
+    // 当前连接的服务器 host:port, 被重定向时更新
+    std::string server_address;
+
 };
 
 class WorkerSingleton {
@@ -49,6 +61,15 @@ public:
     // 连接到服务器
     void connectToServer();
 
+    // 集群模式: 断开当前连接并重新连接到指定服务器实例 (host:port)
+    void redirectToServer(const std::string& address);
+
+    // 连接断开或连接失败后重新连接当前服务器, 间隔按指数退避, 已经在等待时不重复安排
+    void scheduleReconnect();
+
+    // 注册成功后重置退避间隔
+    inline void resetReconnectBackoff() { reconnectAttempts_ = 0; }
+
     // 初始化 nvml
     inline void initNvml() {
         nvml_.emplace();
@@ -61,11 +82,20 @@ public:
         return nvml_;
     }
 
-    // 获取 worker usage Json
-    Json::Value getUsageJson();
+    // 获取 worker usage Json, 取自最新的采样, 还没有采样时为 null
+    Json::Value getUsageJson() const;
 
     // 获取 worker usageGPU Json
-    Json::Value getUsageGPUJson();
+    static Json::Value getUsageGPUJson(const UsageSample& sample);
+
+    // 启动使用率采样线程, 保留最近 historySamples 秒的样本, 需要在 initNvml 之后调用
+    void initUsageSampler(std::size_t historySamples);
+
+    // 注册本地 /metrics 和 /status 接口及其指标, 需要在 initExecutor 之后调用
+    void registerStatusHandlers(const Config& config);
+
+    // 获取本地状态 Json, 包含最近 historySamples 个使用率样本, 需要在执行器的 EventLoop 上调用
+    Json::Value getStatusJson(std::size_t historySamples) const;
 
     // 获取 worker register Json
     Json::Value getRegisterJson() const;
@@ -87,6 +117,25 @@ public:
     // logNvmlInfo
     void logNvmlInfo();
 
+    // 初始化任务执行器, 槽位数由配置和机器资源推导
+    void initExecutor(trantor::EventLoop* loop, const Config& config);
+
+    // 执行服务器分发的任务
+    void dispatchTask(const Json::Value& dispatch);
+
+    // 取消任务, 例如作业被取消, 或推测执行中其他副本已经完成
+    // preempt 表示被更高优先级的任务抢占, 服务器收到报告后重新入队
+    void cancelTask(const Json::Value& cancel, bool preempt);
+
+    // 发送任务报告, 未连接时暂存, 重新注册后补发
+    void sendReport(Json::Value&& report);
+
+    // 补发暂存的任务报告
+    void flushReports();
+
+    // 发送任务日志块, 未连接时返回 false
+    bool sendLogFrame(const YSolowork::util::LogFrameHeader& header, std::string_view payload);
+
 private:
     // 私有构造函数，防止外部实例化
     WorkerSingleton();
@@ -100,9 +149,18 @@ private:
     // nv 设备
     std::optional<std::vector<YSolowork::util::nvDevice>> nvDevices_;
 
-    // 更新 GPU 设备使用信息
+    // 更新 GPU 设备使用信息, 只在采样线程上调用
     void updateUsageInfoGPU();
 
+    // 采样一次 CPU/内存/GPU 使用率, 阻塞 1 秒, 只在采样线程上调用
+    UsageSample sampleUsage();
+
+    // 使用率采样
+    std::unique_ptr<UsageSampler> usageSampler_;
+
+    // 是否已连接到服务器, 在 EventLoop 上读取
+    bool isConnected() const;
+
     // 加载 nv 设备
     void loadNvDevices();
 
@@ -114,6 +172,58 @@ private:
 
     // worker uuid
     boost::uuids::uuid worker_uuid;
+
+    // 任务执行器
+    std::unique_ptr<TaskExecutor> executor_;
+
+    // 连续重连的次数, 决定下一次的退避间隔
+    std::uint32_t reconnectAttempts_ = 0;
+
+    // 等待中的重连定时器
+    std::optional<trantor::TimerId> reconnectTimer_;
+
+    // 用新的 client 连接 server_address, 旧 client 不再回调
+    void replaceClient();
+
+    // 服务器没有指定时的取消宽限期 (秒)
+    double cancelGrace_ = 10.0;
+
+    // 输入文件缓存
+    std::unique_ptr<AssetCache> assetCache_;
+
+    // 输出上传
+    std::unique_ptr<OutputUploader> outputUploader_;
+
+    // 服务器上的任务产物, 由输入缓存和输出上传共用
+    std::shared_ptr<ArtifactClient> artifactClient_;
+
+    // 上报缓存变化, 未连接时不发送, 重新注册时会上报完整列表
+    void sendCacheUpdate(std::vector<std::string>&& added, std::vector<std::string>&& evicted);
+
+    // 未发送的任务报告
+    std::vector<Json::Value> pendingReports_;
+
+    // 任务检查点的上传状态, 每个任务同时只上传一个, 上传期间只保留最新的标记
+    // delivery tag 只在服务器的同一个 Channel 代数内唯一, 重连后新投递可能复用旧投递的 tag, 所以和代数一起作为键
+    using CheckpointKey = std::pair<std::uint64_t, std::uint64_t>; // (delivery_tag, generation)
+    struct CheckpointUpload {
+        std::string task_id;
+        std::int64_t job_id = 0;
+        bool uploading = false;
+        bool finished = false;                          // 任务已结束, 上传完成后删除
+        std::optional<std::filesystem::path> pending;   // 上传期间收到的最新检查点
+        std::uint64_t seq = 0;
+    };
+    std::map<CheckpointKey, CheckpointUpload> checkpoints_;
+
+    // 任务输出了检查点标记
+    void onCheckpoint(const TaskSpec& spec, std::filesystem::path file);
+
+    // 上传检查点并报告给服务器
+    void uploadCheckpoint(const CheckpointKey& key, std::filesystem::path file);
+
+    // 任务结束, 没有正在上传的检查点时删除状态
+    void finishCheckpoints(const CheckpointKey& key);
 };
 
 
@@ -127,5 +237,8 @@ MachineInfo getMachineInfo();
 
 void logWorkerMachineInfo(const MachineInfo& machineInfo);
 
+// 函数: 与服务器的连接事件计数 (attempt, connected, failed, closed, redirect, reconnect), 用于本地指标和状态接口
+Counter& connectionEvents(const std::string& event);
+
 }
 #endif // YLINEWORKER_APP_H
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "workerMessages.h"
+
+#include <chrono>
+#include <magic_enum.hpp>
+
+#include <boost/uuid/uuid_io.hpp> // for boost::uuids::to_string
+
+namespace YLineWorker {
+
+Json::Value makeUsageJson(const UsageSample& sample)
+{
+    Json::Value json;
+    json["command"] = "usage";
+    json["ts"] = static_cast<Json::Int64>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(sample.time.time_since_epoch()).count()
+    );
+    json["cpuUsage"] = sample.cpuUsage;
+    json["cpuMemoryUsage"] = sample.memoryUsage;
+
+    if (!sample.gpus.empty()) 
+    {   
+        json["gpuUsage"] = makeUsageGPUJson(sample);
+    }
+
+    return json;
+}
+
+Json::Value makeUsageGPUJson(const UsageSample& sample)
+{
+    Json::Value json;
+    for (const auto& gpu : sample.gpus) 
+    {
+        Json::Value deviceJson;
+        deviceJson["index"] = gpu.index;
+        deviceJson["gpuUsage"] = gpu.usage.gpuUsage;
+        deviceJson["gpuMemoryUsed"] = gpu.usage.gpuMemoryUsed;
+        deviceJson["gpuTemperature"] = gpu.usage.gpuTemperature;
+        deviceJson["gpuClockInfo"]["graphicsClock"] = gpu.usage.gpuClockInfo.graphicsClock;
+        deviceJson["gpuClockInfo"]["smClock"] = gpu.usage.gpuClockInfo.smClock;
+        deviceJson["gpuClockInfo"]["memClock"] = gpu.usage.gpuClockInfo.memClock;
+        deviceJson["gpuClockInfo"]["videoClock"] = gpu.usage.gpuClockInfo.videoClock;
+        deviceJson["gpuPowerUsage"] = gpu.usage.gpuPowerUsage;
+        json["NVIDIA"].append(deviceJson);
+    }
+
+    return json;
+}
+
+Json::Value makeMachineInfoJson(const YSolowork::util::MachineInfo& machineInfo)
+{
+    Json::Value json;
+    json["machineName"] = machineInfo.machineName;
+    json["systomInfo"]["OS"] = std::string(
+         magic_enum::enum_name(machineInfo.systomInfo.os)
+    );
+    json["systomInfo"]["osName"] = machineInfo.systomInfo.osName;
+    json["systomInfo"]["osRelease"] = machineInfo.systomInfo.osRelease;
+    json["systomInfo"]["osVersion"] = machineInfo.systomInfo.osVersion;
+    json["systomInfo"]["osArchitecture"] = std::string(
+         magic_enum::enum_name(machineInfo.systomInfo.osArchitecture)
+    );
+    for (const auto& device : machineInfo.devices) 
+    {
+        Json::Value deviceJson;
+        deviceJson["type"] = std::string(
+            magic_enum::enum_name(device.type)
+        );
+        deviceJson["platformName"] = device.platformName;
+        deviceJson["name"] = device.name;
+        deviceJson["cores"] = device.cores;
+        deviceJson["memoryGB"] = device.memoryGB;
+        json["devices"].append(deviceJson);
+    }
+
+    return json;
+}
+
+Json::Value makeRegisterJson(const RegisterInfo& info)
+{
+    Json::Value json;
+    json["worker_uuid"] = boost::uuids::to_string(info.worker_uuid);
+    json["register_secret"] = info.register_secret;
+    json["worker_info"]["machineInfo"] = makeMachineInfoJson(info.machineInfo);
+    json["worker_info"]["slots"] = static_cast<Json::UInt64>(info.slots);
+    json["worker_info"]["lookahead"] = static_cast<Json::UInt64>(info.lookahead);
+    if (info.resources)
+    {
+        json["worker_info"]["resources"] = resourcesToJson(*info.resources);
+    }
+    if (info.cache)
+    {
+        // 服务器优先把任务分发给已经缓存了其输入的工作机
+        json["worker_info"]["cache"] = Json::Value(Json::arrayValue);
+        for (const auto& hash : *info.cache)
+        {
+            json["worker_info"]["cache"].append(hash);
+        }
+    }
+    if (!info.nvidia.isNull())
+    {
+        json["worker_info"]["NVIDIA"] = info.nvidia;
+    }
+
+    return json;
+}
+
+} // namespace YLineWorker
@@ -0,0 +1,49 @@
+#ifndef YLINEWORKER_WORKER_MESSAGES_H
+#define YLINEWORKER_WORKER_MESSAGES_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <json/value.h>
+#include <boost/uuid/uuid.hpp>
+
+#include "UTmachineInfo.h"
+#include "resourceAllocator.h"
+#include "usageSampler.h"
+
+/*
+发送给服务器的注册和使用率消息
+
+只依赖传入的数据, 不访问 WorkerSingleton, 工作机和模拟工作机 (YLineSwarm) 共用, 保证两者的消息格式一致
+*/
+namespace YLineWorker {
+
+// 结构体: 注册请求的内容
+struct RegisterInfo {
+    boost::uuids::uuid worker_uuid;
+    std::string register_secret;
+    YSolowork::util::MachineInfo machineInfo;
+    std::size_t slots = 1;
+    std::size_t lookahead = 0;
+    std::optional<MachineResources> resources;
+    std::optional<std::vector<std::string>> cache; // 输入缓存中的哈希, 没有启用缓存时为空
+    Json::Value nvidia;                            // NVIDIA 设备, 没有时为 null
+};
+
+// 函数: 注册请求 Json, 作为连接 /ws/worker 的请求体
+Json::Value makeRegisterJson(const RegisterInfo& info);
+
+// 函数: 机器信息 Json
+Json::Value makeMachineInfoJson(const YSolowork::util::MachineInfo& machineInfo);
+
+// 函数: 使用率消息 Json, ts 为采样时间 (Unix 毫秒), 服务器用它统计接收延迟
+Json::Value makeUsageJson(const UsageSample& sample);
+
+// 函数: 使用率消息中的 GPU 部分
+Json::Value makeUsageGPUJson(const UsageSample& sample);
+
+} // namespace YLineWorker
+
+#endif // YLINEWORKER_WORKER_MESSAGES_H
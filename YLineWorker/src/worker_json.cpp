@@ -3,55 +3,28 @@
 #include <magic_enum.hpp>
 #include <variant>
 #include "UTusage.h"
+#include "workerMessages.h"
 
 #include <boost/uuid/uuid_io.hpp> // for boost::uuids::to_string
 
 namespace YLineWorker {
 
 
-Json::Value WorkerSingleton::getUsageJson()
+Json::Value WorkerSingleton::getUsageJson() const
 {
-    UsageInfoCPU usageInfoCPU = YSolowork::util::getUsageInfoCPU();
-    Json::Value json;
-    json["command"] = "usage";
-    json["cpuUsage"] = usageInfoCPU.cpuUsage;
-    json["cpuMemoryUsage"] = usageInfoCPU.memoryUsage;
-
-    if (nvml_.has_value()) 
-    {   
-        json["gpuUsage"] = getUsageGPUJson();
+    // CPU 使用率的采样需要 1 秒, 在采样线程上进行, 这里只读取最新的样本, 不阻塞 EventLoop
+    const auto sample = usageSampler_ ? usageSampler_->latest() : std::nullopt;
+    if (!sample)
+    {
+        return Json::Value();
     }
 
-    return json;
+    return makeUsageJson(*sample);
 }
 
-Json::Value WorkerSingleton::getUsageGPUJson()
+Json::Value WorkerSingleton::getUsageGPUJson(const UsageSample& sample)
 {
-    
-    if (!nvml_.has_value()) 
-    {
-        throw std::runtime_error("NVML not initialized NVML, can not get Nvidia GPU usage! 未初始化 NVML, 无法获取 Nvidia GPU 情况!");
-    }
-
-    updateUsageInfoGPU();
-    Json::Value json;
-    for (const auto& device : nvDevices_.value()) 
-    {
-        Json::Value deviceJson;
-        deviceJson["index"] = device.index;
-        // deviceJson["name"] = device.name;
-        deviceJson["gpuUsage"] = device.usageInfoGPU.gpuUsage;
-        deviceJson["gpuMemoryUsed"] = device.usageInfoGPU.gpuMemoryUsed;
-        deviceJson["gpuTemperature"] = device.usageInfoGPU.gpuTemperature;
-        deviceJson["gpuClockInfo"]["graphicsClock"] = device.usageInfoGPU.gpuClockInfo.graphicsClock;
-        deviceJson["gpuClockInfo"]["smClock"] = device.usageInfoGPU.gpuClockInfo.smClock;
-        deviceJson["gpuClockInfo"]["memClock"] = device.usageInfoGPU.gpuClockInfo.memClock;
-        deviceJson["gpuClockInfo"]["videoClock"] = device.usageInfoGPU.gpuClockInfo.videoClock;
-        deviceJson["gpuPowerUsage"] = device.usageInfoGPU.gpuPowerUsage;
-        json["NVIDIA"].append(deviceJson);
-    }
-
-    return json;
+    return makeUsageGPUJson(sample);
 }
 
 // Json::Value WorkerSingleton::getDeviceJson() const
@@ -92,31 +65,7 @@ Json::Value WorkerSingleton::getUsageGPUJson()
 
 Json::Value WorkerSingleton::getMachineInfoJson() const
 {
-    Json::Value json;
-    json["machineName"] = workerData_.worker_machineInfo.machineName;
-    json["systomInfo"]["OS"] = std::string(
-         magic_enum::enum_name(workerData_.worker_machineInfo.systomInfo.os)
-    );
-    json["systomInfo"]["osName"] = workerData_.worker_machineInfo.systomInfo.osName;
-    json["systomInfo"]["osRelease"] = workerData_.worker_machineInfo.systomInfo.osRelease;
-    json["systomInfo"]["osVersion"] = workerData_.worker_machineInfo.systomInfo.osVersion;
-    json["systomInfo"]["osArchitecture"] = std::string(
-         magic_enum::enum_name(workerData_.worker_machineInfo.systomInfo.osArchitecture)
-    );
-    for (const auto& device : workerData_.worker_machineInfo.devices) 
-    {
-        Json::Value deviceJson;
-        deviceJson["type"] = std::string(
-            magic_enum::enum_name(device.type)
-        );
-        deviceJson["platformName"] = device.platformName;
-        deviceJson["name"] = device.name;
-        deviceJson["cores"] = device.cores;
-        deviceJson["memoryGB"] = device.memoryGB;
-        json["devices"].append(deviceJson);
-    }
-
-    return json;
+    return makeMachineInfoJson(workerData_.worker_machineInfo);
 }
 
 Json::Value WorkerSingleton::getNvDeviceRegisterJson() const
@@ -172,17 +121,27 @@ Json::Value WorkerSingleton::getNvDeviceRegisterJson() const
 
 Json::Value WorkerSingleton::getRegisterJson() const
 {
-    Json::Value json;
-    json["worker_uuid"] = boost::uuids::to_string(worker_uuid);
-    json["register_secret"] = workerData_.register_secret;
-    json["worker_info"]["machineInfo"] = getMachineInfoJson();
-
+    RegisterInfo info{
+        .worker_uuid = worker_uuid,
+        .register_secret = workerData_.register_secret,
+        .machineInfo = workerData_.worker_machineInfo,
+        .slots = executor_ ? executor_->slots() : 1,
+        .lookahead = executor_ ? executor_->lookahead() : 0,
+    };
+    if (executor_)
+    {
+        info.resources = executor_->allocator().total();
+    }
+    if (assetCache_)
+    {
+        info.cache = assetCache_->hashes();
+    }
     if (nvml_.has_value() && nvDevices_.has_value() && !nvDevices_.value().empty()) 
     {
-        json["worker_info"]["NVIDIA"] = getNvDeviceRegisterJson();
+        info.nvidia = getNvDeviceRegisterJson();
     }
 
-    return json;
+    return makeRegisterJson(info);
 }
 
 
@@ -0,0 +1,293 @@
+#include "worker.h"
+#include "UTusage.h"
+#include "utils/logger.h"
+
+#include <drogon/drogon.h>
+#include <json/value.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include <boost/uuid/uuid_io.hpp> // for boost::uuids::to_string
+
+namespace YLineWorker {
+
+Counter& connectionEvents(const std::string& event)
+{
+    return MetricsRegistry::instance().counter(
+        "yline_worker_server_connection_events_total",
+        "Connection events with the server: attempt, connected, failed, closed, redirect, reconnect",
+        {{"event", event}}
+    );
+}
+
+UsageSample WorkerSingleton::sampleUsage()
+{
+    UsageSample sample;
+    const UsageInfoCPU usageInfoCPU = YSolowork::util::getUsageInfoCPU();
+    sample.time = std::chrono::system_clock::now();
+    sample.cpuUsage = usageInfoCPU.cpuUsage;
+    sample.memoryUsage = usageInfoCPU.memoryUsage;
+
+    if (nvml_.has_value() && nvDevices_.has_value())
+    {
+        updateUsageInfoGPU();
+        for (const auto& device : nvDevices_.value())
+        {
+            sample.gpus.push_back(GpuUsageSample{device.index, device.usageInfoGPU});
+        }
+    }
+    return sample;
+}
+
+void WorkerSingleton::initUsageSampler(std::size_t historySamples)
+{
+    usageSampler_ = std::make_unique<UsageSampler>(
+        [this]() { return sampleUsage(); },
+        historySamples
+    );
+    usageSampler_->start();
+}
+
+bool WorkerSingleton::isConnected() const
+{
+    const auto& client = workerData_.client;
+    return client && client->getConnection() && client->getConnection()->connected();
+}
+
+// 函数: 使用率样本 Json
+static Json::Value usageSampleJson(const UsageSample& sample)
+{
+    Json::Value json;
+    json["time"] = static_cast<Json::Int64>(
+        std::chrono::duration_cast<std::chrono::seconds>(sample.time.time_since_epoch()).count()
+    );
+    json["cpuUsage"] = sample.cpuUsage;
+    json["cpuMemoryUsage"] = sample.memoryUsage;
+    if (!sample.gpus.empty())
+    {
+        json["gpuUsage"] = WorkerSingleton::getUsageGPUJson(sample);
+    }
+    return json;
+}
+
+Json::Value WorkerSingleton::getStatusJson(std::size_t historySamples) const
+{
+    Json::Value json;
+    json["uuid"] = boost::uuids::to_string(worker_uuid);
+    json["machineName"] = workerData_.worker_machineInfo.machineName;
+
+    // 与服务器的连接
+    json["server"]["address"] = workerData_.server_address;
+    json["server"]["connected"] = isConnected();
+    for (const auto* event : {"attempt", "connected", "failed", "closed", "redirect", "reconnect"})
+    {
+        json["server"]["events"][event] = static_cast<Json::UInt64>(connectionEvents(event).value());
+    }
+    json["server"]["pendingReports"] = static_cast<Json::UInt64>(pendingReports_.size());
+
+    // 槽位和任务
+    if (executor_)
+    {
+        json["slots"]["total"] = static_cast<Json::UInt64>(executor_->slots());
+        json["slots"]["lookahead"] = static_cast<Json::UInt64>(executor_->lookahead());
+        json["slots"]["running"] = static_cast<Json::UInt64>(executor_->running());
+        json["slots"]["queued"] = static_cast<Json::UInt64>(executor_->queued());
+        json["slots"]["terminating"] = static_cast<Json::UInt64>(executor_->terminating());
+        json["logBacklogBytes"] = static_cast<Json::UInt64>(executor_->logBacklog());
+
+        json["tasks"] = Json::arrayValue;
+        for (const auto& task : executor_->runningTasks())
+        {
+            Json::Value taskJson;
+            taskJson["delivery_tag"] = static_cast<Json::UInt64>(task.delivery_tag);
+            taskJson["task_id"] = task.task_id;
+            taskJson["job_id"] = static_cast<Json::Int64>(task.job_id);
+            taskJson["pid"] = task.pid;
+            taskJson["runtime"] = task.runtime;
+            taskJson["logBacklogBytes"] = static_cast<Json::UInt64>(task.log_backlog);
+            taskJson["cancelled"] = task.cancelled;
+            json["tasks"].append(taskJson);
+        }
+    }
+    if (outputUploader_)
+    {
+        json["pendingUploads"] = static_cast<Json::UInt64>(outputUploader_->pending());
+    }
+    if (assetCache_)
+    {
+        const auto stats = assetCache_->stats();
+        json["cache"]["objects"] = static_cast<Json::UInt64>(stats.objects);
+        json["cache"]["bytes"] = static_cast<Json::UInt64>(stats.bytes);
+        json["cache"]["quotaBytes"] = static_cast<Json::UInt64>(stats.quota_bytes);
+        json["cache"]["fetching"] = static_cast<Json::UInt64>(stats.fetching);
+    }
+
+    // 使用率历史
+    json["history"] = Json::arrayValue;
+    if (usageSampler_)
+    {
+        for (const auto& sample : usageSampler_->history(historySamples))
+        {
+            json["history"].append(usageSampleJson(sample));
+        }
+        if (!json["history"].empty())
+        {
+            json["usage"] = json["history"][json["history"].size() - 1];
+        }
+        else if (const auto latest = usageSampler_->latest())
+        {
+            json["usage"] = usageSampleJson(*latest);
+        }
+    }
+
+    return json;
+}
+
+void WorkerSingleton::registerStatusHandlers(const Config& config)
+{
+    auto& registry = MetricsRegistry::instance();
+
+    // 使用率取自采样线程的最新样本, 可以在任意线程读取
+    const auto latestUsage = [](auto field) {
+        return [field]() -> double {
+            const auto& sampler = WorkerSingleton::getInstance().usageSampler_;
+            const auto sample = sampler ? sampler->latest() : std::nullopt;
+            return sample ? field(*sample) : -1.0;
+        };
+    };
+    registry.gaugeCallback("yline_worker_cpu_usage_percent", "CPU usage of the latest sample", {},
+        latestUsage([](const UsageSample& sample) { return sample.cpuUsage; }));
+    registry.gaugeCallback("yline_worker_memory_usage_percent", "Memory usage of the latest sample", {},
+        latestUsage([](const UsageSample& sample) { return sample.memoryUsage; }));
+
+    if (nvDevices_.has_value())
+    {
+        for (const auto& device : nvDevices_.value())
+        {
+            const unsigned int index = device.index;
+            const YSolowork::util::MetricLabels labels{{"gpu", std::to_string(index)}};
+            const auto gpuUsage = [latestUsage, index](auto field) {
+                return latestUsage([field, index](const UsageSample& sample) {
+                    const auto it = std::find_if(sample.gpus.begin(), sample.gpus.end(),
+                        [index](const GpuUsageSample& gpu) { return gpu.index == index; });
+                    return it != sample.gpus.end() ? field(it->usage) : -1.0;
+                });
+            };
+            using GpuUsage = YSolowork::util::nvUsageInfoGPU;
+            registry.gaugeCallback("yline_worker_gpu_usage_percent", "GPU utilization of the latest sample", labels,
+                gpuUsage([](const GpuUsage& usage) { return usage.gpuUsage; }));
+            registry.gaugeCallback("yline_worker_gpu_memory_used_gigabytes", "GPU memory used in the latest sample", labels,
+                gpuUsage([](const GpuUsage& usage) { return usage.gpuMemoryUsed; }));
+            registry.gaugeCallback("yline_worker_gpu_temperature_celsius", "GPU temperature in the latest sample", labels,
+                gpuUsage([](const GpuUsage& usage) { return usage.gpuTemperature; }));
+            registry.gaugeCallback("yline_worker_gpu_power_watts", "GPU power draw in the latest sample", labels,
+                gpuUsage([](const GpuUsage& usage) { return usage.gpuPowerUsage; }));
+        }
+    }
+
+    // 以下回调读取执行器等只能在 EventLoop 上访问的状态, /metrics 在执行器的 EventLoop 上采集
+    const auto onLoop = [](auto read) {
+        return [read]() -> double { return static_cast<double>(read(WorkerSingleton::getInstance())); };
+    };
+    registry.gaugeCallback("yline_worker_task_slots", "Task slots of this worker", {},
+        onLoop([](const WorkerSingleton& worker) { return worker.executor_->slots(); }));
+    registry.gaugeCallback("yline_worker_task_lookahead", "Tasks prefetched beyond the slots", {},
+        onLoop([](const WorkerSingleton& worker) { return worker.executor_->lookahead(); }));
+    registry.gaugeCallback("yline_worker_tasks", "Tasks by state", {{"state", "running"}},
+        onLoop([](const WorkerSingleton& worker) { return worker.executor_->running(); }));
+    registry.gaugeCallback("yline_worker_tasks", "Tasks by state", {{"state", "queued"}},
+        onLoop([](const WorkerSingleton& worker) { return worker.executor_->queued(); }));
+    registry.gaugeCallback("yline_worker_tasks", "Tasks by state", {{"state", "terminating"}},
+        onLoop([](const WorkerSingleton& worker) { return worker.executor_->terminating(); }));
+    registry.gaugeCallback("yline_worker_log_backlog_bytes", "Task output buffered and waiting for upload", {},
+        onLoop([](const WorkerSingleton& worker) { return worker.executor_->logBacklog(); }));
+    registry.gaugeCallback("yline_worker_pending_reports", "Task reports waiting for the server connection", {},
+        onLoop([](const WorkerSingleton& worker) { return worker.pendingReports_.size(); }));
+    registry.gaugeCallback("yline_worker_pending_uploads", "Task outputs waiting for upload", {},
+        onLoop([](const WorkerSingleton& worker) { return worker.outputUploader_->pending(); }));
+    registry.gaugeCallback("yline_worker_server_connected", "1 when connected to the server", {},
+        onLoop([](const WorkerSingleton& worker) { return worker.isConnected() ? 1 : 0; }));
+
+    // 缓存有自己的锁, 可以在任意线程读取
+    registry.gaugeCallback("yline_worker_asset_cache_bytes", "Bytes in the input file cache", {},
+        []() { return static_cast<double>(WorkerSingleton::getInstance().assetCache_->stats().bytes); });
+    registry.gaugeCallback("yline_worker_asset_cache_objects", "Files in the input file cache", {},
+        []() { return static_cast<double>(WorkerSingleton::getInstance().assetCache_->stats().objects); });
+
+    // 异步日志队列已满时被覆盖的日志, 同步日志时始终为 0
+    registry.gaugeCallback("yline_worker_log_messages_dropped", "Log messages overwritten because the async log queue was full", {},
+        []() { return static_cast<double>(droppedLogMessages()); });
+
+    // 过滤器与服务器的配置一致
+    std::vector<drogon::internal::HttpConstraint> constraints{drogon::Get};
+    if (config.intranet_ip_filter)
+    {
+        constraints.emplace_back("drogon::IntranetIpFilter");
+    }
+    if (config.local_host_filter)
+    {
+        constraints.emplace_back("drogon::LocalHostFilter");
+    }
+
+    // 处理函数在 I/O 线程上调用, 转到执行器的 EventLoop 上读取状态
+    drogon::app().registerHandler(
+        "/metrics",
+        [](const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback)
+        {
+            drogon::app().getLoop()->runInLoop(
+                [callback = std::move(callback)]()
+                {
+                    auto resp = HttpResponse::newHttpResponse();
+                    resp->setStatusCode(drogon::k200OK);
+                    resp->setContentTypeString("text/plain; version=0.0.4; charset=utf-8");
+                    resp->setBody(MetricsRegistry::instance().render());
+                    callback(resp);
+                }
+            );
+        },
+        constraints
+    );
+
+    const std::size_t maxHistory = usageSampler_ ? usageSampler_->capacity() : 0;
+    drogon::app().registerHandler(
+        "/status",
+        [maxHistory](const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback)
+        {
+            // ?history=N 返回最近 N 个使用率样本, 默认 60
+            std::size_t history = 60;
+            const auto& param = req->getParameter("history");
+            if (!param.empty())
+            {
+                try
+                {
+                    history = static_cast<std::size_t>(std::max(0L, std::stol(param)));
+                }
+                catch (const std::exception&)
+                {
+                    auto resp = HttpResponse::newHttpResponse();
+                    resp->setStatusCode(drogon::k400BadRequest);
+                    resp->setBody("Invalid history parameter 无效的 history 参数");
+                    callback(resp);
+                    return;
+                }
+            }
+            history = std::min(history, maxHistory);
+
+            drogon::app().getLoop()->runInLoop(
+                [callback = std::move(callback), history]()
+                {
+                    callback(HttpResponse::newHttpJsonResponse(
+                        WorkerSingleton::getInstance().getStatusJson(history)
+                    ));
+                }
+            );
+        },
+        constraints
+    );
+
+    spdlog::info("Local status endpoints enabled 本地状态接口已启用: /metrics, /status");
+}
+
+} // namespace YLineWorker
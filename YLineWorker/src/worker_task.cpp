@@ -0,0 +1,414 @@
+#include "worker.h"
+#include "json/value.h"
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <spdlog/spdlog.h>
+
+#include <boost/uuid/uuid_io.hpp> // for boost::uuids::to_string
+
+#include "UTartifact.h"
+
+namespace YLineWorker {
+
+namespace {
+
+// task_id 中不能出现在产物 key 里的字符替换为 '_'
+std::string artifactSegment(const std::string& value)
+{
+    std::string segment = value;
+    for (auto& c : segment)
+    {
+        const bool allowed = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+                          || c == '-' || c == '_' || c == '.';
+        if (!allowed)
+        {
+            c = '_';
+        }
+    }
+    if (segment.empty() || segment == "." || segment == "..")
+    {
+        segment = "_" + segment;
+    }
+    return segment;
+}
+
+}
+
+void WorkerSingleton::initExecutor(trantor::EventLoop* loop, const Config& config)
+{
+    std::vector<GpuResource> gpus;
+    if (nvDevices_.has_value())
+    {
+        for (const auto& device : nvDevices_.value())
+        {
+            gpus.push_back(GpuResource{device.index, device.totalMemery});
+        }
+    }
+    MachineResources resources = detectMachineResources(YSolowork::util::getTotalMemoryGB(), gpus);
+    const std::size_t slots = deriveTaskSlots(
+        resources,
+        config.executor_slots,
+        config.executor_cpu_cores_per_slot
+    );
+    const LogStreamOptions logOptions{
+        .chunk_size = config.log_chunk_size,
+        .buffer_size = config.log_buffer_size,
+        .flush_interval = config.log_flush_interval,
+        .max_bytes_per_second = config.log_max_bytes_per_second,
+    };
+    executor_ = std::make_unique<TaskExecutor>(
+        loop,
+        slots,
+        config.executor_lookahead,
+        std::move(resources),
+        logOptions,
+        [](const YSolowork::util::LogFrameHeader& header, std::string_view payload) {
+            return WorkerSingleton::getInstance().sendLogFrame(header, payload);
+        }
+    );
+
+    artifactClient_ = std::make_shared<ArtifactClient>(
+        std::format("{}:{}", config.YLineServer_ip, config.YLineServer_port),
+        config.register_secret,
+        config.artifact_chunk_size
+    );
+
+    assetCache_ = std::make_unique<AssetCache>(
+        loop,
+        AssetCacheOptions{
+            .dir = config.cache_dir,
+            .quota_bytes = static_cast<std::uint64_t>(std::max(0.0, config.cache_quota_gb) * 1024 * 1024 * 1024),
+            .fetch_threads = config.cache_fetch_threads,
+        }
+    );
+    assetCache_->setArtifactClient(artifactClient_);
+    assetCache_->start();
+    assetCache_->setChangeCallback([](std::vector<std::string> added, std::vector<std::string> evicted) {
+        WorkerSingleton::getInstance().sendCacheUpdate(std::move(added), std::move(evicted));
+    });
+
+    outputUploader_ = std::make_unique<OutputUploader>(loop, config.upload_threads, artifactClient_);
+    cancelGrace_ = config.cancel_grace;
+
+    executor_->setCheckpointCallback([](const TaskSpec& spec, std::filesystem::path file) {
+        WorkerSingleton::getInstance().onCheckpoint(spec, std::move(file));
+    });
+
+    spdlog::info(
+        "Task executor initialized 任务执行器已初始化, slots 槽位数: {}, lookahead: {}, cores 核心: {}, gpus: {}",
+        slots, config.executor_lookahead, executor_->allocator().total().core_ids.size(), gpus.size()
+    );
+}
+
+void WorkerSingleton::dispatchTask(const Json::Value& dispatch)
+{
+    std::string err;
+    auto spec = parseTaskSpec(dispatch, err);
+    if (!spec.has_value())
+    {
+        spdlog::error("Received invalid task 收到无效任务: {}", err);
+        // 无法执行的任务报告为失败, 服务器确认后不会再次分发
+        if (dispatch["delivery_tag"].isUInt64())
+        {
+            Json::Value report;
+            report["command"] = "taskFinished";
+            report["delivery_tag"] = dispatch["delivery_tag"];
+            report["generation"] = static_cast<Json::UInt64>(dispatch["generation"].asUInt64());
+            report["task_id"] = dispatch["task"]["task_id"];
+            report["job_id"] = dispatch["task"]["job_id"];
+            report["exit_code"] = -1;
+            report["success"] = false;
+            report["error"] = err;
+            sendReport(std::move(report));
+        }
+        return;
+    }
+
+    const std::string taskID = spec->task_id;
+    const std::uint64_t deliveryTag = spec->delivery_tag;
+    const std::uint64_t generation = spec->generation;
+    const std::string cwd = spec->cwd;
+    std::vector<InputSpec> inputs = spec->inputs;
+    std::vector<OutputSpec> outputs = spec->outputs;
+    const bool accepted = executor_->submit(
+        std::move(spec.value()),
+        [](const TaskSpec& spec, int pid, const Allocation& allocation) {
+            // 资源不足时任务在本地排队, 真正启动时才报告
+            Json::Value started;
+            started["command"] = "taskStarted";
+            started["delivery_tag"] = static_cast<Json::UInt64>(spec.delivery_tag);
+            started["generation"] = static_cast<Json::UInt64>(spec.generation);
+            started["task_id"] = spec.task_id;
+            started["job_id"] = static_cast<Json::Int64>(spec.job_id);
+            started["pid"] = pid;
+            started["cores"] = static_cast<Json::UInt>(allocation.cores.size());
+            started["gpus"] = Json::Value(Json::arrayValue);
+            for (const auto index : allocation.gpus)
+            {
+                started["gpus"].append(index);
+            }
+            WorkerSingleton::getInstance().sendReport(std::move(started));
+        },
+        [cwd, outputs = std::move(outputs)](const TaskResult& result) mutable {
+            Json::Value report;
+            report["command"] = "taskFinished";
+            report["delivery_tag"] = static_cast<Json::UInt64>(result.delivery_tag);
+            report["generation"] = static_cast<Json::UInt64>(result.generation);
+            report["task_id"] = result.task_id;
+            report["job_id"] = static_cast<Json::Int64>(result.job_id);
+            report["exit_code"] = result.exit_code;
+            report["success"] = result.spawned && !result.cancelled && result.exit_code == 0;
+            report["cancelled"] = result.cancelled;
+            report["preempted"] = result.preempted;
+            report["duration"] = result.duration;
+            if (!result.error.empty())
+            {
+                report["error"] = result.error;
+            }
+            auto& worker = WorkerSingleton::getInstance();
+            worker.assetCache_->release(result.delivery_tag);
+            worker.finishCheckpoints({result.delivery_tag, result.generation});
+
+            if (!report["success"].asBool() || outputs.empty())
+            {
+                worker.sendReport(std::move(report));
+                return;
+            }
+
+            // 槽位已经释放, 下一个任务开始计算的同时上传输出, 上传完成后才报告结束
+            worker.outputUploader_->upload(
+                cwd,
+                std::move(outputs),
+                [report = std::move(report)](std::uint64_t bytes, double duration, std::string error) mutable {
+                    report["upload_bytes"] = static_cast<Json::UInt64>(bytes);
+                    report["upload_duration"] = duration;
+                    if (!error.empty())
+                    {
+                        spdlog::error("Task {} failed to upload outputs 任务输出上传失败: {}", report["task_id"].asString(), error);
+                        report["success"] = false;
+                        report["error"] = error;
+                    }
+                    WorkerSingleton::getInstance().sendReport(std::move(report));
+                }
+            );
+        }
+    );
+
+    if (!accepted)
+    {
+        // 槽位已满, 本机资源不可能满足, 或者 delivery tag 被旧任务占用, 由服务器重新入队
+        spdlog::warn("Cannot accept task, rejecting 无法接收任务, 拒绝任务: {}", taskID);
+        Json::Value rejected;
+        rejected["command"] = "taskRejected";
+        rejected["delivery_tag"] = static_cast<Json::UInt64>(deliveryTag);
+        rejected["generation"] = static_cast<Json::UInt64>(generation);
+        rejected["task_id"] = taskID;
+        rejected["job_id"] = dispatch["task"]["job_id"];
+        sendReport(std::move(rejected));
+        return;
+    }
+
+    // 任务在执行器中排队时就开始准备输入, 与前面任务的执行重叠
+    if (!inputs.empty())
+    {
+        assetCache_->stage(
+            deliveryTag,
+            cwd,
+            std::move(inputs),
+            [deliveryTag](std::vector<std::filesystem::path> localPaths, std::string error) {
+                auto& worker = WorkerSingleton::getInstance();
+                if (!worker.executor_->inputsStaged(deliveryTag, localPaths, error))
+                {
+                    // 准备期间任务已被取消
+                    worker.assetCache_->release(deliveryTag);
+                }
+            }
+        );
+    }
+}
+
+void WorkerSingleton::cancelTask(const Json::Value& cancel, bool preempt)
+{
+    if (!cancel["delivery_tag"].isUInt64())
+    {
+        spdlog::error("Received invalid cancel command 收到无效的取消指令");
+        return;
+    }
+    const double grace = cancel["grace"].isNumeric() ? std::max(0.0, cancel["grace"].asDouble()) : cancelGrace_;
+    // 任务可能已经结束, 结果已经上报
+    if (!executor_->cancel(cancel["delivery_tag"].asUInt64(), cancel["generation"].asUInt64(), grace, preempt))
+    {
+        spdlog::debug("Task {} to cancel is not running 要取消的任务不在执行中", cancel["task_id"].asString());
+    }
+}
+
+void WorkerSingleton::sendReport(Json::Value&& report)
+{
+    const auto& client = workerData_.client;
+    if (client && client->getConnection() && client->getConnection()->connected())
+    {
+        client->getConnection()->sendJson(report);
+        return;
+    }
+    pendingReports_.push_back(std::move(report));
+}
+
+bool WorkerSingleton::sendLogFrame(const YSolowork::util::LogFrameHeader& header, std::string_view payload)
+{
+    const auto& client = workerData_.client;
+    if (!client || !client->getConnection() || !client->getConnection()->connected())
+    {
+        return false;
+    }
+    const std::string frame = YSolowork::util::encodeLogFrame(header, payload);
+    client->getConnection()->send(frame.data(), frame.size(), WebSocketMessageType::Binary);
+    return true;
+}
+
+void WorkerSingleton::sendCacheUpdate(std::vector<std::string>&& added, std::vector<std::string>&& evicted)
+{
+    const auto& client = workerData_.client;
+    if (!client || !client->getConnection() || !client->getConnection()->connected())
+    {
+        return;
+    }
+    Json::Value update;
+    update["command"] = "cacheUpdate";
+    update["added"] = Json::Value(Json::arrayValue);
+    update["evicted"] = Json::Value(Json::arrayValue);
+    for (auto& hash : added)
+    {
+        update["added"].append(std::move(hash));
+    }
+    for (auto& hash : evicted)
+    {
+        update["evicted"].append(std::move(hash));
+    }
+    client->getConnection()->sendJson(update);
+}
+
+void WorkerSingleton::onCheckpoint(const TaskSpec& spec, std::filesystem::path file)
+{
+    const CheckpointKey checkpointKey{spec.delivery_tag, spec.generation};
+    auto& state = checkpoints_[checkpointKey];
+    state.task_id = spec.task_id;
+    state.job_id = spec.job_id;
+    if (state.uploading)
+    {
+        // 较早的检查点还没有上传完, 只保留最新的一个, 中间的检查点直接跳过
+        state.pending = std::move(file);
+        return;
+    }
+    uploadCheckpoint(checkpointKey, std::move(file));
+}
+
+void WorkerSingleton::uploadCheckpoint(const CheckpointKey& checkpointKey, std::filesystem::path file)
+{
+    auto& state = checkpoints_[checkpointKey];
+    state.uploading = true;
+    ++state.seq;
+
+    const auto ts = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+    const std::string key = std::format(
+        "checkpoints/{}/{}/{}.{}",
+        state.job_id, artifactSegment(state.task_id), boost::uuids::to_string(worker_uuid), ts
+    );
+
+    // 先硬链接一份快照, 任务用 "写临时文件再重命名" 覆盖检查点时上传的仍是标记时的内容
+    std::error_code ec;
+    std::filesystem::path snapshot = file;
+    snapshot.replace_filename(std::format(".{}.yline-checkpoint-{}", file.filename().string(), state.seq));
+    std::filesystem::create_hard_link(file, snapshot, ec);
+    const std::filesystem::path source = ec ? file : snapshot;
+    const bool linked = !ec;
+
+    spdlog::info("Task {} checkpoint 任务检查点: {}, uploading to 上传到 {}", state.task_id, file.string(), key);
+    outputUploader_->upload(
+        "",
+        {OutputSpec{source.string(), std::string(YSolowork::util::ARTIFACT_SCHEME) + key}},
+        [checkpointKey, key, ts, snapshot, linked](std::uint64_t bytes, double duration, std::string error) {
+            auto& worker = WorkerSingleton::getInstance();
+            if (linked)
+            {
+                std::error_code ec;
+                std::filesystem::remove(snapshot, ec);
+            }
+
+            auto it = worker.checkpoints_.find(checkpointKey);
+            if (it == worker.checkpoints_.end())
+            {
+                return;
+            }
+            auto& state = it->second;
+            if (error.empty())
+            {
+                Json::Value report;
+                report["command"] = "taskCheckpoint";
+                report["delivery_tag"] = static_cast<Json::UInt64>(checkpointKey.first);
+                report["generation"] = static_cast<Json::UInt64>(checkpointKey.second);
+                report["task_id"] = state.task_id;
+                report["job_id"] = static_cast<Json::Int64>(state.job_id);
+                report["key"] = key;
+                report["ts"] = static_cast<Json::Int64>(ts);
+                report["size"] = static_cast<Json::UInt64>(bytes);
+                worker.sendReport(std::move(report));
+                spdlog::debug("Task {} checkpoint uploaded 任务检查点已上传, {} bytes in {:.2f}s", state.task_id, bytes, duration);
+            }
+            else
+            {
+                // 上传失败不影响任务, 服务器保留上一个检查点
+                spdlog::warn("Task {} failed to upload checkpoint 任务检查点上传失败: {}", state.task_id, error);
+            }
+
+            state.uploading = false;
+            if (state.pending)
+            {
+                auto next = std::move(*state.pending);
+                state.pending.reset();
+                worker.uploadCheckpoint(checkpointKey, std::move(next));
+            }
+            else if (state.finished)
+            {
+                worker.checkpoints_.erase(it);
+            }
+        }
+    );
+}
+
+void WorkerSingleton::finishCheckpoints(const CheckpointKey& checkpointKey)
+{
+    auto it = checkpoints_.find(checkpointKey);
+    if (it == checkpoints_.end())
+    {
+        return;
+    }
+    if (it->second.uploading)
+    {
+        // 最后一个检查点仍然上传, 任务失败重新入队时可以从它恢复
+        it->second.finished = true;
+        return;
+    }
+    checkpoints_.erase(it);
+}
+
+void WorkerSingleton::flushReports()
+{
+    if (pendingReports_.empty())
+    {
+        return;
+    }
+    // 报告带有分发时的 Channel 代数, 服务器已经回收 (重建 Channel 或工作机被移除) 的投递不会被错误确认
+    spdlog::info("Resending {} pending task reports 补发暂存的任务报告", pendingReports_.size());
+    auto reports = std::move(pendingReports_);
+    pendingReports_.clear();
+    for (auto& report : reports)
+    {
+        sendReport(std::move(report));
+    }
+}
+
+} // namespace YLineWorker
@@ -0,0 +1,806 @@
+// YLineSwarm: 在一个进程中模拟大量工作机连接 /ws/worker, 对服务器的工作机控制面做压力测试
+// simulated worker swarm for stress-testing the /ws/worker control plane
+
+#include "workerMessages.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <drogon/HttpClient.h>
+#include <drogon/WebSocketClient.h>
+#include <json/json.h>
+#include <trantor/net/EventLoopThreadPool.h>
+
+#include <boost/uuid/name_generator.hpp>
+
+#if !defined(_WIN32)
+    #include <sys/resource.h>
+#endif
+
+using namespace YLineWorker;
+
+namespace
+{
+
+constexpr std::string_view USAGE = R"(Usage: YLineSwarm [options]
+
+Open many simulated worker connections to /ws/worker from one process. Each worker registers
+with the same register JSON as YLineWorker, reports usage every --usage-interval seconds and
+executes dispatched tasks by sleeping for --task-ms. Reports registration time, dispatch latency
+and, from the server's /metrics, server-side registration time and usage ingest lag.
+在一个进程中模拟大量工作机连接 /ws/worker, 使用与 YLineWorker 相同的注册和使用率消息,
+任务以等待 --task-ms 代替执行; 统计注册耗时, 分发延迟, 以及服务器 /metrics 中的注册耗时和使用率接收延迟
+工作机 UUID 由 --seed 和编号生成, 相同参数重复运行时以重连的方式注册
+
+Server 服务器:
+  --server <host:port>      default 127.0.0.1:33383
+  --secret <secret>         worker register secret (required)
+  --no-metrics              do not scrape the server's /metrics
+
+Swarm 工作机:
+  --workers <n>             simulated workers, default 1000
+  --connect-rate <n/s>      new connections per second, default 500
+  --io-threads <n>          event loop threads, default 4
+  --duration <seconds>      run time after the last connection, default 60
+  --seed <text>             UUID namespace, default swarm
+  --slots <n>               task slots per worker, default 1
+  --cores <n>               reported cores per worker, default 8
+  --ram-gb <n>              reported RAM per worker, default 32
+  --gpus <n>                reported GPUs per worker, default 0
+  --usage-interval <s>      usage report interval, default 1.0
+
+Tasks 任务:
+  --task-ms <n>             simulated task duration, default 1000
+  --task-jitter-ms <n>      uniform jitter added to the duration, default 0
+  --fail-rate <0-1>         fraction of tasks reported as failed, default 0
+
+Output 输出:
+  --report-interval <s>     progress line interval, default 5
+  --help
+)";
+
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+    std::string server = "127.0.0.1:33383";
+    std::string secret;
+    bool metrics = true;
+
+    std::size_t workers = 1000;
+    double connectRate = 500;
+    std::size_t ioThreads = 4;
+    double duration = 60;
+    std::string seed = "swarm";
+    std::size_t slots = 1;
+    unsigned int cores = 8;
+    double ramGB = 32;
+    unsigned int gpus = 0;
+    double usageInterval = 1.0;
+
+    double taskMs = 1000;
+    double taskJitterMs = 0;
+    double failRate = 0;
+
+    double reportInterval = 5;
+};
+
+template <typename T>
+T
+parseNumber(std::string_view text, std::string_view option)
+{
+    T value{};
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || end != text.data() + text.size())
+    {
+        throw std::invalid_argument(std::format("Invalid value for {}: {}", option, text));
+    }
+    return value;
+}
+
+std::int64_t
+unixMilliseconds()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+}
+
+std::int64_t
+microseconds(Clock::duration duration)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+// 所有工作机共享的统计, 计数器无锁, 延迟样本加锁追加
+struct Stats
+{
+    std::atomic<std::uint64_t> attempts = 0;
+    std::atomic<std::uint64_t> connected = 0;
+    std::atomic<std::uint64_t> failed = 0;
+    std::atomic<std::uint64_t> registered = 0;
+    std::atomic<std::uint64_t> closed = 0;
+    std::atomic<std::uint64_t> redirected = 0;
+    std::atomic<std::uint64_t> usage = 0;
+    std::atomic<std::uint64_t> dispatched = 0;
+    std::atomic<std::uint64_t> finished = 0;
+    std::atomic<std::uint64_t> rejected = 0;
+    std::atomic<std::uint64_t> cancelled = 0;
+
+    std::mutex mutex;
+    std::vector<std::int64_t> registerUs;  // 发起连接到收到 registered
+    std::vector<std::int64_t> dispatchUs;  // 服务器的 dispatch_ts 到收到分发, 毫秒精度
+
+    void
+    addSample(std::vector<std::int64_t> Stats::*samples, std::int64_t value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        (this->*samples).push_back(value);
+    }
+};
+
+// 一个模拟工作机, 所有回调都在其所属的 EventLoop 上执行
+struct SimWorker
+{
+    struct RunningTask
+    {
+        std::string task_id;
+        Json::Value job_id;
+        Json::Value generation; // 服务器 Channel 的代数, 报告时原样带回
+        trantor::TimerId timer;
+        Clock::time_point started;
+    };
+
+    std::size_t index = 0;
+    boost::uuids::uuid uuid;
+    trantor::EventLoop* loop = nullptr;
+    std::string address;
+    drogon::WebSocketClientPtr client;
+    Clock::time_point connectStart;
+    bool registered = false;
+    bool stopping = false;
+    trantor::TimerId usageTimer = trantor::InvalidTimerId;
+    std::unordered_map<std::uint64_t, RunningTask> tasks; // delivery_tag -> 任务
+};
+
+class Swarm
+{
+public:
+    Swarm(const Options& options, Stats& stats)
+        : m_options(options), m_stats(stats)
+    {
+    }
+
+    void
+    connect(SimWorker& worker)
+    {
+        if (worker.stopping)
+        {
+            return;
+        }
+        ++m_stats.attempts;
+        worker.registered = false;
+        worker.client = drogon::WebSocketClient::newWebSocketClient(std::format("ws://{}", worker.address), worker.loop);
+
+        auto req = drogon::HttpRequest::newHttpJsonRequest(makeRegisterJson(registerInfo(worker)));
+        req->setPath("/ws/worker");
+
+        worker.client->setMessageHandler(
+            [this, &worker](std::string&& message, const drogon::WebSocketClientPtr& client, const drogon::WebSocketMessageType& type)
+            {
+                if (client == worker.client && type == drogon::WebSocketMessageType::Text)
+                {
+                    onMessage(worker, std::move(message));
+                }
+            }
+        );
+        worker.client->setConnectionClosedHandler(
+            [this, &worker](const drogon::WebSocketClientPtr& client)
+            {
+                if (client == worker.client && !worker.stopping)
+                {
+                    ++m_stats.closed;
+                    reset(worker);
+                }
+            }
+        );
+
+        worker.connectStart = Clock::now();
+        worker.client->connectToServer(
+            req,
+            [this, &worker](drogon::ReqResult result, const drogon::HttpResponsePtr&, const drogon::WebSocketClientPtr& client)
+            {
+                if (client != worker.client)
+                {
+                    return;
+                }
+                if (result == drogon::ReqResult::Ok)
+                {
+                    ++m_stats.connected;
+                }
+                else
+                {
+                    ++m_stats.failed;
+                }
+            }
+        );
+    }
+
+    // 停止工作机, 在其 EventLoop 上调用
+    void
+    stop(SimWorker& worker)
+    {
+        worker.stopping = true;
+        reset(worker);
+        if (worker.client)
+        {
+            worker.client->stop();
+        }
+    }
+
+private:
+    const Options& m_options;
+    Stats& m_stats;
+
+    static std::mt19937_64&
+    rng()
+    {
+        thread_local std::mt19937_64 engine{std::random_device{}()};
+        return engine;
+    }
+
+    RegisterInfo
+    registerInfo(const SimWorker& worker) const
+    {
+        YSolowork::util::MachineInfo machine;
+        machine.machineName = std::format("swarm-{}", worker.index);
+        machine.systomInfo.os = YSolowork::util::OS::Linux;
+        machine.systomInfo.osName = "YLineSwarm";
+        machine.systomInfo.osArchitecture = YSolowork::util::Architecture::x86_64;
+        machine.devices.push_back(YSolowork::util::Device{
+            YSolowork::util::deviceType::CPU, "YLineSwarm", "Simulated CPU", m_options.cores, m_options.ramGB
+        });
+
+        MachineResources resources;
+        for (unsigned int core = 0; core < m_options.cores; ++core)
+        {
+            resources.core_ids.push_back(core);
+        }
+        resources.ram_gb = m_options.ramGB;
+        for (unsigned int gpu = 0; gpu < m_options.gpus; ++gpu)
+        {
+            resources.gpus.push_back(GpuResource{gpu, 24.0});
+        }
+
+        return RegisterInfo{
+            .worker_uuid = worker.uuid,
+            .register_secret = m_options.secret,
+            .machineInfo = std::move(machine),
+            .slots = m_options.slots,
+            .lookahead = 0,
+            .resources = std::move(resources),
+        };
+    }
+
+    UsageSample
+    usageSample() const
+    {
+        std::uniform_real_distribution<double> percent(0.0, 100.0);
+        UsageSample sample;
+        sample.time = std::chrono::system_clock::now();
+        sample.cpuUsage = percent(rng());
+        sample.memoryUsage = percent(rng());
+        for (unsigned int gpu = 0; gpu < m_options.gpus; ++gpu)
+        {
+            GpuUsageSample gpuSample;
+            gpuSample.index = gpu;
+            gpuSample.usage.gpuUsage = percent(rng());
+            gpuSample.usage.gpuMemoryUsed = percent(rng()) * 0.24;
+            gpuSample.usage.gpuTemperature = 40 + percent(rng()) * 0.4;
+            gpuSample.usage.gpuPowerUsage = percent(rng()) * 3;
+            sample.gpus.push_back(gpuSample);
+        }
+        return sample;
+    }
+
+    void
+    send(SimWorker& worker, const Json::Value& json)
+    {
+        if (worker.client && worker.client->getConnection() && worker.client->getConnection()->connected())
+        {
+            worker.client->getConnection()->sendJson(json);
+        }
+    }
+
+    // 连接断开或停止: 取消定时器, 正在执行的任务由服务器回收
+    void
+    reset(SimWorker& worker)
+    {
+        worker.registered = false;
+        if (worker.usageTimer != trantor::InvalidTimerId)
+        {
+            worker.loop->invalidateTimer(worker.usageTimer);
+            worker.usageTimer = trantor::InvalidTimerId;
+        }
+        for (const auto& [deliveryTag, task] : worker.tasks)
+        {
+            worker.loop->invalidateTimer(task.timer);
+        }
+        worker.tasks.clear();
+    }
+
+    void
+    onMessage(SimWorker& worker, std::string&& message)
+    {
+        Json::Value root;
+        Json::CharReaderBuilder reader;
+        std::string errs;
+        std::istringstream s(message);
+        if (!Json::parseFromStream(reader, s, &root, &errs) || !root["command"].isString())
+        {
+            return;
+        }
+
+        const auto& command = root["command"].asString();
+        if (command == "registered")
+        {
+            onRegistered(worker);
+        }
+        else if (command == "dispatch")
+        {
+            onDispatch(worker, root);
+        }
+        else if (command == "cancelTask" || command == "preemptTask")
+        {
+            onCancel(worker, root, command == "preemptTask");
+        }
+        else if (command == "redirect")
+        {
+            // 集群模式: 连接到所属实例, 不能在当前 client 的回调中替换 client
+            ++m_stats.redirected;
+            worker.address = root["server"].asString();
+            worker.loop->queueInLoop([this, &worker]() {
+                // 先替换 client, 旧连接的关闭事件不计入断开
+                auto oldClient = std::move(worker.client);
+                if (oldClient)
+                {
+                    oldClient->stop();
+                }
+                reset(worker);
+                connect(worker);
+            });
+        }
+    }
+
+    void
+    onRegistered(SimWorker& worker)
+    {
+        if (worker.registered)
+        {
+            return;
+        }
+        worker.registered = true;
+        ++m_stats.registered;
+        m_stats.addSample(&Stats::registerUs, microseconds(Clock::now() - worker.connectStart));
+
+        // 随机错开第一次上报, 避免所有工作机在同一时刻上报
+        std::uniform_real_distribution<double> offset(0.0, m_options.usageInterval);
+        worker.usageTimer = worker.loop->runAfter(offset(rng()), [this, &worker]() {
+            if (!worker.registered)
+            {
+                return;
+            }
+            const auto report = [this, &worker]() {
+                send(worker, makeUsageJson(usageSample()));
+                ++m_stats.usage;
+            };
+            report();
+            worker.usageTimer = worker.loop->runEvery(m_options.usageInterval, report);
+        });
+    }
+
+    void
+    onDispatch(SimWorker& worker, const Json::Value& dispatch)
+    {
+        if (!dispatch["delivery_tag"].isUInt64())
+        {
+            return;
+        }
+        ++m_stats.dispatched;
+        if (dispatch["dispatch_ts"].isInt64())
+        {
+            const auto delay = std::max<std::int64_t>(unixMilliseconds() - dispatch["dispatch_ts"].asInt64(), 0);
+            m_stats.addSample(&Stats::dispatchUs, delay * 1000);
+        }
+
+        const std::uint64_t deliveryTag = dispatch["delivery_tag"].asUInt64();
+        const Json::Value generation = dispatch["generation"];
+        const auto& task = dispatch["task"];
+        if (worker.tasks.size() >= m_options.slots || worker.tasks.contains(deliveryTag))
+        {
+            ++m_stats.rejected;
+            Json::Value rejected;
+            rejected["command"] = "taskRejected";
+            rejected["delivery_tag"] = static_cast<Json::UInt64>(deliveryTag);
+            rejected["generation"] = generation;
+            rejected["task_id"] = task["task_id"];
+            rejected["job_id"] = task["job_id"];
+            send(worker, rejected);
+            return;
+        }
+
+        Json::Value started;
+        started["command"] = "taskStarted";
+        started["delivery_tag"] = static_cast<Json::UInt64>(deliveryTag);
+        started["generation"] = generation;
+        started["task_id"] = task["task_id"];
+        started["job_id"] = task["job_id"];
+        started["pid"] = 0;
+        started["cores"] = 1;
+        started["gpus"] = Json::Value(Json::arrayValue);
+        send(worker, started);
+
+        std::uniform_real_distribution<double> jitter(-m_options.taskJitterMs, m_options.taskJitterMs);
+        const double seconds = std::max(0.0, m_options.taskMs + (m_options.taskJitterMs > 0 ? jitter(rng()) : 0.0)) / 1000.0;
+        const auto timer = worker.loop->runAfter(seconds, [this, &worker, deliveryTag]() {
+            std::bernoulli_distribution fail(m_options.failRate);
+            finish(worker, deliveryTag, !fail(rng()), false, false);
+        });
+        worker.tasks.emplace(deliveryTag, SimWorker::RunningTask{task["task_id"].asString(), task["job_id"], generation, timer, Clock::now()});
+    }
+
+    void
+    onCancel(SimWorker& worker, const Json::Value& cancel, bool preempt)
+    {
+        if (!cancel["delivery_tag"].isUInt64())
+        {
+            return;
+        }
+        const auto it = worker.tasks.find(cancel["delivery_tag"].asUInt64());
+        if (it == worker.tasks.end() || it->second.generation.asUInt64() != cancel["generation"].asUInt64())
+        {
+            return;
+        }
+        worker.loop->invalidateTimer(it->second.timer);
+        ++m_stats.cancelled;
+        finish(worker, it->first, false, true, preempt);
+    }
+
+    void
+    finish(SimWorker& worker, std::uint64_t deliveryTag, bool success, bool cancelled, bool preempted)
+    {
+        const auto it = worker.tasks.find(deliveryTag);
+        if (it == worker.tasks.end())
+        {
+            return;
+        }
+        Json::Value report;
+        report["command"] = "taskFinished";
+        report["delivery_tag"] = static_cast<Json::UInt64>(deliveryTag);
+        report["generation"] = it->second.generation;
+        report["task_id"] = it->second.task_id;
+        report["job_id"] = it->second.job_id;
+        report["exit_code"] = success ? 0 : 1;
+        report["success"] = success;
+        report["cancelled"] = cancelled;
+        report["preempted"] = preempted;
+        report["duration"] = std::chrono::duration<double>(Clock::now() - it->second.started).count();
+        worker.tasks.erase(it);
+        send(worker, report);
+        ++m_stats.finished;
+    }
+};
+
+struct Percentiles
+{
+    std::size_t count = 0;
+    double p50 = 0;
+    double p99 = 0;
+    double p999 = 0;
+    double max = 0;
+};
+
+// 最近秩分位数, 单位毫秒
+Percentiles
+percentiles(std::vector<std::int64_t>& samples)
+{
+    Percentiles result;
+    result.count = samples.size();
+    if (samples.empty())
+    {
+        return result;
+    }
+    std::sort(samples.begin(), samples.end());
+    const auto at = [&](double q) {
+        const auto rank = static_cast<std::size_t>(std::ceil(q * static_cast<double>(samples.size())));
+        return samples[std::clamp<std::size_t>(rank, 1, samples.size()) - 1] / 1000.0;
+    };
+    result.p50 = at(0.50);
+    result.p99 = at(0.99);
+    result.p999 = at(0.999);
+    result.max = samples.back() / 1000.0;
+    return result;
+}
+
+// 直方图的累计桶, 上界 -> 计数, 同名的所有序列相加
+using Buckets = std::map<double, double>;
+
+Buckets
+parseHistogram(const std::string& text, const std::string& name)
+{
+    Buckets buckets;
+    const std::string prefix = name + "_bucket{";
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        if (!line.starts_with(prefix))
+        {
+            continue;
+        }
+        const auto le = line.find("le=\"");
+        const auto end = le == std::string::npos ? std::string::npos : line.find('"', le + 4);
+        const auto space = line.rfind(' ');
+        if (end == std::string::npos || space == std::string::npos)
+        {
+            continue;
+        }
+        const std::string bound = line.substr(le + 4, end - le - 4);
+        const double upper = bound == "+Inf" ? std::numeric_limits<double>::infinity() : std::stod(bound);
+        buckets[upper] += std::stod(line.substr(space + 1));
+    }
+    return buckets;
+}
+
+std::optional<std::string>
+scrapeMetrics(const std::string& server, trantor::EventLoop* loop)
+{
+    auto client = drogon::HttpClient::newHttpClient(std::format("http://{}", server), loop);
+    auto req = drogon::HttpRequest::newHttpRequest();
+    req->setPath("/metrics");
+    auto [result, resp] = client->sendRequest(req, 10.0);
+    if (result != drogon::ReqResult::Ok || !resp || resp->getStatusCode() != drogon::k200OK)
+    {
+        return std::nullopt;
+    }
+    return std::string(resp->body());
+}
+
+// 本次运行期间的分位数: 两次采集的差值, 取计数达到分位的第一个桶的上界, 单位毫秒
+void
+printHistogramDelta(std::string_view label, const Buckets& before, const Buckets& after)
+{
+    Buckets delta;
+    for (const auto& [upper, count] : after)
+    {
+        const auto it = before.find(upper);
+        delta[upper] = count - (it == before.end() ? 0.0 : it->second);
+    }
+    const double total = delta.empty() ? 0.0 : delta.rbegin()->second;
+    if (total <= 0)
+    {
+        std::cout << std::format("{:<16}{:>10}\n", label, 0);
+        return;
+    }
+    const auto at = [&](double q) -> std::string {
+        for (const auto& [upper, count] : delta)
+        {
+            if (count >= q * total)
+            {
+                return std::isinf(upper) ? std::string("+Inf") : std::format("<={:g}", upper * 1000);
+            }
+        }
+        return "+Inf";
+    };
+    std::cout << std::format("{:<16}{:>10}{:>10}{:>10}{:>10}\n", label, static_cast<std::uint64_t>(total), at(0.50), at(0.99), at(0.999));
+}
+
+// 打开的文件数上限提高到硬上限, 每个连接占用一个文件描述符
+void
+raiseFileLimit(std::size_t needed)
+{
+#if !defined(_WIN32)
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < needed)
+    {
+        std::cerr << std::format(
+            "Warning: open file limit {} is below the {} connections needed 警告: 文件描述符上限不足, 请调整 ulimit -n\n",
+            limit.rlim_cur, needed
+        );
+    }
+#endif
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string_view arg = argv[i];
+            const auto value = [&]() -> std::string_view {
+                if (i + 1 >= argc)
+                {
+                    throw std::invalid_argument(std::format("Missing value for {}", arg));
+                }
+                return argv[++i];
+            };
+
+            if (arg == "--help" || arg == "-h")
+            {
+                std::cout << USAGE;
+                return EXIT_SUCCESS;
+            }
+            else if (arg == "--server") options.server = value();
+            else if (arg == "--secret") options.secret = value();
+            else if (arg == "--no-metrics") options.metrics = false;
+            else if (arg == "--workers") options.workers = parseNumber<std::size_t>(value(), arg);
+            else if (arg == "--connect-rate") options.connectRate = std::max(parseNumber<double>(value(), arg), 1.0);
+            else if (arg == "--io-threads") options.ioThreads = std::max<std::size_t>(parseNumber<std::size_t>(value(), arg), 1);
+            else if (arg == "--duration") options.duration = parseNumber<double>(value(), arg);
+            else if (arg == "--seed") options.seed = value();
+            else if (arg == "--slots") options.slots = std::max<std::size_t>(parseNumber<std::size_t>(value(), arg), 1);
+            else if (arg == "--cores") options.cores = std::max(parseNumber<unsigned int>(value(), arg), 1u);
+            else if (arg == "--ram-gb") options.ramGB = parseNumber<double>(value(), arg);
+            else if (arg == "--gpus") options.gpus = parseNumber<unsigned int>(value(), arg);
+            else if (arg == "--usage-interval") options.usageInterval = std::max(parseNumber<double>(value(), arg), 0.01);
+            else if (arg == "--task-ms") options.taskMs = parseNumber<double>(value(), arg);
+            else if (arg == "--task-jitter-ms") options.taskJitterMs = parseNumber<double>(value(), arg);
+            else if (arg == "--fail-rate") options.failRate = std::clamp(parseNumber<double>(value(), arg), 0.0, 1.0);
+            else if (arg == "--report-interval") options.reportInterval = std::max(parseNumber<double>(value(), arg), 0.1);
+            else throw std::invalid_argument(std::format("Unknown option: {}", arg));
+        }
+        if (options.secret.empty())
+        {
+            throw std::invalid_argument("Missing --secret");
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << "\n\n" << USAGE;
+        return EXIT_FAILURE;
+    }
+
+    raiseFileLimit(options.workers + 64);
+
+    trantor::EventLoopThreadPool pool(options.ioThreads, "YLineSwarm");
+    pool.start();
+
+    const auto metricsBefore = options.metrics ? scrapeMetrics(options.server, pool.getNextLoop()) : std::nullopt;
+    if (options.metrics && !metricsBefore)
+    {
+        std::cerr << "Cannot scrape /metrics, server-side distributions are skipped 无法读取服务器指标\n";
+    }
+
+    // 相同 seed 生成相同的 UUID, 重复运行时服务器走重连流程
+    const boost::uuids::uuid ns = boost::uuids::name_generator_sha1(boost::uuids::ns::url())("yline-swarm");
+    boost::uuids::name_generator_sha1 generator(ns);
+
+    std::vector<std::unique_ptr<SimWorker>> workers;
+    workers.reserve(options.workers);
+    for (std::size_t i = 0; i < options.workers; ++i)
+    {
+        auto worker = std::make_unique<SimWorker>();
+        worker->index = i;
+        worker->uuid = generator(std::format("{}-{}", options.seed, i));
+        worker->loop = pool.getNextLoop();
+        worker->address = options.server;
+        workers.push_back(std::move(worker));
+    }
+
+    Stats stats;
+    Swarm swarm(options, stats);
+
+    const auto start = Clock::now();
+    auto nextReport = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.reportInterval));
+    const auto progress = [&]() {
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << std::format(
+            "[{:7.1f}s] connected {}/{} registered {} failed {} closed {} | usage {} | dispatched {} finished {} rejected {} cancelled {}\n",
+            elapsed, stats.connected.load(), options.workers, stats.registered.load(), stats.failed.load(), stats.closed.load(),
+            stats.usage.load(), stats.dispatched.load(), stats.finished.load(), stats.rejected.load(), stats.cancelled.load()
+        );
+    };
+    const auto reportUntil = [&](Clock::time_point until) {
+        while (Clock::now() < until)
+        {
+            std::this_thread::sleep_until(std::min(until, nextReport));
+            if (Clock::now() >= nextReport)
+            {
+                progress();
+                nextReport += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.reportInterval));
+            }
+        }
+    };
+
+    // 按 connect-rate 逐个发起连接
+    for (std::size_t i = 0; i < workers.size(); ++i)
+    {
+        reportUntil(start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(static_cast<double>(i) / options.connectRate)
+        ));
+        SimWorker* worker = workers[i].get();
+        worker->loop->queueInLoop([&swarm, worker]() { swarm.connect(*worker); });
+    }
+    reportUntil(Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.duration)));
+    progress();
+
+    const auto metricsAfter = metricsBefore ? scrapeMetrics(options.server, pool.getNextLoop()) : std::nullopt;
+
+    // 在各自的 EventLoop 上停止所有工作机, 再结束线程, 之后才能释放工作机
+    std::vector<std::future<void>> stopped;
+    for (auto* loop : pool.getLoops())
+    {
+        auto done = std::make_shared<std::promise<void>>();
+        stopped.push_back(done->get_future());
+        loop->runInLoop([&swarm, &workers, loop, done]() {
+            for (auto& worker : workers)
+            {
+                if (worker->loop == loop)
+                {
+                    swarm.stop(*worker);
+                }
+            }
+            done->set_value();
+        });
+    }
+    for (auto& future : stopped)
+    {
+        future.wait();
+    }
+    for (auto* loop : pool.getLoops())
+    {
+        loop->quit();
+    }
+    pool.wait();
+
+    std::cout << std::format("\n{:<16}{:>10}{:>10}{:>10}{:>10}{:>10}  (ms, client side 客户端)\n", "", "count", "p50", "p99", "p999", "max");
+    const auto row = [](std::string_view name, std::vector<std::int64_t>& samples) {
+        const auto p = percentiles(samples);
+        std::cout << std::format("{:<16}{:>10}{:>10.2f}{:>10.2f}{:>10.2f}{:>10.2f}\n", name, p.count, p.p50, p.p99, p.p999, p.max);
+    };
+    row("register", stats.registerUs);
+    row("dispatch", stats.dispatchUs);
+
+    if (metricsBefore && metricsAfter)
+    {
+        std::cout << std::format("\n{:<16}{:>10}{:>10}{:>10}{:>10}  (ms, server /metrics 服务器, bucket upper bounds)\n", "", "count", "p50", "p99", "p999");
+        for (const auto& [label, name] : {
+                 std::pair<std::string_view, std::string>{"register", "yline_worker_register_duration_seconds"},
+                 std::pair<std::string_view, std::string>{"usage ingest", "yline_worker_usage_lag_seconds"},
+             })
+        {
+            printHistogramDelta(label, parseHistogram(*metricsBefore, name), parseHistogram(*metricsAfter, name));
+        }
+    }
+
+    return stats.failed == 0 && stats.closed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
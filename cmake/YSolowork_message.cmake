@@ -20,4 +20,6 @@ YSolowork_message("│ YSolowork_BUILD_TYPE      : ${YSolowork_BUILD_TYPE}")
 YSolowork_message("│ BUILD_YLINESERVER         : ${BUILD_YLINESERVER}")
 YSolowork_message("│ BUILD_YLINEWORKER         : ${BUILD_YLINEWORKER}")
 YSolowork_message("│ YSolowork_QUIET           : ${YSolowork_QUIET}")
+YSolowork_message("│ YLINE_LOG_ACTIVE_LEVEL    : ${YLINE_LOG_ACTIVE_LEVEL}")
+YSolowork_message("│ YLINE_BUILD_BENCHMARKS    : ${YLINE_BUILD_BENCHMARKS}")
 YSolowork_message("└───────────────────────────────────────")
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef UTartifact_H
+#define UTartifact_H
+
+#include <string_view>
+
+namespace YSolowork::util {
+
+/*
+任务产物 (渲染帧, 缓存等) 在服务器上的存储协议, YLineServer 与 YLineWorker 共用
+
+产物由 key 标识, 例如 "42/frames/0001.exr", 任务中以 artifact://<key> 引用
+上传分块进行, 每块附带自身的 SHA-256, 服务器按顺序追加, 中断后从服务器已收到的位置继续
+全部上传后以整个文件的 SHA-256 完成, 下载使用 Range 分段, 同样可以断点续传
+
+    GET  /api/artifact/status?key=        -> {"complete", "size", "sha256"}
+    PUT  /api/artifact/chunk?key=&offset=&sha256=   body 为数据块
+    POST /api/artifact/complete?key=&sha256=
+    GET  /api/artifact?key=               支持 Range: bytes=<begin>-<end>
+*/
+
+inline constexpr std::string_view ARTIFACT_SCHEME = "artifact://";
+
+// 工作机使用注册密钥访问产物接口
+inline constexpr std::string_view ARTIFACT_SECRET_HEADER = "X-YLine-Secret";
+
+// 函数: 是否为合法的产物 key: 以 '/' 分隔的若干段, 每段只包含字母, 数字, '-', '_', '.', 且不能是 "." 或 ".."
+bool isValidArtifactKey(std::string_view key);
+
+}
+
+#endif // UTartifact_H
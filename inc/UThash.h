@@ -0,0 +1,51 @@
+#ifndef UThash_H
+#define UThash_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace YSolowork::util {
+
+/*
+流式 SHA-256, 数据可以分多次传入, 大文件不需要一次读入内存
+
+    Sha256 hasher;
+    hasher.update(chunk1);
+    hasher.update(chunk2);
+    std::string hex = hasher.hexDigest();
+*/
+class Sha256 {
+public:
+    Sha256();
+
+    void update(const void* data, std::size_t len);
+    inline void update(std::string_view data) { update(data.data(), data.size()); }
+
+    // 结束计算, 返回 64 个字符的小写十六进制摘要; 之后需要 reset 才能复用
+    std::string hexDigest();
+
+    void reset();
+
+private:
+    std::array<std::uint32_t, 8> m_state;
+    std::array<std::uint8_t, 64> m_block;
+    std::size_t m_blockLen = 0;
+    std::uint64_t m_totalLen = 0;
+
+    void transform(const std::uint8_t* block);
+};
+
+// 函数: 计算文件的 SHA-256, 失败时返回空字符串并设置 ec
+std::string sha256File(const std::filesystem::path& path, std::error_code& ec);
+
+// 函数: 是否为合法的 SHA-256 十六进制摘要 (64 个小写十六进制字符)
+bool isSha256Hex(std::string_view hex);
+
+}
+
+#endif // UThash_H
@@ -0,0 +1,38 @@
+#ifndef UTlogFrame_H
+#define UTlogFrame_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace YSolowork::util {
+
+// 结构体: 任务日志分块的头部
+struct LogFrameHeader {
+    std::uint64_t delivery_tag = 0;
+    std::string task_id;
+    std::int64_t job_id = 0;
+    std::uint64_t generation = 0; // 分发时 Channel 的代数, 推测副本为 0
+    std::string stream;        // stdout / stderr
+    std::uint64_t seq = 0;     // 同一任务同一输出流内从 0 递增
+    std::uint64_t dropped = 0; // 自上一块以来因缓冲区溢出丢弃的字节数
+    bool eof = false;          // 最后一块
+};
+
+/*
+任务日志帧, 通过 WebSocket 二进制消息传输
+
+| magic "YLF1" | header 长度 (uint32, 大端) | header (紧凑 JSON) | payload (gzip 成员) |
+
+每块 payload 是一个完整的 gzip 成员, 按顺序直接拼接即为合法的多成员 gzip 文件, 服务器不需要解压
+*/
+
+// 函数: 编码日志帧
+std::string encodeLogFrame(const LogFrameHeader& header, std::string_view payload);
+
+// 函数: 解码日志帧, 失败时返回 false, payload 指向 frame 内部
+bool decodeLogFrame(std::string_view frame, LogFrameHeader& header, std::string_view& payload);
+
+}
+
+#endif // UTlogFrame_H
@@ -0,0 +1,99 @@
+#ifndef UTloopMonitor_H
+#define UTloopMonitor_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace trantor {
+class EventLoop;
+}
+
+namespace YSolowork::util {
+
+// 结构体: 事件循环卡顿
+struct LoopStall {
+    std::string loop;
+    double blocked = 0;              // 已经阻塞的秒数
+    std::vector<std::string> stack;  // 卡住时事件循环线程的调用栈, 不可用或被限流时为空
+};
+
+// 结构体: 一个汇总周期内事件循环的统计
+struct LoopSummary {
+    std::string loop;
+    double max_lag = 0;          // 定时器最大延迟 (秒)
+    double max_queue_delay = 0;  // queueInLoop 任务最大排队时间 (秒)
+    std::uint64_t stalls = 0;    // 卡顿次数
+};
+
+// 结构体: 事件循环监控选项
+struct LoopMonitorOptions {
+    double interval = 0.1;         // 探测间隔 (秒)
+    double stall_threshold = 0.5;  // 事件循环超过该时间 (秒) 没有响应视为卡顿
+    double log_interval = 60.0;    // 汇总间隔 (秒), 同一事件循环在一个汇总间隔内最多取一次调用栈
+
+    // 回调在监控线程调用, 不能阻塞
+    std::function<void(const LoopStall&)> on_stall;
+    std::function<void(const std::vector<LoopSummary>&)> on_summary;
+};
+
+/*
+事件循环监控, 发现阻塞事件循环的回调 (sleep, 忙等待, 同步等待 future 等)
+
+每个事件循环三个探测:
+    延迟 (lag)        事件循环上的定时器按 interval 触发, 实际触发时间与预期的差值
+    队列等待          监控线程通过 queueInLoop 投递探测任务, 从投递到执行的时间
+                      trantor 不公开任务队列长度, 排队时间反映了队列中积压的工作量
+    卡顿 (stall)      监控线程发现定时器超过 interval + stall_threshold 没有触发时,
+                      向事件循环线程发送信号取得调用栈, 定位阻塞的回调
+
+结果写入 UTmetrics 注册表 (yline_event_loop_*{loop="<name>"}), 卡顿和汇总通过回调交给调用方记录日志
+调用栈只在 Linux 上可用, 符号名需要可执行文件导出符号 (-rdynamic / ENABLE_EXPORTS)
+所有函数都可以在任意线程调用; 事件循环销毁之前需要调用 stop
+*/
+class LoopMonitor {
+public:
+    static LoopMonitor& instance();
+
+    LoopMonitor(const LoopMonitor&) = delete;
+    LoopMonitor& operator=(const LoopMonitor&) = delete;
+
+    // 在第一次 watch 之前调用
+    void setOptions(LoopMonitorOptions options);
+
+    // 开始监控事件循环, 第一次调用时启动监控线程
+    void watch(trantor::EventLoop* loop, const std::string& name);
+
+    // 停止监控线程, 之后不再访问任何事件循环
+    void stop();
+
+private:
+    LoopMonitor() = default;
+    ~LoopMonitor();
+
+    struct Probe;
+
+    LoopMonitorOptions m_options;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    bool m_stopping = false;
+    std::vector<std::shared_ptr<Probe>> m_probes;
+    std::thread m_watchdog;
+
+    // 监控线程
+    void run();
+
+    // 投递队列探测, 检查卡顿 (监控线程)
+    void inspect(Probe& probe, std::chrono::steady_clock::time_point now);
+};
+
+}
+
+#endif // UTloopMonitor_H
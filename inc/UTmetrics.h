@@ -0,0 +1,173 @@
+#ifndef UTmetrics_H
+#define UTmetrics_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace YSolowork::util {
+
+// 指标的分片数, 每个线程固定写入其中一个分片, 采集时汇总
+constexpr std::size_t METRIC_SHARDS = 16;
+
+// 标签, 按给定顺序输出
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+// 函数: 当前线程的分片号
+std::size_t metricShard() noexcept;
+
+/*
+计数器, 只增不减
+
+每个分片独占一个缓存行, 线程只写自己的分片 (relaxed 原子加), 不同线程之间没有锁和伪共享
+*/
+class Counter {
+public:
+    inline void inc(std::uint64_t n = 1) noexcept
+    {
+        m_shards[metricShard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    std::uint64_t value() const noexcept;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> value{0};
+    };
+    std::array<Shard, METRIC_SHARDS> m_shards;
+};
+
+// 可增可减的计量, 例如连接数
+class Gauge {
+public:
+    inline void add(std::int64_t n) noexcept
+    {
+        m_shards[metricShard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+    inline void inc() noexcept { add(1); }
+    inline void dec() noexcept { add(-1); }
+
+    std::int64_t value() const noexcept;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::int64_t> value{0};
+    };
+    std::array<Shard, METRIC_SHARDS> m_shards;
+};
+
+/*
+直方图, 桶的上界在创建时确定, 观测值落入第一个上界不小于它的桶
+
+采集时把各分片的计数累加为 Prometheus 的累计桶
+*/
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> bounds);
+
+    void observe(double value) noexcept;
+
+    // 记录从 start 到现在经过的秒数
+    inline void observeSince(std::chrono::steady_clock::time_point start) noexcept
+    {
+        observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    struct Snapshot {
+        std::vector<std::uint64_t> cumulative; // 与 bounds 对应, 最后多一个 +Inf
+        double sum = 0;
+        std::uint64_t count = 0;
+    };
+    Snapshot snapshot() const;
+
+    inline const std::vector<double>& bounds() const { return m_bounds; }
+
+private:
+    struct alignas(64) Shard {
+        std::unique_ptr<std::atomic<std::uint64_t>[]> buckets;
+        std::atomic<double> sum{0};
+    };
+    std::vector<double> m_bounds;
+    std::array<Shard, METRIC_SHARDS> m_shards;
+};
+
+// 函数: 延迟直方图的默认桶 (秒), 100us 到 10s
+std::vector<double> latencyBuckets();
+
+/*
+指标注册表, 以 Prometheus 文本格式输出
+
+    auto& requests = MetricsRegistry::instance().counter("app_requests_total", "Requests", {{"route", "/api"}});
+    requests.inc();
+
+同名同标签的指标只创建一次, 返回的引用在进程内一直有效, 调用方应缓存它, 不要在热路径上重复查找
+计量也可以注册为回调, 在采集时调用, 适合已经由其他结构维护的数量
+所有函数都可以在任意线程调用
+*/
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    Counter& counter(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+
+    Gauge& gauge(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+
+    Histogram& histogram(
+        const std::string& name,
+        const std::string& help,
+        const MetricLabels& labels = {},
+        std::vector<double> bounds = latencyBuckets()
+    );
+
+    // 采集时 (在注册表的锁外) 调用 callback 取值, 同名同标签重复注册时替换之前的回调
+    void gaugeCallback(
+        const std::string& name,
+        const std::string& help,
+        const MetricLabels& labels,
+        std::function<double()> callback
+    );
+
+    // Prometheus 文本格式 (text/plain; version=0.0.4)
+    std::string render() const;
+
+private:
+    MetricsRegistry() = default;
+
+    enum class Type { counter, gauge, histogram };
+
+    struct Series {
+        MetricLabels labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        std::function<double()> callback;
+    };
+
+    struct Family {
+        Type type;
+        std::string help;
+        std::map<std::string, Series> series; // 序列化的标签 -> 序列
+    };
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, Family> m_families;
+
+    // 查找或创建序列 (调用者持有锁), 类型不一致时抛出 std::logic_error
+    Series& seriesLocked(const std::string& name, const std::string& help, Type type, const MetricLabels& labels);
+};
+
+}
+
+#endif // UTmetrics_H
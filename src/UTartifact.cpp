@@ -0,0 +1,42 @@
+#include "UTartifact.h"
+
+#include <algorithm>
+
+namespace YSolowork::util {
+
+// 产物 key 的最大长度
+constexpr std::size_t ARTIFACT_KEY_MAX_LENGTH = 1024;
+
+bool isValidArtifactKey(std::string_view key)
+{
+    if (key.empty() || key.size() > ARTIFACT_KEY_MAX_LENGTH)
+    {
+        return false;
+    }
+
+    std::size_t begin = 0;
+    while (begin <= key.size())
+    {
+        const std::size_t end = std::min(key.find('/', begin), key.size());
+        const std::string_view segment = key.substr(begin, end - begin);
+        if (segment.empty() || segment == "." || segment == "..")
+        {
+            return false;
+        }
+        for (const char c : segment)
+        {
+            const bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+                || c == '-' || c == '_' || c == '.';
+            if (!safe)
+            {
+                return false;
+            }
+        }
+        begin = end + 1;
+    }
+
+    // 服务器在产物旁边存放 .part 和 .sha256 文件
+    return !key.ends_with(".part") && !key.ends_with(".sha256");
+}
+
+}
@@ -0,0 +1,186 @@
+#include "UThash.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+namespace YSolowork::util {
+
+namespace {
+
+constexpr std::array<std::uint32_t, 64> SHA256_K = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+constexpr std::uint32_t rotr(std::uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+// 读取文件时的缓冲区大小
+constexpr std::size_t HASH_FILE_BUFFER = 1024 * 1024;
+
+}
+
+Sha256::Sha256()
+{
+    reset();
+}
+
+void Sha256::reset()
+{
+    m_state = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    m_blockLen = 0;
+    m_totalLen = 0;
+}
+
+void Sha256::transform(const std::uint8_t* block)
+{
+    std::array<std::uint32_t, 64> w;
+    for (std::size_t i = 0; i < 16; ++i)
+    {
+        w[i] = (static_cast<std::uint32_t>(block[i * 4]) << 24)
+             | (static_cast<std::uint32_t>(block[i * 4 + 1]) << 16)
+             | (static_cast<std::uint32_t>(block[i * 4 + 2]) << 8)
+             | static_cast<std::uint32_t>(block[i * 4 + 3]);
+    }
+    for (std::size_t i = 16; i < 64; ++i)
+    {
+        const std::uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const std::uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    auto [a, b, c, d, e, f, g, h] = m_state;
+    for (std::size_t i = 0; i < 64; ++i)
+    {
+        const std::uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+        const std::uint32_t ch = (e & f) ^ (~e & g);
+        const std::uint32_t t1 = h + s1 + ch + SHA256_K[i] + w[i];
+        const std::uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+        const std::uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        const std::uint32_t t2 = s0 + maj;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    m_state[0] += a;
+    m_state[1] += b;
+    m_state[2] += c;
+    m_state[3] += d;
+    m_state[4] += e;
+    m_state[5] += f;
+    m_state[6] += g;
+    m_state[7] += h;
+}
+
+void Sha256::update(const void* data, std::size_t len)
+{
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    m_totalLen += len;
+
+    // 先补齐上次剩下的不完整块
+    if (m_blockLen > 0)
+    {
+        const std::size_t take = std::min(len, m_block.size() - m_blockLen);
+        std::copy_n(bytes, take, m_block.data() + m_blockLen);
+        m_blockLen += take;
+        bytes += take;
+        len -= take;
+        if (m_blockLen < m_block.size())
+        {
+            return;
+        }
+        transform(m_block.data());
+        m_blockLen = 0;
+    }
+
+    // 完整的块直接从输入中处理, 不复制
+    while (len >= m_block.size())
+    {
+        transform(bytes);
+        bytes += m_block.size();
+        len -= m_block.size();
+    }
+
+    std::copy_n(bytes, len, m_block.data());
+    m_blockLen = len;
+}
+
+std::string Sha256::hexDigest()
+{
+    const std::uint64_t bitLen = m_totalLen * 8;
+
+    // 填充: 0x80, 若干 0x00, 64 位大端长度
+    const std::uint8_t pad = 0x80;
+    update(&pad, 1);
+    const std::uint8_t zero = 0x00;
+    while (m_blockLen != 56)
+    {
+        update(&zero, 1);
+    }
+    std::array<std::uint8_t, 8> lenBytes;
+    for (std::size_t i = 0; i < 8; ++i)
+    {
+        lenBytes[i] = static_cast<std::uint8_t>(bitLen >> (56 - i * 8));
+    }
+    update(lenBytes.data(), lenBytes.size());
+
+    constexpr char HEX[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(64);
+    for (const auto word : m_state)
+    {
+        for (int shift = 28; shift >= 0; shift -= 4)
+        {
+            hex.push_back(HEX[(word >> shift) & 0xF]);
+        }
+    }
+    return hex;
+}
+
+std::string sha256File(const std::filesystem::path& path, std::error_code& ec)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        return {};
+    }
+
+    Sha256 hasher;
+    std::vector<char> buffer(HASH_FILE_BUFFER);
+    while (file)
+    {
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        hasher.update(buffer.data(), static_cast<std::size_t>(file.gcount()));
+    }
+    if (file.bad())
+    {
+        ec = std::make_error_code(std::errc::io_error);
+        return {};
+    }
+    return hasher.hexDigest();
+}
+
+bool isSha256Hex(std::string_view hex)
+{
+    return hex.size() == 64 && std::all_of(hex.begin(), hex.end(), [](char c) {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+    });
+}
+
+}
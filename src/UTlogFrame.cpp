@@ -0,0 +1,94 @@
+#include "UTlogFrame.h"
+
+#include <json/reader.h>
+#include <json/value.h>
+#include <json/writer.h>
+
+#include <memory>
+
+namespace YSolowork::util {
+
+namespace {
+
+constexpr std::string_view LOG_FRAME_MAGIC = "YLF1";
+constexpr std::size_t LOG_FRAME_PREFIX = LOG_FRAME_MAGIC.size() + 4;
+
+}
+
+std::string encodeLogFrame(const LogFrameHeader& header, std::string_view payload)
+{
+    Json::Value json;
+    json["delivery_tag"] = static_cast<Json::UInt64>(header.delivery_tag);
+    json["task_id"] = header.task_id;
+    json["job_id"] = static_cast<Json::Int64>(header.job_id);
+    json["generation"] = static_cast<Json::UInt64>(header.generation);
+    json["stream"] = header.stream;
+    json["seq"] = static_cast<Json::UInt64>(header.seq);
+    json["dropped"] = static_cast<Json::UInt64>(header.dropped);
+    json["eof"] = header.eof;
+
+    thread_local const Json::StreamWriterBuilder writer = []() {
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        return builder;
+    }();
+    const std::string headerStr = Json::writeString(writer, json);
+    const auto headerLen = static_cast<std::uint32_t>(headerStr.size());
+
+    std::string frame;
+    frame.reserve(LOG_FRAME_PREFIX + headerStr.size() + payload.size());
+    frame.append(LOG_FRAME_MAGIC);
+    frame.push_back(static_cast<char>((headerLen >> 24) & 0xFF));
+    frame.push_back(static_cast<char>((headerLen >> 16) & 0xFF));
+    frame.push_back(static_cast<char>((headerLen >> 8) & 0xFF));
+    frame.push_back(static_cast<char>(headerLen & 0xFF));
+    frame.append(headerStr);
+    frame.append(payload);
+    return frame;
+}
+
+bool decodeLogFrame(std::string_view frame, LogFrameHeader& header, std::string_view& payload)
+{
+    if (frame.size() < LOG_FRAME_PREFIX || frame.substr(0, LOG_FRAME_MAGIC.size()) != LOG_FRAME_MAGIC)
+    {
+        return false;
+    }
+
+    const auto* len = reinterpret_cast<const unsigned char*>(frame.data() + LOG_FRAME_MAGIC.size());
+    const std::uint32_t headerLen =
+        (static_cast<std::uint32_t>(len[0]) << 24) |
+        (static_cast<std::uint32_t>(len[1]) << 16) |
+        (static_cast<std::uint32_t>(len[2]) << 8) |
+        static_cast<std::uint32_t>(len[3]);
+    if (frame.size() - LOG_FRAME_PREFIX < headerLen)
+    {
+        return false;
+    }
+
+    thread_local const std::unique_ptr<Json::CharReader> reader(Json::CharReaderBuilder().newCharReader());
+    const char* begin = frame.data() + LOG_FRAME_PREFIX;
+    Json::Value json;
+    std::string errs;
+    if (!reader->parse(begin, begin + headerLen, &json, &errs) || !json.isObject())
+    {
+        return false;
+    }
+    if (!json["delivery_tag"].isUInt64() || !json["stream"].isString() || !json["seq"].isUInt64())
+    {
+        return false;
+    }
+
+    header.delivery_tag = json["delivery_tag"].asUInt64();
+    header.task_id = json["task_id"].asString();
+    header.job_id = json["job_id"].asInt64();
+    header.generation = json["generation"].asUInt64();
+    header.stream = json["stream"].asString();
+    header.seq = json["seq"].asUInt64();
+    header.dropped = json["dropped"].asUInt64();
+    header.eof = json["eof"].asBool();
+
+    payload = frame.substr(LOG_FRAME_PREFIX + headerLen);
+    return true;
+}
+
+}
@@ -0,0 +1,350 @@
+#include "UTloopMonitor.h"
+#include "UTmetrics.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include <trantor/net/EventLoop.h>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <execinfo.h>
+#include <pthread.h>
+#endif
+
+namespace YSolowork::util {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+double toSeconds(std::int64_t ns)
+{
+    return static_cast<double>(ns) / 1e9;
+}
+
+// 原子地更新最大值
+void updateMax(std::atomic<std::int64_t>& target, std::int64_t value)
+{
+    auto current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+// 事件循环延迟的桶 (秒), 1ms 到 30s, 比请求延迟更关注长尾
+std::vector<double> lagBuckets()
+{
+    return {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30};
+}
+
+#if defined(__linux__)
+
+// 取调用栈: 向目标线程发送信号, 信号处理函数在目标线程上调用 backtrace 写入全局缓冲区
+// 只有监控线程会发起请求, 同一时间最多一个请求
+constexpr int STACK_SIGNAL = SIGUSR2;
+constexpr int STACK_DEPTH = 48;
+
+void* stackFrames[STACK_DEPTH];
+std::atomic<int> stackDepth{-1};
+
+void onStackSignal(int)
+{
+    const int savedErrno = errno;
+    stackDepth.store(backtrace(stackFrames, STACK_DEPTH), std::memory_order_release);
+    errno = savedErrno;
+}
+
+void installStackHandler()
+{
+    static std::once_flag once;
+    std::call_once(once, [] {
+        // backtrace 第一次调用时会加载 libgcc, 这一步不是异步信号安全的, 提前在这里完成
+        void* warmup[1];
+        backtrace(warmup, 1);
+
+        struct sigaction action{};
+        action.sa_handler = onStackSignal;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(STACK_SIGNAL, &action, nullptr);
+    });
+}
+
+std::vector<std::string> captureStack(pthread_t thread)
+{
+    stackDepth.store(-1, std::memory_order_relaxed);
+    if (pthread_kill(thread, STACK_SIGNAL) != 0)
+    {
+        return {};
+    }
+
+    // 等待信号处理函数完成, 最多 100ms
+    int depth = -1;
+    for (int i = 0; i < 100; ++i)
+    {
+        depth = stackDepth.load(std::memory_order_acquire);
+        if (depth >= 0)
+        {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (depth <= 0)
+    {
+        return {};
+    }
+
+    std::vector<std::string> stack;
+    char** symbols = backtrace_symbols(stackFrames, depth);
+    if (symbols == nullptr)
+    {
+        return {};
+    }
+    // 跳过信号处理函数和信号跳板自身的两帧
+    for (int i = std::min(depth, 2); i < depth; ++i)
+    {
+        stack.emplace_back(symbols[i]);
+    }
+    std::free(symbols);
+    return stack;
+}
+
+#endif
+
+}
+
+struct LoopMonitor::Probe {
+    std::string name;
+    trantor::EventLoop* loop = nullptr;
+
+    Histogram& lag;
+    Histogram& queueDelay;
+    Counter& stalls;
+
+    // 事件循环线程写入, 监控线程读取
+    std::atomic<std::int64_t> lastTick{0};  // 定时器上一次触发的时间, 0 表示还没有触发过
+    std::atomic<bool> queuePending{false};  // 上一个队列探测还没有执行
+    std::atomic<std::int64_t> maxLag{0};
+    std::atomic<std::int64_t> maxQueueDelay{0};
+    std::atomic<std::uint64_t> windowStalls{0};
+
+    // 只在事件循环线程访问
+    std::int64_t expectedTick = 0;
+
+#if defined(__linux__)
+    pthread_t thread{};
+    std::atomic<bool> threadKnown{false};
+#endif
+
+    // 只在监控线程访问
+    bool stalled = false;
+    Clock::time_point lastStack{};
+};
+
+LoopMonitor& LoopMonitor::instance()
+{
+    static LoopMonitor monitor;
+    return monitor;
+}
+
+LoopMonitor::~LoopMonitor()
+{
+    stop();
+}
+
+void LoopMonitor::setOptions(LoopMonitorOptions options)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_options = std::move(options);
+}
+
+void LoopMonitor::watch(trantor::EventLoop* loop, const std::string& name)
+{
+    auto& registry = MetricsRegistry::instance();
+    const MetricLabels labels{{"loop", name}};
+    // Probe 含有原子成员, 不能移动, 直接聚合初始化
+    auto probe = std::shared_ptr<Probe>(new Probe{
+        name,
+        loop,
+        registry.histogram(
+            "yline_event_loop_lag_seconds",
+            "Delay between scheduled and actual firing of the event loop probe timer",
+            labels,
+            lagBuckets()
+        ),
+        registry.histogram(
+            "yline_event_loop_queue_delay_seconds",
+            "Time a task posted with queueInLoop waits before it runs",
+            labels,
+            lagBuckets()
+        ),
+        registry.counter(
+            "yline_event_loop_stalls_total",
+            "Times the event loop did not respond within the stall threshold",
+            labels
+        ),
+    });
+
+    double interval;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping)
+        {
+            return;
+        }
+        interval = m_options.interval;
+        m_probes.push_back(probe);
+        if (!m_watchdog.joinable())
+        {
+#if defined(__linux__)
+            installStackHandler();
+#endif
+            m_watchdog = std::thread(&LoopMonitor::run, this);
+        }
+    }
+
+    const auto intervalNs = static_cast<std::int64_t>(interval * 1e9);
+    loop->runInLoop([probe, interval, intervalNs] {
+#if defined(__linux__)
+        probe->thread = pthread_self();
+        probe->threadKnown.store(true, std::memory_order_release);
+#endif
+        probe->expectedTick = nowNs() + intervalNs;
+        probe->lastTick.store(nowNs(), std::memory_order_relaxed);
+        probe->loop->runEvery(interval, [probe, intervalNs] {
+            const auto now = nowNs();
+            const auto lag = std::max<std::int64_t>(0, now - probe->expectedTick);
+            probe->expectedTick = now + intervalNs;
+            probe->lastTick.store(now, std::memory_order_relaxed);
+            probe->lag.observe(toSeconds(lag));
+            updateMax(probe->maxLag, lag);
+        });
+    });
+}
+
+void LoopMonitor::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeup.notify_all();
+    if (m_watchdog.joinable() && m_watchdog.get_id() != std::this_thread::get_id())
+    {
+        m_watchdog.join();
+    }
+}
+
+void LoopMonitor::inspect(Probe& probe, Clock::time_point now)
+{
+    // 队列探测: 上一个探测还在排队时不再投递, 避免在卡住的事件循环上堆积
+    if (!probe.queuePending.exchange(true, std::memory_order_acq_rel))
+    {
+        const auto posted = nowNs();
+        auto* target = &probe;
+        probe.loop->queueInLoop([target, posted] {
+            const auto delay = nowNs() - posted;
+            target->queueDelay.observe(toSeconds(delay));
+            updateMax(target->maxQueueDelay, delay);
+            target->queuePending.store(false, std::memory_order_release);
+        });
+    }
+
+    const auto lastTick = probe.lastTick.load(std::memory_order_relaxed);
+    if (lastTick == 0)
+    {
+        // 事件循环还没有开始运行
+        return;
+    }
+
+    const double blocked = toSeconds(nowNs() - lastTick);
+    if (blocked <= m_options.interval + m_options.stall_threshold)
+    {
+        probe.stalled = false;
+        return;
+    }
+    if (probe.stalled)
+    {
+        // 同一次卡顿只报告一次
+        return;
+    }
+    probe.stalled = true;
+    probe.stalls.inc();
+    probe.windowStalls.fetch_add(1, std::memory_order_relaxed);
+
+    LoopStall stall{probe.name, blocked, {}};
+#if defined(__linux__)
+    const auto stackInterval = std::chrono::duration<double>(m_options.log_interval);
+    if (probe.threadKnown.load(std::memory_order_acquire)
+        && (probe.lastStack == Clock::time_point{} || now - probe.lastStack >= stackInterval))
+    {
+        probe.lastStack = now;
+        stall.stack = captureStack(probe.thread);
+    }
+#endif
+    if (m_options.on_stall)
+    {
+        m_options.on_stall(stall);
+    }
+}
+
+void LoopMonitor::run()
+{
+    auto nextSummary = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(m_options.log_interval)
+    );
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping)
+    {
+        m_wakeup.wait_for(lock, std::chrono::duration<double>(m_options.interval), [this] { return m_stopping; });
+        if (m_stopping)
+        {
+            break;
+        }
+
+        // 探测和回调在锁外执行, 回调可能很慢 (写日志), 不应该阻塞 watch
+        const auto probes = m_probes;
+        lock.unlock();
+
+        const auto now = Clock::now();
+        for (const auto& probe : probes)
+        {
+            inspect(*probe, now);
+        }
+
+        if (m_options.log_interval > 0 && now >= nextSummary)
+        {
+            nextSummary = now + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(m_options.log_interval)
+            );
+            std::vector<LoopSummary> summaries;
+            summaries.reserve(probes.size());
+            for (const auto& probe : probes)
+            {
+                summaries.push_back(LoopSummary{
+                    probe->name,
+                    toSeconds(probe->maxLag.exchange(0, std::memory_order_relaxed)),
+                    toSeconds(probe->maxQueueDelay.exchange(0, std::memory_order_relaxed)),
+                    probe->windowStalls.exchange(0, std::memory_order_relaxed),
+                });
+            }
+            if (m_options.on_summary)
+            {
+                m_options.on_summary(summaries);
+            }
+        }
+
+        lock.lock();
+    }
+}
+
+}
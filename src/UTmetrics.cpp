@@ -0,0 +1,278 @@
+#include "UTmetrics.h"
+
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+
+namespace YSolowork::util {
+
+namespace {
+
+std::atomic<std::size_t> nextShard{0};
+
+// 标签值转义: 反斜杠, 双引号, 换行
+std::string escapeLabelValue(const std::string& value)
+{
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (const char c : value)
+    {
+        switch (c)
+        {
+        case '\\': escaped += "\\\\"; break;
+        case '"': escaped += "\\\""; break;
+        case '\n': escaped += "\\n"; break;
+        default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// {a="1",b="2"}, extra 为直方图的 le 标签
+std::string formatLabels(const MetricLabels& labels, const std::string& extra = {})
+{
+    if (labels.empty() && extra.empty())
+    {
+        return {};
+    }
+    std::string out = "{";
+    for (const auto& [key, value] : labels)
+    {
+        if (out.size() > 1)
+        {
+            out += ',';
+        }
+        out += std::format("{}=\"{}\"", key, escapeLabelValue(value));
+    }
+    if (!extra.empty())
+    {
+        if (out.size() > 1)
+        {
+            out += ',';
+        }
+        out += extra;
+    }
+    out += '}';
+    return out;
+}
+
+std::string formatValue(double value)
+{
+    if (value > -1e15 && value < 1e15 && value == static_cast<double>(static_cast<std::int64_t>(value)))
+    {
+        return std::to_string(static_cast<std::int64_t>(value));
+    }
+    return std::format("{}", value);
+}
+
+}
+
+std::size_t metricShard() noexcept
+{
+    thread_local const std::size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+    return shard;
+}
+
+std::uint64_t Counter::value() const noexcept
+{
+    std::uint64_t total = 0;
+    for (const auto& shard : m_shards)
+    {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::int64_t Gauge::value() const noexcept
+{
+    std::int64_t total = 0;
+    for (const auto& shard : m_shards)
+    {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+Histogram::Histogram(std::vector<double> bounds)
+    : m_bounds(std::move(bounds))
+{
+    std::sort(m_bounds.begin(), m_bounds.end());
+    m_bounds.erase(std::unique(m_bounds.begin(), m_bounds.end()), m_bounds.end());
+    for (auto& shard : m_shards)
+    {
+        // 最后一个桶为 +Inf
+        shard.buckets = std::make_unique<std::atomic<std::uint64_t>[]>(m_bounds.size() + 1);
+    }
+}
+
+void Histogram::observe(double value) noexcept
+{
+    const auto bucket = static_cast<std::size_t>(
+        std::lower_bound(m_bounds.begin(), m_bounds.end(), value) - m_bounds.begin()
+    );
+    auto& shard = m_shards[metricShard()];
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const
+{
+    Snapshot snapshot;
+    snapshot.cumulative.assign(m_bounds.size() + 1, 0);
+    for (const auto& shard : m_shards)
+    {
+        for (std::size_t i = 0; i <= m_bounds.size(); ++i)
+        {
+            snapshot.cumulative[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+        snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    for (std::size_t i = 1; i < snapshot.cumulative.size(); ++i)
+    {
+        snapshot.cumulative[i] += snapshot.cumulative[i - 1];
+    }
+    snapshot.count = snapshot.cumulative.back();
+    return snapshot;
+}
+
+std::vector<double> latencyBuckets()
+{
+    return {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+}
+
+MetricsRegistry& MetricsRegistry::instance()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Series& MetricsRegistry::seriesLocked(
+    const std::string& name,
+    const std::string& help,
+    Type type,
+    const MetricLabels& labels
+)
+{
+    auto [familyIt, created] = m_families.try_emplace(name, Family{type, help, {}});
+    if (!created && familyIt->second.type != type)
+    {
+        throw std::logic_error("Metric " + name + " registered with a different type");
+    }
+    auto [seriesIt, _] = familyIt->second.series.try_emplace(formatLabels(labels));
+    seriesIt->second.labels = labels;
+    return seriesIt->second;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const MetricLabels& labels)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& series = seriesLocked(name, help, Type::counter, labels);
+    if (!series.counter)
+    {
+        series.counter = std::make_unique<Counter>();
+    }
+    return *series.counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const MetricLabels& labels)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& series = seriesLocked(name, help, Type::gauge, labels);
+    if (!series.gauge)
+    {
+        series.gauge = std::make_unique<Gauge>();
+    }
+    return *series.gauge;
+}
+
+Histogram& MetricsRegistry::histogram(
+    const std::string& name,
+    const std::string& help,
+    const MetricLabels& labels,
+    std::vector<double> bounds
+)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& series = seriesLocked(name, help, Type::histogram, labels);
+    if (!series.histogram)
+    {
+        series.histogram = std::make_unique<Histogram>(std::move(bounds));
+    }
+    return *series.histogram;
+}
+
+void MetricsRegistry::gaugeCallback(
+    const std::string& name,
+    const std::string& help,
+    const MetricLabels& labels,
+    std::function<double()> callback
+)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    seriesLocked(name, help, Type::gauge, labels).callback = std::move(callback);
+}
+
+std::string MetricsRegistry::render() const
+{
+    // 回调在锁外调用, 回调可能需要获取其他锁, 而持有那些锁的线程可能正在注册指标
+    // 序列创建后不会被移除, 指针一直有效
+    std::vector<std::pair<const Series*, std::function<double()>>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& [name, family] : m_families)
+        {
+            for (const auto& [labelStr, series] : family.series)
+            {
+                if (series.callback)
+                {
+                    callbacks.emplace_back(&series, series.callback);
+                }
+            }
+        }
+    }
+    std::map<const Series*, double> values;
+    for (const auto& [series, callback] : callbacks)
+    {
+        values[series] = callback();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string out;
+    for (const auto& [name, family] : m_families)
+    {
+        const char* type = family.type == Type::counter ? "counter"
+                         : family.type == Type::gauge ? "gauge"
+                         : "histogram";
+        out += std::format("# HELP {} {}\n# TYPE {} {}\n", name, family.help, name, type);
+        for (const auto& [labelStr, series] : family.series)
+        {
+            if (series.counter)
+            {
+                out += std::format("{}{} {}\n", name, labelStr, series.counter->value());
+            }
+            else if (series.histogram)
+            {
+                const auto snapshot = series.histogram->snapshot();
+                const auto& bounds = series.histogram->bounds();
+                for (std::size_t i = 0; i < snapshot.cumulative.size(); ++i)
+                {
+                    const std::string le = i < bounds.size() ? std::format("le=\"{}\"", bounds[i]) : "le=\"+Inf\"";
+                    out += std::format("{}_bucket{} {}\n", name, formatLabels(series.labels, le), snapshot.cumulative[i]);
+                }
+                out += std::format("{}_sum{} {}\n", name, labelStr, formatValue(snapshot.sum));
+                out += std::format("{}_count{} {}\n", name, labelStr, snapshot.count);
+            }
+            else
+            {
+                const auto callbackValue = values.find(&series);
+                const double value = callbackValue != values.end() ? callbackValue->second
+                                   : series.gauge ? static_cast<double>(series.gauge->value())
+                                   : 0.0;
+                out += std::format("{}{} {}\n", name, labelStr, formatValue(value));
+            }
+        }
+    }
+    return out;
+}
+
+}
@@ -1,3 +1,3 @@
 @echo off
 echo Running CMake with Ninja generator...
-cmake -G Ninja -B target -DCMAKE_EXPORT_COMPILE_COMMANDS=ON -DUSE_SPDLOG=ON -DBUILD_SQLITE=OFF -DBUILD_EXAMPLES=OFF -DBUILD_YAML_CONFIG=OFF -DCMAKE_BUILD_TYPE=Release
+cmake -G Ninja -B target -DCMAKE_EXPORT_COMPILE_COMMANDS=ON -DUSE_SPDLOG=ON -DBUILD_SQLITE=OFF -DBUILD_EXAMPLES=OFF -DBUILD_YAML_CONFIG=OFF -DCMAKE_BUILD_TYPE=Release -DYLINE_LOG_ACTIVE_LEVEL=INFO